@@ -6,4 +6,44 @@ struct bpf_iter_target_info {
 	struct list_head list;
 	const struct bpf_iter_reg *reg_info;
 	u32 btf_id;	/* cached value */
-};
\ No newline at end of file
+};
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,9,0)
+// ripped from https://elixir.bootlin.com/linux/v6.1/source/kernel/bpf/bpf_iter.c#L23
+struct bpf_iter_link {
+	struct bpf_link link;
+	struct bpf_iter_aux_info aux;
+	struct bpf_iter_target_info *tinfo;
+};
+
+// ripped from https://elixir.bootlin.com/linux/v6.1/source/kernel/bpf/net_namespace.c#L13
+struct bpf_netns_link {
+	struct bpf_link	link;
+	enum bpf_attach_type type;
+	enum netns_bpf_attach_type netns_type;
+
+	/* We don't hold a ref to net in order to auto-detach the link
+	 * when netns is going away. Instead we rely on pernet
+	 * pre_exit callback to clear this pointer. Must be accessed
+	 * with netns_bpf_mutex held.
+	 */
+	struct net *net;
+	struct list_head node; /* node in list of links attached to net */
+};
+#endif
+
+// ripped from https://elixir.bootlin.com/linux/v6.1/source/kernel/bpf/syscall.c#L2836
+// since 6.10 it is in include/linux/bpf.h
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,10,0)
+struct bpf_raw_tp_link {
+	struct bpf_link link;
+	struct bpf_raw_event_map *btp;
+};
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,15,0)
+// ripped from https://elixir.bootlin.com/linux/v6.1/source/kernel/bpf/syscall.c#L3054
+struct bpf_perf_link {
+	struct bpf_link link;
+	struct file *perf_file;
+};
+#endif
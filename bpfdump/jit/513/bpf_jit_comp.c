@@ -389,7 +389,7 @@ int bpf_arch_text_poke(void *ip, enum bpf_text_poke_type t,
 		/* BPF poking in modules is not supported */
 		return -EINVAL;
 #ifdef _DEBUG
- printf("bpf_arch_text_poke %p\n", ip);
+ jlog(2, "bpf_arch_text_poke %p\n", ip);
 #endif
 	return __bpf_arch_text_poke(ip, t, old_addr, new_addr, true);
 }
@@ -2233,7 +2233,7 @@ struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 
 	tmp = bpf_jit_blind_constants(prog);
 #ifdef _DEBUG
- printf("after bpf_jit_blind_constants\n"); fflush(stdout);
+ jlog(2, "after bpf_jit_blind_constants\n");
 #endif
 	/*
 	 * If blinding was requested and we failed during blinding,
@@ -2,7 +2,8 @@
 #include <linux/bpf.h>
 
 extern int bpf_jit_enable;
-extern u64 __bpf_call_base;
+// per thread - filled from jit_ctx in bpf_jit_binary_alloc
+extern __thread u64 __bpf_call_base;
 
 #define MAX_BPF_FUNC_REG_ARGS 5
 #define MAX_BPF_FUNC_ARGS 12
@@ -604,6 +605,7 @@ bpf_jit_binary_alloc(unsigned int proglen, u8 **image_ptr,
 		     bpf_jit_fill_hole_t bpf_fill_ill_insns);
 void bpf_jit_binary_free(struct bpf_binary_header *hdr);
 void bpf_jit_binary_lock_ro(struct bpf_binary_header *hdr);
+struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog);
 void bpf_jit_prog_release_other(struct bpf_prog *fp, struct bpf_prog *fp_other);
 void bpf_prog_unlock_free(struct bpf_prog *fp);
 bool is_bpf_text_address(unsigned long addr);
@@ -619,4 +621,4 @@ int bpf_jit_get_func_addr(const struct bpf_prog *prog,
 
 void text_poke_bp(void *addr, const void *opcode, size_t len, const void *emulate);
 int is_kernel_text(unsigned long addr);
-extern void * __bpf_prog_enter, *__bpf_prog_exit, *__bpf_prog_enter_sleepable, *__bpf_prog_exit_sleepable, *__bpf_tramp_enter, *__bpf_tramp_exit;
+extern __thread void * __bpf_prog_enter, *__bpf_prog_exit, *__bpf_prog_enter_sleepable, *__bpf_prog_exit_sleepable, *__bpf_tramp_enter, *__bpf_tramp_exit;
@@ -330,7 +330,7 @@ int bpf_arch_text_poke(void *ip, enum bpf_text_poke_type t,
 		/* BPF poking in modules is not supported */
 		return -EINVAL;
 #ifdef _DEBUG
- printf("bpf_arch_text_poke %p\n", ip);
+ jlog(2, "bpf_arch_text_poke %p\n", ip);
 #endif
 	return __bpf_arch_text_poke(ip, t, old_addr, new_addr, true);
 }
@@ -1102,7 +1102,7 @@ xadd:			if (is_imm8(insn->off))
 		case BPF_JMP | BPF_CALL:
 			func = (u8 *) __bpf_call_base + imm32;
 #ifdef _DEBUG
-                        printf("func %p imm32 %X __bpf_call_base %p\n", func, imm32, __bpf_call_base);
+                        jlog(2, "func %p imm32 %X __bpf_call_base %p\n", func, imm32, (void *)__bpf_call_base);
 #endif
 			if (!imm32 || emit_call(&prog, func, image + addrs[i - 1]))
 				return -EINVAL;
@@ -1382,7 +1382,7 @@ static int invoke_bpf(const struct btf_func_model *m, u8 **pprog,
 	int cnt = 0, i;
 
 #ifdef _DEBUG
- printf("invoke_bpf prog %p prog_cnt %d\n", prog, prog_cnt);
+ jlog(2, "invoke_bpf prog %p prog_cnt %d\n", prog, prog_cnt);
 #endif
 
 	for (i = 0; i < prog_cnt; i++) {
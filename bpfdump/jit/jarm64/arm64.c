@@ -22,7 +22,7 @@
 
 bool cpus_have_cap(unsigned int num)
 {
-  printf("cpus_have_cap(%d)\n", num);
+  jlog(2, "cpus_have_cap(%d)\n", num);
   return 0;
 }
 
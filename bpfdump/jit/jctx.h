@@ -0,0 +1,45 @@
+#pragma once
+// context of user-space JIT compilation
+// JIT sources were written for kernel and read call base as globals. they are thread-local now and
+// filled from context of compilation, so several contexts can compile concurrently in different threads
+
+#if __cplusplus
+ extern "C" {
+#endif
+
+struct bpf_prog;
+
+// counters of all compilations with context, not reset by jit_ctx_release
+struct jit_stat
+{
+  unsigned long compiled;
+  unsigned long failed;
+  unsigned long bytes; // of images
+  unsigned long ns;    // spent inside JIT
+};
+
+struct jit_ctx
+{
+  // absolute addresses in real kernel
+  unsigned long call_base;
+  unsigned long enter;
+  unsigned long ex;
+  // address of image in kernel, calls are encoded relative to it
+  void *orig_jit_addr;
+  // arena for scratch memory and images, see jmem.h
+  void *mem;
+  // 0 - quiet, 1 - result of each compilation, 2 - JIT internals
+  int verbose;
+  struct jit_stat stat;
+};
+
+// exported from JIT shims
+struct bpf_prog *jit_compile_ctx(struct jit_ctx *, struct bpf_prog *);
+// release images and scratch memory of all compilations with context, arena is kept for reuse
+void jit_ctx_release(struct jit_ctx *);
+// free arena of context
+void jit_ctx_destroy(struct jit_ctx *);
+
+#if __cplusplus
+};
+#endif
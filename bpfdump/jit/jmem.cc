@@ -1,25 +1,95 @@
-#include <set>
 #include <stdlib.h>
+#include <vector>
 #include "jmem.h"
 
-std::set<void *> s_stg;
+struct jchunk
+{
+  char *base;
+  size_t size;
+};
+
+struct jarena
+{
+  std::vector<jchunk> chunks;
+  char *cur;
+  char *end;
+};
+
+static const size_t s_chunk = 256 * 1024;
+
+void *jmem_create()
+{
+  jarena *a = new jarena;
+  a->cur = a->end = NULL;
+  return a;
+}
 
-void jmem_store(void *addr)
+static char *new_chunk(jarena *a, size_t size)
 {
-  s_stg.insert(addr);
+  char *base = (char *)malloc(size);
+  if ( base == NULL )
+    return NULL;
+  a->chunks.push_back({ base, size });
+  return base;
 }
 
-void jmem_remove(void *addr)
+void *jmem_alloc(void *stg, size_t size)
 {
-  auto a = s_stg.find(addr);
-  if ( a == s_stg.end() )
-    return;
-  s_stg.erase(addr);
+  jarena *a = (jarena *)stg;
+  size = (size + 15) & ~(size_t)15;
+  if ( size <= (size_t)(a->end - a->cur) )
+  {
+    char *res = a->cur;
+    a->cur += size;
+    return res;
+  }
+  // big blocks get own chunk and current one is not wasted
+  if ( size > s_chunk / 4 )
+    return new_chunk(a, size);
+  char *base = new_chunk(a, s_chunk);
+  if ( base == NULL )
+    return NULL;
+  a->cur = base + size;
+  a->end = base + s_chunk;
+  return base;
 }
 
-void jmem_clear()
+int jmem_owns(void *stg, const void *addr)
 {
-  for ( auto addr: s_stg )
-    free(addr);
-  s_stg.clear();
-}
\ No newline at end of file
+  jarena *a = (jarena *)stg;
+  for ( auto &c: a->chunks )
+    if ( (const char *)addr >= c.base && (const char *)addr < c.base + c.size )
+      return 1;
+  return 0;
+}
+
+void jmem_reset(void *stg)
+{
+  jarena *a = (jarena *)stg;
+  // keep first regular chunk
+  size_t kept = 0;
+  for ( auto &c: a->chunks )
+  {
+    if ( !kept && c.size == s_chunk )
+    {
+      a->chunks[kept++] = c;
+      continue;
+    }
+    free(c.base);
+  }
+  a->chunks.resize(kept);
+  if ( kept )
+  {
+    a->cur = a->chunks[0].base;
+    a->end = a->cur + s_chunk;
+  } else
+    a->cur = a->end = NULL;
+}
+
+void jmem_destroy(void *stg)
+{
+  jarena *a = (jarena *)stg;
+  for ( auto &c: a->chunks )
+    free(c.base);
+  delete a;
+}
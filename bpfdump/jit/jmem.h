@@ -1,13 +1,20 @@
 #pragma once
+#include <stddef.h>
 
 #if __cplusplus
  extern "C" {
 #endif
 
-void jmem_store(void *addr);
-void jmem_remove(void *addr);
-void jmem_clear();
+// bump arena of one jit_ctx: scratch memory and images of compilation are never freed one by one,
+// everything is released at once after image was compared
+void *jmem_create();
+// 16-byte aligned, not zeroed
+void *jmem_alloc(void *stg, size_t size);
+int jmem_owns(void *stg, const void *addr);
+// release all allocations, first chunk is kept for next compilation
+void jmem_reset(void *stg);
+void jmem_destroy(void *stg);
 
 #if __cplusplus
 };
-#endif
\ No newline at end of file
+#endif
@@ -1,7 +1,10 @@
 #include "types.h"
 #include "bpf.h"
+#include <stdarg.h>
 #include <stdlib.h>
+#include <time.h>
 #include "jmem.h"
+#include "jctx.h"
 
 #define PAGE_SIZE 	0x1000
 #define MAX_ERRNO	4095
@@ -35,71 +38,157 @@ static inline void *ERR_PTR(long error)
 }
 
 int bpf_jit_enable = 1;
-u64 __bpf_call_base = 0;
-void *__bpf_prog_enter = 0;
-void *__bpf_prog_exit = 0;
-void *__bpf_prog_enter_sleepable = 0;
-void *__bpf_prog_exit_sleepable = 0;
-void *__bpf_tramp_enter = 0;
-void *__bpf_tramp_exit = 0;
-// absolute values in real kernel
-static u64 _base = 0;
-static u64 _enter = 0;
-static u64 _ex = 0;
-static char *original_jit_addr = NULL;
+// JIT code reads them as globals, so they are per thread and relative to current image
+__thread u64 __bpf_call_base = 0;
+__thread void *__bpf_prog_enter = 0;
+__thread void *__bpf_prog_exit = 0;
+__thread void *__bpf_prog_enter_sleepable = 0;
+__thread void *__bpf_prog_exit_sleepable = 0;
+__thread void *__bpf_tramp_enter = 0;
+__thread void *__bpf_tramp_exit = 0;
+// context of compilation running in this thread
+static __thread struct jit_ctx *s_ctx = NULL;
+// log of current compilation, written with single fwrite when full or at end of compilation
+static __thread char s_log[8192];
+static __thread size_t s_log_len = 0;
+
+static void jlog_flush()
+{
+  if ( !s_log_len )
+    return;
+  fwrite(s_log, 1, s_log_len, stdout);
+  s_log_len = 0;
+}
+
+void jlog(int level, const char *fmt, ...)
+{
+  va_list args;
+  int len;
+  if ( s_ctx == NULL || s_ctx->verbose < level )
+    return;
+  va_start(args, fmt);
+  len = vsnprintf(s_log + s_log_len, sizeof(s_log) - s_log_len, fmt, args);
+  va_end(args);
+  if ( len < 0 )
+    return;
+  if ( s_log_len + len < sizeof(s_log) )
+  {
+    s_log_len += len;
+    return;
+  }
+  // does not fit, flush and format again
+  jlog_flush();
+  va_start(args, fmt);
+  len = vsnprintf(s_log, sizeof(s_log), fmt, args);
+  va_end(args);
+  if ( len > 0 )
+    s_log_len = len < sizeof(s_log) ? len : sizeof(s_log) - 1;
+}
+
+static unsigned long now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+struct bpf_prog *jit_compile_ctx(struct jit_ctx *ctx, struct bpf_prog *prog)
+{
+  struct bpf_prog *res;
+  unsigned long start = now_ns();
+  s_ctx = ctx;
+  res = bpf_int_jit_compile(prog);
+  ctx->stat.ns += now_ns() - start;
+  if ( res != NULL && res->jited && res->jited_len )
+  {
+    ctx->stat.compiled++;
+    ctx->stat.bytes += res->jited_len;
+  } else
+    ctx->stat.failed++;
+  jlog_flush();
+  s_ctx = NULL;
+  return res;
+}
 
-void put_call_base(u64 addr, u64 enter, u64 ex)
+void jit_ctx_release(struct jit_ctx *ctx)
 {
-  _base = addr;
-  _enter = enter;
-  _ex = ex;
+  if ( ctx->mem != NULL )
+    jmem_reset(ctx->mem);
 }
 
-void put_original_jit_addr(void *addr)
+void jit_ctx_destroy(struct jit_ctx *ctx)
 {
-  original_jit_addr = (char *)addr;
+  if ( ctx->mem == NULL )
+    return;
+  jmem_destroy(ctx->mem);
+  ctx->mem = NULL;
 }
 
-void *kzalloc(size_t size, int flags)
+// allocations inside jit_compile_ctx go to arena of context
+static void *jalloc(size_t size)
 {
-  void *res = malloc(size);
+  if ( s_ctx == NULL )
+    return malloc(size);
+  if ( s_ctx->mem == NULL )
+  {
+    s_ctx->mem = jmem_create();
+    if ( s_ctx->mem == NULL )
+      return NULL;
+  }
+  return jmem_alloc(s_ctx->mem, size);
+}
+
+static void *jzalloc(size_t size)
+{
+  void *res = jalloc(size);
   if ( res )
     memset(res, 0, size);
   return res;
 }
 
-void kfree(void *ptr)
+// arena memory is released with jit_ctx_release
+static void jfree(void *ptr)
 {
+  if ( ptr == NULL )
+    return;
+  if ( s_ctx != NULL && s_ctx->mem != NULL && jmem_owns(s_ctx->mem, ptr) )
+    return;
   free(ptr);
 }
 
+void *kzalloc(size_t size, int flags)
+{
+  return jzalloc(size);
+}
+
+void kfree(void *ptr)
+{
+  jfree(ptr);
+}
+
 void *kcalloc(size_t n, size_t size, int flags)
 {
-  return calloc(n, size);
+  return jzalloc(n * size);
 }
 
 void *kmalloc_array(size_t n, size_t size, int flags)
 {
-  return malloc(n * size);
+  return jalloc(n * size);
 }
 
 void *kvmalloc_array(size_t n, size_t size, int flags)
 {
-  void *res = malloc(n * size);
-  if ( !res )
-    return res;
-   memset(res, 0, n * size);
-   return res;
+  return jzalloc(n * size);
 }
 
 void *kvcalloc(size_t n, size_t size, int flags)
 {
-  return calloc(n, size);
+  return jzalloc(n * size);
 }
 
 void kvfree(void *addr)
 {
-  free(addr);
+  jfree(addr);
 }
 
 static inline bool bpf_pseudo_func(const struct bpf_insn *insn)
@@ -668,6 +757,9 @@ void HexDump(unsigned char *From, int Len)
 
 void bpf_jit_dump(unsigned int flen, unsigned int proglen, u32 pass, void *image)
 {
+  if ( s_ctx != NULL && s_ctx->verbose < 2 )
+    return;
+  jlog_flush();
   printf("flen=%u proglen=%u pass=%u\n", flen, proglen, pass);
   HexDump(image, proglen);
 }
@@ -686,7 +778,7 @@ void bpf_jit_binary_lock_ro(struct bpf_binary_header *hdr)
 
 bool is_bpf_text_address(unsigned long addr)
 {
-  printf("is_bpf_text_address(%lX)\n", addr);
+  jlog(2, "is_bpf_text_address(%lX)\n", addr);
   return false;
 }
 
@@ -700,35 +792,34 @@ bpf_jit_binary_alloc(unsigned int proglen, u8 **image_ptr,
   ptrdiff_t off;
 
   size = round_up(proglen + sizeof(*hdr) + 128, PAGE_SIZE);
-  hdr = malloc(size);
-printf("bpf_jit_binary_alloc(%X) %p\n", size, hdr); fflush(stdout);
+  // only inside jit_compile_ctx
+  if ( s_ctx == NULL )
+    return NULL;
+  hdr = jalloc(size);
+  jlog(2, "bpf_jit_binary_alloc(%X) %p\n", size, hdr);
   if ( !hdr )
     return NULL;
-  jmem_store(hdr);
   hdr->size = size;
 //  hole = min(size - (proglen + sizeof(*hdr)), PAGE_SIZE - sizeof(*hdr));
 
   *image_ptr = &hdr->image[start];
   /* adjust __bpf_call_base */
-  off = original_jit_addr - (char *)*image_ptr;
-#ifdef _DEBUG
- printf("original_jit_addr %p off %lX\n", original_jit_addr, off);
-#endif
-  __bpf_call_base = _base - off;
-  __bpf_prog_enter = (char *)_enter - off;
-  __bpf_prog_exit = (char *)_ex - off;
+  off = (char *)s_ctx->orig_jit_addr - (char *)*image_ptr;
+  jlog(2, "original_jit_addr %p off %lX\n", s_ctx->orig_jit_addr, off);
+  __bpf_call_base = s_ctx->call_base - off;
+  __bpf_prog_enter = (char *)s_ctx->enter - off;
+  __bpf_prog_exit = (char *)s_ctx->ex - off;
   return hdr;  
 }
 
 void bpf_jit_binary_free(struct bpf_binary_header *hdr)
 {
-  jmem_remove(hdr);
-  free(hdr);
+  jfree(hdr);
 }
 
 void text_poke_bp(void *addr, const void *opcode, size_t len, const void *emulate)
 {
-  printf("text_poke_bp called, addr %p, len %lX\n", addr, len);
+  jlog(2, "text_poke_bp called, addr %p, len %lX\n", addr, len);
 }
 
 int is_kernel_text(unsigned long addr)
@@ -121,7 +121,7 @@ static inline u32 sw64_bpf_gen_format_simple_alu_imm(int opcode, enum sw64_bpf_r
 static inline void emit(const u32 insn, struct jit_ctx *ctx)
 {
 #ifdef _DEBUG
- printf("emit %p\n", ctx->image); fflush(stdout);
+ jlog(2, "emit %p\n", ctx->image);
 #endif
 	if (ctx->image != NULL)
 		ctx->image[ctx->idx] = insn;
@@ -312,7 +312,7 @@ static void build_prologue(struct jit_ctx *ctx, bool was_classic)
 	const int tcc = bpf2sw64[TCALL_CNT];
 	const int tmp1 = bpf2sw64[TMP_REG_1];
 #ifdef _DEBUG
- printf("build_prologue %p\n", ctx->image); fflush(stdout);
+ jlog(2, "build_prologue %p\n", ctx->image);
 #endif
 	/* Save callee-saved registers */
 	emit(SW64_BPF_SUBL_REG(SW64_BPF_REG_SP, 56, SW64_BPF_REG_SP), ctx);
@@ -905,7 +905,7 @@ struct bpf_prog *bpf_int_jit_compile(struct bpf_prog *prog)
 
 	/* 1. Initial fake pass to compute ctx->idx. */
 #ifdef _DEBUG
- printf("before build_prologue %p\n", ctx.image); 
+ jlog(2, "before build_prologue %p\n", ctx.image); 
 #endif
 	/* Fake pass to fill in ctx->offset. */
 	build_prologue(&ctx, was_classic);
@@ -35,6 +35,8 @@ do {									\
 #define pr_err_once(...) fprintf(stderr,  __VA_ARGS__)
 #define pr_info(...) fprintf(stderr, __VA_ARGS__)
 #define pr_err_ratelimited(...) fprintf(stderr, __VA_ARGS__)
+// debug output, written only when verbose level of current jit_ctx is at least level
+void jlog(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 #define BUILD_BUG_ON(x)
 
 #define GFP_KERNEL 0
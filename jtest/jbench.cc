@@ -0,0 +1,449 @@
+// differential benchmark of user-space JITs for all architectures
+// usage: jbench [-d jit_dir] [-n repeats] [-o out.json] [-p threads] [-s stack_depth] [-v] [files or dirs]
+// corpus is files with raw eBPF opcodes, dirs are scanned for such files. without args small builtin programs are used
+// every JIT shim found in jit_dir (../bpfdump/jit by default) compiles whole corpus, each architecture in own threads
+// with own ujit_ctx. reported per architecture:
+//  - compiled and failed programs, best compile time of -n repeats, image size and native bytes per eBPF insn
+//  - expansion of each opcode found in corpus: size of (insn; mov r0, 0; exit) minus size of (mov r0, 0; exit)
+// programs compiled by some JITs and rejected by others are listed as cross-arch regressions, exit code is 1 then
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ujit.h"
+#include "ebpf_disasm.h"
+
+struct jprog
+{
+  std::string name;
+  std::vector<bpf_insn> body;
+};
+
+struct shim
+{
+  const char *arch;
+  const char *path; // relative to jit dir
+};
+
+static const shim s_shims[] = {
+  { "x64",      "j64/libjx64.so" },
+  { "x64-5.13", "513/libjx64.so" },
+  { "arm64",    "jarm64/libjarm64.so" },
+  { "ppc64",    "jppc/libjppc.so" },
+  { "riscv",    "jriscv/libjriscv.so" },
+  { "s390",     "js390/libjs390.so" },
+  { "sparc",    "jsparc/libjsparc.so" },
+  { "sw64",     "jsw64/libjsw64.so" },
+};
+
+// expansion of one opcode
+struct op_exp
+{
+  double bytes = 0; // average over samples
+  int ok = 0;       // samples compiled
+};
+
+struct arch_res
+{
+  const char *arch;
+  ujit_lib *lib;
+  std::vector<double> best; // ns per program, < 0 - not compiled
+  std::vector<long> size;
+  std::map<unsigned char, op_exp> exp;
+};
+
+static std::vector<jprog> s_corpus;
+// up to s_samples different instructions of each opcode from corpus, lddw has 2 slots
+static std::map<unsigned char, std::vector<std::vector<bpf_insn> > > s_ops;
+static const size_t s_samples = 8;
+static int s_repeats = 3;
+static int s_threads = 1;
+static unsigned int s_stack = 32;
+
+// fake kernel addresses, so calls are encoded in range like in real kernel
+static const unsigned long s_call_base = 0xffffffff81000000UL;
+static void *const s_image = (void *)0xffffffffc0000000UL;
+
+static const unsigned char fault_body[] = {
+ 0xBF, 0x16, 0, 0, 0, 0, 0, 0,
+ 0x69, 0x67, 0xB0, 0, 0, 0, 0, 0,
+ 0xB4, 0x08, 0, 0, 0, 0, 0, 0,
+ 0x44, 0x08, 0, 0, 2, 0, 0, 0,
+ 0xB7, 0, 0, 0, 1, 0, 0, 0,
+ 0x55, 0x08, 1, 0, 2, 0, 0, 0,
+ 0xB7, 0, 0, 0, 0, 0, 0, 0,
+ 0x95, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const bpf_insn s_tail[2] = {
+  { 0xb7, 0, 0, 0, 0 }, // mov r0, 0
+  { 0x95, 0, 0, 0, 0 }, // exit
+};
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int add_file(const char *fname)
+{
+  FILE *fp = fopen(fname, "rb");
+  if ( fp == NULL )
+    return 0;
+  fseek(fp, 0, SEEK_END);
+  long fsize = ftell(fp);
+  if ( fsize <= 0 || fsize % sizeof(bpf_insn) )
+  {
+    fclose(fp);
+    return 0;
+  }
+  fseek(fp, 0, SEEK_SET);
+  jprog p;
+  p.name = fname;
+  p.body.resize(fsize / sizeof(bpf_insn));
+  int res = fread(p.body.data(), fsize, 1, fp) == 1;
+  fclose(fp);
+  if ( res )
+    s_corpus.push_back(std::move(p));
+  return res;
+}
+
+static void add_path(const char *path)
+{
+  struct stat st;
+  if ( stat(path, &st) )
+  {
+    printf("cannot stat %s, error %d\n", path, errno);
+    return;
+  }
+  if ( !S_ISDIR(st.st_mode) )
+  {
+    if ( !add_file(path) )
+      printf("%s is not eBPF program\n", path);
+    return;
+  }
+  DIR *d = opendir(path);
+  if ( d == NULL )
+    return;
+  struct dirent *de;
+  while ( (de = readdir(d)) != NULL )
+  {
+    if ( de->d_name[0] == '.' )
+      continue;
+    std::string fname = std::string(path) + "/" + de->d_name;
+    if ( !stat(fname.c_str(), &st) && S_ISREG(st.st_mode) )
+      add_file(fname.c_str());
+  }
+  closedir(d);
+}
+
+static inline int is_jmp(unsigned char code)
+{
+  int cls = code & 7;
+  return (cls == 5 || cls == 6) && code != 0x85 && code != 0x95;
+}
+
+static void collect_ops()
+{
+  for ( auto &p: s_corpus )
+  {
+    for ( size_t i = 0; i < p.body.size(); i++ )
+    {
+      std::vector<bpf_insn> s(1, p.body[i]);
+      if ( p.body[i].code == 0x18 && i + 1 < p.body.size() )
+        s.push_back(p.body[++i]);
+      // jumps in probe fall through to tail
+      if ( is_jmp(s[0].code) )
+        s[0].off = 0;
+      auto &v = s_ops[s[0].code];
+      if ( v.size() >= s_samples )
+        continue;
+      int found = 0;
+      for ( auto &prev: v )
+        if ( prev.size() == s.size() && !memcmp(prev.data(), s.data(), s.size() * sizeof(bpf_insn)) )
+        {
+          found = 1;
+          break;
+        }
+      if ( !found )
+        v.push_back(std::move(s));
+    }
+  }
+}
+
+// returns size of image or 0
+static long jit_size(ujit_ctx &ctx, const bpf_insn *body, size_t len)
+{
+  jitted_code jc;
+  long res = 0;
+  if ( ujit2mem(ctx, (unsigned char *)body, len, s_stack, jc) > 0 )
+    res = jc.size;
+  ujit_release(ctx);
+  return res;
+}
+
+static void run_arch(arch_res &r, int tid)
+{
+  ujit_ctx ctx(r.lib);
+  put_kdata(ctx, s_call_base, 0, 0);
+  put_orig_jit_addr(ctx, s_image);
+  for ( size_t i = tid; i < s_corpus.size(); i += s_threads )
+  {
+    auto &p = s_corpus[i];
+    for ( int j = 0; j < s_repeats; j++ )
+    {
+      double start = now();
+      long size = jit_size(ctx, p.body.data(), p.body.size());
+      double t = now() - start;
+      if ( !size )
+        break;
+      r.size[i] = size;
+      if ( r.best[i] < 0 || t < r.best[i] )
+        r.best[i] = t;
+    }
+  }
+  if ( tid )
+    return;
+  long base = jit_size(ctx, s_tail, 2);
+  if ( !base )
+    return;
+  for ( auto &op: s_ops )
+  {
+    op_exp &e = r.exp[op.first];
+    for ( auto &s: op.second )
+    {
+      std::vector<bpf_insn> probe(s);
+      probe.insert(probe.end(), s_tail, s_tail + 2);
+      long size = jit_size(ctx, probe.data(), probe.size());
+      if ( !size )
+        continue;
+      e.bytes += size - base;
+      e.ok++;
+    }
+    if ( e.ok )
+      e.bytes /= e.ok;
+  }
+}
+
+// names come from file names in the corpus, so quote them properly
+static void put_json_str(FILE *fp, const char *s)
+{
+  fputc('"', fp);
+  for ( ; *s; s++ )
+  {
+    unsigned char c = *s;
+    if ( c == '"' || c == '\\' )
+      fprintf(fp, "\\%c", c);
+    else if ( c < 0x20 )
+      fprintf(fp, "\\u%4.4x", c);
+    else
+      fputc(c, fp);
+  }
+  fputc('"', fp);
+}
+
+static void usage(const char *prog)
+{
+  printf("%s usage: [options] [files or dirs with eBPF programs]\n", prog);
+  printf("Options:\n");
+  printf("-d dir - root of JIT shims, default ../bpfdump/jit\n");
+  printf("-n num - repeats of each compilation, default 3\n");
+  printf("-o file - write JSON to file\n");
+  printf("-p num - threads for each architecture, default 1\n");
+  printf("-s depth - stack depth of programs, default 32\n");
+  printf("-v - dump size of each program\n");
+  exit(6);
+}
+
+int main(int argc, char **argv)
+{
+  const char *jit_dir = "../bpfdump/jit",
+             *out_name = NULL;
+  int c, verbose = 0;
+  while ( (c = getopt(argc, argv, "d:n:o:p:s:v")) != -1 )
+  {
+    switch(c)
+    {
+      case 'd': jit_dir = optarg;
+       break;
+      case 'n': s_repeats = atoi(optarg);
+        if ( s_repeats < 1 )
+          usage(argv[0]);
+       break;
+      case 'o': out_name = optarg;
+       break;
+      case 'p': s_threads = atoi(optarg);
+        if ( s_threads < 1 )
+          usage(argv[0]);
+       break;
+      case 's': s_stack = atoi(optarg);
+       break;
+      case 'v': verbose = 1;
+       break;
+      default: usage(argv[0]);
+    }
+  }
+  for ( int i = optind; i < argc; i++ )
+    add_path(argv[i]);
+  if ( optind == argc )
+  {
+    jprog p;
+    p.name = "builtin";
+    p.body.resize(sizeof(fault_body) / sizeof(bpf_insn));
+    memcpy(p.body.data(), fault_body, sizeof(fault_body));
+    s_corpus.push_back(std::move(p));
+  }
+  if ( s_corpus.empty() )
+  {
+    printf("empty corpus\n");
+    return -1;
+  }
+  collect_ops();
+  size_t total_insns = 0;
+  for ( auto &p: s_corpus )
+    total_insns += p.body.size();
+  // load all shims
+  std::vector<arch_res> res;
+  for ( auto &s: s_shims )
+  {
+    std::string path = std::string(jit_dir) + "/" + s.path;
+    if ( access(path.c_str(), R_OK) )
+      continue;
+    ujit_lib *lib = ujit_load(path.c_str());
+    if ( lib == NULL )
+      continue;
+    arch_res r;
+    r.arch = s.arch;
+    r.lib = lib;
+    r.best.resize(s_corpus.size(), -1);
+    r.size.resize(s_corpus.size(), 0);
+    res.push_back(std::move(r));
+  }
+  if ( res.empty() )
+  {
+    printf("no JIT shims in %s\n", jit_dir);
+    return -1;
+  }
+  std::vector<std::thread> threads;
+  for ( auto &r: res )
+    for ( int t = 0; t < s_threads; t++ )
+      threads.emplace_back(run_arch, std::ref(r), t);
+  for ( auto &t: threads )
+    t.join();
+  // report
+  printf("\ncorpus: %ld programs, %ld insns, %ld opcodes\n", s_corpus.size(), total_insns, s_ops.size());
+  printf("%-10s %8s %8s %12s %12s %10s %8s\n", "arch", "ok", "failed", "time_us", "us/prog", "bytes", "b/insn");
+  for ( auto &r: res )
+  {
+    size_t ok = 0, insns = 0;
+    long bytes = 0;
+    double t = 0;
+    for ( size_t i = 0; i < s_corpus.size(); i++ )
+    {
+      if ( r.best[i] < 0 )
+        continue;
+      ok++;
+      t += r.best[i];
+      bytes += r.size[i];
+      insns += s_corpus[i].body.size();
+    }
+    printf("%-10s %8ld %8ld %12.1f %12.2f %10ld %8.2f\n", r.arch, ok, s_corpus.size() - ok, t / 1000,
+      ok ? t / 1000 / ok : 0, bytes, insns ? (double)bytes / insns : 0);
+  }
+  // opcodes: native bytes for one insn and factor against 8 bytes of eBPF insn
+  printf("\nopcode expansion, bytes (factor):\n%-6s", "op");
+  for ( auto &r: res )
+    printf(" %16s", r.arch);
+  printf("\n");
+  for ( auto &op: s_ops )
+  {
+    printf("0x%2.2X  ", op.first);
+    for ( auto &r: res )
+    {
+      auto &e = r.exp[op.first];
+      if ( e.ok )
+        printf(" %8.1f (%5.2f)", e.bytes, e.bytes / (sizeof(bpf_insn) * op.second[0].size()));
+      else
+        printf(" %16s", "-");
+    }
+    printf("\n");
+  }
+  if ( verbose )
+  {
+    printf("\n%-32s", "program");
+    for ( auto &r: res )
+      printf(" %10s", r.arch);
+    printf("\n");
+    for ( size_t i = 0; i < s_corpus.size(); i++ )
+    {
+      printf("%-32s", s_corpus[i].name.c_str());
+      for ( auto &r: res )
+        printf(" %10ld", r.size[i]);
+      printf("\n");
+    }
+  }
+  // cross-arch regressions
+  int regs = 0;
+  for ( size_t i = 0; i < s_corpus.size(); i++ )
+  {
+    std::string ok, failed;
+    for ( auto &r: res )
+    {
+      std::string &s = r.best[i] < 0 ? failed : ok;
+      s += " ";
+      s += r.arch;
+    }
+    if ( ok.empty() || failed.empty() )
+      continue;
+    if ( !regs++ )
+      printf("\ncompiled only by some JITs:\n");
+    printf("%s: ok%s, failed%s\n", s_corpus[i].name.c_str(), ok.c_str(), failed.c_str());
+  }
+  if ( out_name != NULL )
+  {
+    FILE *fp = fopen(out_name, "w");
+    if ( fp == NULL )
+      printf("cannot create %s, error %d\n", out_name, errno);
+    else {
+      fprintf(fp, "{\"programs\":%ld,\"insns\":%ld,\"repeats\":%d,\"archs\":[\n", s_corpus.size(), total_insns, s_repeats);
+      for ( size_t a = 0; a < res.size(); a++ )
+      {
+        auto &r = res[a];
+        fprintf(fp, "%s{\"arch\":", a ? "," : "");
+        put_json_str(fp, r.arch);
+        fprintf(fp, ",\"progs\":[");
+        for ( size_t i = 0; i < s_corpus.size(); i++ )
+        {
+          fprintf(fp, "%s{\"name\":", i ? "," : "");
+          put_json_str(fp, s_corpus[i].name.c_str());
+          fprintf(fp, ",\"ns\":%.0f,\"size\":%ld}", r.best[i], r.size[i]);
+        }
+        fprintf(fp, "],\"ops\":{");
+        int first = 1;
+        for ( auto &e: r.exp )
+        {
+          if ( !e.second.ok )
+            continue;
+          fprintf(fp, "%s\"0x%2.2X\":%.2f", first ? "" : ",", e.first, e.second.bytes);
+          first = 0;
+        }
+        fprintf(fp, "}}\n");
+      }
+      fprintf(fp, "]}\n");
+      fclose(fp);
+    }
+  }
+  for ( auto &r: res )
+    ujit_unload(r.lib);
+  return regs ? 1 : 0;
+}
@@ -48,18 +48,22 @@ int main(int argc, char **argv)
     printf("cannot open libjx64.so\n");
     return -1;
   }
-  if ( argc > 1 )
   {
-    size_t fsize = 0;
-    char *buf = read_file(argv[1], fsize);
-    if ( !buf )
-      printf("cannot open %s\n", argv[1]);
-    else {
-      ujit2file(0, (unsigned char *)buf, fsize / 8, 32);
-      free(buf);
-    }
-  } else 
-    ujit2file(0, fault_body, sizeof(fault_body) / 8, 32);
+    ujit_ctx ctx;
+    put_verbose(ctx, 2);
+    if ( argc > 1 )
+    {
+      size_t fsize = 0;
+      char *buf = read_file(argv[1], fsize);
+      if ( !buf )
+        printf("cannot open %s\n", argv[1]);
+      else {
+        ujit2file(ctx, 0, (unsigned char *)buf, fsize / 8, 32);
+        free(buf);
+      }
+    } else 
+      ujit2file(ctx, 0, fault_body, sizeof(fault_body) / 8, 32);
+  }
   ujit_close();
   return 0;
 }
\ No newline at end of file
@@ -57,6 +57,10 @@
 #include <linux/lsm_hooks.h>
 #include <linux/bpf.h>
 #include <linux/filter.h>
+#include <linux/sort.h>
+#include <linux/bsearch.h>
+#include <linux/memcontrol.h>
+#include <linux/bpf-cgroup.h>
 #include <linux/timer.h>
 #include <linux/workqueue.h>
 #include <linux/alarmtimer.h>
@@ -964,6 +968,436 @@ void fill_bpf_prog(struct one_bpf_prog *curr, struct bpf_prog *prog)
   }
 }
 
+// like bpf_map_memory_footprint in kernel/bpf/syscall.c before 6.4
+static unsigned long bpf_map_mem(struct bpf_map *map)
+{
+  unsigned long vsize = map->value_size;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+  if ( map->ops && map->ops->map_mem_usage )
+    return map->ops->map_mem_usage(map);
+#endif
+  switch(map->map_type)
+  {
+    case BPF_MAP_TYPE_PERCPU_HASH:
+    case BPF_MAP_TYPE_LRU_PERCPU_HASH:
+    case BPF_MAP_TYPE_PERCPU_ARRAY:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,20,0)
+    case BPF_MAP_TYPE_PERCPU_CGROUP_STORAGE:
+#endif
+      vsize = round_up(map->value_size, 8) * num_possible_cpus();
+     break;
+    case BPF_MAP_TYPE_ARRAY_OF_MAPS:
+    case BPF_MAP_TYPE_HASH_OF_MAPS:
+    case BPF_MAP_TYPE_PROG_ARRAY:
+    case BPF_MAP_TYPE_PERF_EVENT_ARRAY:
+    case BPF_MAP_TYPE_CGROUP_ARRAY:
+      vsize = sizeof(u32);
+     break;
+    default: ;
+  }
+  return round_up((unsigned long)map->max_entries * round_up(map->key_size + vsize, 8), PAGE_SIZE);
+}
+
+static unsigned long bpf_map_memcg_id(struct bpf_map *map)
+{
+  unsigned long res = 0;
+#ifdef CONFIG_MEMCG_KMEM
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+  struct mem_cgroup *memcg;
+  if ( !map->objcg )
+    return 0;
+  rcu_read_lock();
+  memcg = obj_cgroup_memcg(map->objcg);
+  if ( memcg )
+    res = cgroup_id(memcg->css.cgroup);
+  rcu_read_unlock();
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5,11,0)
+  if ( map->memcg )
+    res = cgroup_id(map->memcg->css.cgroup);
+#endif
+#endif /* CONFIG_MEMCG_KMEM */
+  return res;
+}
+
+static int cmp_bpf_map_addr(const void *a, const void *b)
+{
+  const struct one_bpf_map *ma = *(const struct one_bpf_map **)a;
+  const struct one_bpf_map *mb = *(const struct one_bpf_map **)b;
+  if ( ma->addr == mb->addr )
+    return 0;
+  return ma->addr < mb->addr ? -1 : 1;
+}
+
+static int find_bpf_map_addr(const void *key, const void *elt)
+{
+  const struct one_bpf_map *m = *(const struct one_bpf_map **)elt;
+  if ( key == m->addr )
+    return 0;
+  return key < m->addr ? -1 : 1;
+}
+
+// fill nprogs/progs of maps in curr from used_maps of all programs in prog_idr
+// used_maps is protected by used_maps_mutex (since 5.10, before it was immutable after load) which can't be taken
+// under prog_idr_lock, so first take references to progs under spinlock and then walk their maps
+static int fill_bpf_map_progs(struct one_bpf_map *curr, unsigned long cnt, struct idr *progs, spinlock_t *lock)
+{
+  struct one_bpf_map **sorted;
+  struct bpf_prog **held;
+  struct bpf_prog *prog;
+  unsigned long i, j, lim = 0, nprogs = 0;
+  unsigned int id;
+  if ( !cnt )
+    return 0;
+  spin_lock_bh(lock);
+  idr_for_each_entry(progs, prog, id)
+    lim++;
+  spin_unlock_bh(lock);
+  if ( !lim )
+    return 0;
+  sorted = (struct one_bpf_map **)kmalloc_array(cnt, sizeof(*sorted), GFP_KERNEL);
+  if ( !sorted )
+    return -ENOMEM;
+  held = (struct bpf_prog **)kmalloc_array(lim, sizeof(*held), GFP_KERNEL);
+  if ( !held )
+  {
+    kfree(sorted);
+    return -ENOMEM;
+  }
+  for ( i = 0; i < cnt; i++ )
+    sorted[i] = curr + i;
+  sort(sorted, cnt, sizeof(*sorted), cmp_bpf_map_addr, NULL);
+  spin_lock_bh(lock);
+  idr_for_each_entry(progs, prog, id)
+  {
+    // loaded after counting - skip
+    if ( nprogs >= lim )
+      break;
+    // prog with zero refcnt is being freed
+    if ( IS_ERR(bpf_prog_inc_not_zero(prog)) )
+      continue;
+    held[nprogs++] = prog;
+  }
+  spin_unlock_bh(lock);
+  for ( j = 0; j < nprogs; j++ )
+  {
+    prog = held[j];
+    if ( !prog->aux )
+    {
+      bpf_prog_put(prog);
+      continue;
+    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+    mutex_lock(&prog->aux->used_maps_mutex);
+#endif
+    for ( i = 0; prog->aux->used_maps && i < prog->aux->used_map_cnt; i++ )
+    {
+      struct one_bpf_map **found = (struct one_bpf_map **)bsearch(prog->aux->used_maps[i], sorted, cnt, sizeof(*sorted), find_bpf_map_addr);
+      if ( !found )
+        continue;
+      if ( (*found)->nprogs < ARRAY_SIZE((*found)->progs) )
+        (*found)->progs[(*found)->nprogs] = prog->aux->id;
+      (*found)->nprogs++;
+    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,10,0)
+    mutex_unlock(&prog->aux->used_maps_mutex);
+#endif
+    bpf_prog_put(prog);
+  }
+  kfree(held);
+  kfree(sorted);
+  return 0;
+}
+
+// graph of bpf programs for IOCTL_GET_BPF_GRAPH, when curr is NULL edges are only counted
+struct bpf_graph
+{
+  struct one_bpf_edge *curr;
+  unsigned long lim;
+  unsigned long cnt;
+};
+
+static struct one_bpf_edge *add_bpf_edge(struct bpf_graph *g, struct bpf_prog *prog, unsigned int link_id, int kind, int attach_type)
+{
+  struct one_bpf_edge *e;
+  if ( !prog )
+    return NULL;
+  if ( !g->curr )
+  {
+    g->cnt++;
+    return NULL;
+  }
+  if ( g->cnt >= g->lim )
+    return NULL;
+  e = g->curr + g->cnt++;
+  e->prog = (void *)prog;
+  e->prog_id = prog->aux ? prog->aux->id : 0;
+  e->link_id = link_id;
+  e->kind = kind;
+  e->attach_type = attach_type;
+  return e;
+}
+
+#ifdef CONFIG_PERF_EVENTS
+static void set_trace_edge(struct one_bpf_edge *e, struct trace_event_call *call)
+{
+  if ( call->flags & TRACE_EVENT_FL_KPROBE )
+    e->kind = BPF_AP_KPROBE;
+  else if ( call->flags & TRACE_EVENT_FL_UPROBE )
+    e->kind = BPF_AP_UPROBE;
+  else
+    e->kind = BPF_AP_TRACEPOINT;
+  e->target = (void *)call;
+  strlcpy(e->name, trace_event_name(call), sizeof(e->name));
+}
+#endif /* CONFIG_PERF_EVENTS */
+
+// cgroup and net of links are cleared on detach/netns exit under cgroup_mutex/netns_bpf_mutex which can't
+// be taken under link_idr_lock. they are freed only after RCU grace period and spin_lock_bh is RCU read-side
+// section, so pointer read once with READ_ONCE stays valid until unlock
+// the same is for link->prog - bpf_link_update replaces it with xchg and old prog is freed after RCU grace period
+static void bpf_graph_links(struct bpf_graph *g, struct idr *links, spinlock_t *lock)
+{
+  struct bpf_link *link;
+  struct one_bpf_edge *e;
+  unsigned int id;
+  spin_lock_bh(lock);
+  idr_for_each_entry(links, link, id)
+  {
+    struct bpf_prog *prog = READ_ONCE(link->prog);
+    if ( !prog )
+      continue;
+    switch(link->type)
+    {
+      case BPF_LINK_TYPE_RAW_TRACEPOINT:
+        {
+          struct bpf_raw_tp_link *raw = container_of(link, struct bpf_raw_tp_link, link);
+          // fentry/fexit/lsm attached with BPF_RAW_TRACEPOINT_OPEN have no btp
+          if ( !raw->btp )
+          {
+            e = add_bpf_edge(g, prog, link->id, BPF_AP_TRACING, prog->expected_attach_type);
+            if ( e && prog->aux && prog->aux->attach_func_name )
+              strlcpy(e->name, prog->aux->attach_func_name, sizeof(e->name));
+            break;
+          }
+          e = add_bpf_edge(g, prog, link->id, BPF_AP_RAW_TP, prog->expected_attach_type);
+          if ( e )
+          {
+            e->target = (void *)raw->btp;
+            if ( raw->btp->tp )
+              strlcpy(e->name, raw->btp->tp->name, sizeof(e->name));
+          }
+        }
+       break;
+      case BPF_LINK_TYPE_TRACING:
+        e = add_bpf_edge(g, prog, link->id, BPF_AP_TRACING, prog->expected_attach_type);
+        if ( e && prog->aux && prog->aux->attach_func_name )
+          strlcpy(e->name, prog->aux->attach_func_name, sizeof(e->name));
+       break;
+      case BPF_LINK_TYPE_CGROUP:
+        {
+          struct bpf_cgroup_link *cl = container_of(link, struct bpf_cgroup_link, link);
+          struct cgroup *cg = READ_ONCE(cl->cgroup);
+          e = add_bpf_edge(g, prog, link->id, BPF_AP_CGROUP, cl->type);
+          if ( e && cg )
+          {
+            e->target = (void *)cg;
+            e->target_id = cgroup_id(cg);
+          }
+        }
+       break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,9,0)
+      case BPF_LINK_TYPE_ITER:
+        {
+          struct bpf_iter_link *il = container_of(link, struct bpf_iter_link, link);
+          e = add_bpf_edge(g, prog, link->id, BPF_AP_ITER, prog->expected_attach_type);
+          if ( e && il->tinfo )
+          {
+            e->target = (void *)il->tinfo;
+            if ( il->tinfo->reg_info && il->tinfo->reg_info->target )
+              strlcpy(e->name, il->tinfo->reg_info->target, sizeof(e->name));
+          }
+        }
+       break;
+      case BPF_LINK_TYPE_NETNS:
+        {
+          struct bpf_netns_link *nl = container_of(link, struct bpf_netns_link, link);
+          // net is cleared when netns is going away
+          struct net *net = READ_ONCE(nl->net);
+          e = add_bpf_edge(g, prog, link->id, BPF_AP_NETNS, nl->type);
+          if ( e && net )
+          {
+            e->target = (void *)net;
+            e->target_id = net->ns.inum;
+          }
+        }
+       break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,15,0)
+      case BPF_LINK_TYPE_PERF_EVENT:
+        {
+          struct bpf_perf_link *pl = container_of(link, struct bpf_perf_link, link);
+          e = add_bpf_edge(g, prog, link->id, BPF_AP_TRACEPOINT, prog->expected_attach_type);
+#if defined(CONFIG_PERF_EVENTS) && defined(CONFIG_EVENT_TRACING)
+          if ( e && pl->perf_file && pl->perf_file->private_data )
+          {
+            struct perf_event *event = (struct perf_event *)pl->perf_file->private_data;
+            if ( event->tp_event )
+              set_trace_edge(e, event->tp_event);
+          }
+#endif
+        }
+       break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,18,0)
+      case BPF_LINK_TYPE_KPROBE_MULTI:
+        add_bpf_edge(g, prog, link->id, BPF_AP_KPROBE, prog->expected_attach_type);
+       break;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,6,0)
+      case BPF_LINK_TYPE_UPROBE_MULTI:
+        add_bpf_edge(g, prog, link->id, BPF_AP_UPROBE, prog->expected_attach_type);
+       break;
+#endif
+      default:
+        add_bpf_edge(g, prog, link->id, BPF_AP_OTHER, prog->expected_attach_type);
+    }
+  }
+  spin_unlock_bh(lock);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+#define for_each_cg_prog(pl, head) hlist_for_each_entry(pl, head, node)
+#else
+#define for_each_cg_prog(pl, head) list_for_each_entry(pl, head, node)
+#endif
+
+// progs attached to cgroups without link, links were already reported from link_idr
+static void bpf_graph_cgroups(struct bpf_graph *g, struct idr *genl, struct mutex *m)
+{
+  struct cgroup_root *item;
+  unsigned int hierarchy_id;
+  mutex_lock(m);
+  idr_for_each_entry(genl, item, hierarchy_id)
+  {
+    struct cgroup_subsys_state *child;
+    rcu_read_lock();
+    for (child = css_next_descendant_pre(NULL, &item->cgrp.self); child; child = css_next_descendant_pre(child, &item->cgrp.self) )
+    {
+      struct cgroup *cg = (struct cgroup *)child;
+      int i;
+      for ( i = 0; i < ARRAY_SIZE(cg->bpf.progs); i++ )
+      {
+        struct bpf_prog_list *pl;
+        for_each_cg_prog(pl, &cg->bpf.progs[i])
+        {
+          struct one_bpf_edge *e;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,7,0)
+          if ( pl->link )
+            continue;
+#endif
+          e = add_bpf_edge(g, pl->prog, 0, BPF_AP_CGROUP, i);
+          if ( e )
+          {
+            e->target = (void *)cg;
+            e->target_id = cgroup_id(cg);
+          }
+        }
+      }
+    }
+    rcu_read_unlock();
+  }
+  mutex_unlock(m);
+}
+
+// progs attached to netns without link (flow dissector & sk_lookup)
+// progs are replaced under netns_bpf_mutex, so take reference to each under RCU
+static void bpf_graph_nets(struct bpf_graph *g)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,8,0)
+  struct net *net;
+  if ( !s_net )
+    return;
+  down_read(s_net);
+  for_each_net(net)
+  {
+    int i;
+    for ( i = 0; i < MAX_NETNS_BPF_ATTACH_TYPE; i++ )
+    {
+      struct one_bpf_edge *e;
+      struct bpf_prog *prog;
+      rcu_read_lock();
+      prog = rcu_dereference(net->bpf.progs[i]);
+      if ( prog && IS_ERR(bpf_prog_inc_not_zero(prog)) )
+        prog = NULL;
+      rcu_read_unlock();
+      if ( !prog )
+        continue;
+      e = add_bpf_edge(g, prog, 0, BPF_AP_NETNS, i);
+      if ( e )
+      {
+        e->target = (void *)net;
+        e->target_id = net->ns.inum;
+      }
+      bpf_prog_put(prog);
+    }
+  }
+  up_read(s_net);
+#endif
+}
+
+// prog_array of trace events contains both progs attached with PERF_EVENT_IOC_SET_BPF and perf links
+static void bpf_graph_trace_events(struct bpf_graph *g)
+{
+#ifdef CONFIG_PERF_EVENTS
+  struct trace_event_call *call;
+  if ( !s_trace_event_sem || !s_ftrace_events || !s_bpf_event_mutex )
+    return;
+  down_read(s_trace_event_sem);
+  mutex_lock(s_bpf_event_mutex);
+  list_for_each_entry(call, s_ftrace_events, list)
+  {
+    int i;
+    if ( !call->prog_array )
+      continue;
+    // array is NULL terminated, bpf_prog_array_length doesn't count dummy progs so can't be used as bound
+    for ( i = 0; call->prog_array->items[i].prog; i++ )
+    {
+      struct bpf_prog *prog = call->prog_array->items[i].prog;
+      struct one_bpf_edge *e;
+      // dummy prog left in place of detached one has no aux
+      if ( !prog->aux )
+        continue;
+      e = add_bpf_edge(g, prog, 0, BPF_AP_TRACEPOINT, prog->expected_attach_type);
+      if ( e )
+        set_trace_edge(e, call);
+    }
+  }
+  mutex_unlock(s_bpf_event_mutex);
+  up_read(s_trace_event_sem);
+#endif /* CONFIG_PERF_EVENTS */
+}
+
+static void collect_bpf_graph(struct bpf_graph *g, unsigned long *args)
+{
+  bpf_graph_links(g, (struct idr *)args[0], (spinlock_t *)args[1]);
+  if ( args[2] && args[3] )
+    bpf_graph_cgroups(g, (struct idr *)args[2], (struct mutex *)args[3]);
+  bpf_graph_nets(g);
+  bpf_graph_trace_events(g);
+}
+
+static int fill_kmod_range(struct one_kmod_range *curr, void *addr, void *start, unsigned long size, int kind, const char *name)
+{
+  if ( !start || !size )
+    return 0;
+  curr->addr = addr;
+  curr->start = (unsigned long)start;
+  curr->size = size;
+  curr->kind = kind;
+  strlcpy(curr->name, name, sizeof(curr->name));
+  return 1;
+}
+
 static long lkcd_ioctl(struct file *file, unsigned int ioctl_num, unsigned long ioctl_param)
 {
   unsigned long ptrbuf[16];
@@ -3463,7 +3897,11 @@ static long lkcd_ioctl(struct file *file, unsigned int ioctl_num, unsigned long
           unsigned long cnt = 0;
           size_t kbuf_size = sizeof(unsigned long) + ptrbuf[2] * sizeof(struct one_bpf_map);
           struct one_bpf_map *curr;
-          unsigned long *buf = (unsigned long *)kmalloc(kbuf_size, GFP_KERNEL  | __GFP_ZERO);
+          unsigned long *buf;
+          // prog_idr & prog_idr_lock
+          if ( copy_from_user( (void*)(ptrbuf + 3), (void*)(ioctl_param + sizeof(long) * 3), sizeof(long) * 2) > 0 )
+            return -EFAULT;
+          buf = (unsigned long *)kmalloc(kbuf_size, GFP_KERNEL  | __GFP_ZERO);
           if ( !buf )
              return -ENOMEM;
           curr = (struct one_bpf_map *)(buf + 1);
@@ -3484,6 +3922,10 @@ static long lkcd_ioctl(struct file *file, unsigned int ioctl_num, unsigned long
               curr->value_size = map->value_size;
               curr->id = map->id;
               strlcpy(curr->name, map->name, 16);
+              curr->max_entries = map->max_entries;
+              curr->map_flags = map->map_flags;
+              curr->mem = bpf_map_mem(map);
+              curr->memcg_id = bpf_map_memcg_id(map);
               curr++;
             }
             cnt++;
@@ -3491,6 +3933,18 @@ static long lkcd_ioctl(struct file *file, unsigned int ioctl_num, unsigned long
           // unlock
           spin_unlock_bh(lock);
           idr_preload_end();
+          if ( cnt > ptrbuf[2] )
+            cnt = ptrbuf[2];
+          // owners of maps
+          if ( ptrbuf[3] && ptrbuf[4] )
+          {
+            int err = fill_bpf_map_progs((struct one_bpf_map *)(buf + 1), cnt, (struct idr *)ptrbuf[3], (spinlock_t *)ptrbuf[4]);
+            if ( err )
+            {
+              kfree(buf);
+              return err;
+            }
+          }
           // copy to user
           buf[0] = cnt;
           if (copy_to_user((void*)ioctl_param, (void*)buf, kbuf_size) > 0)
@@ -4752,6 +5206,139 @@ static long lkcd_ioctl(struct file *file, unsigned int ioctl_num, unsigned long
      }
      break; /* IOCTL_GET_KTIMERS */
 
+    case IOCTL_GET_KMOD_RANGES:
+      if ( copy_from_user( (void*)ptrbuf, (void*)ioctl_param, sizeof(long) * 5) > 0 )
+  	    return -EFAULT;
+      else {
+        struct list_head *head = (struct list_head *)ptrbuf[0];
+        struct mutex *m = (struct mutex *)ptrbuf[1];
+        struct list_head *bhead = (struct list_head *)ptrbuf[2];
+        spinlock_t *block = (spinlock_t *)ptrbuf[3];
+        struct module *mod;
+        struct bpf_ksym *ti;
+        unsigned long cnt = 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+        enum mod_mem_type t;
+#endif
+        if ( !ptrbuf[4] )
+        {
+          mutex_lock(m);
+          list_for_each_entry(mod, head, list)
+          {
+            if ( mod->state == MODULE_STATE_UNFORMED )
+              continue;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+            cnt += MOD_MEM_NUM_TYPES;
+#else
+            cnt += 2;
+#endif
+          }
+          mutex_unlock(m);
+          if ( bhead && block )
+          {
+            spin_lock_bh(block);
+            list_for_each_entry(ti, bhead, lnode)
+              cnt++;
+            spin_unlock_bh(block);
+          }
+          if (copy_to_user((void*)ioctl_param, (void*)&cnt, sizeof(cnt)) > 0)
+            return -EFAULT;
+        } else {
+          struct one_kmod_range *curr;
+          size_t kbuf_size = sizeof(unsigned long) + sizeof(struct one_kmod_range) * ptrbuf[4];
+          unsigned long *buf = (unsigned long *)kmalloc(kbuf_size, GFP_KERNEL);
+          if ( !buf )
+            return -ENOMEM;
+          curr = (struct one_kmod_range *)(buf + 1);
+          mutex_lock(m);
+          list_for_each_entry(mod, head, list)
+          {
+            if ( mod->state == MODULE_STATE_UNFORMED )
+              continue;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+            for_each_mod_mem_type(t)
+            {
+              if ( cnt >= ptrbuf[4] )
+                break;
+              if ( fill_kmod_range(curr, mod, mod->mem[t].base, mod->mem[t].size, mod_mem_type_is_init(t), mod->name) )
+              {
+                curr++;
+                cnt++;
+              }
+            }
+#else
+            if ( cnt < ptrbuf[4] && fill_kmod_range(curr, mod, mod->core_layout.base, mod->core_layout.size, 0, mod->name) )
+            {
+              curr++;
+              cnt++;
+            }
+            if ( cnt < ptrbuf[4] && fill_kmod_range(curr, mod, mod->init_layout.base, mod->init_layout.size, 1, mod->name) )
+            {
+              curr++;
+              cnt++;
+            }
+#endif
+          }
+          mutex_unlock(m);
+          if ( bhead && block )
+          {
+            spin_lock_bh(block);
+            list_for_each_entry(ti, bhead, lnode)
+            {
+              if ( cnt >= ptrbuf[4] )
+                break;
+              if ( fill_kmod_range(curr, ti, (void *)ti->start, ti->end - ti->start, 2, ti->name) )
+              {
+                curr++;
+                cnt++;
+              }
+            }
+            spin_unlock_bh(block);
+          }
+          buf[0] = cnt;
+          kbuf_size = sizeof(unsigned long) + sizeof(struct one_kmod_range) * cnt;
+          if (copy_to_user((void*)ioctl_param, (void*)buf, kbuf_size) > 0)
+          {
+            kfree(buf);
+            return -EFAULT;
+          }
+          kfree(buf);
+        }
+      }
+     break; /* IOCTL_GET_KMOD_RANGES */
+
+    case IOCTL_GET_BPF_GRAPH:
+      if ( copy_from_user( (void*)ptrbuf, (void*)ioctl_param, sizeof(long) * 5) > 0 )
+        return -EFAULT;
+      if ( !ptrbuf[0] || !ptrbuf[1] )
+        return -EINVAL;
+      else {
+        struct bpf_graph g = { NULL, 0, 0 };
+        if ( !ptrbuf[4] )
+        {
+          collect_bpf_graph(&g, ptrbuf);
+          if (copy_to_user((void*)ioctl_param, (void*)&g.cnt, sizeof(g.cnt)) > 0)
+            return -EFAULT;
+        } else {
+          size_t kbuf_size = sizeof(unsigned long) + sizeof(struct one_bpf_edge) * ptrbuf[4];
+          unsigned long *buf = (unsigned long *)kmalloc(kbuf_size, GFP_KERNEL | __GFP_ZERO);
+          if ( !buf )
+            return -ENOMEM;
+          g.curr = (struct one_bpf_edge *)(buf + 1);
+          g.lim = ptrbuf[4];
+          collect_bpf_graph(&g, ptrbuf);
+          buf[0] = g.cnt;
+          kbuf_size = sizeof(unsigned long) + sizeof(struct one_bpf_edge) * g.cnt;
+          if (copy_to_user((void*)ioctl_param, (void*)buf, kbuf_size) > 0)
+          {
+            kfree(buf);
+            return -EFAULT;
+          }
+          kfree(buf);
+        }
+      }
+     break; /* IOCTL_GET_BPF_GRAPH */
+
     case IOCTL_PATCH_KTEXT1:
       if ( !s_patch_text )
           return -ENOCSI;
@@ -0,0 +1,170 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "allowlist.h"
+
+// FNV-1a, each part followed by zero byte
+static inline uint64_t fnv(uint64_t h, const char *s, size_t len)
+{
+  for ( size_t i = 0; i < len; i++ )
+  {
+    h ^= (unsigned char)s[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h * 0x100000001b3ULL;
+}
+
+// snapshot key without parts depending on order of objects: idx=N fields of contexts and
+// records, #N suffix of repeated unnamed handler. see canon_sink::canon for key format
+static std::string allow_location(const char *key, size_t klen)
+{
+  std::string res;
+  res.reserve(klen);
+  size_t i = 0;
+  while ( i < klen )
+  {
+    int start = !i || strchr("\t>:;", key[i - 1]);
+    if ( start && klen - i >= 4 && !memcmp(key + i, "idx=", 4) )
+    {
+      i += 4;
+      while ( i < klen && isxdigit((unsigned char)key[i]) )
+        i++;
+      if ( i < klen && key[i] == ';' )
+        i++;
+      else if ( !res.empty() && res.back() == ';' )
+        res.pop_back();
+      continue;
+    }
+    res.push_back(key[i++]);
+  }
+  // #N can be only at end of last part
+  size_t tab = res.rfind('\t');
+  size_t hash = res.rfind('#');
+  if ( hash != std::string::npos && (tab == std::string::npos || hash > tab) && hash + 1 < res.size() &&
+       res.find_first_not_of("0123456789", hash + 1) == std::string::npos )
+    res.resize(hash);
+  return res;
+}
+
+uint64_t allow_hash(const std::string &build_id, const char *key, size_t klen, const char *val, size_t vlen)
+{
+  std::string loc = allow_location(key, klen);
+  uint64_t h = 0xcbf29ce484222325ULL;
+  h = fnv(h, build_id.data(), build_id.size());
+  h = fnv(h, loc.data(), loc.size());
+  return fnv(h, val, vlen);
+}
+
+allowlist::~allowlist()
+{
+  if ( m_base != NULL )
+    munmap((void *)m_base, m_size);
+}
+
+int allowlist::load(const char *fname)
+{
+  int fd = open(fname, O_RDONLY);
+  if ( fd == -1 )
+    return errno;
+  struct stat st;
+  if ( fstat(fd, &st) )
+  {
+    int err = errno;
+    close(fd);
+    return err;
+  }
+  m_size = st.st_size;
+  if ( m_size < sizeof(allow_header) )
+  {
+    close(fd);
+    return EINVAL;
+  }
+  void *base = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if ( base == MAP_FAILED )
+    return errno;
+  m_base = (const char *)base;
+  const allow_header *hdr = (const allow_header *)m_base;
+  if ( memcmp(hdr->magic, ALLOW_MAGIC, 4) || hdr->version != ALLOW_VERSION )
+    return EINVAL;
+  if ( sizeof(allow_header) + (uint64_t)hdr->count * sizeof(uint64_t) > m_size )
+    return EINVAL;
+  if ( !memchr(hdr->build_id, 0, sizeof(hdr->build_id)) )
+    return EINVAL;
+  m_hashes = (const uint64_t *)(m_base + sizeof(allow_header));
+  m_hdr = hdr;
+  return 0;
+}
+
+int allowlist::has(uint64_t h) const
+{
+  if ( !m_hdr )
+    return 0;
+  return std::binary_search(m_hashes, m_hashes + m_hdr->count, h);
+}
+
+// if shared mapping failed only main process drops are counted
+static unsigned long s_dummy;
+
+allow_sink::allow_sink(rsink *next, const allowlist &al, const std::string &build_id)
+ : canon_sink(next),
+   m_list(al),
+   m_build_id(build_id)
+{
+  void *p = mmap(NULL, sizeof(unsigned long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  m_dropped = p != MAP_FAILED ? (unsigned long *)p : &s_dummy;
+  *m_dropped = 0;
+}
+
+allow_sink::~allow_sink()
+{
+  if ( m_dropped != &s_dummy )
+    munmap(m_dropped, sizeof(unsigned long));
+}
+
+void allow_sink::emit()
+{
+  std::string key, val;
+  if ( canon(key, val) &&
+       m_list.has(allow_hash(m_build_id, key.data(), key.size(), val.data(), val.size())) )
+  {
+    __atomic_add_fetch(m_dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  pass_to(m_next);
+}
+
+int write_allowlist(const char *fname, snap_sink *snap, const std::string &build_id)
+{
+  if ( snap == NULL )
+    return EINVAL;
+  std::vector<uint64_t> hashes;
+  int err = snap->each_item([&](const char *k, size_t klen, const char *v, size_t vlen) {
+    hashes.push_back(allow_hash(build_id, k, klen, v, vlen));
+  });
+  if ( err )
+    return err;
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+  allow_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, ALLOW_MAGIC, 4);
+  hdr.version = ALLOW_VERSION;
+  hdr.count = (uint32_t)hashes.size();
+  strncpy(hdr.build_id, build_id.c_str(), sizeof(hdr.build_id) - 1);
+  FILE *fp = fopen(fname, "wb");
+  if ( fp == NULL )
+    return errno;
+  fwrite(&hdr, sizeof(hdr), 1, fp);
+  fwrite(hashes.data(), sizeof(uint64_t), hashes.size(), fp);
+  err = ferror(fp) ? EIO : 0;
+  if ( fclose(fp) )
+    err = errno;
+  return err;
+}
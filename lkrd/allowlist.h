@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include "snapshot.h"
+
+// fleet baseline: hashes of canonical findings from known-good host
+// finding is (kernel build-id, location, target): location is snapshot key without positional
+// parts (index of unnamed list entry, #N of repeated handler) and target is snapshot value,
+// so both are symbol-relative and neither addresses nor order of objects on concrete host matter
+// file: header, then sorted unique uint64_t hashes - mmapped and searched in place
+
+#define ALLOW_MAGIC   "LKAL"
+#define ALLOW_VERSION 3
+
+struct allow_header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+  char build_id[64]; // hex, zero terminated
+};
+
+// key and val are snapshot item
+uint64_t allow_hash(const std::string &build_id, const char *key, size_t klen, const char *val, size_t vlen);
+
+class allowlist
+{
+  public:
+    allowlist()
+     : m_base(NULL),
+       m_size(0),
+       m_hdr(NULL),
+       m_hashes(NULL)
+    { }
+    ~allowlist();
+    // returns 0 on success, errno or EINVAL if file is not valid allowlist
+    int load(const char *fname);
+    int has(uint64_t) const;
+    inline uint32_t size() const
+    {
+      return m_hdr ? m_hdr->count : 0;
+    }
+    inline const char *build_id() const
+    {
+      return m_hdr ? m_hdr->build_id : "";
+    }
+  protected:
+    const char *m_base;
+    size_t m_size;
+    const allow_header *m_hdr;
+    const uint64_t *m_hashes;
+};
+
+// passes to next sink only records not found in allowlist
+// records without stable fields always passed
+class allow_sink: public canon_sink
+{
+  public:
+    allow_sink(rsink *next, const allowlist &al, const std::string &build_id);
+    virtual ~allow_sink();
+    // total for main process and all collectors
+    inline unsigned long dropped() const
+    {
+      return __atomic_load_n(m_dropped, __ATOMIC_RELAXED);
+    }
+  protected:
+    virtual void emit();
+
+    const allowlist &m_list;
+    std::string m_build_id;
+    unsigned long *m_dropped; // shared with forked collectors
+};
+
+// write hashes of all items collected by snapshot
+int write_allowlist(const char *fname, snap_sink *, const std::string &build_id);
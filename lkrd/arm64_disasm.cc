@@ -1,5 +1,6 @@
 #include "arm64_disasm.h"
 #include "cf_graph.h"
+#include "profile.h"
 
 // check if current instruction is jmp jimm
 int arm64_disasm::is_b_jimm(PBYTE &addr) const
@@ -136,6 +137,7 @@ int arm64_disasm::disasm()
   if ( m_psp + 4 >= (PBYTE)(m_text + m_text_size) )
     return 0;
   a64 addr = conv(m_psp);
+  prof_add(PC_INSNS, 1);
   if ( ArmadilloDisassemble(*(unsigned int *)m_psp, (a64)addr, &m_dis) )
     return 0;
 #ifdef _DEBUG
@@ -269,8 +271,9 @@ int arm64_disasm::process_trace_remove_event_call(a64 addr, a64 free_event_filte
   return 0;
 }
 
-int arm64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out_res)
+int arm64_disasm::process(a64 addr, const ptr_hits &skip, std::set<a64> &out_res)
 {
+  prof_add(PC_FUNCS, 1);
   statefull_graph<PBYTE, regs_pad> cgraph;
   std::list<std::pair<PBYTE, regs_pad> > addr_list;
   regs_pad tmp;
@@ -354,8 +357,7 @@ int arm64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out
              continue;
            if ( in_data(what) )
            {
-             auto was = skip.find(what);
-             if ( was == skip.end() )
+             if ( !skip.has(what) )
              {
 #ifdef _DEBUG
                if (what == 0xFFFFFFC01147EB90)
@@ -0,0 +1,163 @@
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include "collectors.h"
+
+int collector_pool::start(int max)
+{
+  if ( m_stdout != -1 )
+    return 0;
+  flush_out();
+  m_out = g_sink->get_fd();
+  if ( m_out == -1 )
+    m_out = 1;
+  m_stdout = dup(m_out);
+  if ( m_stdout == -1 )
+    return errno;
+  m_max = max;
+  m_owner = getpid();
+  if ( !new_main_slot() )
+  {
+    close(m_stdout);
+    m_stdout = -1;
+    return errno;
+  }
+  return 0;
+}
+
+int collector_pool::new_main_slot()
+{
+  int sfd = memfd_create("lkmem", 0);
+  if ( sfd == -1 )
+    return 0;
+  dup2(sfd, m_out);
+  m_slots.push_back({ sfd, 0, NULL, 1, 0 });
+  m_cur = (int)m_slots.size() - 1;
+  return 1;
+}
+
+// returns 0 in child, -1 if collector should be run inline, pid of child otherwise
+pid_t collector_pool::spawn(const char *name)
+{
+  if ( m_stdout == -1 )
+    return -1;
+  // all printed so far belongs to current main slot
+  flush_out();
+  while ( m_running >= m_max )
+    wait_one();
+  int sfd = memfd_create(name, 0);
+  if ( sfd == -1 )
+    return -1;
+  pid_t pid = fork();
+  if ( pid < 0 )
+  {
+    close(sfd);
+    return -1;
+  }
+  if ( !pid )
+  {
+    dup2(sfd, m_out);
+    close(sfd);
+    return 0;
+  }
+  m_slots.push_back({ sfd, pid, name, 0, 0 });
+  m_running++;
+  if ( !new_main_slot() )
+  {
+    // cannot continue buffering - wait all and write directly
+    finish();
+    return pid;
+  }
+  flush_ready();
+  return pid;
+}
+
+void collector_pool::reap(slot &s, int flags)
+{
+  if ( s.reaped )
+    return;
+  int st = 0;
+  pid_t res;
+  do {
+    res = waitpid(s.pid, &st, flags);
+  } while ( res == -1 && errno == EINTR );
+  if ( !res )
+    return;
+  s.reaped = 1;
+  s.status = st;
+  m_running--;
+}
+
+void collector_pool::wait_one()
+{
+  // wait oldest running collector - its output will be flushed first anyway
+  for ( auto &s: m_slots )
+  {
+    if ( s.reaped )
+      continue;
+    reap(s, 0);
+    return;
+  }
+  m_running = 0;
+}
+
+void collector_pool::flush_slot(slot &s)
+{
+  char buf[8192];
+  lseek(s.fd, 0, SEEK_SET);
+  ssize_t rd;
+  while( (rd = read(s.fd, buf, sizeof(buf))) > 0 )
+  {
+    char *p = buf;
+    while ( rd > 0 )
+    {
+      ssize_t wr = write(m_stdout, p, rd);
+      if ( wr <= 0 )
+        break;
+      p += wr;
+      rd -= wr;
+    }
+  }
+  close(s.fd);
+  s.fd = -1;
+  if ( s.pid && (!WIFEXITED(s.status) || WEXITSTATUS(s.status)) )
+    dprintf(m_stdout, "collector %s failed, status %X\n", s.name, s.status);
+}
+
+// write output of all finished slots from head of queue
+void collector_pool::flush_ready()
+{
+  for ( ; m_flushed < m_slots.size(); m_flushed++ )
+  {
+    slot &s = m_slots[m_flushed];
+    if ( (int)m_flushed == m_cur )
+      return;
+    if ( s.pid )
+    {
+      reap(s, WNOHANG);
+      if ( !s.reaped )
+        return;
+    }
+    flush_slot(s);
+  }
+}
+
+void collector_pool::finish()
+{
+  if ( m_stdout == -1 || getpid() != m_owner )
+    return;
+  flush_out();
+  m_cur = -1;
+  for ( ; m_flushed < m_slots.size(); m_flushed++ )
+  {
+    slot &s = m_slots[m_flushed];
+    if ( s.pid )
+      reap(s, 0);
+    flush_slot(s);
+  }
+  m_slots.clear();
+  m_flushed = 0;
+  dup2(m_stdout, m_out);
+  close(m_stdout);
+  m_stdout = -1;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <sys/types.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <functional>
+#include <vector>
+#include "rsink.h"
+#include "profile.h"
+#include "kdev.h"
+
+// runs independent collectors concurrently
+// each collector is forked child with own /dev/lkcd fd and output redirected to memfd
+// output is stdout or fd of structured g_sink
+// main process output also goes to memfd slots, so all output is flushed in the same order
+// as with sequential run
+// fork instead of threads bcs collectors print to stdout and use lots of globals
+class collector_pool
+{
+  public:
+    collector_pool()
+     : m_max(0),
+       m_running(0),
+       m_cur(-1),
+       m_flushed(0),
+       m_stdout(-1),
+       m_out(1),
+       m_owner(0),
+       m_resident(0)
+    { }
+    ~collector_pool()
+    {
+      finish();
+    }
+    // start buffering, max - number of concurrently running collectors
+    int start(int max);
+    // run func(fd) - in child if pool started or inline
+    template <typename F>
+    void run(const char *name, int fd, F func)
+    {
+      if ( m_resident )
+      {
+        m_kept.push_back({ name, fd, func });
+        return;
+      }
+      pid_t pid = spawn(name);
+      if ( pid > 0 )
+        return;
+      if ( pid < 0 )
+      {
+        prof_scope ps(name);
+        g_sink->set_scope(name);
+        kdev_set_scope(name);
+        func(fd);
+        g_sink->set_scope(NULL);
+        kdev_set_scope(NULL);
+        return;
+      }
+      // child
+      g_sink->set_scope(name);
+      kdev_set_scope(name);
+      int cfd = kdev_open();
+      {
+        prof_scope ps(name);
+        func(cfd != -1 ? cfd : fd);
+      }
+      flush_out();
+      _exit(0);
+    }
+    // wait for all collectors and flush their output, restore stdout
+    void finish();
+    inline int started() const
+    {
+      return m_stdout != -1;
+    }
+    // daemon mode: run() only remembers collectors, all captured state must outlive main body
+    struct kept
+    {
+      const char *name;
+      int fd;
+      std::function<void(int)> func;
+    };
+    inline void set_resident(int v)
+    {
+      m_resident = v;
+    }
+    inline const std::vector<kept> &get_kept() const
+    {
+      return m_kept;
+    }
+  protected:
+    struct slot
+    {
+      int fd;
+      pid_t pid; // 0 for main process output
+      const char *name;
+      int reaped;
+      int status;
+    };
+    static void flush_out()
+    {
+      fflush(stdout);
+      g_sink->flush();
+    }
+    pid_t spawn(const char *name);
+    int new_main_slot();
+    void wait_one();
+    void reap(slot &, int flags);
+    void flush_ready();
+    void flush_slot(slot &);
+
+    std::vector<slot> m_slots;
+    int m_max;
+    int m_running;
+    int m_cur;     // index of current main slot
+    size_t m_flushed;
+    int m_stdout;  // saved original output
+    int m_out;     // redirected fd
+    pid_t m_owner;
+    int m_resident;
+    std::vector<kept> m_kept;
+};
@@ -0,0 +1,332 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <string.h>
+#include <algorithm>
+#include "daemon.h"
+#include "kmem.h"
+
+// limits for clients: max connections at once and seconds to send command and read reply
+static const size_t s_max_conns = 16;
+static const int s_conn_timeout = 10;
+
+lk_daemon::~lk_daemon()
+{
+  drop_conns();
+  if ( m_sock != -1 )
+  {
+    close(m_sock);
+    unlink(m_path.c_str());
+  }
+}
+
+int lk_daemon::set_intervals(const char *s)
+{
+  while ( *s )
+  {
+    const char *eq = strchr(s, '=');
+    if ( eq == NULL || eq == s )
+      return 0;
+    char *end;
+    long v = strtol(eq + 1, &end, 10);
+    if ( end == eq + 1 || v < 0 || (*end && *end != ',') )
+      return 0;
+    m_intervals[std::string(s, eq - s)] = (int)v;
+    s = *end ? end + 1 : end;
+  }
+  return 1;
+}
+
+lk_daemon::subsys *lk_daemon::find(const char *name)
+{
+  for ( auto &s: m_subs )
+    if ( !strcmp(s.c->name, name) )
+      return &s;
+  return NULL;
+}
+
+void lk_daemon::scan(subsys &s)
+{
+  int mfd = memfd_create(s.c->name, 0);
+  if ( mfd == -1 )
+  {
+    s.status = errno;
+    return;
+  }
+  fflush(stdout);
+  g_sink->flush();
+  pid_t pid = fork();
+  if ( pid < 0 )
+  {
+    s.status = errno;
+    close(mfd);
+    return;
+  }
+  if ( !pid )
+  {
+    // child - output of collector goes to memfd
+    close(m_sock);
+    for ( auto &c: m_conns )
+      close(c.fd);
+    int out = g_sink->get_fd();
+    dup2(mfd, out == -1 ? 1 : out);
+    g_sink->set_scope(s.c->name);
+    kdev_set_scope(s.c->name);
+    int cfd = kdev_open();
+    if ( m_refresh )
+      m_refresh(cfd);
+    // pages cached by previous scan are stale
+    if ( g_kmem != NULL )
+      g_kmem->invalidate();
+    s.c->func(cfd != -1 ? cfd : s.c->fd);
+    fflush(stdout);
+    g_sink->flush();
+    _exit(0);
+  }
+  int st = 0;
+  while ( waitpid(pid, &st, 0) == -1 && errno == EINTR )
+    ;
+  s.status = st;
+  s.last = time(NULL);
+  s.scans++;
+  s.prev.swap(s.cur);
+  s.cur.clear();
+  struct stat fst;
+  if ( !fstat(mfd, &fst) && fst.st_size )
+  {
+    s.cur.resize(fst.st_size);
+    if ( pread(mfd, &s.cur[0], fst.st_size, 0) != fst.st_size )
+      s.cur.clear();
+  }
+  close(mfd);
+}
+
+void lk_daemon::list(std::string &out) const
+{
+  char buf[256];
+  time_t now = time(NULL);
+  for ( auto &s: m_subs )
+  {
+    snprintf(buf, sizeof(buf), "%s interval %d scans %ld age %ld status %X\n", s.c->name, s.interval,
+      s.scans, s.scans ? (long)(now - s.last) : -1L, s.status);
+    out += buf;
+  }
+}
+
+static void split_lines(const std::string &s, std::vector<std::string> &res)
+{
+  size_t pos = 0;
+  while ( pos < s.size() )
+  {
+    size_t eol = s.find('\n', pos);
+    if ( eol == std::string::npos )
+      eol = s.size();
+    res.emplace_back(s, pos, eol - pos);
+    pos = eol + 1;
+  }
+  std::sort(res.begin(), res.end());
+}
+
+// lines are compared as multisets - order of objects in kernel lists can change between scans
+void lk_daemon::diff(const subsys &s, std::string &out) const
+{
+  std::vector<std::string> o, n;
+  split_lines(s.prev, o);
+  split_lines(s.cur, n);
+  size_t i = 0, j = 0;
+  while ( i < o.size() || j < n.size() )
+  {
+    int cmp = i >= o.size() ? 1 : (j >= n.size() ? -1 : o[i].compare(n[j]));
+    if ( !cmp )
+    {
+      i++;
+      j++;
+      continue;
+    }
+    if ( cmp < 0 )
+    {
+      out += "- ";
+      out += o[i++];
+    } else {
+      out += "+ ";
+      out += n[j++];
+    }
+    out.push_back('\n');
+  }
+}
+
+void lk_daemon::drop_conns()
+{
+  for ( auto &c: m_conns )
+    close(c.fd);
+  m_conns.clear();
+}
+
+void lk_daemon::command(char *cmd, std::string &out)
+{
+  char *eol = strpbrk(cmd, "\r\n");
+  if ( eol != NULL )
+    *eol = 0;
+  char *arg = strchr(cmd, ' ');
+  if ( arg != NULL )
+    *arg++ = 0;
+  subsys *s = NULL;
+  if ( !strcmp(cmd, "list") )
+    list(out);
+  else if ( arg == NULL || (strcmp(cmd, "get") && strcmp(cmd, "diff") && strcmp(cmd, "scan")) )
+    out = "unknown command\n";
+  else if ( !strcmp(cmd, "scan") && !strcmp(arg, "all") )
+  {
+    for ( auto &ss: m_subs )
+      scan(ss);
+    list(out);
+  } else if ( (s = find(arg)) == NULL )
+    out = "unknown collector\n";
+  else if ( !strcmp(cmd, "get") )
+    out = s->cur;
+  else if ( !strcmp(cmd, "diff") )
+    diff(*s, out);
+  else {
+    scan(*s);
+    out = s->cur;
+  }
+}
+
+// command is one line up to 255 chars, connection closed by client also ends it
+int lk_daemon::on_read(conn &c)
+{
+  char buf[256];
+  ssize_t rd = read(c.fd, buf, sizeof(buf) - 1 - c.in.size());
+  if ( rd < 0 )
+    return errno == EAGAIN || errno == EINTR;
+  c.in.append(buf, rd);
+  if ( rd && c.in.size() < sizeof(buf) - 1 && c.in.find('\n') == std::string::npos )
+    return 1;
+  std::string cmd = c.in;
+  command(&cmd[0], c.out);
+  c.replied = 1;
+  c.sent = 0;
+  return on_write(c);
+}
+
+int lk_daemon::on_write(conn &c)
+{
+  while ( c.sent < c.out.size() )
+  {
+    ssize_t wr = write(c.fd, c.out.data() + c.sent, c.out.size() - c.sent);
+    if ( wr < 0 )
+      return errno == EAGAIN || errno == EINTR;
+    c.sent += wr;
+  }
+  return 0;
+}
+
+int lk_daemon::serve(const char *path, const std::vector<collector_pool::kept> &kept)
+{
+  if ( kept.empty() )
+    return ENOENT;
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  if ( strlen(path) >= sizeof(sa.sun_path) )
+    return ENAMETOOLONG;
+  strcpy(sa.sun_path, path);
+  m_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if ( m_sock == -1 )
+    return errno;
+  unlink(path);
+  m_path = path;
+  if ( bind(m_sock, (struct sockaddr *)&sa, sizeof(sa)) || chmod(path, 0600) || listen(m_sock, 8) )
+    return errno;
+  signal(SIGPIPE, SIG_IGN);
+  for ( auto &k: kept )
+  {
+    auto it = m_intervals.find(k.name);
+    int interval = it == m_intervals.end() ? m_interval : it->second;
+    m_subs.push_back({ &k, interval, 0, 0, 0, 0, std::string(), std::string() });
+  }
+  printf("daemon: %ld collectors, listening on %s\n", m_subs.size(), path);
+  fflush(stdout);
+  std::vector<struct pollfd> pfds;
+  for ( ;; )
+  {
+    // first scan of all collectors right at start, then each by own interval
+    int wait = INT_MAX;
+    for ( auto &s: m_subs )
+    {
+      if ( s.scans && !s.interval )
+        continue;
+      time_t now = time(NULL);
+      if ( s.next <= now )
+      {
+        scan(s);
+        s.next = time(NULL) + s.interval;
+      }
+      if ( !s.interval )
+        continue;
+      long left = (long)(s.next - time(NULL));
+      if ( left < 0 )
+        left = 0;
+      if ( left < wait )
+        wait = (int)left;
+    }
+    // drop clients which are too slow
+    time_t now = time(NULL);
+    for ( size_t i = 0; i < m_conns.size(); )
+    {
+      long left = (long)(m_conns[i].start + s_conn_timeout - now);
+      if ( left > 0 )
+      {
+        if ( left < wait )
+          wait = (int)left;
+        i++;
+        continue;
+      }
+      close(m_conns[i].fd);
+      m_conns.erase(m_conns.begin() + i);
+    }
+    pfds.clear();
+    for ( auto &c: m_conns )
+      pfds.push_back({ c.fd, (short)(c.replied ? POLLOUT : POLLIN), 0 });
+    // backlog of listen holds the rest
+    if ( m_conns.size() < s_max_conns )
+      pfds.push_back({ m_sock, POLLIN, 0 });
+    int res = poll(pfds.data(), pfds.size(), wait == INT_MAX ? -1 : wait * 1000);
+    if ( res < 0 && errno != EINTR )
+      return errno;
+    if ( res <= 0 )
+      continue;
+    // connections first - accept appends to m_conns
+    size_t nconns = m_conns.size();
+    std::vector<conn> alive;
+    for ( size_t i = 0; i < nconns; i++ )
+    {
+      conn &c = m_conns[i];
+      int keep = 1;
+      if ( pfds[i].revents & (POLLERR | POLLNVAL) )
+        keep = 0;
+      else if ( pfds[i].revents & (POLLIN | POLLHUP) && !c.replied )
+        keep = on_read(c);
+      else if ( pfds[i].revents & (POLLOUT | POLLHUP) )
+        keep = on_write(c);
+      if ( keep )
+        alive.push_back(std::move(c));
+      else
+        close(c.fd);
+    }
+    m_conns.swap(alive);
+    if ( pfds.size() > nconns && (pfds[nconns].revents & POLLIN) )
+    {
+      int cfd = accept4(m_sock, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+      if ( cfd != -1 )
+        m_conns.push_back({ cfd, time(NULL), std::string(), std::string(), 0, 0 });
+    }
+  }
+  return 0;
+}
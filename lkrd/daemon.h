@@ -0,0 +1,77 @@
+#pragma once
+#include <time.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "collectors.h"
+
+// resident mode: vmlinux analysis, symbols and /dev/lkcd stay loaded and collectors are rescanned
+// periodically, each scan in forked child so crash or leaks of one collector don't hurt daemon
+// results are served over unix socket, one command per connection:
+//  list           - collectors with interval, number of scans, seconds since last scan and exit status
+//  get name       - output of last scan
+//  diff name      - lines added (+) and removed (-) in last scan compared with previous
+//  scan name|all  - rescan now, returns output of scan or list for all
+// clients are served from the same poll loop which runs interval scans, so idle or slow
+// client doesn't delay them
+class lk_daemon
+{
+  public:
+    lk_daemon()
+     : m_interval(60),
+       m_sock(-1)
+    { }
+    ~lk_daemon();
+    // default rescan interval in seconds, 0 - only on request
+    inline void set_interval(int secs)
+    {
+      m_interval = secs;
+    }
+    // per collector intervals: name=secs,name2=secs. returns 0 on bad syntax
+    int set_intervals(const char *);
+    // called in scan child before collector, for example to reread list of modules
+    inline void set_refresh(std::function<void(int)> f)
+    {
+      m_refresh = f;
+    }
+    // never returns on success
+    int serve(const char *path, const std::vector<collector_pool::kept> &);
+  protected:
+    struct subsys
+    {
+      const collector_pool::kept *c;
+      int interval;
+      time_t next;
+      time_t last;
+      unsigned long scans;
+      int status;
+      std::string cur, prev;
+    };
+    // connection: command is read into in, then out is written back
+    struct conn
+    {
+      int fd;
+      time_t start;
+      std::string in, out;
+      size_t sent;
+      int replied;
+    };
+    void scan(subsys &);
+    subsys *find(const char *name);
+    void command(char *cmd, std::string &out);
+    // returns 0 when connection is finished and must be closed
+    int on_read(conn &);
+    int on_write(conn &);
+    void drop_conns();
+    void list(std::string &) const;
+    void diff(const subsys &, std::string &) const;
+
+    int m_interval;
+    int m_sock;
+    std::string m_path;
+    std::map<std::string, int> m_intervals;
+    std::function<void(int)> m_refresh;
+    std::vector<subsys> m_subs;
+    std::vector<conn> m_conns;
+};
@@ -3,6 +3,7 @@
 #include <set>
 #include <vector>
 #include "types.h"
+#include "ptr_scan.h"
 
 struct lsm_hook
 {
@@ -67,7 +68,7 @@ class dis_base
       }
       return res;
     }
-    virtual int process(a64 addr, std::map<a64, a64> &, std::set<a64> &out_res) = 0;
+    virtual int process(a64 addr, const ptr_hits &, std::set<a64> &out_res) = 0;
     virtual int process_sl(lsm_hook &) = 0;
     // find address of bpf target list from bpf_iter_reg_target
     virtual a64 process_bpf_target(a64 addr, a64 mlock) = 0;
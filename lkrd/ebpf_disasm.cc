@@ -1,6 +1,10 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
 #include <map>
 #include <list>
-#include <elfio/elfio_dump.hpp>
+#include <algorithm>
+#include <mutex>
 #include "ksyms.h"
 #include "ebpf_disasm.h"
 
@@ -8,91 +12,89 @@
 struct bpf_op
 {
   const char *name;
-  void (*dump)(FILE *, const char *, const struct bpf_insn *);
+  void (*dump)(FILE *, const char *, const struct ebpf_ins *);
 };
 
-static void reg_imm64(FILE *fp, const char *name, const struct bpf_insn *op)
+static void reg_imm64(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  unsigned int vlow = (unsigned int)op->imm;
-  unsigned long vhigh = (unsigned long)op[1].imm << 32;
-  unsigned long val = vlow | vhigh;
-  fprintf(fp, "%s r%d, %lX\n", name, op->dst_reg, val);
+  if ( op->name != NULL )
+    fprintf(fp, "%s r%d, %lX ; %s\n", name, op->dst, op->imm64, op->name);
+  else
+    fprintf(fp, "%s r%d, %lX\n", name, op->dst, op->imm64);
 }
 
-static void reg_imm(FILE *fp, const char *name, const struct bpf_insn *op)
+static void reg_imm(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s r%d, %d\n", name, op->dst_reg, op->imm);
+  fprintf(fp, "%s r%d, %d\n", name, op->dst, op->imm);
 }
 
-static void reg1(FILE *fp, const char *name, const struct bpf_insn *op)
+static void reg1(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s r%d\n", name, op->dst_reg);
+  fprintf(fp, "%s r%d\n", name, op->dst);
 }
 
-static void reg2(FILE *fp, const char *name, const struct bpf_insn *op)
+static void reg2(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s r%d, r%d\n", name, op->dst_reg, op->src_reg);
+  fprintf(fp, "%s r%d, r%d\n", name, op->dst, op->src);
 }
 
-static void phrase_imm(FILE *fp, const char *name, const struct bpf_insn *op)
+static void phrase_imm(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
   fprintf(fp, "%s r0, [%d]\n", name, op->imm);
 }
 
-static void reg_regdisp(FILE *fp, const char *name, const struct bpf_insn *op)
+static void reg_regdisp(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
   if ( op->code == 0x40 || op->code == 0x48 || op->code == 0x50 || op->code == 0x58 )
-    fprintf(fp, "%s r0, [r%d + %d]\n", name, op->src_reg, op->imm);
+    fprintf(fp, "%s r0, [r%d + %d]\n", name, op->src, op->imm);
   else
-    fprintf(fp, "%s r%d, [r%d + %d]\n", name, op->dst_reg, op->src_reg, op->off);
+    fprintf(fp, "%s r%d, [r%d + %d]\n", name, op->dst, op->src, op->off);
 }
 
-static void regdisp_reg(FILE *fp, const char *name, const struct bpf_insn *op)
+static void regdisp_reg(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s [r%d + %d], r%d\n", name, op->dst_reg, op->off, op->src_reg);
+  fprintf(fp, "%s [r%d + %d], r%d\n", name, op->dst, op->off, op->src);
 }
 
-static void lock(FILE *fp, const char *name, const struct bpf_insn *op)
+static void lock(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s [r%d + %d], r%d, %d\n", name, op->dst_reg, op->off, op->src_reg, op->imm);
+  fprintf(fp, "%s [r%d + %d], r%d, %d\n", name, op->dst, op->off, op->src, op->imm);
 }
 
-static void nop(FILE *fp, const char *name, const struct bpf_insn *op)
+static void nop(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
   fprintf(fp, "%s\n", name);
 }
 
-static void jmp(FILE *fp, const char *name, const struct bpf_insn *op)
+static void jmp(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
   fprintf(fp, "%s %d\n", name, op->off);
 }
 
-static void call(FILE *fp, const char *op_name, const struct bpf_insn *op)
+static void call(FILE *fp, const char *op_name, const struct ebpf_ins *op)
 {
-  a64 base = get_addr("__bpf_call_base");
-  if ( base )
-  {
-    a64 addr = base + (int)op->imm;
-    const char *name = name_by_addr(addr);
-    if ( name != NULL )
-      fprintf(fp, "%s 0x%X ; %s\n", op_name, op->imm, name);
-    else
-      fprintf(fp, "%s 0x%X ; %lX\n", op_name, op->imm, addr);
-  } else
+  if ( op->kind == EK_PCALL )
+    fprintf(fp, "%s 0x%X ; %d\n", op_name, op->imm, op->slot + 1 + op->imm);
+  else if ( op->name != NULL )
+    fprintf(fp, "%s 0x%X ; %s\n", op_name, op->imm, op->name);
+  else if ( op->imm64 )
+    fprintf(fp, "%s 0x%X ; %lX\n", op_name, op->imm, op->imm64);
+  else
     fprintf(fp, "%s 0x%X\n", op_name, op->imm);
 }
 
-static void jmp_reg_imm(FILE *fp, const char *name, const struct bpf_insn *op)
+static void jmp_reg_imm(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s r%d, %d, %d\n", name, op->dst_reg, op->imm, op->off);
+  fprintf(fp, "%s r%d, %d, %d\n", name, op->dst, op->imm, op->off);
 }
 
-static void jmp_reg_reg(FILE *fp, const char *name, const struct bpf_insn *op)
+static void jmp_reg_reg(FILE *fp, const char *name, const struct ebpf_ins *op)
 {
-  fprintf(fp, "%s r%d, r%d, %d\n", name, op->dst_reg, op->src_reg, op->off);
+  fprintf(fp, "%s r%d, r%d, %d\n", name, op->dst, op->src, op->off);
 }
 
 std::map<int, bpf_op> s_ops;
+static std::once_flag s_ops_once;
 
 void init_ops()
 {
@@ -189,34 +191,211 @@ void init_ops()
   s_ops[0xdd] = { "jsle", jmp_reg_reg };
   // call
   s_ops[0x85] = { "call", call };
+  s_ops[0xf5] = { "tail_call", nop };
   // retn
   s_ops[0x95] = { "ret", nop };
 }
 
-void ebpf_disasm(unsigned char *buf, long len, FILE *out_fp)
+// helpers by address of function from bpf_xxx_proto, filled once on first call - decode can run in several threads
+static std::map<a64, const char *> s_helpers;
+static std::once_flag s_helpers_once;
+
+static void fill_helpers()
 {
-  if ( s_ops.empty() )
-    init_ops();
-  for ( long i = 0; i < len; i++, buf += sizeof(bpf_insn) )
+  std::list<one_bpf_proto> protos;
+  fill_bpf_protos(protos);
+  for ( auto &p: protos )
+    s_helpers[p.func.addr] = p.func.name;
+}
+
+static const char *helper_name(a64 addr)
+{
+  std::call_once(s_helpers_once, fill_helpers);
+  auto hi = s_helpers.find(addr);
+  if ( hi != s_helpers.end() )
+    return hi->second;
+  // inlined map ops and kfuncs
+  return name_by_addr(addr);
+}
+
+static int ebpf_kind_of(const bpf_insn *op)
+{
+  switch(op->code & 7)
+  {
+    case 0: // BPF_LD
+      return op->code == 0x18 ? EK_LDDW : EK_LD;
+    case 1: // BPF_LDX
+      return EK_LD;
+    case 2: // BPF_ST
+      return EK_ST;
+    case 3: // BPF_STX
+      return (op->code & 0xe0) == 0xc0 ? EK_ATOMIC : EK_ST;
+    case 4: // BPF_ALU
+    case 7: // BPF_ALU64
+      return EK_ALU;
+  }
+  // BPF_JMP & BPF_JMP32
+  switch(op->code)
   {
-     bpf_insn *op = (bpf_insn *)buf;
-     auto li = s_ops.find(op->code);
-     if ( li == s_ops.end() )
-       fprintf(out_fp, "%ld %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X invalid opcode %X\n", i, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7], op->code);
-     else {
-       if ( op->code == 0x18 )
-       {
-         fprintf(out_fp, "%ld %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X ", i, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7],
-           buf[8], buf[9], buf[10], buf[11], buf[12], buf[13], buf[14], buf[15]
-         );
-         li->second.dump(out_fp, li->second.name, op);
-         ++i;
-         buf += sizeof(bpf_insn);
-       } else
-       {
-         fprintf(out_fp, "%ld %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X ", i, buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]);
-         li->second.dump(out_fp, li->second.name, op);
-       }
-     }
+    case 0x85:
+      if ( op->src_reg == 1 )
+        return EK_PCALL;
+      return op->src_reg == 2 ? EK_KFUNC : EK_CALL;
+    case 0xf5: return EK_TAIL_CALL;
+    case 0x95: return EK_EXIT;
   }
-}
\ No newline at end of file
+  return EK_JMP;
+}
+
+static inline int is_cond_jmp(const ebpf_ins &ins)
+{
+  return ins.kind == EK_JMP && ins.code != 0x05 && ins.code != 0x06;
+}
+
+void ebpf_decode(const unsigned char *buf, long len, ebpf_ir &ir, const std::map<void *, std::string> *map_names)
+{
+  std::call_once(s_ops_once, init_ops);
+  ir.insns.clear();
+  ir.body.assign(buf, buf + (len > 0 ? len * sizeof(bpf_insn) : 0));
+  ir.bbs.clear();
+  ir.bb_of.clear();
+  if ( len <= 0 )
+    return;
+  ir.insns.reserve(len);
+  a64 base = get_addr("__bpf_call_base");
+  const bpf_insn *ops = (const bpf_insn *)buf;
+  // index of instruction for each slot, second slot of lddw points to lddw
+  std::vector<int> slot2idx(len + 1, -1);
+  for ( long i = 0; i < len; i++ )
+  {
+    const bpf_insn *op = ops + i;
+    ebpf_ins ins;
+    ins.slot = i;
+    ins.target = -1;
+    ins.code = op->code;
+    ins.dst = op->dst_reg;
+    ins.src = op->src_reg;
+    ins.off = op->off;
+    ins.imm = op->imm;
+    ins.imm64 = 0;
+    ins.name = NULL;
+    ins.kind = s_ops.find(op->code) == s_ops.end() ? EK_INVALID : ebpf_kind_of(op);
+    slot2idx[i] = ir.insns.size();
+    switch(ins.kind)
+    {
+      case EK_LDDW:
+        if ( i + 1 < len )
+        {
+          ins.imm64 = (unsigned int)op->imm | ((unsigned long)op[1].imm << 32);
+          slot2idx[++i] = ir.insns.size();
+        } else
+          ins.kind = EK_INVALID;
+        // verifier replaces map fd with address of map
+        if ( map_names != NULL && ins.imm64 )
+        {
+          auto mi = map_names->find((void *)ins.imm64);
+          if ( mi != map_names->end() )
+            ins.name = mi->second.c_str();
+        }
+       break;
+      case EK_CALL:
+      case EK_KFUNC:
+        if ( base )
+        {
+          ins.imm64 = base + op->imm;
+          ins.name = helper_name(ins.imm64);
+        }
+       break;
+    }
+    ir.insns.push_back(ins);
+  }
+  // resolve targets, they are in slots relative to next insn
+  for ( auto &ins: ir.insns )
+  {
+    long to;
+    if ( ins.kind == EK_JMP )
+      to = (long)ins.slot + 1 + (ins.code == 0x06 ? ins.imm : ins.off);
+    else if ( ins.kind == EK_PCALL )
+      to = (long)ins.slot + 1 + ins.imm;
+    else
+      continue;
+    if ( to >= 0 && to < len )
+      ins.target = slot2idx[to];
+  }
+  // leaders of basic blocks
+  size_t n = ir.insns.size();
+  std::vector<char> leader(n + 1, 0);
+  leader[0] = 1;
+  for ( size_t i = 0; i < n; i++ )
+  {
+    const ebpf_ins &ins = ir.insns[i];
+    if ( ins.kind == EK_JMP || ins.kind == EK_EXIT )
+    {
+      leader[i + 1] = 1;
+      if ( ins.target >= 0 )
+        leader[ins.target] = 1;
+    }
+    if ( ins.kind == EK_PCALL && ins.target >= 0 )
+      leader[ins.target] = 1;
+  }
+  ir.bb_of.resize(n);
+  for ( size_t i = 0; i < n; i++ )
+  {
+    if ( leader[i] )
+      ir.bbs.push_back({ (unsigned int)i, (unsigned int)i, { -1, -1 } });
+    ir.bbs.back().end = i + 1;
+    ir.bb_of[i] = ir.bbs.size() - 1;
+  }
+  // edges
+  for ( size_t b = 0; b < ir.bbs.size(); b++ )
+  {
+    ebpf_bb &bb = ir.bbs[b];
+    const ebpf_ins &last = ir.insns[bb.end - 1];
+    int k = 0;
+    if ( last.kind == EK_JMP && last.target >= 0 )
+      bb.succ[k++] = ir.bb_of[last.target];
+    if ( last.kind == EK_EXIT || last.kind == EK_INVALID )
+      continue;
+    if ( last.kind == EK_JMP && !is_cond_jmp(last) )
+      continue;
+    if ( bb.end < n )
+      bb.succ[k] = b + 1;
+  }
+}
+
+void ebpf_print(const ebpf_ir &ir, FILE *out_fp)
+{
+  for ( size_t i = 0; i < ir.insns.size(); i++ )
+  {
+    const ebpf_ins *op = &ir.insns[i];
+    if ( ir.bbs.size() > 1 && ir.bbs[ir.bb_of[i]].start == i )
+      fprintf(out_fp, "; bb %d\n", ir.bb_of[i]);
+    // raw bytes, second slot of lddw can't be rebuilt from decoded fields
+    unsigned char b[16];
+    memset(b, 0, sizeof(b));
+    size_t boff = op->slot * sizeof(bpf_insn);
+    if ( boff < ir.body.size() )
+      memcpy(b, ir.body.data() + boff, std::min(sizeof(b), ir.body.size() - boff));
+    if ( op->kind == EK_INVALID )
+    {
+      fprintf(out_fp, "%d %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X invalid opcode %X\n", op->slot, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], op->code);
+      continue;
+    }
+    auto li = s_ops.find(op->code);
+    if ( op->kind == EK_LDDW )
+    {
+      fprintf(out_fp, "%d %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X ", op->slot, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7],
+        b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]
+      );
+    } else
+      fprintf(out_fp, "%d %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X %2.2X ", op->slot, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7]);
+    li->second.dump(out_fp, li->second.name, op);
+  }
+}
+
+void ebpf_disasm(unsigned char *buf, long len, FILE *out_fp, const std::map<void *, std::string> *map_names)
+{
+  ebpf_ir ir;
+  ebpf_decode(buf, len, ir, map_names);
+  ebpf_print(ir, out_fp);
+}
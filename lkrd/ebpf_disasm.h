@@ -1,4 +1,8 @@
 #pragma once
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
 
 struct bpf_insn {
   unsigned char	code;		/* opcode */
@@ -8,4 +12,55 @@ struct bpf_insn {
   int	imm;			/* signed immediate constant */
 };
 
-void ebpf_disasm(unsigned char *, long len, FILE *);
\ No newline at end of file
+// decoded eBPF program: vector of instructions with basic blocks
+// ebpf_disasm is just printer of it, other analysis (used helpers, maps, tail calls) should use ebpf_decode
+enum ebpf_kind
+{
+  EK_INVALID = 0,
+  EK_ALU,
+  EK_LDDW,      // 2 slots, imm64 is constant or address of map
+  EK_LD,        // ld_abs/ld_ind and ldx
+  EK_ST,
+  EK_ATOMIC,
+  EK_JMP,       // ja and conditional jumps
+  EK_CALL,      // helper, imm64 is address
+  EK_KFUNC,     // call of kernel function, imm64 is address
+  EK_PCALL,     // bpf to bpf call
+  EK_TAIL_CALL,
+  EK_EXIT
+};
+
+struct ebpf_ins
+{
+  unsigned int slot;    // index of first 8 byte slot in program
+  int target;           // index in ebpf_ir.insns of jump or bpf to bpf call target, -1 if none
+  unsigned char code;
+  unsigned char kind;
+  unsigned char dst;
+  unsigned char src;
+  short off;
+  int imm;
+  unsigned long imm64;  // lddw value or call address
+  const char *name;     // helper or map name, NULL if unknown
+};
+
+struct ebpf_bb
+{
+  unsigned int start, end; // [start, end) in ebpf_ir.insns
+  int succ[2];             // indexes of successor blocks, -1 if none
+};
+
+struct ebpf_ir
+{
+  std::vector<ebpf_ins> insns;
+  std::vector<ebpf_bb> bbs;
+  // index of block for each instruction
+  std::vector<unsigned int> bb_of;
+  // copy of decoded program for printing raw bytes
+  std::vector<unsigned char> body;
+};
+
+// map_names - addresses of maps from dump_bpf_maps, can be NULL
+void ebpf_decode(const unsigned char *, long len, ebpf_ir &, const std::map<void *, std::string> *map_names = NULL);
+void ebpf_print(const ebpf_ir &, FILE *);
+void ebpf_disasm(unsigned char *, long len, FILE *, const std::map<void *, std::string> *map_names = NULL);
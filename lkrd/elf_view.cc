@@ -0,0 +1,313 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include "elf_view.h"
+
+void elf_convertor::setup(unsigned char encoding)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  m_swap = (encoding == ELFDATA2MSB);
+#else
+  m_swap = (encoding == ELFDATA2LSB);
+#endif
+}
+
+static long s_page_size = 0;
+
+static void advise_range(const char *start, size_t size, int advice)
+{
+  if ( start == NULL || !size )
+    return;
+  if ( !s_page_size )
+    s_page_size = sysconf(_SC_PAGESIZE);
+  // madvise wants page-aligned address
+  uintptr_t from = (uintptr_t)start & ~(uintptr_t)(s_page_size - 1);
+  madvise((void *)from, (uintptr_t)start + size - from, advice);
+}
+
+void elf_view::advise(const char *start, size_t size, int advice) const
+{
+  advise_range(start, size, advice);
+}
+
+void elf_section::advise(int advice) const
+{
+  advise_range(m_data, m_hdr.sh_size, advice);
+}
+
+elf_view::elf_view()
+{
+  m_map = NULL;
+  m_size = 0;
+  memset(&m_hdr, 0, sizeof(m_hdr));
+}
+
+elf_view::~elf_view()
+{
+  if ( m_map != NULL )
+    munmap(m_map, m_size);
+}
+
+bool elf_view::unload()
+{
+  if ( m_map != NULL )
+    munmap(m_map, m_size);
+  m_map = NULL;
+  m_size = 0;
+  sections.m_items.clear();
+  segments.m_items.clear();
+  return false;
+}
+
+void elf_view::conv_shdr(Elf64_Shdr &s) const
+{
+  s.sh_name      = m_conv(s.sh_name);
+  s.sh_type      = m_conv(s.sh_type);
+  s.sh_flags     = m_conv(s.sh_flags);
+  s.sh_addr      = m_conv(s.sh_addr);
+  s.sh_offset    = m_conv(s.sh_offset);
+  s.sh_size      = m_conv(s.sh_size);
+  s.sh_link      = m_conv(s.sh_link);
+  s.sh_info      = m_conv(s.sh_info);
+  s.sh_addralign = m_conv(s.sh_addralign);
+  s.sh_entsize   = m_conv(s.sh_entsize);
+}
+
+void elf_view::conv_phdr(Elf64_Phdr &p) const
+{
+  p.p_type   = m_conv(p.p_type);
+  p.p_flags  = m_conv(p.p_flags);
+  p.p_offset = m_conv(p.p_offset);
+  p.p_vaddr  = m_conv(p.p_vaddr);
+  p.p_paddr  = m_conv(p.p_paddr);
+  p.p_filesz = m_conv(p.p_filesz);
+  p.p_memsz  = m_conv(p.p_memsz);
+  p.p_align  = m_conv(p.p_align);
+}
+
+bool elf_view::load(const char *fname)
+{
+  int fd = open(fname, O_RDONLY);
+  if ( -1 == fd )
+    return false;
+  struct stat st;
+  if ( fstat(fd, &st) || (size_t)st.st_size < sizeof(Elf64_Ehdr) )
+  {
+    close(fd);
+    return false;
+  }
+  m_size = st.st_size;
+  m_map = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if ( m_map == MAP_FAILED )
+  {
+    m_map = NULL;
+    return false;
+  }
+  memcpy(&m_hdr, m_map, sizeof(m_hdr));
+  if ( memcmp(m_hdr.e_ident, ELFMAG, SELFMAG) || m_hdr.e_ident[EI_CLASS] != ELFCLASS64 )
+    return unload();
+  m_conv.setup(m_hdr.e_ident[EI_DATA]);
+  m_hdr.e_type      = m_conv(m_hdr.e_type);
+  m_hdr.e_machine   = m_conv(m_hdr.e_machine);
+  m_hdr.e_version   = m_conv(m_hdr.e_version);
+  m_hdr.e_entry     = m_conv(m_hdr.e_entry);
+  m_hdr.e_phoff     = m_conv(m_hdr.e_phoff);
+  m_hdr.e_shoff     = m_conv(m_hdr.e_shoff);
+  m_hdr.e_flags     = m_conv(m_hdr.e_flags);
+  m_hdr.e_ehsize    = m_conv(m_hdr.e_ehsize);
+  m_hdr.e_phentsize = m_conv(m_hdr.e_phentsize);
+  m_hdr.e_phnum     = m_conv(m_hdr.e_phnum);
+  m_hdr.e_shentsize = m_conv(m_hdr.e_shentsize);
+  m_hdr.e_shnum     = m_conv(m_hdr.e_shnum);
+  m_hdr.e_shstrndx  = m_conv(m_hdr.e_shstrndx);
+  // section headers
+  if ( m_hdr.e_shoff && m_hdr.e_shentsize >= sizeof(Elf64_Shdr) )
+  {
+    size_t shnum = m_hdr.e_shnum;
+    unsigned int shstrndx = m_hdr.e_shstrndx;
+    const char *sh = ptr(m_hdr.e_shoff, m_hdr.e_shentsize);
+    if ( sh == NULL )
+      return unload();
+    // extended numbering - real values are in section 0
+    Elf64_Shdr first;
+    memcpy(&first, sh, sizeof(first));
+    conv_shdr(first);
+    if ( !shnum )
+      shnum = first.sh_size;
+    if ( shstrndx == SHN_XINDEX )
+      shstrndx = first.sh_link;
+    sh = ptr(m_hdr.e_shoff, shnum * m_hdr.e_shentsize);
+    if ( sh == NULL )
+      return unload();
+    sections.m_items.resize(shnum);
+    for ( size_t i = 0; i < shnum; i++, sh += m_hdr.e_shentsize )
+    {
+      elf_section &s = sections.m_items[i];
+      memcpy(&s.m_hdr, sh, sizeof(s.m_hdr));
+      conv_shdr(s.m_hdr);
+      s.m_index = i;
+      s.m_data = NULL;
+      if ( s.m_hdr.sh_type != SHT_NOBITS && s.m_hdr.sh_type != SHT_NULL )
+        s.m_data = ptr(s.m_hdr.sh_offset, s.m_hdr.sh_size);
+    }
+    // names
+    if ( shstrndx < shnum )
+    {
+      const elf_section &strs = sections.m_items[shstrndx];
+      if ( strs.m_data != NULL )
+      {
+        for ( auto &s: sections.m_items )
+        {
+          if ( s.m_hdr.sh_name >= strs.m_hdr.sh_size )
+            continue;
+          const char *name = strs.m_data + s.m_hdr.sh_name;
+          s.m_name.assign(name, strnlen(name, strs.m_hdr.sh_size - s.m_hdr.sh_name));
+        }
+      }
+    }
+  }
+  // program headers
+  if ( m_hdr.e_phoff && m_hdr.e_phentsize >= sizeof(Elf64_Phdr) )
+  {
+    const char *ph = ptr(m_hdr.e_phoff, (size_t)m_hdr.e_phnum * m_hdr.e_phentsize);
+    if ( ph != NULL )
+    {
+      segments.m_items.resize(m_hdr.e_phnum);
+      for ( auto &p: segments.m_items )
+      {
+        memcpy(&p.m_hdr, ph, sizeof(p.m_hdr));
+        conv_phdr(p.m_hdr);
+        p.m_data = p.m_hdr.p_filesz ? ptr(p.m_hdr.p_offset, p.m_hdr.p_filesz) : NULL;
+        ph += m_hdr.e_phentsize;
+      }
+    }
+  }
+  return true;
+}
+
+const elf_section *elf_view::find_section(const char *name) const
+{
+  for ( auto &s: sections )
+    if ( s.get_name() == name )
+      return &s;
+  return NULL;
+}
+
+std::string elf_view::get_build_id() const
+{
+  static const char hex[] = "0123456789abcdef";
+  std::string res;
+  for ( auto &s: sections )
+  {
+    if ( s.get_type() != SHT_NOTE || s.get_data() == NULL )
+      continue;
+    const char *p = s.get_data();
+    const char *end = p + s.get_size();
+    while ( p + sizeof(Elf64_Nhdr) <= end )
+    {
+      const Elf64_Nhdr *n = (const Elf64_Nhdr *)p;
+      Elf64_Word nsz = m_conv(n->n_namesz);
+      Elf64_Word dsz = m_conv(n->n_descsz);
+      const char *name = p + sizeof(Elf64_Nhdr);
+      const unsigned char *desc = (const unsigned char *)name + ((nsz + 3) & ~3);
+      if ( (const char *)desc + dsz > end )
+        break;
+      if ( m_conv(n->n_type) == NT_GNU_BUILD_ID && nsz == 4 && !memcmp(name, "GNU", 4) )
+      {
+        for ( Elf64_Word i = 0; i < dsz; i++ )
+        {
+          res.push_back(hex[desc[i] >> 4]);
+          res.push_back(hex[desc[i] & 0xf]);
+        }
+        return res;
+      }
+      p = (const char *)desc + ((dsz + 3) & ~3);
+    }
+  }
+  return res;
+}
+
+const elf_section *elf_view::find_section(a64 addr) const
+{
+  for ( auto &s: sections )
+  {
+    if ( !s.get_address() )
+      continue;
+    if ( addr >= s.get_address() && addr < s.get_address() + s.get_size() )
+      return &s;
+  }
+  return NULL;
+}
+
+const char *elf_view::find_addr(a64 addr) const
+{
+  const elf_section *s = find_section(addr);
+  if ( s == NULL || s->get_data() == NULL )
+    return NULL;
+  return s->get_data() + (addr - s->get_address());
+}
+
+elf_symbols::elf_symbols(const elf_view &reader, const elf_section *sec)
+ : m_conv(reader.get_convertor())
+{
+  m_syms = (const Elf64_Sym *)sec->get_data();
+  m_num = 0;
+  if ( m_syms != NULL )
+    m_num = sec->get_size() / sizeof(Elf64_Sym);
+  m_strings = NULL;
+  m_strings_size = 0;
+  const elf_section *strs = reader.sections[sec->get_link()];
+  if ( strs != NULL && strs->get_data() != NULL )
+  {
+    m_strings = strs->get_data();
+    m_strings_size = strs->get_size();
+  }
+}
+
+bool elf_symbols::get_symbol(Elf64_Xword idx, const char *&name, Elf64_Addr &value, Elf64_Xword &size,
+                             unsigned char &bind, unsigned char &type, Elf64_Half &section_index, unsigned char &other) const
+{
+  if ( idx >= m_num )
+    return false;
+  const Elf64_Sym *s = m_syms + idx;
+  Elf64_Word noff = m_conv(s->st_name);
+  if ( m_strings != NULL && noff < m_strings_size && memchr(m_strings + noff, 0, m_strings_size - noff) )
+    name = m_strings + noff;
+  else
+    name = "";
+  value = m_conv(s->st_value);
+  size = m_conv(s->st_size);
+  bind = ELF64_ST_BIND(s->st_info);
+  type = ELF64_ST_TYPE(s->st_info);
+  section_index = m_conv(s->st_shndx);
+  other = s->st_other;
+  return true;
+}
+
+elf_relocs::elf_relocs(const elf_view &reader, const elf_section *sec)
+ : m_conv(reader.get_convertor())
+{
+  m_data = sec->get_data();
+  m_rela = (sec->get_type() == SHT_RELA);
+  m_esize = m_rela ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel);
+  m_num = 0;
+  if ( m_data != NULL )
+    m_num = sec->get_size() / m_esize;
+}
+
+bool elf_relocs::get_entry(Elf64_Xword idx, Elf64_Addr &offset, Elf64_Word &symbol, Elf64_Word &type, Elf64_Sxword &addend) const
+{
+  if ( idx >= m_num )
+    return false;
+  const Elf64_Rela *r = (const Elf64_Rela *)(m_data + idx * m_esize);
+  offset = m_conv(r->r_offset);
+  Elf64_Xword info = m_conv(r->r_info);
+  symbol = ELF64_R_SYM(info);
+  type = ELF64_R_TYPE(info);
+  addend = m_rela ? m_conv(r->r_addend) : 0;
+  return true;
+}
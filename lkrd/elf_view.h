@@ -0,0 +1,261 @@
+#pragma once
+#include <elf.h>
+#include <string>
+#include <vector>
+#include "types.h"
+
+// read-only zero-copy view of ELF64 file
+// whole file is mmapped and section data are just pointers into mapping, so only pages
+// we really touch are read from disk
+// note: <elf.h> clashes with ELFIO constants so don't mix them in one translation unit
+
+class elf_convertor
+{
+  public:
+    elf_convertor()
+     : m_swap(0)
+    { }
+    void setup(unsigned char encoding);
+    uint64_t operator()(uint64_t v) const
+    {
+      return m_swap ? __builtin_bswap64(v) : v;
+    }
+    int64_t operator()(int64_t v) const
+    {
+      return m_swap ? (int64_t)__builtin_bswap64((uint64_t)v) : v;
+    }
+    uint32_t operator()(uint32_t v) const
+    {
+      return m_swap ? __builtin_bswap32(v) : v;
+    }
+    int32_t operator()(int32_t v) const
+    {
+      return m_swap ? (int32_t)__builtin_bswap32((uint32_t)v) : v;
+    }
+    uint16_t operator()(uint16_t v) const
+    {
+      return m_swap ? __builtin_bswap16(v) : v;
+    }
+    inline int need_swap() const
+    {
+      return m_swap;
+    }
+  protected:
+    int m_swap;
+};
+
+class elf_section
+{
+  public:
+    inline unsigned int get_index() const
+    {
+      return m_index;
+    }
+    inline const std::string &get_name() const
+    {
+      return m_name;
+    }
+    inline Elf64_Word get_type() const
+    {
+      return m_hdr.sh_type;
+    }
+    inline Elf64_Xword get_flags() const
+    {
+      return m_hdr.sh_flags;
+    }
+    inline Elf64_Addr get_address() const
+    {
+      return m_hdr.sh_addr;
+    }
+    inline Elf64_Xword get_size() const
+    {
+      return m_hdr.sh_size;
+    }
+    inline Elf64_Off get_offset() const
+    {
+      return m_hdr.sh_offset;
+    }
+    inline Elf64_Word get_link() const
+    {
+      return m_hdr.sh_link;
+    }
+    inline Elf64_Word get_info() const
+    {
+      return m_hdr.sh_info;
+    }
+    inline Elf64_Xword get_entry_size() const
+    {
+      return m_hdr.sh_entsize;
+    }
+    // pointer inside mapping, NULL for SHT_NOBITS
+    inline const char *get_data() const
+    {
+      return m_data;
+    }
+    // madvise for section data - MADV_SEQUENTIAL before linear scans, MADV_WILLNEED before disasm etc
+    void advise(int advice) const;
+  protected:
+    friend class elf_view;
+    Elf64_Shdr m_hdr; // in host byte order
+    unsigned int m_index;
+    std::string m_name;
+    const char *m_data;
+};
+
+class elf_segment
+{
+  public:
+    inline Elf64_Word get_type() const
+    {
+      return m_hdr.p_type;
+    }
+    inline Elf64_Word get_flags() const
+    {
+      return m_hdr.p_flags;
+    }
+    inline Elf64_Addr get_virtual_address() const
+    {
+      return m_hdr.p_vaddr;
+    }
+    inline Elf64_Addr get_physical_address() const
+    {
+      return m_hdr.p_paddr;
+    }
+    inline Elf64_Xword get_file_size() const
+    {
+      return m_hdr.p_filesz;
+    }
+    inline Elf64_Xword get_memory_size() const
+    {
+      return m_hdr.p_memsz;
+    }
+    inline Elf64_Off get_offset() const
+    {
+      return m_hdr.p_offset;
+    }
+    // pointer inside mapping, NULL if segment has no file data
+    inline const char *get_data() const
+    {
+      return m_data;
+    }
+  protected:
+    friend class elf_view;
+    Elf64_Phdr m_hdr; // in host byte order
+    const char *m_data;
+};
+
+template <typename T>
+class elf_array
+{
+  public:
+    inline unsigned int size() const
+    {
+      return (unsigned int)m_items.size();
+    }
+    const T *operator[](unsigned int idx) const
+    {
+      if ( idx >= m_items.size() )
+        return NULL;
+      return &m_items[idx];
+    }
+    typename std::vector<T>::const_iterator begin() const
+    {
+      return m_items.cbegin();
+    }
+    typename std::vector<T>::const_iterator end() const
+    {
+      return m_items.cend();
+    }
+  protected:
+    friend class elf_view;
+    std::vector<T> m_items;
+};
+
+class elf_view
+{
+  public:
+    elf_view();
+   ~elf_view();
+    bool load(const char *fname);
+    inline Elf64_Half get_machine() const
+    {
+      return m_hdr.e_machine;
+    }
+    inline Elf64_Half get_type() const
+    {
+      return m_hdr.e_type;
+    }
+    inline Elf64_Addr get_entry() const
+    {
+      return m_hdr.e_entry;
+    }
+    inline const elf_convertor &get_convertor() const
+    {
+      return m_conv;
+    }
+    const elf_section *find_section(const char *name) const;
+    // hex of NT_GNU_BUILD_ID note, empty string if there is no one
+    std::string get_build_id() const;
+    // returns section with address inside
+    const elf_section *find_section(a64 addr) const;
+    // pointer to data for address or NULL
+    const char *find_addr(a64 addr) const;
+    void advise(const char *start, size_t size, int advice) const;
+
+    elf_array<elf_section> sections;
+    elf_array<elf_segment> segments;
+  protected:
+    const char *ptr(Elf64_Off off, Elf64_Xword size) const
+    {
+      if ( off > m_size || size > m_size - off )
+        return NULL;
+      return (const char *)m_map + off;
+    }
+    void conv_shdr(Elf64_Shdr &) const;
+    void conv_phdr(Elf64_Phdr &) const;
+    // unmap file after failed load, always returns false
+    bool unload();
+
+    Elf64_Ehdr m_hdr; // in host byte order
+    elf_convertor m_conv;
+    void *m_map;
+    size_t m_size;
+};
+
+// lazy symbol table - each symbol decoded only when requested
+class elf_symbols
+{
+  public:
+    elf_symbols(const elf_view &, const elf_section *);
+    inline Elf64_Xword get_symbols_num() const
+    {
+      return m_num;
+    }
+    // name points to string table inside mapping
+    bool get_symbol(Elf64_Xword idx, const char *&name, Elf64_Addr &value, Elf64_Xword &size,
+                    unsigned char &bind, unsigned char &type, Elf64_Half &section_index, unsigned char &other) const;
+  protected:
+    const elf_convertor &m_conv;
+    const Elf64_Sym *m_syms;
+    Elf64_Xword m_num;
+    const char *m_strings;
+    Elf64_Xword m_strings_size;
+};
+
+// SHT_RELA or SHT_REL entries, addend is 0 for SHT_REL
+class elf_relocs
+{
+  public:
+    elf_relocs(const elf_view &, const elf_section *);
+    inline Elf64_Xword get_entries_num() const
+    {
+      return m_num;
+    }
+    bool get_entry(Elf64_Xword idx, Elf64_Addr &offset, Elf64_Word &symbol, Elf64_Word &type, Elf64_Sxword &addend) const;
+  protected:
+    const elf_convertor &m_conv;
+    const char *m_data;
+    Elf64_Xword m_num;
+    Elf64_Xword m_esize;
+    int m_rela;
+};
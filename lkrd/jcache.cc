@@ -0,0 +1,155 @@
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include "jcache.h"
+
+static uint64_t fnv(uint64_t h, const void *data, size_t size)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  for ( size_t i = 0; i < size; i++ )
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+void make_jcache_key(jcache_key &k, const unsigned char *tag, const unsigned char *insns, unsigned int len,
+  unsigned int stack_depth, const ujit_ctx &ctx)
+{
+  memset(&k, 0, sizeof(k));
+  memcpy(k.tag, tag, sizeof(k.tag));
+  k.insn_hash = fnv(0xcbf29ce484222325ULL, insns, len * 8);
+  k.lib = ujit_build(ctx);
+  k.call_base = (int64_t)(ctx.call_base - (unsigned long)ctx.orig_jit_addr);
+  k.enter = (int64_t)(ctx.enter - (unsigned long)ctx.orig_jit_addr);
+  k.ex = (int64_t)(ctx.ex - (unsigned long)ctx.orig_jit_addr);
+  k.stack_depth = stack_depth;
+  k.len = len;
+}
+
+struct jcache_header
+{
+  char magic[4];
+  uint32_t version;
+};
+
+// each entry in file is key, jcache_entry and image
+struct jcache_entry
+{
+  uint32_t size;
+  uint32_t version;
+  uint64_t sum;   // fnv of key and image
+};
+
+static uint64_t entry_sum(const jcache_key &k, const void *body, size_t size)
+{
+  return fnv(fnv(0xcbf29ce484222325ULL, &k, sizeof(k)), body, size);
+}
+
+jit_cache::~jit_cache()
+{
+  if ( m_fd != -1 )
+    close(m_fd);
+}
+
+int jit_cache::open(const char *fname)
+{
+  m_fd = ::open(fname, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if ( m_fd == -1 )
+    return errno;
+  jcache_header hdr;
+  ssize_t rd = pread(m_fd, &hdr, sizeof(hdr), 0);
+  if ( !rd )
+  {
+    memcpy(hdr.magic, JCACHE_MAGIC, 4);
+    hdr.version = JCACHE_VERSION;
+    if ( write(m_fd, &hdr, sizeof(hdr)) != sizeof(hdr) )
+      return errno ? errno : EIO;
+  } else if ( rd != sizeof(hdr) || memcmp(hdr.magic, JCACHE_MAGIC, 4) || hdr.version != JCACHE_VERSION )
+  {
+    close(m_fd);
+    m_fd = -1;
+    return EINVAL;
+  }
+  m_read = sizeof(hdr);
+  sync();
+  return 0;
+}
+
+void jit_cache::sync()
+{
+  if ( m_fd == -1 )
+    return;
+  struct stat st;
+  if ( fstat(m_fd, &st) || st.st_size <= m_read )
+    return;
+  std::vector<char> buf(st.st_size - m_read);
+  if ( pread(m_fd, buf.data(), buf.size(), m_read) != (ssize_t)buf.size() )
+    return;
+  const size_t hsize = sizeof(jcache_key) + sizeof(jcache_entry);
+  size_t off = 0;
+  while ( off + hsize <= buf.size() )
+  {
+    jcache_key k;
+    jcache_entry e;
+    memcpy(&k, buf.data() + off, sizeof(k));
+    memcpy(&e, buf.data() + off + sizeof(k), sizeof(e));
+    if ( e.size > JCACHE_MAX_IMAGE )
+    {
+      // cannot find next entry, skip rest of file
+      fprintf(stderr, "jit cache corrupted at offset %lu\n", (unsigned long)(m_read + off));
+      m_bad++;
+      off = buf.size();
+      break;
+    }
+    if ( e.size > buf.size() - off - hsize )
+      break; // partial entry, will be read next time
+    const char *body = buf.data() + off + hsize;
+    if ( e.version != JCACHE_VERSION || !k.lib || e.sum != entry_sum(k, body, e.size) )
+      m_bad++;
+    else
+      m_cache[k].assign(body, body + e.size);
+    off += hsize + e.size;
+  }
+  m_read += off;
+}
+
+int jit_cache::get(const jcache_key &k, jitted_code &jc)
+{
+  if ( !k.lib )
+    return 0;
+  auto it = m_cache.find(k);
+  if ( it == m_cache.end() )
+  {
+    m_misses++;
+    return 0;
+  }
+  m_hits++;
+  jc.size = it->second.size();
+  jc.body = it->second.data();
+  return 1;
+}
+
+void jit_cache::put(const jcache_key &k, const jitted_code &jc)
+{
+  if ( !jc.size || !k.lib || jc.size > JCACHE_MAX_IMAGE )
+    return;
+  auto &v = m_cache[k];
+  v.assign(jc.body, jc.body + jc.size);
+  if ( m_fd == -1 )
+    return;
+  // single write - file is shared with other collectors
+  jcache_entry hdr;
+  hdr.size = (uint32_t)jc.size;
+  hdr.version = JCACHE_VERSION;
+  hdr.sum = entry_sum(k, jc.body, jc.size);
+  std::vector<char> e(sizeof(k) + sizeof(hdr) + jc.size);
+  memcpy(e.data(), &k, sizeof(k));
+  memcpy(e.data() + sizeof(k), &hdr, sizeof(hdr));
+  memcpy(e.data() + sizeof(k) + sizeof(hdr), jc.body, jc.size);
+  if ( write(m_fd, e.data(), e.size()) != (ssize_t)e.size() )
+    fprintf(stderr, "cannot write jit cache, error %d\n", errno);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+#include "ujit.h"
+
+// cache of user-space JIT results
+// image depends only on opcodes, stack depth, JIT library and offsets of call targets relative
+// to image, so identical programs of many hosts or of repeated scans are compiled once
+// with file entries are appended by forked collectors and read back by next scans
+
+#define JCACHE_MAGIC   "LKJC"
+#define JCACHE_VERSION 2
+// bigger entries are treated as corruption
+#define JCACHE_MAX_IMAGE (64 * 1024 * 1024)
+
+struct jcache_key
+{
+  unsigned char tag[8];
+  uint64_t insn_hash;
+  uint64_t lib;        // hash of JIT library
+  int64_t call_base;   // relative to original image
+  int64_t enter;
+  int64_t ex;
+  uint32_t stack_depth;
+  uint32_t len;        // number of eBPF instructions
+};
+
+struct jcache_key_hash
+{
+  size_t operator()(const jcache_key &k) const
+  {
+    return k.insn_hash ^ k.call_base ^ (k.lib << 1);
+  }
+};
+
+struct jcache_key_eq
+{
+  bool operator()(const jcache_key &a, const jcache_key &b) const
+  {
+    return !memcmp(&a, &b, sizeof(a));
+  }
+};
+
+void make_jcache_key(jcache_key &, const unsigned char *tag, const unsigned char *insns, unsigned int len,
+  unsigned int stack_depth, const ujit_ctx &);
+
+class jit_cache
+{
+  public:
+    jit_cache()
+     : m_fd(-1),
+       m_read(0),
+       m_hits(0),
+       m_misses(0),
+       m_bad(0)
+    { }
+    ~jit_cache();
+    // attach file, it is created if not exists. returns 0 or errno
+    int open(const char *fname);
+    // read entries appended by other processes
+    void sync();
+    // jc points to cached image, it is valid while cache lives
+    // keys without JIT library are never cached and not counted as misses
+    int get(const jcache_key &, jitted_code &jc);
+    void put(const jcache_key &, const jitted_code &jc);
+    inline size_t hits() const
+    {
+      return m_hits;
+    }
+    inline size_t misses() const
+    {
+      return m_misses;
+    }
+    // entries dropped by sync due to bad version or checksum
+    inline size_t bad() const
+    {
+      return m_bad;
+    }
+  protected:
+    int m_fd;
+    off_t m_read;
+    size_t m_hits;
+    size_t m_misses;
+    size_t m_bad;
+    std::unordered_map<jcache_key, std::vector<unsigned char>, jcache_key_hash, jcache_key_eq> m_cache;
+};
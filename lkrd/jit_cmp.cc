@@ -0,0 +1,142 @@
+#include "jit_cmp.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAS_AVX2_CMP
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HAS_NEON_CMP
+#endif
+
+// image is compared by blocks of 64 bytes: kernel returns bitmask of differing bytes in block,
+// bits of holes are cleared and rest are turned to runs. almost all blocks are equal and
+// never look at holes
+static const size_t s_block = 64;
+
+static inline unsigned long long ne_scalar(const unsigned char *a, const unsigned char *b, size_t len)
+{
+  unsigned long long res = 0;
+  for ( size_t i = 0; i < len; i++ )
+    res |= (unsigned long long)(a[i] != b[i]) << i;
+  return res;
+}
+
+#ifdef HAS_AVX2_CMP
+__attribute__((target("avx2")))
+static unsigned long long ne_avx2(const unsigned char *a, const unsigned char *b)
+{
+  __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)a), _mm256_loadu_si256((const __m256i *)b));
+  __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + 32)), _mm256_loadu_si256((const __m256i *)(b + 32)));
+  return ~(((unsigned long long)(unsigned int)_mm256_movemask_epi8(e1) << 32) | (unsigned int)_mm256_movemask_epi8(e0));
+}
+#endif /* HAS_AVX2_CMP */
+
+#ifdef HAS_NEON_CMP
+static unsigned long long ne_neon(const unsigned char *a, const unsigned char *b)
+{
+  uint8x16_t e0 = vandq_u8(vceqq_u8(vld1q_u8(a), vld1q_u8(b)), vceqq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16)));
+  uint8x16_t e1 = vandq_u8(vceqq_u8(vld1q_u8(a + 32), vld1q_u8(b + 32)), vceqq_u8(vld1q_u8(a + 48), vld1q_u8(b + 48)));
+  if ( vminvq_u8(vandq_u8(e0, e1)) == 0xff )
+    return 0;
+  return ne_scalar(a, b, s_block);
+}
+#endif /* HAS_NEON_CMP */
+
+static unsigned long long ne_block(const unsigned char *a, const unsigned char *b)
+{
+  return ne_scalar(a, b, s_block);
+}
+
+typedef unsigned long long (*ne_kernel)(const unsigned char *a, const unsigned char *b);
+
+static inline void add_diff(std::vector<jit_diff> &out, size_t off, size_t len)
+{
+  if ( !out.empty() && out.back().off + out.back().len == off )
+    out.back().len += len;
+  else
+    out.push_back({ off, len });
+}
+
+// ne - differing bytes of block at offset base with size len
+static size_t add_block(unsigned long long ne, size_t base, size_t len, const std::vector<jit_hole> &holes, size_t &h, std::vector<jit_diff> &out)
+{
+  // holes ended before this block are not needed anymore
+  while ( h < holes.size() && holes[h].off + holes[h].len <= base )
+    h++;
+  for ( size_t k = h; k < holes.size() && holes[k].off < base + len; k++ )
+  {
+    // overlapped by previous hole
+    if ( holes[k].off + holes[k].len <= base )
+      continue;
+    size_t from = holes[k].off > base ? holes[k].off - base : 0;
+    size_t to = holes[k].off + holes[k].len - base;
+    if ( to > len )
+      to = len;
+    if ( from >= to )
+      continue;
+    unsigned long long bits = to - from == 64 ? ~0ULL : ((1ULL << (to - from)) - 1) << from;
+    ne &= ~bits;
+  }
+  size_t res = 0;
+  while ( ne )
+  {
+    // run of set bits
+    int start = __builtin_ctzll(ne);
+    unsigned long long rest = ~(ne >> start);
+    int rlen = rest ? __builtin_ctzll(rest) : 64 - start;
+    add_diff(out, base + start, rlen);
+    res += rlen;
+    if ( start + rlen >= 64 )
+      break;
+    ne &= ~0ULL << (start + rlen);
+  }
+  return res;
+}
+
+static size_t cmp_masked(ne_kernel kernel, const unsigned char *a, const unsigned char *b, size_t len, const std::vector<jit_hole> &holes, std::vector<jit_diff> &out)
+{
+  size_t res = 0;
+  size_t h = 0;
+  size_t i = 0;
+  for ( ; i + s_block <= len; i += s_block )
+  {
+    unsigned long long ne = kernel(a + i, b + i);
+    if ( ne )
+      res += add_block(ne, i, s_block, holes, h, out);
+  }
+  if ( i < len )
+  {
+    unsigned long long ne = ne_scalar(a + i, b + i, len - i);
+    if ( ne )
+      res += add_block(ne, i, len - i, holes, h, out);
+  }
+  return res;
+}
+
+size_t jit_compare_scalar(const unsigned char *a, const unsigned char *b, size_t len, const std::vector<jit_hole> &holes, std::vector<jit_diff> &out)
+{
+  return cmp_masked(ne_block, a, b, len, holes, out);
+}
+
+const char *jit_compare_kind()
+{
+#ifdef HAS_AVX2_CMP
+  if ( __builtin_cpu_supports("avx2") )
+    return "avx2";
+#elif defined(HAS_NEON_CMP)
+  return "neon";
+#endif
+  return "scalar";
+}
+
+size_t jit_compare(const unsigned char *a, const unsigned char *b, size_t len, const std::vector<jit_hole> &holes, std::vector<jit_diff> &out)
+{
+#ifdef HAS_AVX2_CMP
+  static int s_has_avx2 = __builtin_cpu_supports("avx2");
+  if ( s_has_avx2 )
+    return cmp_masked(ne_avx2, a, b, len, holes, out);
+#elif defined(HAS_NEON_CMP)
+  return cmp_masked(ne_neon, a, b, len, holes, out);
+#endif
+  return cmp_masked(ne_block, a, b, len, holes, out);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+// comparison of JIT image from kernel with image compiled by ujit
+// holes are rel32 of calls, they depend on address of image and are not compared
+
+struct jit_hole
+{
+  size_t off;
+  size_t len;
+
+  bool operator<(const jit_hole &other) const
+  {
+    return off < other.off;
+  }
+};
+
+// run of differing bytes
+struct jit_diff
+{
+  size_t off;
+  size_t len;
+};
+
+// holes must be sorted by offset, they can overlap or go beyond len
+// appends runs of differing bytes to out, returns number of differing bytes
+size_t jit_compare(const unsigned char *a, const unsigned char *b, size_t len, const std::vector<jit_hole> &holes, std::vector<jit_diff> &out);
+// portable version, exported for benchmark
+size_t jit_compare_scalar(const unsigned char *a, const unsigned char *b, size_t len, const std::vector<jit_hole> &holes, std::vector<jit_diff> &out);
+// name of kernel selected for this cpu
+const char *jit_compare_kind();
@@ -0,0 +1,305 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "kdev.h"
+#include "profile.h"
+
+enum kdev_mode
+{
+  KDEV_REAL = 0,
+  KDEV_RECORD,
+  KDEV_REPLAY
+};
+
+static int s_mode = KDEV_REAL;
+static int s_log = -1;
+static std::string s_scope;
+static std::unordered_map<std::string, uint32_t> s_seq;
+// replay
+static const char *s_base = NULL;
+static size_t s_size = 0;
+static std::unordered_map<std::string, const kio_entry *> s_answers;
+// record
+static std::vector<char> s_pre;
+// sizes of argument buffers from kdev_alloc/kdev_arg_size
+static std::unordered_map<const void *, size_t> s_bufs;
+
+// for arguments with unknown size
+static const size_t s_min_window = 64 * 1024;
+// changes closer than this are merged to one range
+static const size_t s_gap = 16;
+
+static std::string answer_key(const std::string &scope, uint32_t seq)
+{
+  std::string res(scope);
+  res.push_back(0);
+  res.append((const char *)&seq, sizeof(seq));
+  return res;
+}
+
+int kdev_record(const char *fname)
+{
+  s_log = open(fname, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if ( s_log == -1 )
+    return errno;
+  kio_header hdr;
+  memcpy(hdr.magic, KDEV_MAGIC, 4);
+  hdr.version = KDEV_VERSION;
+  if ( write(s_log, &hdr, sizeof(hdr)) != sizeof(hdr) )
+  {
+    int err = errno ? errno : EIO;
+    close(s_log);
+    s_log = -1;
+    return err;
+  }
+  s_mode = KDEV_RECORD;
+  return 0;
+}
+
+int kdev_replay(const char *fname)
+{
+  int fd = open(fname, O_RDONLY);
+  if ( fd == -1 )
+    return errno;
+  struct stat st;
+  if ( fstat(fd, &st) )
+  {
+    int err = errno;
+    close(fd);
+    return err;
+  }
+  s_size = st.st_size;
+  if ( s_size < sizeof(kio_header) )
+  {
+    close(fd);
+    return EINVAL;
+  }
+  void *base = mmap(NULL, s_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if ( base == MAP_FAILED )
+    return errno;
+  s_base = (const char *)base;
+  const kio_header *hdr = (const kio_header *)s_base;
+  if ( memcmp(hdr->magic, KDEV_MAGIC, 4) || hdr->version != KDEV_VERSION )
+    return EINVAL;
+  // index entries, each of them must be inside file
+  size_t off = sizeof(kio_header);
+  while ( off + sizeof(kio_entry) <= s_size )
+  {
+    const kio_entry *e = (const kio_entry *)(s_base + off);
+    if ( e->size < sizeof(kio_entry) + e->scope_len || e->size > s_size - off )
+      return EINVAL;
+    const char *p = (const char *)(e + 1) + e->scope_len;
+    const char *end = s_base + off + e->size;
+    for ( uint32_t i = 0; i < e->nranges; i++ )
+    {
+      if ( p + 2 * sizeof(uint32_t) > end )
+        return EINVAL;
+      uint32_t len = ((const uint32_t *)p)[1];
+      p += 2 * sizeof(uint32_t);
+      if ( len > (size_t)(end - p) )
+        return EINVAL;
+      p += len;
+    }
+    s_answers[answer_key(std::string((const char *)(e + 1), e->scope_len), e->seq)] = e;
+    off += e->size;
+  }
+  s_mode = KDEV_REPLAY;
+  return 0;
+}
+
+int kdev_replaying()
+{
+  return s_mode == KDEV_REPLAY;
+}
+
+int kdev_open()
+{
+  return open(s_mode == KDEV_REPLAY ? "/dev/null" : "/dev/lkcd", 0);
+}
+
+void kdev_set_scope(const char *scope)
+{
+  if ( scope != NULL )
+    s_scope = scope;
+  else
+    s_scope.clear();
+}
+
+void *kdev_alloc(size_t size)
+{
+  void *res = calloc(1, size);
+  if ( res != NULL )
+    kdev_arg_size(res, size);
+  return res;
+}
+
+void kdev_free(void *ptr)
+{
+  if ( ptr == NULL )
+    return;
+  kdev_arg_size(ptr, 0);
+  free(ptr);
+}
+
+void kdev_arg_size(const void *arg, size_t size)
+{
+  if ( s_mode != KDEV_RECORD )
+    return;
+  if ( size )
+    s_bufs[arg] = size;
+  else
+    s_bufs.erase(arg);
+}
+
+// copy up to size bytes from arg, stops at first unmapped page
+// process_vm_readv never splits one iovec, so remote side is page by page
+static size_t read_arg(const char *arg, char *out, size_t size)
+{
+  const size_t page = 4096;
+  size_t res = 0;
+  while ( res < size )
+  {
+    struct iovec local = { out + res, 0 };
+    struct iovec remote[IOV_MAX];
+    int n = 0;
+    size_t off = res;
+    while ( off < size && n < IOV_MAX )
+    {
+      size_t chunk = page - ((uintptr_t)(arg + off) & (page - 1));
+      if ( chunk > size - off )
+        chunk = size - off;
+      remote[n].iov_base = (void *)(arg + off);
+      remote[n].iov_len = chunk;
+      n++;
+      off += chunk;
+    }
+    local.iov_len = off - res;
+    ssize_t rd = process_vm_readv(getpid(), &local, 1, remote, n, 0);
+    if ( rd <= 0 )
+      break;
+    res += rd;
+    if ( (size_t)rd < local.iov_len )
+      break;
+  }
+  return res;
+}
+
+static void append(std::string &out, const void *data, size_t len)
+{
+  out.append((const char *)data, len);
+}
+
+extern "C" int __real_ioctl(int fd, unsigned long req, void *arg);
+
+static int record_ioctl(int fd, unsigned long req, void *arg, uint32_t seq)
+{
+  size_t window = s_min_window;
+  auto known = s_bufs.find(arg);
+  if ( known != s_bufs.end() )
+    window = known->second;
+  if ( s_pre.size() < window )
+    s_pre.resize(window);
+  size_t got = arg != NULL ? read_arg((const char *)arg, s_pre.data(), window) : 0;
+  int ret = __real_ioctl(fd, req, arg);
+  int saved = errno;
+  // ranges of bytes changed by driver
+  const char *cur = (const char *)arg;
+  std::string body;
+  uint32_t nranges = 0;
+  size_t i = 0;
+  while ( i < got )
+  {
+    if ( cur[i] == s_pre[i] )
+    {
+      i++;
+      continue;
+    }
+    size_t start = i, last = i;
+    for ( i++; i < got && i - last <= s_gap; i++ )
+      if ( cur[i] != s_pre[i] )
+        last = i;
+    uint32_t r[2] = { (uint32_t)start, (uint32_t)(last + 1 - start) };
+    append(body, r, sizeof(r));
+    append(body, cur + start, r[1]);
+    nranges++;
+    i = last + 1;
+  }
+  // driver wrote up to end of default window - answer can be longer than we logged
+  if ( known == s_bufs.end() && nranges && got == window && i + s_gap >= window )
+  {
+    fprintf(stderr, "kdev: ioctl %lX #%u wrote up to end of %ld bytes window, buffer must be allocated with kdev_alloc\n", req, seq, window);
+    ret = -1;
+    saved = EOVERFLOW;
+    body.clear();
+    nranges = 0;
+  }
+  kio_entry e;
+  e.size = sizeof(e) + s_scope.size() + body.size();
+  e.seq = seq;
+  e.req = req;
+  e.ret = ret;
+  e.err = ret == -1 ? saved : 0;
+  e.scope_len = s_scope.size();
+  e.nranges = nranges;
+  // whole entry with single write - log is shared with forked collectors
+  std::string all;
+  append(all, &e, sizeof(e));
+  all += s_scope;
+  all += body;
+  if ( write(s_log, all.data(), all.size()) != (ssize_t)all.size() )
+    fprintf(stderr, "kdev: cannot log ioctl %lX, error %d\n", req, errno);
+  errno = saved;
+  return ret;
+}
+
+static int replay_ioctl(unsigned long req, void *arg, uint32_t seq)
+{
+  auto it = s_answers.find(answer_key(s_scope, seq));
+  if ( it == s_answers.end() )
+  {
+    fprintf(stderr, "kdev: no recorded answer for ioctl %lX #%u in %s\n", req, seq, s_scope.empty() ? "main" : s_scope.c_str());
+    errno = ENODATA;
+    return -1;
+  }
+  const kio_entry *e = it->second;
+  if ( e->req != req )
+  {
+    fprintf(stderr, "kdev: ioctl %lX #%u in %s was recorded as %lX\n", req, seq, s_scope.empty() ? "main" : s_scope.c_str(), (unsigned long)e->req);
+    errno = EINVAL;
+    return -1;
+  }
+  const char *p = (const char *)(e + 1) + e->scope_len;
+  for ( uint32_t i = 0; i < e->nranges; i++ )
+  {
+    const uint32_t *r = (const uint32_t *)p;
+    p += 2 * sizeof(uint32_t);
+    if ( arg != NULL )
+      memcpy((char *)arg + r[0], p, r[1]);
+    p += r[1];
+  }
+  if ( e->ret == -1 )
+    errno = e->err;
+  return e->ret;
+}
+
+extern "C" int __wrap_ioctl(int fd, unsigned long req, void *arg)
+{
+  g_prof_cnt[PC_IOCTL]++;
+  if ( s_mode == KDEV_REAL )
+    return __real_ioctl(fd, req, arg);
+  uint32_t seq = s_seq[s_scope]++;
+  if ( s_mode == KDEV_RECORD )
+    return record_ioctl(fd, req, arg, seq);
+  return replay_ioctl(req, arg, seq);
+}
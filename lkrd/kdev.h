@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// user-space stand-in of /dev/lkcd
+// all ioctls of lkmem (and kmods) go through __wrap_ioctl, lkmem is linked with -Wl,--wrap=ioctl
+//  record - ioctls are passed to driver and answers are logged to file
+//  replay - answers are served from log, so no driver and no root are needed
+// structures from shared.h are not parsed: argument buffer is read before ioctl and only bytes
+// changed by driver are logged. this is exact only if the buffer has the same content before
+// ioctl in record and replay, so buffers for driver must be allocated with kdev_alloc (zeroed)
+// or initialized by caller. size of buffer is known from kdev_alloc/kdev_arg_size, for other
+// (small, on stack) arguments default window is used and write up to its end fails the ioctl
+// answers are matched by (scope, sequence number in scope) where scope is name of collector,
+// so forked collectors can be recorded and replayed with any -p
+
+#define KDEV_MAGIC   "LKIO"
+#define KDEV_VERSION 2
+
+// file is header + entries
+struct kio_header
+{
+  char magic[4];
+  uint32_t version;
+};
+
+// followed by scope_len bytes of scope and nranges of (uint32_t off, uint32_t len, data)
+struct kio_entry
+{
+  uint32_t size;     // of whole entry
+  uint32_t seq;
+  uint64_t req;
+  int32_t ret;
+  int32_t err;       // errno when ret is -1
+  uint32_t scope_len;
+  uint32_t nranges;
+};
+
+// both must be called before any fork, return 0 on success or errno
+int kdev_record(const char *fname);
+int kdev_replay(const char *fname);
+int kdev_replaying();
+// open /dev/lkcd, in replay mode - /dev/null
+int kdev_open();
+// set current collector name, NULL for main process
+void kdev_set_scope(const char *);
+// zeroed buffer for ioctl argument, must be freed with kdev_free - address can be reused by other buffer
+void *kdev_alloc(size_t size);
+void kdev_free(void *);
+// size of buffer allocated by caller, for following ioctls with it. 0 - forget buffer before it is freed
+extern "C" void kdev_arg_size(const void *arg, size_t size);
@@ -8,7 +8,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
-#include <elfio/elfio_dump.hpp>
+#include <stdio.h>
+#include <string.h>
 #include <list>
 #include "ksyms.h"
 #include "../shared.h"
@@ -0,0 +1,213 @@
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <net/if.h>
+#include <linux/genetlink.h>
+#include "kmem.h"
+#include "../shared.h"
+
+kmem_src *g_kmem = NULL;
+
+int read_kptr(int fd, const void *addr, void *out)
+{
+  if ( g_kmem == NULL )
+  {
+    *(const void **)out = addr;
+    return ioctl(fd, IOCTL_READ_PTR, (int *)out);
+  }
+  int err = g_kmem->read((a64)addr, out, sizeof(void *));
+  if ( !err )
+    return 0;
+  errno = err;
+  return -1;
+}
+
+core_mem::~core_mem()
+{
+  if ( m_base != NULL )
+    munmap((void *)m_base, m_size);
+  if ( m_fd != -1 )
+    close(m_fd);
+}
+
+// VMCOREINFO is text like KERNELOFFSET=1e000000\n
+void core_mem::parse_note(const char *data, size_t size)
+{
+  size_t off = 0;
+  while ( off + sizeof(Elf64_Nhdr) <= size )
+  {
+    const Elf64_Nhdr *nh = (const Elf64_Nhdr *)(data + off);
+    off += sizeof(Elf64_Nhdr);
+    size_t nsz = (nh->n_namesz + 3) & ~3;
+    size_t dsz = (nh->n_descsz + 3) & ~3;
+    if ( off + nsz + nh->n_descsz > size )
+      return;
+    const char *name = data + off;
+    const char *desc = name + nsz;
+    if ( nh->n_namesz >= 10 && !memcmp(name, "VMCOREINFO", 10) )
+    {
+      std::string info(desc, nh->n_descsz);
+      const char *s = strstr(info.c_str(), "KERNELOFFSET=");
+      if ( s != NULL )
+      {
+        m_offset = (sa64)strtoul(s + 13, NULL, 16);
+        m_has_offset = 1;
+      }
+    }
+    off += nsz + dsz;
+  }
+}
+
+int core_mem::open(const char *fname)
+{
+  m_fd = ::open(fname, O_RDONLY);
+  if ( m_fd == -1 )
+    return errno;
+  Elf64_Ehdr eh;
+  if ( pread(m_fd, &eh, sizeof(eh), 0) != sizeof(eh) )
+    return EINVAL;
+  if ( memcmp(eh.e_ident, ELFMAG, SELFMAG) || eh.e_ident[EI_CLASS] != ELFCLASS64 ||
+       eh.e_type != ET_CORE || eh.e_phentsize != sizeof(Elf64_Phdr) )
+    return EINVAL;
+  std::vector<Elf64_Phdr> ph(eh.e_phnum);
+  size_t ph_size = ph.size() * sizeof(Elf64_Phdr);
+  if ( pread(m_fd, ph.data(), ph_size, eh.e_phoff) != (ssize_t)ph_size )
+    return EINVAL;
+  for ( auto &p: ph )
+  {
+    if ( p.p_type == PT_NOTE && p.p_filesz && p.p_filesz < 16 * 1024 * 1024 )
+    {
+      std::vector<char> note(p.p_filesz);
+      if ( pread(m_fd, note.data(), note.size(), p.p_offset) == (ssize_t)note.size() )
+        parse_note(note.data(), note.size());
+    }
+    if ( p.p_type != PT_LOAD || !p.p_memsz )
+      continue;
+    m_segs.push_back({ p.p_vaddr, p.p_memsz, p.p_filesz, p.p_offset });
+  }
+  if ( m_segs.empty() )
+    return EINVAL;
+  std::sort(m_segs.begin(), m_segs.end(), [](const seg &a, const seg &b) -> bool {
+    return a.vaddr < b.vaddr;
+  });
+  struct statfs sfs;
+  if ( !fstatfs(m_fd, &sfs) && sfs.f_type == PROC_SUPER_MAGIC )
+    m_live = 1;
+  // saved cores are mmapped, size of /proc/kcore is fake and it has no mmap
+  struct stat st;
+  if ( !fstat(m_fd, &st) && S_ISREG(st.st_mode) && st.st_size )
+  {
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if ( base != MAP_FAILED )
+    {
+      m_base = (const char *)base;
+      m_size = st.st_size;
+    }
+  }
+  return 0;
+}
+
+const core_mem::seg *core_mem::find(a64 addr) const
+{
+  auto it = std::upper_bound(m_segs.begin(), m_segs.end(), addr, [](a64 a, const seg &s) -> bool {
+    return a < s.vaddr;
+  });
+  if ( it == m_segs.begin() )
+    return NULL;
+  --it;
+  if ( addr - it->vaddr >= it->size )
+    return NULL;
+  return &*it;
+}
+
+void core_mem::invalidate()
+{
+  for ( auto &c: m_cache )
+    c.hi = 0;
+}
+
+// read part of segment s at file offset foff with whole pages, pages don't cross segment bounds in file
+int core_mem::read_file(const seg *s, a64 foff, char *dst, size_t size)
+{
+  if ( m_cache.empty() )
+  {
+    m_cache.resize(cache_pages);
+    invalidate();
+  }
+  a64 send = s->off + s->filesz;
+  while ( size )
+  {
+    a64 pg = foff & ~(a64)(page_size - 1);
+    size_t poff = foff - pg;
+    size_t chunk = std::min(size, page_size - poff);
+    cpage &c = m_cache[(pg / page_size) % cache_pages];
+    if ( c.foff != pg || poff < c.lo || poff + chunk > c.hi )
+    {
+      size_t lo = pg < s->off ? s->off - pg : 0;
+      size_t hi = std::min((a64)page_size, send - pg);
+      if ( pread(m_fd, c.data + lo, hi - lo, pg + lo) != (ssize_t)(hi - lo) )
+      {
+        // some part of page is not readable - try only requested bytes
+        c.hi = 0;
+        if ( pread(m_fd, dst, chunk, foff) != (ssize_t)chunk )
+          return errno ? errno : EFAULT;
+        dst += chunk;
+        foff += chunk;
+        size -= chunk;
+        continue;
+      }
+      c.foff = pg;
+      c.lo = lo;
+      c.hi = hi;
+    }
+    memcpy(dst, c.data + poff, chunk);
+    dst += chunk;
+    foff += chunk;
+    size -= chunk;
+  }
+  return 0;
+}
+
+int core_mem::read(a64 addr, void *out, size_t size)
+{
+  char *dst = (char *)out;
+  while ( size )
+  {
+    const seg *s = find(addr);
+    if ( s == NULL )
+      return EFAULT;
+    a64 soff = addr - s->vaddr;
+    size_t chunk = std::min((a64)size, s->size - soff);
+    // part present in file
+    size_t in_file = soff < s->filesz ? std::min((a64)chunk, s->filesz - soff) : 0;
+    if ( in_file )
+    {
+      a64 foff = s->off + soff;
+      if ( m_base != NULL )
+      {
+        if ( foff + in_file > m_size )
+          return EFAULT;
+        memcpy(dst, m_base + foff, in_file);
+      } else {
+        int err = read_file(s, foff, dst, in_file);
+        if ( err )
+          return err;
+      }
+    }
+    memset(dst + in_file, 0, chunk - in_file);
+    dst += chunk;
+    addr += chunk;
+    size -= chunk;
+  }
+  return 0;
+}
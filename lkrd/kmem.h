@@ -0,0 +1,91 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "types.h"
+
+// source of kernel memory for pointer checks
+// default is driver (IOCTL_READ_PTR per pointer), with -K memory is read from /proc/kcore
+// or saved vmcore, so checks run without syscall per read and post-mortem on crash dumps
+class kmem_src
+{
+  public:
+    virtual ~kmem_src()
+    { }
+    // copy size bytes at kernel address addr, returns 0 or errno
+    virtual int read(a64 addr, void *out, size_t size) = 0;
+    // memory can change since last read - for rescans in daemon mode
+    virtual void invalidate()
+    { }
+};
+
+// ELF core: kernel virtual addresses are translated with PT_LOAD headers
+// files are mmapped, /proc/kcore cannot be mmapped and is read with pread by whole pages
+// through small direct-mapped cache - checked pointers are sorted, so most reads hit it
+class core_mem: public kmem_src
+{
+  public:
+    core_mem()
+     : m_fd(-1),
+       m_base(NULL),
+       m_size(0),
+       m_has_offset(0),
+       m_offset(0),
+       m_live(0)
+    { }
+    virtual ~core_mem();
+    // returns 0 or errno, EINVAL if file is not ELF64 core
+    int open(const char *fname);
+    virtual int read(a64 addr, void *out, size_t size);
+    virtual void invalidate();
+    // KERNELOFFSET from VMCOREINFO note - delta between System.map and loaded kernel
+    inline int get_kaslr(sa64 &res) const
+    {
+      if ( m_has_offset )
+        res = m_offset;
+      return m_has_offset;
+    }
+    inline size_t segs() const
+    {
+      return m_segs.size();
+    }
+    // /proc/kcore of running kernel, not saved dump
+    inline int is_live() const
+    {
+      return m_live;
+    }
+  protected:
+    struct seg
+    {
+      a64 vaddr;
+      a64 size;    // in memory
+      a64 filesz;  // tail after filesz reads as zeros
+      a64 off;
+    };
+    static const size_t page_size = 4096;
+    static const size_t cache_pages = 256;
+    struct cpage
+    {
+      a64 foff;    // page aligned offset in file
+      size_t lo;   // valid range inside page
+      size_t hi;
+      char data[page_size];
+    };
+    const seg *find(a64 addr) const;
+    void parse_note(const char *, size_t);
+    int read_file(const seg *, a64 foff, char *dst, size_t size);
+
+    int m_fd;
+    const char *m_base;
+    size_t m_size;
+    int m_has_offset;
+    sa64 m_offset;
+    int m_live;
+    std::vector<seg> m_segs; // sorted by vaddr
+    std::vector<cpage> m_cache; // only for pread
+};
+
+// NULL - read with driver
+extern kmem_src *g_kmem;
+
+// read one pointer at kernel address like IOCTL_READ_PTR: returns 0 or -1 and errno
+int read_kptr(int fd, const void *addr, void *out);
@@ -2,31 +2,34 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <string>
+#include <stddef.h>
+#include <string.h>
 #include "../types.h"
 #undef min
-#include <elfio/elfio_dump.hpp>
+#include "../elf_view.h"
 
 class dis_base
 {
   public:
-    dis_base(ELFIO::elfio* reader)
+    dis_base(elf_view* reader)
      : m_reader(reader)
     {
     }
     virtual ~dis_base() = default;
-    inline ELFIO::elfio *get_elfio() const
+    inline elf_view *get_elfio() const
     {
       return m_reader;
     }
     int read_syms();
   protected:
-    inline ELFIO::section *in_section(const char *psp)
+    inline const elf_section *in_section(const char *psp)
     {
-      ELFIO::Elf_Half n = m_reader->sections.size();
+      unsigned int n = m_reader->sections.size();
       if ( !n )
         return 0;
-      for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-        ELFIO::section* sec = m_reader->sections[i];
+      for (unsigned int i = 0; i < n; ++i ) { // For all sections
+        const elf_section* sec = m_reader->sections[i];
         if ( sec->get_type() == SHT_PROGBITS )
         {
           const char *curr = (const char *)sec->get_data();
@@ -37,13 +40,13 @@ class dis_base
       }
       return 0;
     }
-    inline ELFIO::section *in_section(ptrdiff_t psp)
+    inline const elf_section *in_section(ptrdiff_t psp)
     {
-      ELFIO::Elf_Half n = m_reader->sections.size();
+      unsigned int n = m_reader->sections.size();
       if ( !n )
         return 0;
-      for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-        ELFIO::section* sec = m_reader->sections[i];
+      for (unsigned int i = 0; i < n; ++i ) { // For all sections
+        const elf_section* sec = m_reader->sections[i];
         if ( sec->get_type() == SHT_PROGBITS )
         {
           auto start = sec->get_address();
@@ -54,13 +57,13 @@ class dis_base
       }
       return 0;
     }
-    inline ELFIO::section *in_xsection(const char *psp)
+    inline const elf_section *in_xsection(const char *psp)
     {
-      ELFIO::Elf_Half n = m_reader->sections.size();
+      unsigned int n = m_reader->sections.size();
       if ( !n )
         return 0;
-      for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-        ELFIO::section* sec = m_reader->sections[i];
+      for (unsigned int i = 0; i < n; ++i ) { // For all sections
+        const elf_section* sec = m_reader->sections[i];
         if ( (sec->get_type() == SHT_PROGBITS) && (sec->get_flags() & SHF_EXECINSTR) )
         {
           const char *curr = (const char *)sec->get_data();
@@ -71,13 +74,13 @@ class dis_base
       }
       return 0;
     }
-    inline ELFIO::section *in_xsection(ptrdiff_t psp)
+    inline const elf_section *in_xsection(ptrdiff_t psp)
     {
-      ELFIO::Elf_Half n = m_reader->sections.size();
+      unsigned int n = m_reader->sections.size();
       if ( !n )
         return 0;
-      for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-        ELFIO::section* sec = m_reader->sections[i];
+      for (unsigned int i = 0; i < n; ++i ) { // For all sections
+        const elf_section* sec = m_reader->sections[i];
         if ( (sec->get_type() == SHT_PROGBITS) && (sec->get_flags() & SHF_EXECINSTR) )
         {
           auto start = sec->get_address();
@@ -91,11 +94,11 @@ class dis_base
     template <typename F>
     int for_each_section(F func)
     {
-      ELFIO::Elf_Half n = m_reader->sections.size();
+      unsigned int n = m_reader->sections.size();
       if ( !n )
         return 0;
-      for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-        ELFIO::section* sec = m_reader->sections[i];
+      for (unsigned int i = 0; i < n; ++i ) { // For all sections
+        const elf_section* sec = m_reader->sections[i];
         if ( sec->get_type() == SHT_PROGBITS )
         {
           int res = func(sec);
@@ -108,11 +111,11 @@ class dis_base
     template <typename F>
     int for_each_xsection(F func)
     {
-      ELFIO::Elf_Half n = m_reader->sections.size();
+      unsigned int n = m_reader->sections.size();
       if ( !n )
         return 0;
-      for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-        ELFIO::section* sec = m_reader->sections[i];
+      for (unsigned int i = 0; i < n; ++i ) { // For all sections
+        const elf_section* sec = m_reader->sections[i];
         if ( (sec->get_type() == SHT_PROGBITS) && (sec->get_flags() & SHF_EXECINSTR) )
         {
           int res = func(sec);
@@ -125,5 +128,5 @@ class dis_base
     ptrdiff_t find_cstr(const char *);
     // data
     std::map<std::string, ptrdiff_t> m_syms;
-    ELFIO::elfio *m_reader;
+    elf_view *m_reader;
 };
\ No newline at end of file
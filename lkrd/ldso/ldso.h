@@ -4,7 +4,7 @@
 class ldso: public x64_disasm
 {
   public:
-    ldso(ELFIO::elfio* reader)
+    ldso(elf_view* reader)
      : x64_disasm(reader)
     {
       library_path = NULL;
@@ -1,4 +1,7 @@
 #include <iostream>
+#include <fstream>
+#include <string.h>
+#include <errno.h>
 #include "ldso.h"
 
 enum r_dir_status { unknown, nonexisting, existing };
@@ -31,7 +34,7 @@ int main(int argc, char **argv)
     fprintf(stderr, "Usage: %s path\n", argv[0]);
     return 6;
   }
-  ELFIO::elfio rdr;
+  elf_view rdr;
   if ( !rdr.load( argv[1] ) ) 
   {
      printf( "File %s is not found or it is not an ELF file\n", argv[1] );
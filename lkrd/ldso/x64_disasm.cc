@@ -117,11 +117,11 @@ ptrdiff_t x64_disasm::get_addr(int idx) const
 
 ptrdiff_t x64_disasm::find_mov(ptrdiff_t toff)
 {
-  ELFIO::Elf_Half n = m_reader->sections.size();
+  unsigned int n = m_reader->sections.size();
   if ( !n )
     return 0;
-  for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-     ELFIO::section* sec = m_reader->sections[i];
+  for (unsigned int i = 0; i < n; ++i ) { // For all sections
+     const elf_section* sec = m_reader->sections[i];
      if ( sec->get_type() != SHT_PROGBITS )
        continue;
      if ( !(sec->get_flags() & SHF_EXECINSTR) )
@@ -148,11 +148,11 @@ ptrdiff_t x64_disasm::find_mov(ptrdiff_t toff)
 
 ptrdiff_t x64_disasm::find_lea(ptrdiff_t toff)
 {
-  ELFIO::Elf_Half n = m_reader->sections.size();
+  unsigned int n = m_reader->sections.size();
   if ( !n )
     return 0;
-  for (ELFIO::Elf_Half i = 0; i < n; ++i ) { // For all sections
-     ELFIO::section* sec = m_reader->sections[i];
+  for (unsigned int i = 0; i < n; ++i ) { // For all sections
+     const elf_section* sec = m_reader->sections[i];
      if ( sec->get_type() != SHT_PROGBITS )
        continue;
      if ( !(sec->get_flags() & SHF_EXECINSTR) )
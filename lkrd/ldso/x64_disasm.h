@@ -104,7 +104,7 @@ class used_regs
 class x64_disasm: public dis_base
 {
   public:
-    x64_disasm(ELFIO::elfio* reader)
+    x64_disasm(elf_view* reader)
      : dis_base(reader)
     {
       ud_init(&ud_obj);
@@ -141,5 +141,5 @@ class x64_disasm: public dis_base
     ud_type expand_reg(int idx) const;
 
     ud_t ud_obj;
-    ELFIO::section *m_sec;
+    const elf_section *m_sec;
 };
\ No newline at end of file
@@ -0,0 +1,617 @@
+// benchmarks of lkrd user-space hot paths, results are written as JSON to track regressions per commit
+// usage: lkbench [-m System.map] [-k vmlinux] [-n repeats] [-r revision] [-o out.json]
+// groups:
+//  ksyms  - load of System.map (cold & with .lkc cache) and address lookups
+//  disasm - x64_disasm/arm64_disasm::process over functions from .text of vmlinux, needs -k
+//  graph  - cf_graph/statefull_graph on synthetic CFGs
+//  bpf    - ebpf_decode, ebpf_disasm, x64_jit_disasm and jit_compare over synthetic corpus of BPF programs and JIT bodies
+//  ioctl  - round trip to /dev/null as stand-in device and IOCTL_READ_PTR to /dev/lkcd if it is loaded
+// synthetic fixtures use fixed seed so results from different commits are comparable
+// each group runs in forked child bcs ksyms are global and jit disasm prints to stdout
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <net/if.h>
+#include <linux/genetlink.h>
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "elf_view.h"
+#include "ksyms.h"
+#include "x64_disasm.h"
+#include "arm64_disasm.h"
+#include "ebpf_disasm.h"
+#include "jit_cmp.h"
+#include "cf_graph.h"
+#include "../shared.h"
+#include "lk.h"
+
+struct bench_res
+{
+  std::string name;
+  size_t ops;
+  double best;   // ns per op
+  double median; // ns per op
+};
+
+static std::vector<bench_res> s_res;
+static int s_repeats = 5;
+static uint64_t s_seed;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// xorshift64 - the same sequence on every run
+static inline uint64_t rnd()
+{
+  s_seed ^= s_seed << 13;
+  s_seed ^= s_seed >> 7;
+  s_seed ^= s_seed << 17;
+  return s_seed;
+}
+
+static void add_res(const char *name, size_t ops, std::vector<double> &times)
+{
+  if ( !ops || times.empty() )
+    return;
+  std::sort(times.begin(), times.end());
+  s_res.push_back({ name, ops, times[0] / ops, times[times.size() / 2] / ops });
+}
+
+// func is called s_repeats times, prepare - before each call without timing
+template <typename P, typename F>
+static void bench(const char *name, size_t ops, P prepare, F func)
+{
+  std::vector<double> times;
+  for ( int i = 0; i < s_repeats; i++ )
+  {
+    prepare();
+    double start = now();
+    func();
+    times.push_back(now() - start);
+  }
+  add_res(name, ops, times);
+}
+
+template <typename F>
+static void bench(const char *name, size_t ops, F func)
+{
+  bench(name, ops, []() {}, func);
+}
+
+// run group in child, results are passed back through pipe as lines "ops best median name"
+template <typename F>
+static void run_group(const char *group, F func)
+{
+  int fds[2];
+  if ( pipe(fds) )
+    return;
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if ( pid < 0 )
+  {
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  }
+  if ( !pid )
+  {
+    close(fds[0]);
+    s_res.clear();
+    func();
+    FILE *fp = fdopen(fds[1], "w");
+    for ( auto &r: s_res )
+      fprintf(fp, "%ld %f %f %s\n", r.ops, r.best, r.median, r.name.c_str());
+    fclose(fp);
+    _exit(0);
+  }
+  close(fds[1]);
+  FILE *fp = fdopen(fds[0], "r");
+  char name[256];
+  bench_res r;
+  while ( 4 == fscanf(fp, "%ld %lf %lf %255s", &r.ops, &r.best, &r.median, name) )
+  {
+    r.name = name;
+    s_res.push_back(r);
+  }
+  fclose(fp);
+  int st = 0;
+  waitpid(pid, &st, 0);
+  if ( !WIFEXITED(st) || WEXITSTATUS(st) )
+    fprintf(stderr, "group %s failed, status %X\n", group, st);
+}
+
+// all output of jit disasm and ebpf_disasm goes to /dev/null
+static FILE *null_stdout()
+{
+  int nfd = open("/dev/null", O_WRONLY);
+  if ( nfd != -1 )
+  {
+    dup2(nfd, 1);
+    close(nfd);
+  }
+  return fopen("/dev/null", "w");
+}
+
+// --- ksyms
+static std::string s_tmpdir;
+
+static int copy_file(const char *from, const char *to)
+{
+  FILE *in = fopen(from, "rb");
+  if ( in == NULL )
+    return 0;
+  FILE *out = fopen(to, "wb");
+  if ( out == NULL )
+  {
+    fclose(in);
+    return 0;
+  }
+  char buf[0x10000];
+  size_t rd;
+  while ( (rd = fread(buf, 1, sizeof(buf), in)) > 0 )
+    fwrite(buf, 1, rd, out);
+  fclose(in);
+  return !fclose(out);
+}
+
+static void make_map(const char *to)
+{
+  FILE *fp = fopen(to, "w");
+  if ( fp == NULL )
+    return;
+  s_seed = 0x4c4b5359;
+  a64 addr = 0xffffffff81000000UL;
+  for ( int i = 0; i < 200000; i++ )
+  {
+    addr += 1 + rnd() % 0x200;
+    fprintf(fp, "%016lx %c sym_%d\n", addr, (i & 7) ? 't' : 'T', i);
+  }
+  fclose(fp);
+}
+
+static double load_once(const char *map)
+{
+  int fds[2];
+  if ( pipe(fds) )
+    return 0;
+  pid_t pid = fork();
+  if ( !pid )
+  {
+    double start = now();
+    read_ksyms(map);
+    double t = now() - start;
+    write(fds[1], &t, sizeof(t));
+    _exit(0);
+  }
+  close(fds[1]);
+  double t = 0;
+  if ( read(fds[0], &t, sizeof(t)) != sizeof(t) )
+    t = 0;
+  close(fds[0]);
+  waitpid(pid, NULL, 0);
+  return t;
+}
+
+static void bench_ksyms(const char *map_name)
+{
+  // fixture is copied to temp dir, so .lkc cache is under our control
+  std::string map = s_tmpdir + "/System.map";
+  std::string cache = map + ".lkc";
+  if ( map_name == NULL || !copy_file(map_name, map.c_str()) )
+    make_map(map.c_str());
+  std::vector<double> cold, cached;
+  for ( int i = 0; i < s_repeats; i++ )
+  {
+    unlink(cache.c_str());
+    cold.push_back(load_once(map.c_str()));
+    cached.push_back(load_once(map.c_str()));
+  }
+  add_res("ksyms.load_cold", 1, cold);
+  add_res("ksyms.load_cached", 1, cached);
+  if ( read_ksyms(map.c_str()) )
+    return;
+  size_t count = 0;
+  struct addr_sym *syms = get_in_range(0, ~0UL, &count);
+  if ( syms == NULL || !count )
+    return;
+  a64 lo = syms[0].addr, hi = syms[count - 1].addr;
+  free(syms);
+  // random addresses - no cache hits, hot - small set like handlers of the same ops tables
+  const size_t n = 1000000;
+  std::vector<a64> addrs(n), hot(n);
+  s_seed = 0x6c6f6f6b;
+  for ( size_t i = 0; i < n; i++ )
+  {
+    addrs[i] = lo + rnd() % (hi - lo);
+    hot[i] = addrs[i % 512];
+  }
+  volatile size_t sink = 0;
+  bench("ksyms.lookup_random", n, [&]() {
+    size_t off;
+    for ( auto a: addrs )
+      sink += (size_t)lower_name_by_addr_with_off(a, &off);
+  });
+  bench("ksyms.lookup_hot", n, [&]() {
+    size_t off;
+    for ( auto a: hot )
+      sink += (size_t)lower_name_by_addr_with_off(a, &off);
+  });
+  std::vector<a64> sorted = addrs;
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<const char *> names(n);
+  bench("ksyms.lookup_batch_sorted", n, [&]() {
+    sink += lower_names_by_addrs(sorted.data(), n, names.data(), NULL);
+  });
+  bench("ksyms.get_addr", 100000, [&]() {
+    char name[32];
+    for ( int i = 0; i < 100000; i++ )
+    {
+      snprintf(name, sizeof(name), "sym_%d", (i * 7919) % 200000);
+      sink += get_addr(name);
+    }
+  });
+}
+
+// --- disasm
+static void bench_disasm(const char *vmlinux)
+{
+  elf_view reader;
+  if ( !reader.load(vmlinux) )
+  {
+    fprintf(stderr, "cannot load %s\n", vmlinux);
+    return;
+  }
+  for ( auto &sec: reader.sections )
+  {
+    if ( sec.get_type() != SHT_SYMTAB )
+      continue;
+    elf_symbols symbols(reader, &sec);
+    read_syms(reader, symbols);
+  }
+  const elf_section *text = reader.find_section(".text");
+  const elf_section *data = reader.find_section(".data");
+  if ( text == NULL || data == NULL || text->get_data() == NULL )
+  {
+    fprintf(stderr, "no .text or .data in %s\n", vmlinux);
+    return;
+  }
+  text->advise(MADV_WILLNEED);
+  size_t count = 0;
+  struct addr_sym *syms = get_in_range(text->get_address(), text->get_address() + text->get_size(), &count);
+  if ( syms == NULL || !count )
+  {
+    fprintf(stderr, "no symbols in .text of %s\n", vmlinux);
+    return;
+  }
+  // every k-th function to keep run time sane but deterministic
+  std::vector<a64> funcs;
+  size_t step = count > 5000 ? count / 5000 : 1;
+  for ( size_t i = 0; i < count; i += step )
+    funcs.push_back(syms[i].addr);
+  free(syms);
+  dis_base *bd = NULL;
+  const char *name = NULL;
+  if ( reader.get_machine() == EM_AARCH64 )
+  {
+    bd = new arm64_disasm(text->get_address(), text->get_size(), text->get_data(), data->get_address(), data->get_size());
+    name = "disasm.arm64_process";
+  } else if ( reader.get_machine() == EM_X86_64 )
+  {
+    bd = new x64_disasm(text->get_address(), text->get_size(), text->get_data(), data->get_address(), data->get_size());
+    name = "disasm.x64_process";
+  } else {
+    fprintf(stderr, "no disasm for machine %d\n", reader.get_machine());
+    return;
+  }
+  ptr_hits skip;
+  std::set<a64> out_res;
+  bench(name, funcs.size(), [&]() { out_res.clear(); }, [&]() {
+    for ( auto f: funcs )
+      bd->process(f, skip, out_res);
+  });
+  delete bd;
+}
+
+// --- graph
+static void bench_graph()
+{
+  const a64 base = 0xffffffff81000000UL;
+  const size_t n = 100000;
+  std::vector<a64> addrs(n);
+  s_seed = 0x67726170;
+  for ( size_t i = 0; i < n; i++ )
+    addrs[i] = base + rnd() % 0x1000000;
+  std::list<code_area<a64> > ranges;
+  for ( int i = 0; i < 64; i++ )
+    ranges.push_back(code_area<a64>(base + rnd() % 0x1000000, 0x400 + rnd() % 0x4000));
+  volatile size_t sink = 0;
+  // graphs cannot be assigned, so they are recreated in prepare step
+  {
+    std::unique_ptr<cf_graph<a64> > g;
+    bench("graph.cf_add", n, [&]() { g.reset(new cf_graph<a64>); }, [&]() {
+      for ( auto a: addrs )
+        g->add(a);
+    });
+    std::vector<a64> out;
+    bench("graph.cf_delete_ranges", n, [&]() {
+      g.reset(new cf_graph<a64>);
+      for ( auto a: addrs )
+        g->add(a);
+    }, [&]() {
+      std::list<code_area<a64> > r(ranges);
+      sink += g->delete_ranges(&r, out);
+    });
+  }
+  {
+    std::unique_ptr<statefull_graph<a64, int> > g;
+    bench("graph.statefull_add", n, [&]() { g.reset(new statefull_graph<a64, int>); }, [&]() {
+      for ( size_t i = 0; i < n; i++ )
+        g->add(addrs[i], (int)(i & 7));
+    });
+    std::vector<std::pair<a64, int> > out;
+    bench("graph.statefull_delete_ranges", n, [&]() {
+      g.reset(new statefull_graph<a64, int>);
+      for ( size_t i = 0; i < n; i++ )
+        g->add(addrs[i], (int)(i & 7));
+    }, [&]() {
+      std::list<code_area<a64> > r(ranges);
+      sink += g->delete_ranges(&r, out);
+    });
+    // in_ranges is linear in number of current ranges
+    for ( auto &r: ranges )
+      g->add_range(r.addr, r.size);
+    bench("graph.in_ranges", n, [&]() {
+      for ( auto a: addrs )
+        sink += g->in_ranges(a);
+    });
+  }
+}
+
+// --- bpf
+// mix of opcodes typical for real programs: alu64, mov, ldx/stx, jumps, calls, ld_imm64 and exit
+static void make_bpf_prog(std::vector<bpf_insn> &prog, size_t len)
+{
+  static const unsigned char ops[] = {
+    0x07, 0x0f, 0xb7, 0xbf, 0x17, 0x1f, 0x57, 0x5f, 0x67, 0x77, // alu64
+    0x04, 0xb4, 0xbc,                                           // alu32
+    0x79, 0x61, 0x69, 0x71, 0x7b, 0x63, 0x6b, 0x73, 0x7a, 0x62, // ldx/stx/st
+    0x05, 0x15, 0x1d, 0x25, 0x55, 0x5d, 0xa5, 0xb5, 0x16, 0x56, // jumps
+    0x85,                                                       // call
+  };
+  prog.clear();
+  while ( prog.size() + 3 < len )
+  {
+    bpf_insn op;
+    memset(&op, 0, sizeof(op));
+    if ( !(rnd() % 16) )
+    {
+      // ld_imm64 takes 2 slots
+      op.code = 0x18;
+      op.dst_reg = rnd() % 10;
+      op.imm = (int)rnd();
+      prog.push_back(op);
+      memset(&op, 0, sizeof(op));
+      op.imm = (int)rnd();
+      prog.push_back(op);
+      continue;
+    }
+    op.code = ops[rnd() % sizeof(ops)];
+    op.dst_reg = rnd() % 10;
+    op.src_reg = rnd() % 10;
+    op.off = (short)(rnd() % 64);
+    op.imm = (int)(rnd() % 4096);
+    prog.push_back(op);
+  }
+  bpf_insn ex;
+  memset(&ex, 0, sizeof(ex));
+  ex.code = 0xb7; // r0 = 0
+  prog.push_back(ex);
+  ex.code = 0x95; // exit
+  prog.push_back(ex);
+}
+
+// instruction encodings emitted by x86 bpf jit
+static void make_jit_body(std::string &body, size_t len)
+{
+  static const char *const insns[] = {
+    "\x55", "\x48\x89\xe5", "\x48\x81\xec\x10\x00\x00\x00", "\x53", "\x41\x55",
+    "\x48\x8b\x47\x08", "\x48\x83\xc0\x01", "\x48\x89\x45\xf8", "\x31\xc0", "\x48\x31\xc9",
+    "\x48\x8b\x7d\xf0", "\x0f\x1f\x44\x00\x00", "\x66\x90", "\x74\x05", "\x0f\x85\x10\x00\x00\x00",
+    "\x48\xc1\xe0\x20", "\x89\xc0", "\x48\x01\xf8", "\xe8\x00\x10\x00\x00",
+  };
+  static const size_t lens[] = { 1, 3, 7, 1, 2, 4, 4, 4, 2, 3, 4, 5, 2, 2, 6, 4, 2, 3, 5 };
+  body.clear();
+  while ( body.size() + 2 < len )
+  {
+    size_t idx = rnd() % (sizeof(lens) / sizeof(lens[0]));
+    body.append(insns[idx], lens[idx]);
+  }
+  body.append("\xc9\xc3", 2); // leave; ret
+}
+
+static void bench_bpf()
+{
+  FILE *null_fp = null_stdout();
+  s_seed = 0x627066;
+  std::vector<std::vector<bpf_insn> > progs(200);
+  size_t insns = 0;
+  for ( auto &p: progs )
+  {
+    make_bpf_prog(p, 16 + rnd() % 2000);
+    insns += p.size();
+  }
+  bench("bpf.ebpf_decode", insns, [&]() {
+    ebpf_ir ir;
+    for ( auto &p: progs )
+      ebpf_decode((const unsigned char *)p.data(), p.size(), ir);
+  });
+  bench("bpf.ebpf_disasm", insns, [&]() {
+    for ( auto &p: progs )
+      ebpf_disasm((unsigned char *)p.data(), p.size(), null_fp);
+    fflush(null_fp);
+  });
+  std::vector<std::string> bodies(200);
+  size_t bytes = 0;
+  for ( auto &b: bodies )
+  {
+    make_jit_body(b, 64 + rnd() % 8000);
+    bytes += b.size();
+  }
+  std::map<void *, std::string> map_names;
+  bench("bpf.x64_jit_disasm_per_byte", bytes, [&]() {
+    for ( auto &b: bodies )
+    {
+      std::vector<const char *> holes;
+      x64_jit_disasm dis(0xffffffffc0000000UL, b.data(), b.size());
+      dis.disasm(0, map_names, &holes);
+    }
+    fflush(stdout);
+  });
+  // kernel and jitted images are the same except rel32 of calls every 64 bytes
+  std::vector<std::string> copies(bodies);
+  std::vector<std::vector<jit_hole> > masks(bodies.size());
+  for ( size_t i = 0; i < bodies.size(); i++ )
+  {
+    for ( size_t off = 1; off + 4 <= copies[i].size(); off += 64 )
+    {
+      copies[i][off] ^= 0xff;
+      masks[i].push_back({ off, 4 });
+    }
+  }
+  bench("bpf.jit_compare_per_byte", bytes, [&]() {
+    std::vector<jit_diff> diffs;
+    for ( size_t i = 0; i < bodies.size(); i++ )
+    {
+      diffs.clear();
+      jit_compare((const unsigned char *)bodies[i].data(), (const unsigned char *)copies[i].data(), bodies[i].size(), masks[i], diffs);
+    }
+  });
+  fclose(null_fp);
+}
+
+// --- ioctl
+static void bench_ioctl()
+{
+  const size_t n = 200000;
+  int fd = open("/dev/null", O_RDONLY);
+  if ( fd != -1 )
+  {
+    bench("ioctl.stand_in_enotty", n, [&]() {
+      for ( size_t i = 0; i < n; i++ )
+      {
+        unsigned long arg = 0;
+        ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+      }
+    });
+    close(fd);
+  }
+  fd = open("/dev/lkcd", 0);
+  if ( fd == -1 )
+    return;
+  union ksym_params kparm;
+  strcpy(kparm.name, "group_balance_cpu");
+  if ( !ioctl(fd, IOCTL_RKSYM, (int *)&kparm) && kparm.addr )
+  {
+    a64 addr = kparm.addr;
+    bench("ioctl.lkcd_read_ptr", n, [&]() {
+      for ( size_t i = 0; i < n; i++ )
+      {
+        a64 arg = addr;
+        ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+      }
+    });
+  }
+  close(fd);
+}
+
+static void usage(const char *prog)
+{
+  printf("%s usage: [options]\n", prog);
+  printf("Options:\n");
+  printf("-k vmlinux - ELF for disasm benchmarks\n");
+  printf("-m System.map - map for ksyms benchmarks, synthetic if not specified\n");
+  printf("-n num - repeats of each benchmark, default 5\n");
+  printf("-o file - write JSON to file instead of stdout\n");
+  printf("-r rev - revision to put into JSON\n");
+  exit(6);
+}
+
+int main(int argc, char **argv)
+{
+  const char *map = NULL,
+             *vmlinux = NULL,
+             *out_name = NULL,
+             *rev = "";
+  int c;
+  while ( (c = getopt(argc, argv, "k:m:n:o:r:")) != -1 )
+  {
+    switch(c)
+    {
+      case 'k': vmlinux = optarg;
+       break;
+      case 'm': map = optarg;
+       break;
+      case 'n': s_repeats = atoi(optarg);
+        if ( s_repeats < 1 )
+          usage(argv[0]);
+       break;
+      case 'o': out_name = optarg;
+       break;
+      case 'r': rev = optarg;
+       break;
+      default: usage(argv[0]);
+    }
+  }
+  char tmpl[] = "/tmp/lkbench.XXXXXX";
+  if ( mkdtemp(tmpl) == NULL )
+  {
+    printf("cannot create temp dir, error %d\n", errno);
+    return errno;
+  }
+  s_tmpdir = tmpl;
+  run_group("ksyms", [map]() { bench_ksyms(map); });
+  if ( vmlinux != NULL )
+    run_group("disasm", [vmlinux]() { bench_disasm(vmlinux); });
+  run_group("graph", bench_graph);
+  run_group("bpf", bench_bpf);
+  run_group("ioctl", bench_ioctl);
+  std::string cache = s_tmpdir + "/System.map.lkc";
+  unlink(cache.c_str());
+  cache = s_tmpdir + "/System.map";
+  unlink(cache.c_str());
+  rmdir(tmpl);
+  // results
+  FILE *fp = out_name != NULL ? fopen(out_name, "w") : stdout;
+  if ( fp == NULL )
+  {
+    printf("cannot create %s, error %d\n", out_name, errno);
+    return errno;
+  }
+  fprintf(fp, "{\"rev\":\"%s\",\"repeats\":%d,\"results\":[\n", rev, s_repeats);
+  for ( size_t i = 0; i < s_res.size(); i++ )
+  {
+    auto &r = s_res[i];
+    fprintf(fp, "%s{\"name\":\"%s\",\"ops\":%ld,\"best_ns\":%.3f,\"median_ns\":%.3f}\n",
+      i ? "," : "", r.name.c_str(), r.ops, r.best, r.median);
+    fprintf(stderr, "%-32s %10ld ops %12.3f ns/op (median %.3f)\n", r.name.c_str(), r.ops, r.best, r.median);
+  }
+  fprintf(fp, "]}\n");
+  if ( fp != stdout )
+    fclose(fp);
+  return 0;
+}
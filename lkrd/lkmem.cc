@@ -15,7 +15,13 @@
 #include <iostream>
 #include <list>
 #include <set>
-#include <elfio/elfio_dump.hpp>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <sys/mman.h>
+#include "elf_view.h"
+#include "ptr_scan.h"
+#include "rsink.h"
 #include "ksyms.h"
 #include "getopt.h"
 #include "x64_disasm.h"
@@ -28,15 +34,31 @@
 #include "lk.h"
 #include "minfo.h"
 #include "ujit.h"
+#include "jit_cmp.h"
+#include "jcache.h"
+#include "collectors.h"
+#include "allowlist.h"
+#include "daemon.h"
+#include "profile.h"
+#include "kdev.h"
+#include "kmem.h"
 #endif
 
 int g_opt_v = 0;
 int g_opt_h = 0;
 int g_dump_bpf_ops = 0;
 int g_event_foff = 0;
+int g_opt_O = 0;
+int g_opt_e = 0;
 std::set<unsigned long> g_kpe, g_kpd; // enable-disable kprobe, key is just address
-
-using namespace ELFIO;
+#ifndef _MSC_VER
+static collector_pool s_collectors;
+static allowlist s_allow;
+static allow_sink *s_allow_sink = NULL;
+static lk_daemon s_daemon;
+static core_mem s_core;
+static jit_cache s_jcache;
+#endif
 
 struct x64_thunk
 {
@@ -48,29 +70,45 @@ void usage(const char *prog)
 {
   printf("%s usage: [options] image [symbols]\n", prog);
   printf("Options:\n");
+  printf("-A file - report only findings not in allowlist\n");
+  printf("-a file - write allowlist of all findings on this known-good host\n");
   printf("-B - dump BPF\n");
   printf("-b - check .bss section\n");
   printf("-c - check memory. Achtung - you must first load lkcd driver\n");
   printf("-C - dump consoles\n");
   printf("-d - use disasm\n");
+  printf("-D sock - daemon mode: rescan collectors periodically and serve results on unix socket, not with -w/-a\n");
+  printf("-E file - replay answers of driver recorded with -R, no driver and root are needed\n");
+  printf("-e - dump features of BPF programs (helpers, maps, calls), use with -B\n");
   printf("-F - dump super-blocks\n");
   printf("-f - dump ftraces\n");  
   printf("-g - dump cgroups\n");
   printf("-h - hexdump\n");
   printf("-j jit.so\n");
+  printf("-J file - write chrome trace of phases to file, implies -P\n");
   printf("-H - dump BPF opcodes\n");
+  printf("-i secs - default rescan interval in daemon mode, 0 - only on request\n");
+  printf("-I name=secs,... - rescan intervals of collectors in daemon mode\n");
   printf("-k - dump kprobes\n");
+  printf("-K core - read kernel memory from /proc/kcore or vmcore, implies -c. without driver only memory checks are done\n");
   printf("-kp addr byte - patch kernel\n");
   printf("-kpd addr - disable kprobe\n");
   printf("-kpe addr - enable kprobe\n");
   printf("-n - dump nets\n");
+  printf("-o fmt - output format: text (default), json or bin. with json/bin diagnostics and disasm listings go to stderr\n");
+  printf("-O - estimate overhead of BPF JIT code, use with -B\n");
+  printf("-p num - run up to num collectors in parallel\n");
+  printf("-P - profile phases and collectors, summary is printed to stderr at exit\n");
   printf("-r - check .rodata section\n");
+  printf("-R file - record all ioctls and answers of driver to file\n");
   printf("-S - check security_hooks\n");
   printf("-s - check fs_ops for sysfs files\n");
   printf("-t - dump tracepoints\n");
   printf("-T - dump timers\n");
   printf("-u - dump usb_monitor\n");
   printf("-v - verbose mode\n");
+  printf("-w file - write snapshot of found objects for comparing with snapdiff\n");
+  printf("-x file - cache of JIT results, shared between runs and hosts with the same JIT library\n");
   exit(6);
 }
 
@@ -355,153 +393,193 @@ static const x64_thunk s_x64_thunks[] = {
   { "__x86_indirect_thunk_r15", UD_R_R15 },
 };
 
-section* find_section(const elfio& reader, a64 addr)
-{
-  Elf_Half n = reader.sections.size();
-  for ( Elf_Half i = 0; i < n; ++i ) 
-  {
-    section* sec = reader.sections[i];
-    auto start = sec->get_address();
-    if ( (addr >= start) &&
-         addr < (start + sec->get_size())
-       )
-      return sec;
-  }
-  return NULL;
-}
+// R_AARCH64_RELATIVE relocs sorted by offset
+// decoded once from all RELA sections, then each consumer just make range query
+static ptr_hits s_arm64_relocs;
+static int s_arm64_relocs_built = 0;
 
-const char *find_addr(const elfio& reader, a64 addr)
+struct rela_chunk
 {
-  section *s = find_section(reader, addr);
-  if ( NULL == s )
-    return NULL;
-  if ( s->get_type() & SHT_NOBITS )
-    return NULL;
-  return s->get_data() + (addr - s->get_address());
-}
+  const elf_section *sec;
+  Elf64_Xword from;
+  Elf64_Xword to;
+  std::vector<ptr_hit> res;
+};
 
-template <typename F>
-void dump_arm64_ftraces(const elfio& reader, a64 start, a64 end, F func)
+const ptr_hits &get_arm64_relocs(const elf_view& reader)
 {
-  Elf_Half n = reader.sections.size();
-  if ( !n )
-    return;
-  for ( Elf_Half i = 0; i < n; ++i ) 
+  if ( s_arm64_relocs_built )
+    return s_arm64_relocs;
+  s_arm64_relocs_built = 1;
+  // split all RELA sections to chunks - vmlinux usually has just one huge .rela.dyn
+  const Elf64_Xword chunk_size = 256 * 1024;
+  std::vector<rela_chunk> chunks;
+  unsigned int n = reader.sections.size();
+  for ( unsigned int i = 0; i < n; ++i ) 
   {
-    section* sec = reader.sections[i];
-    if ( sec->get_type() == SHT_RELA )
+    const elf_section* sec = reader.sections[i];
+    if ( sec->get_type() != SHT_RELA )
+      continue;
+    elf_relocs rsa(reader, sec);
+    Elf64_Xword relno = rsa.get_entries_num();
+    if ( !relno )
+      continue;
+    sec->advise(MADV_WILLNEED);
+    for ( Elf64_Xword from = 0; from < relno; from += chunk_size )
+      chunks.push_back({ sec, from, std::min(from + chunk_size, relno), {} });
+  }
+  if ( chunks.empty() )
+    return s_arm64_relocs;
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for ( size_t c = next++; c < chunks.size(); c = next++ )
     {
-      const_relocation_section_accessor rsa(reader, sec);
-      Elf_Xword relno = rsa.get_entries_num();
-      for ( int i = 0; i < relno; i++ )
+      rela_chunk &ch = chunks[c];
+      elf_relocs rsa(reader, ch.sec);
+      for ( Elf64_Xword i = ch.from; i < ch.to; i++ )
       {
-         Elf64_Addr offset;
-         Elf_Word   symbol;
-         Elf_Word   type;
-         Elf_Sxword addend;
+         Elf64_Addr   offset;
+         Elf64_Word   symbol;
+         Elf64_Word   type;
+         Elf64_Sxword addend;
          rsa.get_entry(i, offset, symbol, type, addend);
-         if ( offset < start || offset > end )
-           continue;
          if ( type != R_AARCH64_RELATIVE )
            continue;
-         func(addend);
+         ch.res.push_back({ offset, (a64)addend });
       }
     }
-  }
+  };
+  size_t nthreads = std::thread::hardware_concurrency();
+  if ( !nthreads )
+    nthreads = 1;
+  nthreads = std::min(nthreads, chunks.size());
+  std::vector<std::thread> threads;
+  for ( size_t i = 1; i < nthreads; i++ )
+    threads.emplace_back(worker);
+  worker();
+  for ( auto &t: threads )
+    t.join();
+  size_t total = 0;
+  for ( auto &ch: chunks )
+    total += ch.res.size();
+  s_arm64_relocs.reserve(total);
+  for ( auto &ch: chunks )
+    for ( auto &r: ch.res )
+      s_arm64_relocs.add(r.addr, r.value);
+  s_arm64_relocs.sort();
+  if ( g_opt_v )
+    printf("arm64 relative relocs: %ld\n", s_arm64_relocs.size());
+  return s_arm64_relocs;
 }
 
-size_t filter_arm64_relocs(const elfio& reader, a64 start, a64 end, a64 fstart, a64 fend, std::map<a64, a64> &filled)
+template <typename F>
+void dump_arm64_ftraces(const elf_view& reader, a64 start, a64 end, F func)
+{
+  const ptr_hits &relocs = get_arm64_relocs(reader);
+  for ( auto it = relocs.lower(start); it != relocs.end() && it->addr <= end; ++it )
+    func((Elf64_Sxword)it->value);
+}
+
+size_t filter_arm64_relocs(const elf_view& reader, a64 start, a64 end, a64 fstart, a64 fend, ptr_hits &filled)
 {
   size_t res = 0;
-  Elf_Half n = reader.sections.size();
-  if ( !n )
-    return 0;
-  for ( Elf_Half i = 0; i < n; ++i ) 
+  const ptr_hits &relocs = get_arm64_relocs(reader);
+  for ( auto it = relocs.lower(start); it != relocs.end() && it->addr <= end; ++it )
   {
-    section* sec = reader.sections[i];
-    if ( sec->get_type() == SHT_RELA )
+    if ( it->value >= fstart && it->value < fend )
     {
-      const_relocation_section_accessor rsa(reader, sec);
-      Elf_Xword relno = rsa.get_entries_num();
-      for ( int i = 0; i < relno; i++ )
-      {
-         Elf64_Addr offset;
-         Elf_Word   symbol;
-         Elf_Word   type;
-         Elf_Sxword addend;
-         rsa.get_entry(i, offset, symbol, type, addend);
-         if ( offset < start || offset > end )
-           continue;
-         if ( type != R_AARCH64_RELATIVE )
-           continue;
-         if ( addend >= fstart && addend < fend )
-         {
-           filled[offset] = addend;
-           res++;
-         }
-      }
+      filled.add(it->addr, it->value);
+      res++;
     }
   }
   return res;
 }
 
+// collect pointers to [text_start, text_end) from section sec
+size_t scan_section(const elf_view& reader, const elf_section *sec, a64 text_start, a64 text_end, ptr_hits &filled)
+{
+  a64 dstart = (a64)sec->get_address();
+  // under arm64 we need count relocs in this section
+  if ( reader.get_machine() == 183 )
+    return filter_arm64_relocs(reader, dstart, dstart + sec->get_size(), text_start, text_end, filled);
+  if ( sec->get_data() == NULL )
+    return 0;
+  sec->advise(MADV_SEQUENTIAL);
+  return filled.scan((const a64 *)sec->get_data(), sec->get_size() / sizeof(a64), dstart, text_start, text_end,
+    reader.get_convertor().need_swap());
+}
+
+// patched pointer inside symbol name+off, real - what it must be or NULL
+void dump_patched(const char *name, size_t off, char *ptr, char *arg, char *real, sa64 delta)
+{
+  const char *pto = name_by_addr((a64)(arg - delta));
+  if ( pto != NULL )
+  {
+    if ( off )
+      g_sink->rec("patched", "mem at %p (%s+%lX) patched to %p (%s)\n").ptr("addr", ptr).str("sym", name).num("off", off).ptr("value", arg).str("to", pto).ptr("must", real).end();
+    else
+      g_sink->rec("patched", "mem at %p (%s) patched to %p (%s)\n").ptr("addr", ptr).str("sym", name).ptr("value", arg).str("to", pto).ptr("must", real).end();
+  } else {
+    if ( off )
+      g_sink->rec("patched", "mem at %p (%s+%lX) patched to %p\n").ptr("addr", ptr).str("sym", name).num("off", off).ptr("value", arg).ptr("must", real).end();
+    else
+      g_sink->rec("patched", "mem at %p (%s) patched to %p\n").ptr("addr", ptr).str("sym", name).ptr("value", arg).ptr("must", real).end();
+  }
+}
+
 void dump_patched(a64 curr_addr, char *ptr, char *arg, sa64 delta)
 {
    size_t off = 0;
    const char *name = lower_name_by_addr_with_off(curr_addr, &off);
    if ( name != NULL )
-   {
-     const char *pto = name_by_addr((a64)(arg - delta));
-     if ( pto != NULL )
-     {
-        if ( off )
-          printf("mem at %p (%s+%lX) patched to %p (%s)\n", ptr, name, off, arg, pto);
-        else
-          printf("mem at %p (%s) patched to %p (%s)\n", ptr, name, arg, pto);
-      } else {
-        if ( off )
-          printf("mem at %p (%s+%lX) patched to %p\n", ptr, name, off, arg);
-        else
-          printf("mem at %p (%s) patched to %p\n", ptr, name, arg);
-      }
-  } else
-     printf("mem at %p patched to %p\n", ptr, arg);
+     dump_patched(name, off, ptr, arg, NULL, delta);
+   else
+     g_sink->rec("patched", "mem at %p patched to %p\n").ptr("addr", ptr).ptr("value", arg).end();
 }
 
-void dump_and_check(int fd, int opt_c, sa64 delta, int has_syms, std::map<a64, a64> &filled)
+void dump_and_check(int fd, int opt_c, sa64 delta, int has_syms, const ptr_hits &filled)
 {
+  // filled is sorted so resolve all names in one pass
+  std::vector<a64> addrs;
+  addrs.reserve(filled.size());
+  for ( auto &c: filled )
+    addrs.push_back(c.addr);
+  std::vector<const char *> names(addrs.size());
+  std::vector<size_t> offs(addrs.size());
+  lower_names_by_addrs(addrs.data(), addrs.size(), names.data(), offs.data());
+  size_t idx = 0;
   for ( auto &c: filled )
   {
-    auto curr_addr = c.first;
-    auto addr = c.second;
+    auto curr_addr = c.addr;
+    auto addr = c.value;
+    const char *name = names[idx];
+    size_t off = offs[idx++];
     if ( g_opt_v )
     {
-      size_t off = 0;
-      const char *name = lower_name_by_addr_with_off(curr_addr, &off);
       if ( name != NULL )
       {
          const char *pto = name_by_addr(addr);
          if ( pto != NULL )
          {
            if ( off )
-             printf("# %s+%lX -> %s\n", name, off, pto);
+             g_sink->rec("dptr", "# %s+%lX -> %s\n%p\n").str("sym", name).num("off", off).str("to", pto).ptr("addr", curr_addr).ptr("value", addr).end();
            else
-             printf("# %s -> %s\n", name, pto);
+             g_sink->rec("dptr", "# %s -> %s\n%p\n").str("sym", name).str("to", pto).ptr("addr", curr_addr).ptr("value", addr).end();
            } else {
              if ( off )
-               printf("# %s+%lX\n", name, off);
+               g_sink->rec("dptr", "# %s+%lX\n%p\n").str("sym", name).num("off", off).ptr("addr", curr_addr).ptr("value", addr).end();
              else
-               printf("# %s\n", name);
+               g_sink->rec("dptr", "# %s\n%p\n").str("sym", name).ptr("addr", curr_addr).ptr("value", addr).end();
            }
-         }
-         printf("%p\n", (void *)curr_addr);
+         } else
+           g_sink->rec("dptr", "%p\n").ptr("addr", curr_addr).ptr("value", addr).end();
       }
 #ifndef _MSC_VER
       if ( opt_c )
       {
          char *ptr = (char *)curr_addr + delta;
          char *arg = ptr;
-         int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+         int err = read_kptr(fd, arg, &arg);
          if ( err )
          {
            printf("read at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
@@ -513,36 +591,21 @@ void dump_and_check(int fd, int opt_c, sa64 delta, int has_syms, std::map<a64, a
            if ( is_inside_kernel((unsigned long)arg) )
            {
               if ( !has_syms )
-                printf("mem at %p: %p (must be %p)\n", ptr, arg, real);
+                g_sink->rec("patched", "mem at %p: %p (must be %p)\n").ptr("addr", ptr).ptr("value", arg).ptr("must", real).str("owner", "kernel").end();
               else 
               {
-                size_t off = 0;
-                const char *name = lower_name_by_addr_with_off(curr_addr, &off);
                 if ( name != NULL )
-                {
-                  const char *pto = name_by_addr((a64)(arg - delta));
-                  if ( pto != NULL )
-                  {
-                     if ( off )
-                       printf("mem at %p (%s+%lX) patched to %p (%s)\n", ptr, name, off, arg, pto);
-                     else
-                       printf("mem at %p (%s) patched to %p (%s)\n", ptr, name, arg, pto);
-                   } else {
-                     if ( off )
-                       printf("mem at %p (%s+%lX) patched to %p\n", ptr, name, off, arg);
-                     else
-                       printf("mem at %p (%s) patched to %p\n", ptr, name, arg);
-                   }
-                } else
-                   printf("mem at %p: %p (must be %p)\n", ptr, arg, real);
+                  dump_patched(name, off, ptr, arg, real, delta);
+                else
+                  g_sink->rec("patched", "mem at %p: %p (must be %p)\n").ptr("addr", ptr).ptr("value", arg).ptr("must", real).str("owner", "kernel").end();
               }
            } else 
            { // address not in kernel
               const char *mname = find_kmod((unsigned long)arg);
               if ( mname )
-                printf("mem at %p: %p (must be %p) - patched by %s\n", ptr, arg, real, mname);
+                g_sink->rec("patched", "mem at %p: %p (must be %p) - patched by %s\n").ptr("addr", ptr).ptr("value", arg).ptr("must", real).str("owner", mname).end();
               else
-                printf("mem at %p: %p (must be %p) - patched by UNKNOWN\n", ptr, arg, real);
+                g_sink->rec("patched", "mem at %p: %p (must be %p) - patched by UNKNOWN\n").ptr("addr", ptr).ptr("value", arg).ptr("must", real).end();
             }
          }
       } /* opt_c */
@@ -551,59 +614,86 @@ void dump_and_check(int fd, int opt_c, sa64 delta, int has_syms, std::map<a64, a
 }
 
 #ifndef _MSC_VER
-void dump_unnamed_kptr(unsigned long l, sa64 delta)
+struct kptr_class
 {
-  if ( is_inside_kernel(l) )
+  const char *name; // symbol name if in_kernel, else module name
+  int in_kernel;
+};
+
+// classify array of pointers at once for dump_xxx routines
+void classify_kptrs(const unsigned long *ptrs, size_t count, sa64 delta, kptr_class *out)
+{
+  std::vector<const char *> mods(count);
+  find_kmods(ptrs, count, mods.data());
+  for ( size_t i = 0; i < count; i++ )
   {
-    const char *sname = name_by_addr(l - delta);
-    if (sname != NULL)
-      printf(" %p - kernel!%s\n", (void *)l, sname);
+    out[i].in_kernel = is_inside_kernel(ptrs[i]);
+    if ( out[i].in_kernel )
+      out[i].name = name_by_addr(ptrs[i] - delta);
+    else
+      out[i].name = mods[i];
+  }
+}
+
+void dump_unnamed_kptr(unsigned long l, const kptr_class &kc)
+{
+  if ( kc.in_kernel )
+  {
+    if ( kc.name != NULL )
+      g_sink->rec("kptr", " %p - kernel!%s\n").ptr("addr", l).str("sym", kc.name).str("owner", "kernel").end();
     else
-      printf(" %p - kernel\n", (void *)l);
+      g_sink->rec("kptr", " %p - kernel\n").ptr("addr", l).str("owner", "kernel").end();
   } else {
-    const char *mname = find_kmod(l);
-    if ( mname )
-      printf(" %p - %s\n", (void *)l, mname);
+    if ( kc.name )
+      g_sink->rec("kptr", " %p - %s\n").ptr("addr", l).str("owner", kc.name).end();
     else
-      printf(" %p UNKNOWN\n", (void *)l);
+      g_sink->rec("kptr", " %p UNKNOWN\n").ptr("addr", l).end();
   }
 }
 
+void dump_unnamed_kptr(unsigned long l, sa64 delta)
+{
+  kptr_class kc;
+  classify_kptrs(&l, 1, delta, &kc);
+  dump_unnamed_kptr(l, kc);
+}
+
 void dump_kptr(unsigned long l, const char *name, sa64 delta)
 {
   if (is_inside_kernel(l))
   {
     const char *sname = name_by_addr(l - delta);
     if (sname != NULL)
-      printf(" %s: %p - kernel!%s\n", name, (void *)l, sname);
+      g_sink->rec("kptr", " %s: %p - kernel!%s\n").str("name", name).ptr("addr", l).str("sym", sname).str("owner", "kernel").end();
     else
-      printf(" %s: %p - kernel\n", name, (void *)l);
+      g_sink->rec("kptr", " %s: %p - kernel\n").str("name", name).ptr("addr", l).str("owner", "kernel").end();
   }
   else {
     const char *mname = find_kmod(l);
     if (mname)
-      printf(" %s: %p - %s\n", name, (void *)l, mname);
+      g_sink->rec("kptr", " %s: %p - %s\n").str("name", name).ptr("addr", l).str("owner", mname).end();
     else
-      printf(" %s: %p - UNKNOWN\n", name, (void *)l);
+      g_sink->rec("kptr", " %s: %p - UNKNOWN\n").str("name", name).ptr("addr", l).end();
   }
 }
 
+// like dump_kptr but don't complain about unknown owner
 void dump_kptr2(unsigned long l, const char *name, sa64 delta)
 {
   if (is_inside_kernel(l))
   {
     const char *sname = name_by_addr(l - delta);
     if (sname != NULL)
-      printf(" %s: %p - kernel!%s\n", name, (void *)l, sname);
+      g_sink->rec("kptr", " %s: %p - kernel!%s\n").str("name", name).ptr("addr", l).str("sym", sname).str("owner", "kernel").end();
     else
-      printf(" %s: %p - kernel\n", name, (void *)l);
+      g_sink->rec("kptr", " %s: %p - kernel\n").str("name", name).ptr("addr", l).str("owner", "kernel").end();
   }
   else {
     const char *mname = find_kmod(l);
     if (mname)
-      printf(" %s: %p - %s\n", name, (void *)l, mname);
+      g_sink->rec("kptr", " %s: %p - %s\n").str("name", name).ptr("addr", l).str("owner", mname).end();
     else
-      printf(" %s: %p\n", name, (void *)l);
+      g_sink->rec("kptr", " %s: %p\n").str("name", name).ptr("addr", l).end();
   }
 }
 
@@ -622,12 +712,12 @@ class dumb_free
    ~dumb_free()
    {
      if ( m_ptr )
-       free(m_ptr);
+       kdev_free(m_ptr);
    }
    void operator=(T *arg)
    {
      if ( (m_ptr != NULL) && (m_ptr != arg) )
-       free(m_ptr);
+       kdev_free(m_ptr);
      m_ptr = arg;
    }
   protected:
@@ -647,10 +737,35 @@ void patch_kernel(int fd, std::map<unsigned long, unsigned char> &what)
   }
 }
 
+// -K without driver: delta from VMCOREINFO of core, kernel bounds from symbols
+static void init_offline(sa64 &delta)
+{
+  if ( s_core.get_kaslr(delta) )
+    printf("no driver, delta from core: %lX\n", delta);
+  else
+    printf("no driver and no KERNELOFFSET in core, assume delta 0\n");
+  a64 start = get_addr("startup_64");
+  if ( !start )
+    start = get_addr("_text");
+  a64 end = get_addr("__end_of_kernel_reserve");
+  if ( !end )
+    end = get_addr("_end");
+  if ( start && end )
+    set_kernel_area(start + delta, end + delta);
+  // /proc/modules is of this host, modules of dump from other machine are unknown
+  if ( !s_core.is_live() )
+    printf("modules of dump are not known, addresses in modules are reported as UNKNOWN\n");
+  else if ( init_kmods() )
+    printf("init_kmods failed, addresses in modules are reported as UNKNOWN\n");
+}
+
+// all sizes of buffers filled by driver go through calc_xxx_size, so they are counted here
 template <typename T>
 size_t calc_data_size(size_t n)
 {
-  return n * sizeof(T) + sizeof(unsigned long);
+  size_t res = n * sizeof(T) + sizeof(unsigned long);
+  prof_add(PC_KBYTES, res);
+  return res;
 }
 
 void dump_consoles(int fd, sa64 delta)
@@ -662,12 +777,12 @@ void dump_consoles(int fd, sa64 delta)
     printf("IOCTL_READ_CONSOLES count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("registered consoles: %ld\n", cnt);
+  g_sink->rec("list", "registered %s: %ld\n").str("name", "consoles").num("cnt", cnt).end();
   if ( !cnt )
     return;
   // alloc enough memory
   size_t size = calc_data_size<one_console>(cnt);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
   {
     printf("cannot alloc buffer for consoles, len %lX\n", size);
@@ -686,7 +801,7 @@ void dump_consoles(int fd, sa64 delta)
   one_console *curr = (one_console *)(buf + 1);
   for ( size_t idx = 0; idx < size; idx++, curr++ )
   {
-    printf("[%ld] %s at %p flags %X index %d\n", idx, curr->name, curr->addr, curr->flags, curr->index);
+    g_sink->obj("entry", "[%ld] %s at %p flags %X index %d\n").num("idx", idx).str("name", curr->name).ptr("addr", curr->addr).num("flags", curr->flags).num("index", curr->index).end();
     if ( curr->write )
       dump_kptr((unsigned long)curr->write, "  write", delta);
     if ( curr->read )
@@ -714,11 +829,11 @@ void dump_data1arg(int fd, a64 list, sa64 delta, int code, const char *header, c
     printf("%s count failed, error %d (%s)\n", ioctl_name, errno, strerror(errno));
     return;
   }
-  printf("\n%s at %p: %ld\n", header, (void *)(list + delta), args[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", header).ptr("addr", list + delta).num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t size = calc_data_size<T>(args[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
   {
     printf("cannot alloc buffer for %s, len %lX\n", bname, size);
@@ -751,11 +866,11 @@ void dump_data2arg(int fd, a64 list, a64 lock, sa64 delta, int code, const char
     printf("%s count failed, error %d (%s)\n", ioctl_name, errno, strerror(errno));
     return;
   }
-  printf("\n%s at %p: %ld\n", header, (void *)(list + delta), args[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", header).ptr("addr", list + delta).num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t size = calc_data_size<T>(args[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
   {
     printf("cannot alloc buffer for %s, len %lX\n", bname, size);
@@ -788,7 +903,7 @@ void check_bpf_protos(int fd, sa64 delta)
   {    
     char *ptr = (char *)c.proto.addr + delta;
     char *arg = ptr;
-    int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+    int err = read_kptr(fd, arg, &arg);
     if ( err )
     {
        printf("read at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
@@ -796,7 +911,8 @@ void check_bpf_protos(int fd, sa64 delta)
     }
     char *real = (char *)c.func.addr + delta;
     if ( real != arg )
-      printf("proto %s at %p patched, func %s at %p must be %p\n", c.proto.name, (char *)c.proto.addr + delta, c.func.name, arg, (char *)c.func.addr + delta);
+      g_sink->rec("bpf_proto_patched", "proto %s at %p patched, func %s at %p must be %p\n").str("proto", c.proto.name)
+        .ptr("addr", (char *)c.proto.addr + delta).str("func", c.func.name).ptr("to", arg).ptr("must", real).end();
   }
 }
 
@@ -814,7 +930,7 @@ void dump_devfreq_ntfy(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<clk_ntfy>(fd, list, lock, delta, READ_DEVFREQ_NTFY, "devfreq_list", "READ_DEVFREQ_NTFY", "clk_ntfy",
    [=](size_t idx, const clk_ntfy *curr) {
-    printf(" [%ld] devfreq at %p", idx, (void *)curr->clk);
+    g_sink->obj("entry", " [%ld] devfreq at %p").num("idx", idx).ptr("addr", curr->clk).end();
     dump_kptr((unsigned long)curr->ntfy, " ntfy", delta);
    }
   );
@@ -834,7 +950,7 @@ void dump_clk_ntfy(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<clk_ntfy>(fd, list, lock, delta, READ_CLK_NTFY, "clk_notifier_list", "READ_CLK_NTFY", "clk_ntfy",
    [=](size_t idx, const clk_ntfy *curr) {
-    printf(" [%ld] clk at %p", idx, (void *)curr->clk);
+    g_sink->obj("entry", " [%ld] clk at %p").num("idx", idx).ptr("addr", curr->clk).end();
     dump_kptr((unsigned long)curr->ntfy, " ntfy", delta);
    }
   );
@@ -854,7 +970,7 @@ void dump_ftrace_ops(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_ftrace_ops>(fd, list, lock, delta, IOCTL_GET_FTRACE_OPS, "ftrace_ops_list", "IOCTL_GET_FTRACE_OPS", "ftrace_ops",
    [=](size_t idx, const one_ftrace_ops *curr) {
-    printf(" [%ld] flags %lX at", idx, curr->flags);
+    g_sink->obj("entry", " [%ld] flags %lX at").num("idx", idx).num("flags", curr->flags).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->func )
       dump_kptr((unsigned long)curr->func, "  func", delta);
@@ -878,7 +994,7 @@ void dump_dynamic_events(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_tracepoint_func>(fd, list, lock, delta, IOCTL_GET_DYN_EVENTS, "dyn_event_list", "IOCTL_GET_DYN_EVENTS", "dyn_event_list",
    [=](size_t idx, const one_tracepoint_func *curr) {
-    printf(" [%ld] at", idx);
+    g_sink->obj("entry", " [%ld] at").num("idx", idx).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->data )
       dump_kptr((unsigned long)curr->data, "  ops", delta);
@@ -900,7 +1016,7 @@ void dump_dynevents_ops(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_dyn_event_op>(fd, list, lock, delta, IOCTL_GET_DYN_EVT_OPS, "dyn_event_ops_list", "IOCTL_GET_DYN_EVT_OPS", "dynevents_ops",
    [=](size_t idx, const one_dyn_event_op *curr) {
-    printf(" [%ld] at", idx);
+    g_sink->obj("entry", " [%ld] at").num("idx", idx).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->create )
       dump_kptr((unsigned long)curr->create, "  create", delta);
@@ -930,7 +1046,7 @@ void dump_tracefunc_cmds(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_tracefunc_cmd>(fd, list, lock, delta, IOCTL_GET_FTRACE_CMDS, "ftrace_commands", "IOCTL_GET_FTRACE_CMDS", "ftrace_func_commands", 
    [=](size_t idx, const one_tracefunc_cmd *curr) {
-    printf(" [%ld] %s at", idx, curr->name);
+    g_sink->obj("entry", " [%ld] %s at").num("idx", idx).str("name", curr->name).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->func )
       dump_kptr((unsigned long)curr->func, "  func", delta);
@@ -952,7 +1068,7 @@ void dump_trace_exports(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_trace_export>(fd, list, lock, delta, IOCTL_GET_TRACE_EXPORTS, "trace_exports", "IOCTL_GET_TRACE_EXPORTS", "trace_exports",
    [=](size_t idx, const one_trace_export *curr) {
-    printf(" [%ld] flags %d at", idx, curr->flags);
+    g_sink->obj("entry", " [%ld] flags %d at").num("idx", idx).num("flags", curr->flags).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->write )
       dump_kptr((unsigned long)curr->write, "  write", delta);
@@ -974,7 +1090,7 @@ void dump_pmus(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_pmu>(fd, list, lock, delta, IOCTL_GET_PMUS, "pmus", "IOCTL_GET_PMUS", "pmus",
    [=](size_t idx, const one_pmu *curr) {
-     printf(" [%ld] type %X capabilities %X at ", idx, curr->type, curr->capabilities);
+     g_sink->obj("entry", " [%ld] type %X capabilities %X at ").num("idx", idx).num("type", curr->type).num("capabilities", curr->capabilities).end();
      dump_unnamed_kptr((unsigned long)curr->addr, delta);
      if ( curr->pmu_enable )
        dump_kptr((unsigned long)curr->pmu_enable, "  pmu_enable", delta);
@@ -1042,7 +1158,7 @@ void dump_event_cmds(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_event_command>(fd, list, lock, delta, IOCTL_GET_EVENT_CMDS, "trigger_commands", "IOCTL_GET_EVENT_CMDS", "trigger_commands",
    [=](size_t idx, const one_event_command *curr) {
-    printf(" [%ld] %s trigger_type %d flags %d at", idx, curr->name, curr->trigger_type, curr->flags);
+    g_sink->obj("entry", " [%ld] %s trigger_type %d flags %d at").num("idx", idx).str("name", curr->name).num("trigger_type", curr->trigger_type).num("flags", curr->flags).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->func )
       dump_kptr((unsigned long)curr->func, "  func", delta);
@@ -1160,12 +1276,13 @@ void show_bpf_progs(size_t bpf_size, const one_bpf_prog *curr, sa64 delta)
 {
   for ( size_t j = 0; j < bpf_size; j++, curr++ )
   {
-    printf("  [%ld] prog %p id %d type %d len %d jited_len %d aux %p used_maps %d used_btf %d func_cnt %d\n", j, curr->prog, curr->aux_id, curr->prog_type, curr->len, curr->jited_len, 
-      curr->aux, curr->used_map_cnt, curr->used_btf_cnt, curr->func_cnt);
-    printf("        tag:");
+    g_sink->obj("entry", "  [%ld] prog %p id %d type %d len %d jited_len %d aux %p used_maps %d used_btf %d func_cnt %d\n").num("idx", j).ptr("prog", curr->prog)
+      .num("id", curr->aux_id).num("type", curr->prog_type).num("len", curr->len).num("jited_len", curr->jited_len).ptr("aux", curr->aux)
+      .num("used_maps", curr->used_map_cnt).num("used_btf", curr->used_btf_cnt).num("func_cnt", curr->func_cnt).end();
+    char tag[8 * 3 + 1];
     for ( int i = 0; i < 8; i++ )
-      printf(" %2.2X", curr->tag[i]);
-    printf("\n");
+      sprintf(tag + i * 3, " %2.2X", curr->tag[i]);
+    g_sink->rec("bpf_tag", "        tag:%s\n").str("tag", tag).end();
     if ( curr->bpf_func )
       dump_kptr2((unsigned long)curr->bpf_func, "  bpf_func", delta);
   }
@@ -1178,18 +1295,18 @@ struct uprobe_args
 
 void dump_trace_event_call(int fd, size_t idx, one_trace_event_call *curr, sa64 delta, uprobe_args *ua = NULL)
 {
+    const char *fmt;
     if ( curr->bpf_prog )
-    {
-      if ( curr->perf_cnt )
-        printf(" [%ld] flags %X filter %p perf_cnt %ld bpf_cnt %d at", idx, curr->flags, curr->filter, curr->perf_cnt, curr->bpf_cnt);
-      else
-        printf(" [%ld] flags %X filter %p bpf_cnt %d at", idx, curr->flags, curr->filter, curr->bpf_cnt);
-    } else {
-      if ( curr->perf_cnt )
-        printf(" [%ld] flags %X filter %p perf_cnt %ld at", idx, curr->flags, curr->filter, curr->perf_cnt);
-      else
-        printf(" [%ld] flags %X filter %p at", idx, curr->flags, curr->filter);
-    }
+      fmt = curr->perf_cnt ? " [%ld] flags %X filter %p perf_cnt %ld bpf_cnt %d at" : " [%ld] flags %X filter %p bpf_cnt %d at";
+    else
+      fmt = curr->perf_cnt ? " [%ld] flags %X filter %p perf_cnt %ld at" : " [%ld] flags %X filter %p at";
+    // fields are consumed by format in order
+    rsink &r = g_sink->obj("entry", fmt).num("idx", idx).num("flags", curr->flags).ptr("filter", curr->filter);
+    if ( curr->perf_cnt )
+      r.num("perf_cnt", curr->perf_cnt);
+    if ( curr->bpf_prog )
+      r.num("bpf_cnt", curr->bpf_cnt);
+    r.end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->evt_class )
       dump_kptr((unsigned long)curr->evt_class, "  evt_class", delta);
@@ -1198,7 +1315,7 @@ void dump_trace_event_call(int fd, size_t idx, one_trace_event_call *curr, sa64
     if ( curr->perf_perm )
       dump_kptr((unsigned long)curr->perf_perm, "  perf_perm", delta);
     if ( curr->bpf_prog )
-      printf("   bpf_prog: %p\n", (void *)curr->bpf_prog);
+      g_sink->rec("bpf_prog_ref", "   bpf_prog: %p\n").ptr("prog", curr->bpf_prog).end();
     if ( !curr->bpf_cnt )
       return;
     if ( ua )
@@ -1212,7 +1329,7 @@ void dump_trace_event_call(int fd, size_t idx, one_trace_event_call *curr, sa64
       size_t bsize = bpf_size;
       if ( bsize < args_size )
         bsize = args_size;
-      unsigned long *bpf_buf = (unsigned long *)malloc(bsize);
+      unsigned long *bpf_buf = (unsigned long *)kdev_alloc(bsize);
       if ( !bpf_buf )
       {
         printf("dump_trace_event_call: cannot alloc %ld bytes for uprobe %ld bpf_progs\n", bsize, idx);
@@ -1231,11 +1348,11 @@ void dump_trace_event_call(int fd, size_t idx, one_trace_event_call *curr, sa64
         return;
       }
       for ( unsigned long i = 0; i < bpf_buf[0]; ++i )
-        printf("  [%ld] %p\n", i, (void *)bpf_buf[i + 1]);
+        g_sink->rec("bpf_prog_ref", "  [%ld] %p\n").num("idx", i).ptr("prog", bpf_buf[i + 1]).end();
     } else {
       // dump bpf progs for some tracepoint
       size_t bpf_size = calc_data_size<one_bpf_prog>(curr->bpf_cnt);
-      unsigned long *bpf_buf = (unsigned long *)malloc(bpf_size);
+      unsigned long *bpf_buf = (unsigned long *)kdev_alloc(bpf_size);
       if ( !bpf_buf )
       {
         printf("dump_trace_event_call: cannot alloc %ld bytes for tracepoint %ld bpf_progs\n", bpf_size, idx);
@@ -1264,11 +1381,11 @@ void dump_registered_trace_event_calls(int fd, sa64 delta)
     printf("IOCTL_GET_EVT_CALLS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("\nregistered trace_event_calls: %ld\n", args[0]);
+  g_sink->rec("list", "\nregistered %s: %ld\n").str("name", "trace_event_calls").num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t size = calc_data_size<one_trace_event_call>(args[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
   {
     printf("cannot alloc buffer for trace_event_calls, len %lX\n", size);
@@ -1305,19 +1422,94 @@ void dump_bpf_ksyms(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_bpf_ksym>(fd, list, lock, delta, IOCTL_GET_BPF_KSYMS, "bpf_kallsyms", "IOCTL_GET_BPF_KSYMS", "bpf_ksyms",
    [](size_t idx, const one_bpf_ksym *curr) {
-     printf(" [%ld] ksym %p %p %p %d %s\n", idx, curr->addr, (void *)curr->start, (void *)curr->end, curr->prog ? 1 : 0, curr->name);
+     g_sink->rec("bpf_ksym", " [%ld] ksym %p %p %p %d %s\n").num("idx", idx).ptr("addr", curr->addr).ptr("start", curr->start)
+       .ptr("end", curr->end).num("prog", curr->prog ? 1 : 0).str("name", curr->name).end();
    }
   );
 }
 
-void dump_holes(const char *body, std::list<const char *> *holes)
+void dump_holes(const char *body, std::vector<const char *> *holes)
 {
-  printf("holes %ld\n", holes->size());
+  g_sink->rec("jit_holes", "holes %ld\n").num("cnt", holes->size()).end();
   for ( auto c: *holes )
-   printf("%p %lX\n", c, c - body);
+   g_sink->rec("jit_hole", "%p %lX\n").ptr("addr", c).num("off", c - body).end();
+}
+
+// summary of decoded program: used helpers, maps and calls
+static void dump_bpf_features(const ebpf_ir &ir)
+{
+  std::set<std::string> helpers, maps;
+  long calls = 0, tail_calls = 0, pcalls = 0, kfuncs = 0;
+  for ( auto &ins: ir.insns )
+  {
+    switch(ins.kind)
+    {
+      case EK_CALL:
+        calls++;
+        if ( ins.name != NULL )
+          helpers.insert(ins.name);
+       break;
+      case EK_KFUNC:
+        kfuncs++;
+        if ( ins.name != NULL )
+          helpers.insert(ins.name);
+       break;
+      case EK_PCALL:
+        pcalls++;
+       break;
+      case EK_TAIL_CALL:
+        tail_calls++;
+       break;
+      case EK_LDDW:
+        if ( ins.name != NULL )
+          maps.insert(ins.name);
+       break;
+    }
+  }
+  std::string hl, ml;
+  for ( auto &h: helpers )
+  {
+    if ( !hl.empty() )
+      hl += ",";
+    hl += h;
+  }
+  for ( auto &m: maps )
+  {
+    if ( !ml.empty() )
+      ml += ",";
+    ml += m;
+  }
+  g_sink->rec("bpf_features", "  features: bbs %ld calls %ld kfuncs %ld bpf2bpf %ld tail_calls %ld\n   helpers: %s\n   maps: %s\n")
+    .num("bbs", ir.bbs.size()).num("calls", calls).num("kfuncs", kfuncs).num("bpf2bpf", pcalls).num("tail_calls", tail_calls)
+    .str("helpers", hl.c_str()).str("maps", ml.c_str()).end();
+}
+
+static void put_jit_ovh(const char *type, const char *fmt, const jit_ovh &ovh, unsigned long ebpf_len)
+{
+  g_sink->rec(type, fmt).num("insns", ovh.insns).num("ebpf", ebpf_len).dbl("ratio", ebpf_len ? (double)ovh.insns / ebpf_len : 0.0).num("bytes", ovh.bytes)
+    .num("prologue", ovh.prologue).num("nops", ovh.nops).num("barriers", ovh.barriers).num("retpolines", ovh.retpolines)
+    .num("odd", ovh.odd).end();
 }
 
-void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std::string> &map_names)
+// memory of maps is summed per program using them and per cgroup it charged to
+struct bpf_map_usage
+{
+  unsigned long maps = 0;
+  unsigned long mem = 0;
+
+  void add(const one_bpf_map *m)
+  {
+    add(m->mem);
+  }
+  void add(unsigned long m)
+  {
+    maps++;
+    mem += m;
+  }
+};
+
+// map_mems - memory of maps from dump_bpf_maps, per prog usage is summed from used_maps of progs
+void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std::string> &map_names, const std::map<void *, unsigned long> &map_mems, ujit_ctx &jctx)
 {
   if ( !list )
   {
@@ -1329,19 +1521,24 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
     printf("cannot find prog_idr_lock\n");
     return;
   }
+  // totals for -O
+  jit_ovh all_ovh;
+  memset(&all_ovh, 0, sizeof(all_ovh));
+  unsigned long all_ebpf = 0, all_progs = 0;
+  std::map<unsigned int, bpf_map_usage> per_prog;
   dump_data2arg<one_bpf_prog>(fd, list, lock, delta, IOCTL_GET_BPF_PROGS, "prog_idr", "IOCTL_GET_BPF_PROGS", "bpf_progs",
-   [=,&map_names](size_t idx, const one_bpf_prog *curr) {
-    printf(" [%ld] prog %p id %d len %d jited_len %d aux %p used_maps %d used_btf %d func_cnt %d\n", idx, curr->prog, curr->aux_id, curr->len, curr->jited_len,
-      curr->aux, curr->used_map_cnt, curr->used_btf_cnt, curr->func_cnt
-    );
-    printf("     tag:");
+   [=,&map_names,&map_mems,&jctx,&all_ovh,&all_ebpf,&all_progs,&per_prog](size_t idx, const one_bpf_prog *curr) {
+    char tag[8 * 3 + 1];
     for ( int i = 0; i < 8; i++ )
-      printf(" %2.2X", curr->tag[i]);
-    printf("\n");
-    printf("  stack_depth: %d\n", curr->stack_depth);
-    printf("  num_exentries: %d\n", curr->num_exentries);
-    printf("  type: %d %s\n", curr->prog_type, get_bpf_prog_type_name(curr->prog_type));
-    printf("  expected_attach_type: %d %s\n", curr->expected_attach_type, get_bpf_attach_type_name(curr->expected_attach_type));
+      sprintf(tag + i * 3, " %2.2X", curr->tag[i]);
+    g_sink->obj("bpf_prog", " [%ld] prog %p id %d len %d jited_len %d aux %p used_maps %d used_btf %d func_cnt %d\n     tag:%s\n")
+      .num("idx", idx).ptr("prog", curr->prog).num("id", curr->aux_id).num("len", curr->len).num("jited_len", curr->jited_len)
+      .ptr("aux", curr->aux).num("used_maps", curr->used_map_cnt).num("used_btf", curr->used_btf_cnt).num("func_cnt", curr->func_cnt)
+      .str("tag", tag).str("ptype", get_bpf_prog_type_name(curr->prog_type)).end();
+    g_sink->rec("bpf_prog_info", "  stack_depth: %d\n  num_exentries: %d\n  type: %d %s\n  expected_attach_type: %d %s\n")
+      .num("stack_depth", curr->stack_depth).num("num_exentries", curr->num_exentries).num("type", curr->prog_type)
+      .str("type_name", get_bpf_prog_type_name(curr->prog_type)).num("attach_type", curr->expected_attach_type)
+      .str("attach_name", get_bpf_attach_type_name(curr->expected_attach_type)).end();
     if ( curr->used_map_cnt )
     {
       // dump body
@@ -1353,7 +1550,7 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
 #endif /* _DEBUG */
       if ( body_len < args_len )
         len = args_len;
-      unsigned long *l = (unsigned long *)malloc(len);
+      unsigned long *l = (unsigned long *)kdev_alloc(len);
       if ( !l )
       {
         printf("cannot alloc memory for bpf used maps\n");
@@ -1375,17 +1572,20 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
       for ( int i = 0; i < curr->used_map_cnt; i++ )
       {
         void *map_addr = (void *)l[i];
+        auto mm = map_mems.find(map_addr);
+        if ( mm != map_mems.end() )
+          per_prog[curr->aux_id].add(mm->second);
         auto mi = map_names.find(map_addr);
         if ( mi == map_names.end() )
-          printf("   [%d] %p\n", i, map_addr);
+          g_sink->rec("bpf_used_map", "   [%d] %p\n").num("idx", i).ptr("addr", map_addr).end();
         else
-          printf("   [%d] %p - %s\n", i, map_addr, mi->second.c_str());
+          g_sink->rec("bpf_used_map", "   [%d] %p - %s\n").num("idx", i).ptr("addr", map_addr).str("name", mi->second.c_str()).end();
       }      
     }
     unsigned long *jit_body = NULL;
     unsigned char *curr_jit;
     dumb_free<unsigned long> jit_tmp;
-    std::list<const char *> holes;
+    std::vector<const char *> holes;
     if ( curr->bpf_func && curr->jited_len )
     {
       dump_kptr2((unsigned long)curr->bpf_func, "  bpf_func", delta);
@@ -1394,7 +1594,7 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
       size_t body_len = curr->jited_len;
       if ( body_len < args_len )
         body_len = args_len;
-      jit_body = (unsigned long *)malloc(body_len);
+      jit_body = (unsigned long *)kdev_alloc(body_len);
       if ( !jit_body )
       {
         printf("cannot alloc memory for bpf jit code\n");
@@ -1417,6 +1617,22 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
       x64_jit_disasm dis((a64)curr->bpf_func, (const char *)curr_jit, curr->jited_len);
       dis.disasm(delta, map_names, &holes);
       dump_holes((const char *)curr_jit, &holes);
+      if ( g_opt_O )
+      {
+        jit_ovh ovh;
+        dis.overhead(delta, ovh);
+        put_jit_ovh("jit_ovh", "  jit overhead: %ld insns for %ld ebpf (%.2f), %ld bytes: prologue %ld nops %ld barriers %ld retpolines %ld odd %ld\n",
+          ovh, curr->len);
+        all_ovh.insns += ovh.insns;
+        all_ovh.bytes += ovh.bytes;
+        all_ovh.prologue += ovh.prologue;
+        all_ovh.nops += ovh.nops;
+        all_ovh.barriers += ovh.barriers;
+        all_ovh.retpolines += ovh.retpolines;
+        all_ovh.odd += ovh.odd;
+        all_ebpf += curr->len;
+        all_progs++;
+      }
     }
     if ( curr->len )
     {
@@ -1425,7 +1641,7 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
       size_t body_len = curr->len * 8;
       if ( body_len < args_len )
         body_len = args_len;
-      unsigned long *l = (unsigned long *)malloc(body_len);
+      unsigned long *l = (unsigned long *)kdev_alloc(body_len);
       if ( !l )
       {
         printf("cannot alloc memory for bpf body\n");
@@ -1444,13 +1660,23 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
       }
       if ( g_dump_bpf_ops )
         HexDump((unsigned char *)l, curr->len * 8);
-      ebpf_disasm((unsigned char *)l, curr->len, stdout);
-      put_orig_jit_addr(curr->bpf_func);
+      ebpf_ir ir;
+      ebpf_decode((unsigned char *)l, curr->len, ir, &map_names);
+      ebpf_print(ir, stdout);
+      if ( g_opt_e )
+        dump_bpf_features(ir);
+      put_orig_jit_addr(jctx, curr->bpf_func);
       if ( jit_body )
       {
         jitted_code jc;
         x64_jit_nops skipper;
-        ujit2mem((unsigned char *)l, curr->len, curr->stack_depth, jc);
+        jcache_key key;
+        make_jcache_key(key, curr->tag, (const unsigned char *)l, curr->len, curr->stack_depth, jctx);
+        if ( !s_jcache.get(key, jc) )
+        {
+          ujit2mem(jctx, (unsigned char *)l, curr->len, curr->stack_depth, jc);
+          s_jcache.put(key, jc);
+        }
         int orig_skip = skipper.skip((const char *)curr_jit, curr->jited_len);
         curr_jit += orig_skip;
         if ( jc.body )
@@ -1461,37 +1687,56 @@ void dump_bpf_progs(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std
         }
         if ( jc.size != curr->jited_len - orig_skip)
         {
-          printf("jit id %ld has different length - in kernel %d, jitted %ld\n", idx, curr->jited_len, jc.size);
+          g_sink->rec("jit_mismatch", "jit id %ld has different length - in kernel %d, jitted %ld\n").num("idx", idx)
+            .num("jited_len", curr->jited_len).num("ujit_len", jc.size).end();
           if ( jc.size )
           {
             x64_jit_disasm dis((a64)curr->bpf_func, (const char *)jc.body, jc.size);
             dis.disasm(delta, map_names, NULL);
           }
         } else {
-          int patched = 0;
-          std::list<const char *>::iterator hiter = holes.begin();
-          for ( size_t i = 0; i < jc.size; i++ )
+          // rel32 of calls depend on address of image
+          std::vector<jit_hole> mask;
+          mask.reserve(holes.size());
+          for ( auto h: holes )
           {
-            if ( jc.body[i] != curr_jit[i] )
-            {
-              patched++;
-              printf(" patched at %p, %X - %X\n", i + orig_skip + (char *)curr->bpf_func, jc.body[i], curr_jit[i]);
-            }
-            if ( hiter != holes.end() && (const char *)(curr_jit + i) == *hiter )
-            {
-              i += 4;
-              ++hiter;
-            }
+            long off = h + 1 - (const char *)curr_jit;
+            if ( off >= 0 )
+              mask.push_back({ (size_t)off, 4 });
           }
+          std::sort(mask.begin(), mask.end());
+          std::vector<jit_diff> diffs;
+          size_t patched = jit_compare(jc.body, curr_jit, jc.size, mask, diffs);
+          for ( auto &d: diffs )
+            g_sink->rec("jit_patched", " patched at %p (+%lX), %ld bytes\n").ptr("addr", d.off + orig_skip + (char *)curr->bpf_func)
+              .num("off", d.off + orig_skip).num("len", d.len).end();
           if ( patched )
-            printf("total %d bytes patched\n", patched);
+            g_sink->rec("jit_patched_total", "total %ld bytes patched in %ld runs\n").num("bytes", patched).num("runs", diffs.size()).end();
         }
+        ujit_release(jctx);
       } else
-        ujit2file(idx, (unsigned char *)l, curr->len, curr->stack_depth);
+        ujit2file(jctx, idx, (unsigned char *)l, curr->len, curr->stack_depth);
     }
     printf("\n");
    }
   );
+  if ( !per_prog.empty() )
+  {
+    printf("bpf maps memory per prog:\n");
+    for ( auto &p: per_prog )
+      g_sink->rec("bpf_map_mem_prog", " prog %d: %ld maps %ld bytes\n").num("prog", p.first).num("maps", p.second.maps).num("mem", p.second.mem).end();
+  }
+  if ( all_progs )
+  {
+    g_sink->rec("jit_ovh_progs", "jit overhead of %ld programs:\n").num("progs", all_progs).end();
+    put_jit_ovh("jit_ovh_total", " %ld insns for %ld ebpf (%.2f), %ld bytes: prologue %ld nops %ld barriers %ld retpolines %ld odd %ld\n",
+      all_ovh, all_ebpf);
+  }
+  if ( s_jcache.hits() || s_jcache.misses() || s_jcache.bad() )
+    fprintf(stderr, "jit cache: %lu hits, %lu misses, %lu bad entries\n", s_jcache.hits(), s_jcache.misses(), s_jcache.bad());
+  const jit_stat &js = ujit_stat(jctx);
+  if ( js.compiled || js.failed )
+    fprintf(stderr, "jit: %lu compiled, %lu failed, %lu bytes, %.3f ms\n", js.compiled, js.failed, js.bytes, js.ns / 1e6);
 }
 
 // ripped from https://elixir.bootlin.com/linux/v5.18/source/include/uapi/linux/bpf.h#L880
@@ -1571,8 +1816,8 @@ void dump_bpf_links(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_bpf_links>(fd, list, lock, delta, IOCTL_GET_BPF_LINKS, "link_idr", "IOCTL_GET_BPF_LINKS", "bpf_links",
    [=](size_t idx, const one_bpf_links *curr) {
-    printf(" [%ld] at %p id %d\n", idx, curr->addr, curr->id);
-    printf("  type: %d %s\n", curr->type, get_bpf_link_type_name(curr->type));
+    g_sink->obj("bpf_link", " [%ld] at %p id %d\n  type: %d %s\n").num("idx", idx).ptr("addr", curr->addr).num("id", curr->id)
+      .num("type", curr->type).str("ltype", get_bpf_link_type_name(curr->type)).end();
     if ( curr->ops )
     {
       dump_kptr((unsigned long)curr->ops, " ops", delta);
@@ -1591,7 +1836,8 @@ void dump_bpf_links(int fd, a64 list, a64 lock, sa64 delta)
     }
     if ( curr->prog.prog )
     {
-      printf("  prog %p id %d type %d len %d jited_len %d\n", curr->prog.prog, curr->prog.aux_id, curr->prog.prog_type, curr->prog.len, curr->prog.jited_len);
+      g_sink->rec("bpf_prog_ref", "  prog %p id %d type %d len %d jited_len %d\n").ptr("prog", curr->prog.prog).num("id", curr->prog.aux_id)
+        .num("type", curr->prog.prog_type).num("len", curr->prog.len).num("jited_len", curr->prog.jited_len).end();
       if ( curr->prog.bpf_func )
         dump_kptr2((unsigned long)curr->prog.bpf_func, "  bpf_func", delta);     
     }
@@ -1600,62 +1846,62 @@ void dump_bpf_links(int fd, a64 list, a64 lock, sa64 delta)
 }
 
 template <typename T>
-void dump_jit_option(int fd, a64 addr, sa64 delta, const char *fmt)
+void dump_jit_option(int fd, a64 addr, sa64 delta, const char *name)
 {
   char *ptr = (char *)addr + delta;
   char *arg = ptr;
-  int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+  int err = read_kptr(fd, arg, &arg);
   if ( err )
   {
      printf("read at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
      return;
   }
   T val = *(T *)&arg;
-  printf(fmt, val);
+  g_sink->rec("option", "%s: %ld\n").str("name", name).num("value", val).end();
 }
 
 void dump_ftrace_options(int fd, sa64 delta)
 {
   auto addr = get_addr("ftrace_enabled");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "ftrace_enabled: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "ftrace_enabled");
   addr = get_addr("ftrace_disabled");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "ftrace_disabled: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "ftrace_disabled");
   addr = get_addr("last_ftrace_enabled");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "last_ftrace_enabled: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "last_ftrace_enabled");
   addr = get_addr("ftrace_profile_enabled");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "ftrace_profile_enabled: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "ftrace_profile_enabled");
   addr = get_addr("ftrace_graph_active");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "ftrace_graph_active: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "ftrace_graph_active");
   addr = get_addr("ftrace_direct_func_count");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "ftrace_direct_func_count: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "ftrace_direct_func_count");
   addr = get_addr("ftrace_number_of_groups");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "ftrace_number_of_groups: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "ftrace_number_of_groups");
 }
 
 void dump_jit_options(int fd, sa64 delta)
 {
   auto addr = get_addr("bpf_jit_enable");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "bpf_jit_enable: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "bpf_jit_enable");
   addr = get_addr("bpf_jit_harden");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "bpf_jit_harden: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "bpf_jit_harden");
   addr = get_addr("bpf_jit_kallsyms");
   if ( addr )
-    dump_jit_option<int>(fd, addr, delta, "bpf_jit_kallsyms: %d\n");
+    dump_jit_option<int>(fd, addr, delta, "bpf_jit_kallsyms");
   addr = get_addr("bpf_jit_limit");
   if ( addr )
-    dump_jit_option<long>(fd, addr, delta, "bpf_jit_limit: %ld\n");
+    dump_jit_option<long>(fd, addr, delta, "bpf_jit_limit");
   addr = get_addr("bpf_jit_limit_max");
   if ( addr )
-    dump_jit_option<long>(fd, addr, delta, "bpf_jit_limit_max: %ld\n");
+    dump_jit_option<long>(fd, addr, delta, "bpf_jit_limit_max");
 }
 
 void dump_bpf_raw_events(int fd, a64 start, a64 end, sa64 delta)
@@ -1672,7 +1918,7 @@ void dump_bpf_raw_events(int fd, a64 start, a64 end, sa64 delta)
   }
   dump_data2arg<one_bpf_raw_event>(fd, start, end, delta, IOCTL_GET_BPF_RAW_EVENTS, "bpf_raw_tps", "IOCTL_GET_BPF_RAW_EVENTS", "bpf_raw_tps",
    [=](size_t idx, const one_bpf_raw_event *curr) {
-     printf(" [%ld] num_args %d ", idx, curr->num_args);
+     g_sink->obj("entry", " [%ld] num_args %d ").num("idx", idx).num("num_args", curr->num_args).end();
      dump_kptr2((unsigned long)curr->addr, "addr", delta);
      if ( curr->tp )
        dump_kptr((unsigned long)curr->tp, "  tp", delta);
@@ -1682,7 +1928,114 @@ void dump_bpf_raw_events(int fd, a64 start, a64 end, sa64 delta)
   );
 }
 
-void dump_bpf_maps(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std::string> &map_names)
+static const char *const bpf_ap_names[] = {
+ "other",
+ "cgroup",
+ "netns",
+ "tracepoint",
+ "kprobe",
+ "uprobe",
+ "iter",
+ "raw_tp",
+ "tracing",
+};
+
+static const char *get_bpf_ap_name(int idx)
+{
+  if ( idx < 0 || idx >= sizeof(bpf_ap_names) / sizeof(bpf_ap_names[0]) )
+    return "";
+  return bpf_ap_names[idx];
+}
+
+// graph of prog -> link -> attach point, indexed by prog id
+void dump_bpf_graph(int fd, a64 list, a64 lock, a64 cg_idr, a64 cg_mutex, sa64 delta)
+{
+  if ( !list || !lock )
+  {
+    printf("cannot find link_idr\n");
+    return;
+  }
+  unsigned long args[5] = { list + delta, lock + delta, 0, 0, 0 };
+  if ( cg_idr && cg_mutex )
+  {
+    args[2] = cg_idr + delta;
+    args[3] = cg_mutex + delta;
+  }
+  int err = ioctl(fd, IOCTL_GET_BPF_GRAPH, (int *)args);
+  if ( err )
+  {
+    printf("IOCTL_GET_BPF_GRAPH count failed, error %d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  g_sink->rec("bpf_graph", "\nbpf graph: %ld edges\n").num("edges", args[0]).end();
+  if ( !args[0] )
+    return;
+  size_t size = calc_data_size<one_bpf_edge>(args[0]);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
+  if ( !buf )
+  {
+    printf("cannot alloc buffer for bpf graph, len %lX\n", size);
+    return;
+  }
+  dumb_free<unsigned long> tmp(buf);
+  buf[0] = list + delta;
+  buf[1] = lock + delta;
+  buf[2] = args[2];
+  buf[3] = args[3];
+  buf[4] = args[0];
+  err = ioctl(fd, IOCTL_GET_BPF_GRAPH, (int *)buf);
+  if ( err )
+  {
+    printf("IOCTL_GET_BPF_GRAPH failed, error %d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  size = buf[0];
+  const one_bpf_edge *curr = (const one_bpf_edge *)(buf + 1);
+  std::map<unsigned int, std::vector<const one_bpf_edge *> > graph;
+  for ( size_t idx = 0; idx < size; idx++, curr++ )
+    graph[curr->prog_id].push_back(curr);
+  for ( auto &p: graph )
+  {
+    auto &edges = p.second;
+    // perf links are seen both from link_idr and from prog_array of trace events
+    auto has_link = [&](const one_bpf_edge *e) {
+      for ( auto l: edges )
+        if ( l->link_id && l->kind == e->kind && l->target == e->target )
+          return true;
+      return false;
+    };
+    g_sink->obj("bpf_graph_prog", " prog %d at %p\n").num("prog", p.first).ptr("addr", edges[0]->prog).end();
+    for ( auto e: edges )
+    {
+      if ( !e->link_id && e->target && has_link(e) )
+        continue;
+      std::string fmt = e->link_id ? "  link %d" : "  direct";
+      fmt += " %s attach_type %d";
+      if ( e->target_id )
+        fmt += " id %ld";
+      if ( e->name[0] )
+        fmt += " %s";
+      if ( e->target )
+        fmt += " at %p";
+      fmt += "\n";
+      // fields are consumed by format in order
+      rsink &r = g_sink->rec("bpf_graph_edge", fmt.c_str());
+      if ( e->link_id )
+        r.num("link", e->link_id);
+      r.str("kind", get_bpf_ap_name(e->kind)).num("attach_type", e->attach_type);
+      if ( e->target_id )
+        r.num("target_id", e->target_id);
+      if ( e->name[0] )
+        r.str("name", e->name);
+      if ( e->target )
+        r.ptr("target", e->target);
+      r.end();
+    }
+  }
+}
+
+
+void dump_bpf_maps(int fd, a64 list, a64 lock, a64 plist, a64 plock, sa64 delta, std::map<void *, std::string> &map_names, std::map<void *, unsigned long> &map_mems)
 {
   if ( !list )
   {
@@ -1694,18 +2047,81 @@ void dump_bpf_maps(int fd, a64 list, a64 lock, sa64 delta, std::map<void *, std:
     printf("cannot find map_idr_lock\n");
     return;
   }
-  dump_data2arg<one_bpf_map>(fd, list, lock, delta, IOCTL_GET_BPF_MAPS, "bpf_maps", "IOCTL_GET_BPF_MAPS", "bpf_maps",
-   [=,&map_names](size_t idx, const one_bpf_map *curr) {
-      printf(" [%ld] id %d %s at %p\n", idx, curr->id, curr->name, curr->addr);
-      if ( curr->ops )
-        dump_kptr((unsigned long)curr->ops, "  ops", delta);
-      map_names[curr->addr] = curr->name;
-      printf("  type: %d %s\n", curr->map_type, get_bpf_map_type_name(curr->map_type));
-      printf("  key_size %d value_size %d\n", curr->key_size, curr->value_size);
-      if ( curr->btf )
-        dump_kptr((unsigned long)curr->btf, "  btf", delta);
-   }
-  );
+  unsigned long args[3] = { list + delta, lock + delta, 0 };
+  int err = ioctl(fd, IOCTL_GET_BPF_MAPS, (int *)args);
+  if ( err )
+  {
+    printf("IOCTL_GET_BPF_MAPS count failed, error %d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "bpf_maps").ptr("addr", list + delta).num("cnt", args[0]).end();
+  if ( !args[0] )
+    return;
+  // owners of maps are gathered in the same ioctl, prog_idr is optional
+  size_t size = calc_data_size<one_bpf_map>(args[0]);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
+  if ( !buf )
+  {
+    printf("cannot alloc buffer for bpf_maps, len %lX\n", size);
+    return;
+  }
+  dumb_free<unsigned long> tmp(buf);
+  buf[0] = list + delta;
+  buf[1] = lock + delta;
+  buf[2] = args[0];
+  buf[3] = plist && plock ? plist + delta : 0;
+  buf[4] = plist && plock ? plock + delta : 0;
+  err = ioctl(fd, IOCTL_GET_BPF_MAPS, (int *)buf);
+  if ( err )
+  {
+    printf("IOCTL_GET_BPF_MAPS failed, error %d (%s)\n", errno, strerror(errno));
+    return;
+  }
+  size = buf[0];
+  one_bpf_map *curr = (one_bpf_map *)(buf + 1);
+  std::map<unsigned long, bpf_map_usage> per_cg;
+  bpf_map_usage total;
+  for ( size_t idx = 0; idx < size; idx++, curr++ )
+  {
+    g_sink->obj("bpf_map", " [%ld] id %d %s at %p\n").num("idx", idx).num("id", curr->id).str("name", curr->name).ptr("addr", curr->addr).end();
+    if ( curr->ops )
+      dump_kptr((unsigned long)curr->ops, "  ops", delta);
+    map_names[curr->addr] = curr->name;
+    map_mems[curr->addr] = curr->mem;
+    g_sink->rec("bpf_map_info", "  type: %d %s\n  key_size %d value_size %d max_entries %d flags %X\n").num("type", curr->map_type)
+      .str("type_name", get_bpf_map_type_name(curr->map_type)).num("key_size", curr->key_size).num("value_size", curr->value_size)
+      .num("max_entries", curr->max_entries).num("flags", curr->map_flags).end();
+    g_sink->rec("bpf_map_mem", "  mem %ld memcg %ld\n").num("mem", curr->mem).num("memcg", curr->memcg_id).num("id", curr->id).end();
+    if ( curr->btf )
+      dump_kptr((unsigned long)curr->btf, "  btf", delta);
+    if ( curr->nprogs )
+    {
+      const unsigned int shown = sizeof(curr->progs) / sizeof(curr->progs[0]);
+      std::string ids;
+      char tmp[16];
+      for ( unsigned int i = 0; i < curr->nprogs && i < shown; i++ )
+      {
+        snprintf(tmp, sizeof(tmp), " %d", curr->progs[i]);
+        ids += tmp;
+      }
+      // driver keeps only first ids
+      if ( curr->nprogs > shown )
+        ids += " ...";
+      g_sink->rec("bpf_map_progs", "  used by %d progs:%s\n").num("nprogs", curr->nprogs).str("progs", ids.c_str()).end();
+    }
+    per_cg[curr->memcg_id].add(curr);
+    total.add(curr);
+  }
+  // summary, per prog - in dump_bpf_progs
+  printf("bpf maps memory per cgroup:\n");
+  for ( auto &c: per_cg )
+  {
+    if ( c.first )
+      g_sink->rec("bpf_map_mem_cgroup", " cgroup %ld: %ld maps %ld bytes\n").num("cgroup", c.first).num("maps", c.second.maps).num("mem", c.second.mem).end();
+    else
+      g_sink->rec("bpf_map_mem_cgroup", " unknown cgroup: %ld maps %ld bytes\n").num("maps", c.second.maps).num("mem", c.second.mem).end();
+  }
+  g_sink->rec("bpf_map_mem_total", "total %ld maps %ld bytes\n").num("maps", total.maps).num("mem", total.mem).end();
 }
 
 void dump_bpf_targets(int fd, a64 list, a64 lock, sa64 delta)
@@ -1722,7 +2138,7 @@ void dump_bpf_targets(int fd, a64 list, a64 lock, sa64 delta)
   }
   dump_data2arg<one_bpf_reg>(fd, list, lock, delta, IOCTL_GET_BPF_REGS, "bpf_iter_reg", "IOCTL_GET_BPF_REGS", "bpf_regs",
    [=](size_t idx, const one_bpf_reg *curr) {
-    printf(" [%ld] feature %d at", idx, curr->feature);
+    g_sink->obj("entry", " [%ld] feature %d at").num("idx", idx).num("feature", curr->feature).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->attach_target )
       dump_kptr((unsigned long)curr->attach_target, "  attach_target", delta);
@@ -1747,7 +2163,7 @@ void dump_lsm(int fd, sa64 delta)
     unsigned long args[2] = { c.list + delta, 0 };
     if ( !is_inside_kernel(args[0]) )
     {
-      printf("%s list has strange address %p\n", c.name.c_str(), (void *)args[0]);
+      g_sink->rec("lsm_strange", "%s list has strange address %p\n").str("name", c.name.c_str()).ptr("addr", args[0]).end();
       continue;
     }
 #ifdef _DEBUG
@@ -1761,9 +2177,9 @@ void dump_lsm(int fd, sa64 delta)
     }
     if ( !args[0] )
       continue;
-    printf("%s: %ld\n", c.name.c_str(), args[0]);
+    g_sink->rec("list", "%s: %ld\n").str("name", c.name.c_str()).num("cnt", args[0]).end();
     size_t size = (1 + args[0]) * sizeof(unsigned long);
-    unsigned long *buf = (unsigned long *)malloc(size);
+    unsigned long *buf = (unsigned long *)kdev_alloc(size);
     if ( !buf )
       continue;
     dumb_free<unsigned long> tmp(buf);
@@ -1777,8 +2193,10 @@ void dump_lsm(int fd, sa64 delta)
       continue;
     }
     size = buf[0];
+    std::vector<kptr_class> kc(size);
+    classify_kptrs(buf + 1, size, delta, kc.data());
     for ( auto idx = 0; idx < size; idx++ )
-      dump_unnamed_kptr(buf[1 + idx], delta);
+      dump_unnamed_kptr(buf[1 + idx], kc[idx]);
   }
 }
 
@@ -1786,12 +2204,16 @@ size_t calc_cgroup_bpf_size(unsigned long n)
 {
   const size_t args_size = 6 * sizeof(unsigned long);
   size_t res = sizeof(unsigned long) + n * sizeof(one_bpf_prog);
-  return res < args_size ? args_size : res;
+  if ( res < args_size )
+    res = args_size;
+  prof_add(PC_KBYTES, res);
+  return res;
 }
 
 void dump_cgroup(const one_cgroup *cg, sa64 delta, int fd, unsigned long a1, unsigned long a2, unsigned long root)
 {
-  printf(" cgroup at %p id %ld serial_nr %ld flags %lX level %d kn %p\n", cg->addr, cg->id, cg->serial_nr, cg->flags, cg->level, cg->kn);
+  g_sink->obj("cgroup", " cgroup at %p id %ld serial_nr %ld flags %lX level %d kn %p\n").ptr("addr", cg->addr).num("id", cg->id)
+    .num("serial_nr", cg->serial_nr).num("flags", cg->flags).num("level", cg->level).ptr("kn", cg->kn).end();
   if ( cg->ss )
     dump_kptr((unsigned long)cg->ss, "ss", delta);
   int i = 0;
@@ -1811,9 +2233,10 @@ void dump_cgroup(const one_cgroup *cg, sa64 delta, int fd, unsigned long a1, uns
   {
     if ( !cg->prog_array_cnt[i] )
       continue;
-    printf("  %s: %p cnt %ld flags %X\n", get_bpf_attach_type_name(i), cg->prog_array[i], cg->prog_array_cnt[i], cg->bpf_flags[i]);
+    g_sink->rec("cgroup_bpf", "  %s: %p cnt %ld flags %X\n").str("attach", get_bpf_attach_type_name(i)).ptr("array", cg->prog_array[i])
+      .num("cnt", cg->prog_array_cnt[i]).num("flags", cg->bpf_flags[i]).end();
     size_t size = calc_cgroup_bpf_size(cg->prog_array_cnt[i]);
-    unsigned long *buf = (unsigned long *)malloc(size);
+    unsigned long *buf = (unsigned long *)kdev_alloc(size);
     if ( !buf )
       continue;
     dumb_free<unsigned long> tmp(buf);
@@ -1856,11 +2279,11 @@ void dump_groups(int fd, sa64 delta)
     printf("IOCTL_GET_CGRP_ROOTS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("\ncgroup_hierarchy_idr at %p: %ld\n", (void *)(a1 + delta), params[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "cgroup_hierarchy_idr").ptr("addr", a1 + delta).num("cnt", params[0]).end();
   if ( !params[0] )
     return;
   size_t size = calc_data_size<one_group_root>(params[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
   {
     printf("cannot alloc buffer for group_roots, len %lX\n", size);
@@ -1879,12 +2302,14 @@ void dump_groups(int fd, sa64 delta)
   one_group_root *gr = (one_group_root *)(buf + 1);
   for ( auto cnt = 0; cnt < buf[0]; cnt++, gr++ )
   {
-    printf("[%d] %s at %p flags %X hierarchy_id %d nr_cgrps %ld real_cnt %ld\n", cnt, gr->name, gr->addr, gr->flags, gr->hierarchy_id, gr->nr_cgrps, gr->real_cnt);
+    g_sink->obj("cgroup_root", "[%d] %s at %p flags %X hierarchy_id %d nr_cgrps %ld real_cnt %ld\n").num("idx", cnt).str("name", gr->name)
+      .ptr("addr", gr->addr).num("flags", gr->flags).num("hierarchy_id", gr->hierarchy_id).num("nr_cgrps", gr->nr_cgrps)
+      .num("real_cnt", gr->real_cnt).end();
     dump_cgroup(&gr->grp, delta, fd, a1 + delta, a2 + delta, (unsigned long)gr->addr);
     if ( !gr->real_cnt )
       continue;
     size = calc_data_size<one_cgroup>(gr->real_cnt);
-    unsigned long *cbuf = (unsigned long *)malloc(size);
+    unsigned long *cbuf = (unsigned long *)kdev_alloc(size);
     if ( !cbuf )
       continue;
     dumb_free<unsigned long> ctmp(cbuf);
@@ -1930,11 +2355,11 @@ void dump_uprobes(int fd, sa64 delta)
     printf("IOCTL_CNT_UPROBES count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("uprobes: %ld\n", params[0]);
+  g_sink->rec("list", "%s: %ld\n").str("name", "uprobes").num("cnt", params[0]).end();
   if ( !params[0] )
     return;
   size_t size = calc_data_size<one_uprobe>(params[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
   {
     printf("cannot alloc buffer for uprobes, len %lX\n", size);
@@ -1953,12 +2378,16 @@ void dump_uprobes(int fd, sa64 delta)
   one_uprobe *up = (one_uprobe *)(buf + 1);
   for ( auto cnt = 0; cnt < buf[0]; cnt++ )
   {
-      printf("[%d] addr %p inode %p ino %ld clnts %ld offset %lX ref_ctr_offset %lX flags %lX %s\n", 
-        cnt, up[cnt].addr, up[cnt].inode, up[cnt].i_no, up[cnt].cons_cnt, up[cnt].offset, up[cnt].ref_ctr_offset, up[cnt].flags, up[cnt].name);
+      char at[32];
+      snprintf(at, sizeof(at), "+%lX", (unsigned long)up[cnt].offset);
+      g_sink->obj("uprobe", "[%d] addr %p inode %p ino %ld clnts %ld offset %lX ref_ctr_offset %lX flags %lX %s\n")
+        .num("idx", cnt).ptr("addr", up[cnt].addr).ptr("inode", up[cnt].inode).num("ino", up[cnt].i_no).num("clnts", up[cnt].cons_cnt)
+        .num("offset", up[cnt].offset).num("ref_ctr_offset", up[cnt].ref_ctr_offset).num("flags", up[cnt].flags).str("name", up[cnt].name)
+        .str("at", at).end();
       if ( !up[cnt].cons_cnt )
         continue;
       size_t client_size = calc_data_size<one_uprobe_consumer>(up[cnt].cons_cnt);
-      unsigned long *cbuf = (unsigned long *)malloc(client_size);
+      unsigned long *cbuf = (unsigned long *)kdev_alloc(client_size);
       if ( !cbuf )
       {
         printf("cannot alloc buffer for uprobe %p consumers, len %lX\n", up[cnt].addr, client_size);
@@ -1980,7 +2409,7 @@ void dump_uprobes(int fd, sa64 delta)
       one_uprobe_consumer *uc = (one_uprobe_consumer *)(cbuf + 1);
       for ( auto cnt2 = 0; cnt2 < cbuf[0]; cnt2++ )
       {
-        printf(" consumer[%d] at %p\n", cnt2, uc[cnt2].addr);
+        g_sink->rec("uprobe_consumer", " consumer[%d] at %p\n").num("idx", cnt2).ptr("addr", uc[cnt2].addr).end();
         if ( uc[cnt2].handler )
           dump_kptr((unsigned long)uc[cnt2].handler, "  handler", delta);
         if ( uc[cnt2].ret_handler )
@@ -1997,7 +2426,7 @@ void dump_uprobes(int fd, sa64 delta)
         size_t ut_size = sizeof(one_trace_event_call);
         if ( ut_size < 4 * sizeof(unsigned long) )
           ut_size = 4 * sizeof(unsigned long);
-        unsigned long *cbuf = (unsigned long *)malloc(ut_size);
+        unsigned long *cbuf = (unsigned long *)kdev_alloc(ut_size);
         if ( !cbuf )
           continue;
         dumb_free<unsigned long> tmp3(cbuf);
@@ -2019,7 +2448,7 @@ void dump_uprobes(int fd, sa64 delta)
 
 void dump_protosw(int fd, a64 list, a64 lock, sa64 delta, const char *what)
 {
-  printf("\n%s at %p:\n", what, (void *)(list + delta));
+  g_sink->rec("list", "\n%s at %p:\n").str("name", what).ptr("addr", list + delta).end();
   for ( int i = 0; i < 11; i++ )
   {
     unsigned long args[4] = { list + delta, lock + delta, (unsigned long)i, 0 };
@@ -2032,7 +2461,7 @@ void dump_protosw(int fd, a64 list, a64 lock, sa64 delta, const char *what)
     if ( !args[0] )
       continue;
     size_t size = calc_data_size<one_protosw>(args[0]);
-    unsigned long *buf = (unsigned long *)malloc(size);
+    unsigned long *buf = (unsigned long *)kdev_alloc(size);
     if ( !buf )
       continue;
     dumb_free<unsigned long> tmp(buf);
@@ -2047,11 +2476,11 @@ void dump_protosw(int fd, a64 list, a64 lock, sa64 delta, const char *what)
       continue;
     }
     size = buf[0];
-    printf("[%d]: count %ld\n", i, size);
+    g_sink->rec("protosw_type", "[%d]: count %ld\n").num("type", i).num("cnt", size).end();
     struct one_protosw *sb = (struct one_protosw *)(buf + 1);
     for ( size_t idx = 0; idx < size; idx++, sb++ )
     {
-      printf(" addr %p type %d protocol %d\n", sb->addr, sb->type, sb->protocol);
+      g_sink->rec("protosw", " addr %p type %d protocol %d\n").ptr("addr", sb->addr).num("type", sb->type).num("protocol", sb->protocol).end();
       if ( sb->prot )
         dump_kptr((unsigned long)sb->prot, " prot", delta);
       if ( sb->ops )
@@ -2069,13 +2498,13 @@ void dump_rtnl_af_ops(int fd, a64 nca, sa64 delta)
     printf("IOCTL_GET_RTNL_AF_OPS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("\nrtnl_af_ops at %p: %ld\n", (void *)(nca + delta), args[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "rtnl_af_ops").ptr("addr", nca + delta).num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t m = args[0];
   if ( m < 2 )
     m = 2;
-  unsigned long *buf = (unsigned long *)malloc(m * sizeof(unsigned long));
+  unsigned long *buf = (unsigned long *)kdev_alloc(m * sizeof(unsigned long));
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2102,13 +2531,13 @@ void dump_link_ops(int fd, a64 nca, sa64 delta)
     printf("IOCTL_GET_LINKS_OPS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("\nlink_ops at %p: %ld\n", (void *)(nca + delta), args[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "link_ops").ptr("addr", nca + delta).num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t m = args[0];
   if ( m < 2 )
     m = 2;
-  unsigned long *buf = (unsigned long *)malloc(m * sizeof(unsigned long));
+  unsigned long *buf = (unsigned long *)kdev_alloc(m * sizeof(unsigned long));
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2140,7 +2569,7 @@ void dump_ulps(int fd, a64 nca, a64 plock, sa64 delta)
   }
   dump_data2arg<one_tcp_ulp_ops>(fd, nca, plock, delta, IOCTL_GET_ULP_OPS, "tcp_ulp_list", "IOCTL_GET_ULP_OPS", "tcp_ulp_ops",
    [=](size_t idx, const one_tcp_ulp_ops *sb) {
-    printf(" [%ld] at %p %s", idx, sb->addr, sb->name);
+    g_sink->obj("entry", " [%ld] at %p %s").num("idx", idx).ptr("addr", sb->addr).str("name", sb->name).end();
     dump_unnamed_kptr((unsigned long)sb->addr, delta);
     if ( sb->init )
      dump_kptr((unsigned long)sb->init, " init", delta);
@@ -2172,7 +2601,7 @@ void dump_pernet_ops(int fd, a64 nca, a64 plock, sa64 delta)
   }
   dump_data2arg<one_pernet_ops>(fd, nca, plock, delta, IOCTL_GET_PERNET_OPS, "pernet_ops", "IOCTL_GET_PERNET_OPS", "pernet_ops",
    [=](size_t idx, const one_pernet_ops *sb) {
-    printf(" [%ld] at %p", idx, sb->addr);
+    g_sink->obj("entry", " [%ld] at %p").num("idx", idx).ptr("addr", sb->addr).end();
     dump_unnamed_kptr((unsigned long)sb->addr, delta);
     if ( sb->init )
      dump_kptr((unsigned long)sb->init, " init", delta);
@@ -2186,6 +2615,7 @@ void dump_pernet_ops(int fd, a64 nca, a64 plock, sa64 delta)
 
 static size_t calc_net_chains_size(size_t n)
 {
+  prof_add(PC_KBYTES, (n + 1) * sizeof(unsigned long));
   return (n + 1) * sizeof(unsigned long);
 }
 
@@ -2198,11 +2628,11 @@ void dump_block_chain(int fd, a64 nca, sa64 delta, const char *name)
     printf("IOCTL_CNTSNTFYCHAIN for %s failed, error %d (%s)\n", name, errno, strerror(errno));
     return;
   }
-  printf("\n%s at %p: count %ld\n", name, (void *)(nca + delta), val);
+  g_sink->rec("list", "\n%s at %p: count %ld\n").str("name", name).ptr("addr", nca + delta).num("cnt", val).end();
   if ( !val )
     return;
   size_t size = calc_net_chains_size(val);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2216,7 +2646,7 @@ void dump_block_chain(int fd, a64 nca, sa64 delta, const char *name)
   }
   for ( size_t i = 0; i < buf[0]; i++ )
   {
-    printf(" [%ld]", i);
+    g_sink->obj("entry", " [%ld]").num("idx", i).end();
     dump_unnamed_kptr(buf[i+1], delta);
   }
 }
@@ -2224,7 +2654,7 @@ void dump_block_chain(int fd, a64 nca, sa64 delta, const char *name)
 void dump_net_chains(int fd, a64 nca, size_t cnt, sa64 delta)
 {
   size_t size = calc_net_chains_size(cnt);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2257,11 +2687,11 @@ void dump_genl(int fd, a64 addr, sa64 delta)
     printf("IOCTL_GET_GENL_FAMILIES count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("\ngenl_fam_idr at %p: %ld\n", (void *)(addr + delta), args[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "genl_fam_idr").ptr("addr", addr + delta).num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t size = calc_data_size<one_genl_family>(args[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2277,7 +2707,7 @@ void dump_genl(int fd, a64 addr, sa64 delta)
   one_genl_family *curr = (one_genl_family *)(buf + 1);
   for ( size_t j = 0; j < size; j++, curr++ )
   {
-    printf(" [%ld] at %p id %d %s", j, curr->addr, curr->id, curr->name);
+    g_sink->obj("entry", " [%ld] at %p id %d %s").num("idx", j).ptr("addr", curr->addr).num("id", curr->id).str("name", curr->name).end();
     dump_unnamed_kptr((unsigned long)curr->addr, delta);
     if ( curr->pre_doit )
       dump_kptr((unsigned long)curr->pre_doit, " pre_doit", delta);
@@ -2355,10 +2785,11 @@ void dump_netlinks(int fd, a64 nca, a64 lock, sa64 delta)
       printf("IOCTL_GET_NLTAB index %d failed, error %d (%s)\n", i, errno, strerror(errno));
       return;
     }
-    if ( nlk_names[i] )
-      printf("nl_tab[%s] at %p registered %d sockets %ld\n", nlk_names[i], args.out.addr, args.out.registered, args.out.sk_count);
-    else
-      printf("nl_tab[%d] at %p registered %d sockets %ld\n", i, args.out.addr, args.out.registered, args.out.sk_count);
+    char nname[16];
+    if ( !nlk_names[i] )
+      snprintf(nname, sizeof(nname), "%d", i);
+    g_sink->obj("nl_tab", "nl_tab[%s] at %p registered %d sockets %ld\n").str("name", nlk_names[i] ? nlk_names[i] : nname)
+      .ptr("addr", args.out.addr).num("registered", args.out.registered).num("sk_count", args.out.sk_count).end();
     if ( args.out.bind )
       dump_kptr((unsigned long)args.out.bind, "bind", delta);
     if ( args.out.unbind )
@@ -2368,7 +2799,7 @@ void dump_netlinks(int fd, a64 nca, a64 lock, sa64 delta)
     if ( !args.out.sk_count )
       continue;
     size_t buf_size = calc_data_size<one_nl_socket>(args.out.sk_count);
-    unsigned long *buf = (unsigned long *)malloc(buf_size);
+    unsigned long *buf = (unsigned long *)kdev_alloc(buf_size);
     if ( !buf )
       continue;
     dumb_free<unsigned long> tmp(buf);
@@ -2386,9 +2817,9 @@ void dump_netlinks(int fd, a64 nca, a64 lock, sa64 delta)
     one_nl_socket *curr = (one_nl_socket *)(buf + 1);
     for ( size_t j = 0; j < buf_size; j++, curr++ )
     {
-      printf(" sock[%ld] at %p portid %d sk_type %d sk_protocol %d flags %X subscriptions %d\n",
-       j, curr->addr, curr->portid, curr->sk_type, curr->sk_protocol, curr->flags, curr->subscriptions
-      );
+      g_sink->rec("nl_sock", " sock[%ld] at %p portid %d sk_type %d sk_protocol %d flags %X subscriptions %d\n").num("idx", j)
+        .ptr("addr", curr->addr).num("portid", curr->portid).num("sk_type", curr->sk_type).num("sk_protocol", curr->sk_protocol)
+        .num("flags", curr->flags).num("subscriptions", curr->subscriptions).end();
       if ( curr->netlink_rcv )
         dump_kptr((unsigned long)curr->netlink_rcv, " netlink_rcv", delta);
       if ( curr->netlink_bind )
@@ -2407,6 +2838,7 @@ static size_t calc_proto_size(size_t n)
 {
   if ( n < 2 )
     n = 2;
+  prof_add(PC_KBYTES, (n + 1) * sizeof(unsigned long));
   return (n + 1) * sizeof(unsigned long);
 }
 
@@ -2429,11 +2861,11 @@ void dump_protos(int fd, a64 nca, a64 lock, sa64 delta)
     printf("IOCTL_GET_PROTOS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("\nproto_list at %p: %ld\n", (void *)(nca + delta), args[0]);
+  g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "proto_list").ptr("addr", nca + delta).num("cnt", args[0]).end();
   if ( !args[0] )
     return;
   size_t size = calc_proto_size(args[0]);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2449,7 +2881,7 @@ void dump_protos(int fd, a64 nca, a64 lock, sa64 delta)
   size = buf[0];
   for ( size_t i = 0; i < size; i++ )
   {
-    printf(" [%ld] ", i);
+    g_sink->obj("entry", " [%ld] ").num("idx", i).end();
     dump_unnamed_kptr(buf[1 + i], delta);
   }
 }
@@ -2463,11 +2895,11 @@ void dump_nets(int fd, sa64 delta)
     printf("IOCTL_GET_NETS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("nets: %ld\n", cnt);
+  g_sink->rec("list", "%s: %ld\n").str("name", "nets").num("cnt", cnt).end();
   if ( !cnt )
     return;
   size_t size = calc_data_size<one_net>(cnt);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2482,9 +2914,10 @@ void dump_nets(int fd, sa64 delta)
   struct one_net *sb = (struct one_net *)(buf + 1);
   for ( size_t idx = 0; idx < size; idx++, sb++ )
   {
-    printf("Net[%ld]: %p ifindex %d rtnl %p genl_sock %p diag_nlsk %p uevent_sock %p dev_cnt %ld netdev_chain_cnt %ld\n",
-      idx, sb->addr, sb->ifindex, sb->rtnl, sb->genl_sock, sb->diag_nlsk, sb->uevent_sock, sb->dev_cnt, sb->netdev_chain_cnt
-    );
+    g_sink->obj("net", "Net[%ld]: %p ifindex %d rtnl %p genl_sock %p diag_nlsk %p uevent_sock %p dev_cnt %ld netdev_chain_cnt %ld\n")
+      .num("idx", idx).ptr("addr", sb->addr).num("ifindex", sb->ifindex).ptr("rtnl", sb->rtnl).ptr("genl_sock", sb->genl_sock)
+      .ptr("diag_nlsk", sb->diag_nlsk).ptr("uevent_sock", sb->uevent_sock).num("dev_cnt", sb->dev_cnt)
+      .num("netdev_chain_cnt", sb->netdev_chain_cnt).end();
     if ( sb->rtnl_proto )
       dump_kptr((unsigned long)sb->rtnl_proto, "rtnl_proto", delta);
     if ( sb->rtnl_filter )
@@ -2498,18 +2931,17 @@ void dump_nets(int fd, sa64 delta)
     if ( sb->diag_nlsk_filter )
       dump_kptr((unsigned long)sb->diag_nlsk_filter, "diag_nlsk_filter", delta);
     // dump bpf
-    if ( sb->progs[0] )
-      printf(" netns_bpf[0]: %p\n", sb->progs[0]);
-    if ( sb->bpf_cnt[0] )
-      printf(" bpf_cnt[0]: %ld\n", sb->bpf_cnt[0]);
-    if ( sb->progs[1] )
-      printf(" netns_bpf[1]: %p\n", sb->progs[1]);
-    if ( sb->bpf_cnt[1] )
-      printf(" bpf_cnt[1]: %ld\n", sb->bpf_cnt[1]);
+    for ( int b = 0; b < 2; b++ )
+    {
+      if ( sb->progs[b] )
+        g_sink->rec("netns_bpf", " netns_bpf[%d]: %p\n").num("idx", b).ptr("prog", sb->progs[b]).end();
+      if ( sb->bpf_cnt[b] )
+        g_sink->rec("netns_bpf_cnt", " bpf_cnt[%d]: %ld\n").num("idx", b).num("cnt", sb->bpf_cnt[b]).end();
+    }
     if ( !sb->dev_cnt )
       continue;
     size_t dsize = calc_data_size<one_net_dev>(sb->dev_cnt);
-    unsigned long *dbuf = (unsigned long *)malloc(dsize);
+    unsigned long *dbuf = (unsigned long *)kdev_alloc(dsize);
     if ( !dbuf )
      continue;
     dumb_free<unsigned long> tmp2(dbuf);
@@ -2525,9 +2957,9 @@ void dump_nets(int fd, sa64 delta)
     struct one_net_dev *nd = (struct one_net_dev *)(dbuf + 1);
     for ( size_t j = 0; j < dsize; j++, nd++ )
     {
-      printf(" Dev[%ld]: %p %s ntfy_cnt %ld type %d mtu %d min_mtu %d max_mtu %d\n", 
-        j, nd->addr, nd->name, nd->netdev_chain_cnt, nd->type, nd->mtu, nd->min_mtu, nd->max_mtu
-      );
+      g_sink->obj("net_dev", " Dev[%ld]: %p %s ntfy_cnt %ld type %d mtu %d min_mtu %d max_mtu %d\n").num("idx", j)
+        .ptr("addr", nd->addr).str("name", nd->name).num("ntfy_cnt", nd->netdev_chain_cnt).num("dtype", nd->type)
+        .num("mtu", nd->mtu).num("min_mtu", nd->min_mtu).num("max_mtu", nd->max_mtu).end();
       if ( nd->netdev_ops )
         dump_kptr((unsigned long)nd->netdev_ops, " netdev_ops", delta);
       if ( nd->ethtool_ops )
@@ -2553,13 +2985,14 @@ void dump_nets(int fd, sa64 delta)
       if ( nd->macsec_ops )
         dump_kptr((unsigned long)nd->macsec_ops, " macsec_ops", delta);
       if ( nd->num_hook_entries )
-        printf("num_hook_entries: %ld\n", nd->num_hook_entries);
+        g_sink->rec("net_dev_hooks", "num_hook_entries: %ld\n").num("cnt", nd->num_hook_entries).end();
       // dump xdp_state
       for ( int xdp = 0; xdp < 3; xdp++ )
       {
         if ( !nd->bpf_prog[xdp] && !nd->bpf_link[xdp] )
           continue;
-        printf("  xdp_state[%d] prog %p link %p\n", xdp, nd->bpf_prog[xdp], nd->bpf_link[xdp]);
+        g_sink->rec("xdp_state", "  xdp_state[%d] prog %p link %p\n").num("idx", xdp).ptr("prog", nd->bpf_prog[xdp])
+          .ptr("link", nd->bpf_link[xdp]).end();
       }
     }
   }
@@ -2576,7 +3009,7 @@ void dump_nets(int fd, sa64 delta)
     }
     if ( !sd.addr )
       continue;
-    printf("sock_diag[%d]: %p\n", i, sd.addr);
+    g_sink->obj("sock_diag", "sock_diag[%d]: %p\n").num("family", i).ptr("addr", sd.addr).end();
     if ( sd.dump )
       dump_kptr((unsigned long)sd.dump, "dump", delta);
     if ( sd.get_info )
@@ -2595,7 +3028,7 @@ void dump_nets(int fd, sa64 delta)
     if ( err )
       printf("IOCTL_GET_NETDEV_CHAIN failed, error %d (%s)\n", errno, strerror(errno));
     else {
-      printf("\nnetdev_chain at %p: %ld\n", (void *)(nca + delta), nc[0]);
+      g_sink->rec("list", "\n%s at %p: %ld\n").str("name", "netdev_chain").ptr("addr", nca + delta).num("cnt", nc[0]).end();
       if ( nc[0] )
         dump_net_chains(fd, nca, nc[0], delta);
     }
@@ -2690,9 +3123,10 @@ void dump_marks(unsigned long size, one_fsnotify *of, sa64 delta, const char *ma
   m += " ops";
   for ( size_t k = 0; k < size; k++ )
   {
-    printf("%s fsnotify[%ld] %p mask %X ignored_mask %X flags %X\n", margin, k, of[k].mark_addr, of[k].mask, of[k].ignored_mask, of[k].flags);
+    g_sink->rec("fsnotify", "%s fsnotify[%ld] %p mask %X ignored_mask %X flags %X\n").str("margin", margin).num("idx", k)
+      .ptr("addr", of[k].mark_addr).num("mask", of[k].mask).num("ignored_mask", of[k].ignored_mask).num("flags", of[k].flags).end();
     if ( of[k].group )
-      printf("%s group: %p\n", margin, of[k].group);
+      g_sink->rec("fsnotify_group", "%s group: %p\n").str("margin", margin).ptr("group", of[k].group).end();
     if ( of[k].ops )
       dump_kptr((unsigned long)of[k].ops, m.c_str(), delta);
   }
@@ -2707,11 +3141,11 @@ void dump_super_blocks(int fd, sa64 delta)
     printf("IOCTL_GET_SUPERBLOCKS count failed, error %d (%s)\n", errno, strerror(errno));
     return;
   }
-  printf("super-blocks: %ld\n", cnt);
+  g_sink->rec("list", "%s: %ld\n").str("name", "super-blocks").num("cnt", cnt).end();
   if ( !cnt )
     return;
   size_t size = calc_data_size<one_super_block>(cnt);
-  unsigned long *buf = (unsigned long *)malloc(size);
+  unsigned long *buf = (unsigned long *)kdev_alloc(size);
   if ( !buf )
     return;
   dumb_free<unsigned long> tmp(buf);
@@ -2728,9 +3162,9 @@ void dump_super_blocks(int fd, sa64 delta)
   struct one_super_block *sb = (struct one_super_block *)(buf + 1);
   for ( size_t idx = 0; idx < size; idx++ )
   {
-    printf("superblock[%ld] at %p dev %ld flags %lX inodes %ld %s mnt_count %ld root %p %s\n", idx, sb[idx].addr, sb[idx].dev, sb[idx].s_flags, sb[idx].inodes_cnt, sb[idx].s_id, 
-      sb[idx].mount_count, sb[idx].s_root, sb[idx].root
-    );
+    g_sink->obj("super_block", "superblock[%ld] at %p dev %ld flags %lX inodes %ld %s mnt_count %ld root %p %s\n").num("idx", idx)
+      .ptr("addr", sb[idx].addr).num("dev", sb[idx].dev).num("flags", sb[idx].s_flags).num("inodes", sb[idx].inodes_cnt)
+      .str("id", sb[idx].s_id).num("mnt_count", sb[idx].mount_count).ptr("s_root", sb[idx].s_root).str("root", sb[idx].root).end();
     if ( sb[idx].s_type )
       dump_kptr((unsigned long)sb[idx].s_type, "s_type", delta);
     if ( sb[idx].s_op )
@@ -2744,7 +3178,8 @@ void dump_super_blocks(int fd, sa64 delta)
     if ( sb[idx].s_d_op )
       dump_kptr((unsigned long)sb[idx].s_d_op, "s_d_op", delta);
     if ( sb[idx].s_fsnotify_mask || sb[idx].s_fsnotify_marks )
-      printf(" s_fsnotify_mask: %lX s_fsnotify_marks %p\n", sb[idx].s_fsnotify_mask, sb[idx].s_fsnotify_marks);
+      g_sink->rec("sb_fsnotify", " s_fsnotify_mask: %lX s_fsnotify_marks %p\n").num("mask", sb[idx].s_fsnotify_mask)
+        .ptr("marks", sb[idx].s_fsnotify_marks).end();
     // dump super-block marks
     unsigned long sb_marks_arg[2] = { (unsigned long)sb[idx].addr, 0 };
     err = ioctl(fd, IOCTL_GET_SUPERBLOCK_MARKS, (int *)sb_marks_arg);
@@ -2754,7 +3189,7 @@ void dump_super_blocks(int fd, sa64 delta)
     } else if ( sb_marks_arg[1] )
     {
       size_t mmsize = calc_data_size<one_fsnotify>(sb_marks_arg[1]);
-      unsigned long *mmbuf = (unsigned long *)malloc(mmsize);
+      unsigned long *mmbuf = (unsigned long *)kdev_alloc(mmsize);
       if ( mmbuf )
       {
         // params for IOCTL_GET_SUPERBLOCK_MARKS
@@ -2765,14 +3200,14 @@ void dump_super_blocks(int fd, sa64 delta)
           printf("IOCTL_GET_SUPERBLOCK_MARKS failed, error %d (%s)\n", errno, strerror(errno));
         else
           dump_marks(mmbuf[0], (one_fsnotify *)(mmbuf + 1), delta);
-        free(mmbuf);
+        kdev_free(mmbuf);
       }
     }
     // dump mounts
     if ( sb[idx].mount_count )
     {
       size_t msize = calc_data_size<one_mount>(sb[idx].mount_count);
-      unsigned long *mbuf = (unsigned long *)malloc(msize);
+      unsigned long *mbuf = (unsigned long *)kdev_alloc(msize);
       if ( mbuf )
       {
         // params for IOCTL_GET_SUPERBLOCK_MOUNTS
@@ -2796,11 +3231,12 @@ void dump_super_blocks(int fd, sa64 delta)
               path = mnt[j].mnt_mp;
             else
               path = get_mnt(mnt[j].mnt_id);
-            printf(" mnt[%ld] %p mark_cnt %ld mnt_id %d %s\n", j, mnt[j].addr, mnt[j].mark_count, mnt[j].mnt_id, path ? path : "");
+            g_sink->rec("mount", " mnt[%ld] %p mark_cnt %ld mnt_id %d %s\n").num("idx", j).ptr("addr", mnt[j].addr)
+              .num("mark_cnt", mnt[j].mark_count).num("mnt_id", mnt[j].mnt_id).str("path", path).end();
             if ( !mnt[j].mark_count )
               continue;
             size_t mmsize = calc_data_size<one_fsnotify>(mnt[j].mark_count);
-            unsigned long *mmbuf = (unsigned long *)malloc(mmsize);
+            unsigned long *mmbuf = (unsigned long *)kdev_alloc(mmsize);
             if ( !mmbuf )
               continue;
             // params for IOCTL_GET_MOUNT_MARKS
@@ -2811,21 +3247,21 @@ void dump_super_blocks(int fd, sa64 delta)
             if ( err )
             {
                printf("IOCTL_GET_MOUNT_MARKS failed, error %d (%s)\n", errno, strerror(errno));
-               free(mmbuf);
+               kdev_free(mmbuf);
                continue;
             }
             dump_marks(mmbuf[0], (one_fsnotify *)(mmbuf + 1), delta, "   ");
-            free(mmbuf);
+            kdev_free(mmbuf);
           }
         }
-        free(mbuf);
+        kdev_free(mbuf);
       }
     }
     // dump inodes
     if ( !sb[idx].inodes_cnt )
       continue;
     auto isize = calc_data_size<one_inode>(sb[idx].inodes_cnt);
-    unsigned long *ibuf = (unsigned long *)malloc(isize);
+    unsigned long *ibuf = (unsigned long *)kdev_alloc(isize);
     if ( !ibuf )
       continue;
     dumb_free<unsigned long> itmp(ibuf);
@@ -2845,13 +3281,15 @@ void dump_super_blocks(int fd, sa64 delta)
       if ( !g_opt_v && !inod[j].i_fsnotify_mask && !inod[j].i_fsnotify_marks )
         continue;
       const char *mod = get_mod_name(inod[j].i_mode);
-      printf("  inode[%ld] %p i_no %ld i_flags %X %s\n", j, inod[j].addr, inod[j].i_ino, inod[j].i_flags, mod);
+      g_sink->rec("inode", "  inode[%ld] %p i_no %ld i_flags %X %s\n").num("idx", j).ptr("addr", inod[j].addr).num("ino", inod[j].i_ino)
+        .num("flags", inod[j].i_flags).str("mode", mod).end();
       if ( inod[j].i_fsnotify_mask || inod[j].i_fsnotify_marks )
-        printf("    i_fsnotify_mask: %lX i_fsnotify_marks %p count %ld\n", inod[j].i_fsnotify_mask, inod[j].i_fsnotify_marks, inod[j].mark_count);
+        g_sink->rec("inode_fsnotify", "    i_fsnotify_mask: %lX i_fsnotify_marks %p count %ld\n").num("mask", inod[j].i_fsnotify_mask)
+          .ptr("marks", inod[j].i_fsnotify_marks).num("cnt", inod[j].mark_count).end();
       if ( !inod[j].mark_count )
         continue;
       size_t msize = calc_data_size<one_fsnotify>(inod[j].mark_count);
-      unsigned long *fbuf = (unsigned long *)malloc(msize);
+      unsigned long *fbuf = (unsigned long *)kdev_alloc(msize);
       if ( !fbuf )
         continue;
       // params for IOCTL_GET_INODE_MARKS
@@ -2862,11 +3300,11 @@ void dump_super_blocks(int fd, sa64 delta)
       if ( err )
       {
         printf("IOCTL_GET_INODE_MARKS failed, error %d (%s)\n", errno, strerror(errno));
-        free(fbuf);
+        kdev_free(fbuf);
         continue;
       }
       dump_marks(fbuf[0], (one_fsnotify *)(fbuf + 1), delta, "   ");
-      free(fbuf);
+      kdev_free(fbuf);
     }
   }
 }
@@ -2905,7 +3343,7 @@ void dump_kprobes(int fd, sa64 delta)
   }
   size_t curr_n = 3;
   size_t ksize = calc_data_size<one_kprobe>(curr_n);
-  unsigned long *buf = (unsigned long *)malloc(ksize);
+  unsigned long *buf = (unsigned long *)kdev_alloc(ksize);
   if ( !buf )
     return;
   for ( int i = 0; i < 64; i++ )
@@ -2919,17 +3357,17 @@ void dump_kprobes(int fd, sa64 delta)
     }
     if ( !params[0] )
       continue;
-    printf("kprobes[%d]: %ld\n", i, params[0]);
+    g_sink->rec("kprobe_bucket", "kprobes[%d]: %ld\n").num("bucket", i).num("cnt", params[0]).end();
     // ok, we have some kprobes, read them all
     if ( params[0] > curr_n )
     {
       unsigned long *tmp;
       ksize = calc_data_size<one_kprobe>(params[0]);
-      tmp = (unsigned long *)malloc(ksize);
+      tmp = (unsigned long *)kdev_alloc(ksize);
       if ( tmp == NULL )
         break;
       curr_n = params[0];
-      free(buf);
+      kdev_free(buf);
       buf = tmp;
     }
     // fill params
@@ -2948,13 +3386,23 @@ void dump_kprobes(int fd, sa64 delta)
     struct one_kprobe *kp = (struct one_kprobe *)(buf + 1);
     for ( size_t idx = 0; idx < ksize; idx++ )
     {
+      // symbolic location of kprobe for structured output
+      char at[256];
+      size_t off = 0;
+      const char *kname = lower_name_by_addr_with_off((a64)kp[idx].kaddr - delta, &off);
+      if ( kname == NULL )
+        snprintf(at, sizeof(at), "%p", kp[idx].kaddr);
+      else if ( off )
+        snprintf(at, sizeof(at), "%s+%lX", kname, off);
+      else
+        snprintf(at, sizeof(at), "%s", kname);
       if ( kp[idx].is_aggr )
-        printf(" kprobe at %p flags %X aggregated\n", kp[idx].kaddr, kp[idx].flags);
+        g_sink->obj("kprobe", " kprobe at %p flags %X aggregated\n").ptr("addr", kp[idx].kaddr).num("flags", kp[idx].flags).str("at", at).str("kind", "aggr").end();
       else {
         if ( kp[idx].is_retprobe )
-          printf(" kprobe at %p flags %X retprobe\n", kp[idx].kaddr, kp[idx].flags);
+          g_sink->obj("kprobe", " kprobe at %p flags %X retprobe\n").ptr("addr", kp[idx].kaddr).num("flags", kp[idx].flags).str("at", at).str("kind", "retprobe").end();
         else
-          printf(" kprobe at %p flags %X\n", kp[idx].kaddr, kp[idx].flags);
+          g_sink->obj("kprobe", " kprobe at %p flags %X\n").ptr("addr", kp[idx].kaddr).num("flags", kp[idx].flags).str("at", at).end();
         auto is_d = g_kpd.find((unsigned long)kp[idx].kaddr);
         if ( is_d != g_kpd.end() )
         {
@@ -3000,9 +3448,9 @@ void dump_kprobes(int fd, sa64 delta)
         }
         if ( !cbuf[0] )
           continue;
-        printf("  %ld aggregated kprobes:\n", cbuf[0]);
+        g_sink->rec("kprobe_aggr_cnt", "  %ld aggregated kprobes:\n").num("cnt", cbuf[0]).end();
         auto isize = calc_data_size<one_kprobe>(cbuf[0]);
-        unsigned long *ibuf = (unsigned long *)malloc(isize);
+        unsigned long *ibuf = (unsigned long *)kdev_alloc(isize);
         if ( !ibuf )
           continue;
         dumb_free<unsigned long> itmp(ibuf);
@@ -3022,10 +3470,10 @@ void dump_kprobes(int fd, sa64 delta)
         struct one_kprobe *kp = (struct one_kprobe *)(ibuf + 1);
         for ( size_t idx2 = 0; idx2 < agsize; idx2++ )
         {
-          printf("  [%ld] at %p", idx2, kp[idx2].kaddr);
           if ( kp[idx2].is_retprobe )
-            printf(" kretprobe");
-          printf("\n");
+            g_sink->rec("kprobe_aggr", "  [%ld] at %p kretprobe\n").num("idx", idx2).ptr("addr", kp[idx2].kaddr).str("kind", "retprobe").end();
+          else
+            g_sink->rec("kprobe_aggr", "  [%ld] at %p\n").num("idx", idx2).ptr("addr", kp[idx2].kaddr).end();
           auto is_d = g_kpd.find((unsigned long)kp[idx2].kaddr);
           if ( is_d != g_kpd.end() )
           {
@@ -3057,7 +3505,7 @@ void dump_kprobes(int fd, sa64 delta)
     }
   }
   if ( buf != NULL )
-    free(buf);
+    kdev_free(buf);
 }
 
 void install_urn(int fd, int action)
@@ -3090,7 +3538,7 @@ void dump_freq_ntfy(int fd, const char *pfx, unsigned long *buf, sa64 delta)
   }
   for ( size_t i = 0; i < buf[0]; i++ )
   {
-    printf(" %s[%ld]", pfx, i);
+    g_sink->obj("entry", " %s[%ld]").str("name", pfx).num("idx", i).end();
     dump_unnamed_kptr(buf[i+1], delta);
   }
 }
@@ -3108,11 +3556,12 @@ void dump_freq_ntfy(int fd, sa64 delta)
       printf("dump_freq_ntfy count for cpu_id %d failed, error %d (%s)\n", i, errno, strerror(errno));
       break;
     }
-    printf("cpufreq_policy[%d] at %p min_cnt %ld max_cnt %ld\n", i, (void *)arg[0], arg[1], arg[2]);
+    g_sink->rec("cpufreq_policy", "cpufreq_policy[%d] at %p min_cnt %ld max_cnt %ld\n").num("cpu", i).ptr("addr", arg[0])
+      .num("min_cnt", arg[1]).num("max_cnt", arg[2]).end();
     if ( !arg[1] && !arg[2] )
       continue;
     size_t cnt_size = calc_freq_ntfy_size(std::max(arg[1], arg[2]));
-    unsigned long *buf = (unsigned long *)malloc(cnt_size);
+    unsigned long *buf = (unsigned long *)kdev_alloc(cnt_size);
     if ( !buf )
     {
       printf("cannot alloc %ld bytes of memory for cpufreq_policy[%d]\n", cnt_size, i);
@@ -3141,7 +3590,7 @@ void dump_return_notifier_list(int fd, unsigned long this_off, unsigned long off
   int cpu_num = get_nprocs();
   size_t curr_n = 3;
   size_t size = calc_urntfy_size(curr_n);
-  unsigned long *ntfy = (unsigned long *)malloc(size);
+  unsigned long *ntfy = (unsigned long *)kdev_alloc(size);
   if ( ntfy == NULL )
     return;
   for ( int i = 0; i < cpu_num; i++ )
@@ -3154,9 +3603,9 @@ void dump_return_notifier_list(int fd, unsigned long this_off, unsigned long off
       break;
     }
     if ( buf[0] )
-      printf("cpu[%d]: head %p %ld\n", i, (void *)buf[0], buf[1]);
+      g_sink->rec("return_ntfy", "cpu[%d]: head %p %ld\n").num("cpu", i).ptr("head", buf[0]).num("cnt", buf[1]).end();
     else
-      printf("cpu[%d]: %ld\n", i, buf[1]);
+      g_sink->rec("return_ntfy", "cpu[%d]: %ld\n").num("cpu", i).num("cnt", buf[1]).end();
     if ( !buf[1] )
       continue; // no ntfy on this cpu
     // read ntfy
@@ -3164,11 +3613,11 @@ void dump_return_notifier_list(int fd, unsigned long this_off, unsigned long off
     {
       unsigned long *tmp;
       size = calc_urntfy_size(buf[1]);
-      tmp = (unsigned long *)malloc(size);
+      tmp = (unsigned long *)kdev_alloc(size);
       if ( tmp == NULL )
         break;
       curr_n = buf[1];
-      free(ntfy);
+      kdev_free(ntfy);
       ntfy = tmp;
     }
     // fill params
@@ -3190,13 +3639,13 @@ void dump_return_notifier_list(int fd, unsigned long this_off, unsigned long off
     }
   }
   if ( ntfy != NULL )
-    free(ntfy);
+    kdev_free(ntfy);
 }
 
 void dump_efivar_ops_field(int fd, char *ptr, const char *fname, sa64 delta)
 {
   char *arg = ptr;
-  int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+  int err = read_kptr(fd, arg, &arg);
    if ( err )
      printf("cannot read %s at %p, err %d\n", fname, ptr, err);
    else if ( arg )
@@ -3209,7 +3658,7 @@ void dump_efivars(int fd, a64 saddr, sa64 delta)
 {
    char *ptr = (char *)saddr + delta + 2 * sizeof(void *);
    char *arg = ptr;
-   int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+   int err = read_kptr(fd, arg, &arg);
    if ( err )
    {
       printf("dump_efivars: read at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
@@ -3218,13 +3667,13 @@ void dump_efivars(int fd, a64 saddr, sa64 delta)
    if ( !arg )
      return;
    if ( is_inside_kernel((unsigned long)arg) )
-      printf("efivar_operations at %p: %p - kernel\n", ptr, arg);
+      g_sink->rec("kptr", "%s at %p: %p - kernel\n").str("name", "efivar_operations").ptr("at", ptr).ptr("addr", arg).str("owner", "kernel").end();
    else {
      const char *mname = find_kmod((unsigned long)arg);
      if ( mname )
-       printf("efivar_operations at %p: %p - %s\n", ptr, arg, mname);
+       g_sink->rec("kptr", "%s at %p: %p - %s\n").str("name", "efivar_operations").ptr("at", ptr).ptr("addr", arg).str("owner", mname).end();
      else
-       printf("efivar_operations at %p: %p UNKNOWN\n", ptr, arg);
+       g_sink->rec("kptr", "%s at %p: %p UNKNOWN\n").str("name", "efivar_operations").ptr("at", ptr).ptr("addr", arg).end();
    }
    // dump all five fields
    ptr = arg;
@@ -3247,7 +3696,7 @@ void dump_usb_mon(int fd, a64 saddr, sa64 delta)
 {
    char *ptr = (char *)saddr + delta;
    char *arg = ptr;
-   int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+   int err = read_kptr(fd, arg, &arg);
    if ( err )
    {
       printf("dump_usb_mon: read at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
@@ -3256,16 +3705,16 @@ void dump_usb_mon(int fd, a64 saddr, sa64 delta)
    if ( arg )
    {
      if ( is_inside_kernel((unsigned long)arg) )
-       printf("mon_ops at %p: %p - kernel\n", (char *)saddr + delta, arg);
+       g_sink->rec("kptr", "%s at %p: %p - kernel\n").str("name", "mon_ops").ptr("at", ptr).ptr("addr", arg).str("owner", "kernel").end();
      else {
        const char *mname = find_kmod((unsigned long)arg);
        if ( mname )
-         printf("mon_ops at %p: %p - %s\n", (char *)saddr + delta, arg, mname);
+         g_sink->rec("kptr", "%s at %p: %p - %s\n").str("name", "mon_ops").ptr("at", ptr).ptr("addr", arg).str("owner", mname).end();
        else
-         printf("mon_ops at %p: %p UNKNOWN\n", (char *)saddr + delta, arg);
+         g_sink->rec("kptr", "%s at %p: %p UNKNOWN\n").str("name", "mon_ops").ptr("at", ptr).ptr("addr", arg).end();
      }
    } else 
-     printf("mon_ops at %p: %p\n", (char *)saddr + delta, arg);
+     g_sink->rec("kptr", "%s at %p: %p\n").str("name", "mon_ops").ptr("at", ptr).ptr("addr", arg).end();
    if ( !arg )
      return;
    // see https://elixir.bootlin.com/linux/v5.14-rc7/source/include/linux/usb/hcd.h#L702
@@ -3290,7 +3739,7 @@ void check_tracepoints(int fd, sa64 delta, addr_sym *tsyms, size_t tcount)
   // alloc enough memory for tracepoint info
   size_t i, j, curr_n = 3;
   size_t size = calc_tp_size(curr_n);
-  unsigned long *ntfy = (unsigned long *)malloc(size);
+  unsigned long *ntfy = (unsigned long *)kdev_alloc(size);
   if ( ntfy == NULL )
     return;
   for ( i = 0; i < tcount; i++ )
@@ -3303,7 +3752,7 @@ void check_tracepoints(int fd, sa64 delta, addr_sym *tsyms, size_t tcount)
       printf("error %d while read tracepoint info for %s at %p\n", err, tsyms[i].name, (void *)addr);
       continue;
     }
-    printf(" %s at %p: enabled %d cnt %d\n", tsyms[i].name, (void *)addr, (int)ntfy[0], (int)ntfy[3]);
+    g_sink->rec("tracepoint", " %s at %p: enabled %d cnt %d\n").str("name", tsyms[i].name).ptr("addr", addr).num("enabled", (int)ntfy[0]).num("cnt", (int)ntfy[3]).end();
     // 1 - regfunc
     if ( ntfy[1] )
        dump_kptr(ntfy[1], " regfunc", delta);
@@ -3317,11 +3766,11 @@ void check_tracepoints(int fd, sa64 delta, addr_sym *tsyms, size_t tcount)
     {
       unsigned long *tmp;
       size = calc_tp_size(addr);
-      tmp = (unsigned long *)malloc(size);
+      tmp = (unsigned long *)kdev_alloc(size);
       if ( tmp == NULL )
         break;
       curr_n = curr_cnt;
-      free(ntfy);
+      kdev_free(ntfy);
       ntfy = tmp;
     }
     // dump funcs
@@ -3337,11 +3786,23 @@ void check_tracepoints(int fd, sa64 delta, addr_sym *tsyms, size_t tcount)
     one_tracepoint_func *curr = (one_tracepoint_func *)(ntfy + 1);
     for ( j = 0; j < size; j++ , curr++ )
     {
-      printf("  [%ld] data %p", j, (void *)curr->data);
-      dump_unnamed_kptr(curr->addr, delta);
+      kptr_class kc;
+      classify_kptrs(&curr->addr, 1, delta, &kc);
+      if ( kc.in_kernel )
+      {
+        if ( kc.name != NULL )
+          g_sink->rec("tp_func", "  [%ld] data %p %p - kernel!%s\n").num("idx", j).ptr("data", curr->data).ptr("addr", curr->addr).str("sym", kc.name).str("tp", tsyms[i].name).str("owner", "kernel").end();
+        else
+          g_sink->rec("tp_func", "  [%ld] data %p %p - kernel\n").num("idx", j).ptr("data", curr->data).ptr("addr", curr->addr).str("tp", tsyms[i].name).str("owner", "kernel").end();
+      } else {
+        if ( kc.name )
+          g_sink->rec("tp_func", "  [%ld] data %p %p - %s\n").num("idx", j).ptr("data", curr->data).ptr("addr", curr->addr).str("owner", kc.name).str("tp", tsyms[i].name).end();
+        else
+          g_sink->rec("tp_func", "  [%ld] data %p %p UNKNOWN\n").num("idx", j).ptr("data", curr->data).ptr("addr", curr->addr).str("tp", tsyms[i].name).end();
+      }
     }
   }
-  free(ntfy);
+  kdev_free(ntfy);
 }
 
 void dunp_kalarms(int fd, sa64 delta)
@@ -3355,7 +3816,7 @@ void dunp_kalarms(int fd, sa64 delta)
       printf("error %d while read IOCTL_GET_ALARMS %d cnt\n", err, i);
       continue;
     }
-    printf("kalarms %d: cnt %ld\n", i, params[0]);
+    g_sink->rec("kalarm_base", "kalarms %d: cnt %ld\n").num("type", i).num("cnt", params[0]).end();
     if ( params[1] )
       dump_kptr(params[1], " get_ktime", delta);
     if ( params[2] )
@@ -3363,7 +3824,7 @@ void dunp_kalarms(int fd, sa64 delta)
     if ( !params[0] )
       continue;
     size_t size = calc_data_size<one_alarm>(params[0]);
-    unsigned long *buf = (unsigned long *)malloc(size);
+    unsigned long *buf = (unsigned long *)kdev_alloc(size);
     if ( !buf )
     {
       printf("cannot alloc buffer for kalarmss, len %lX\n", size);
@@ -3382,7 +3843,7 @@ void dunp_kalarms(int fd, sa64 delta)
     one_alarm *k = (one_alarm *)(buf + 1);
     for ( unsigned long l = 0; l < buf[0]; ++k, ++l )
     {
-      printf(" %p\n", k->addr);
+      g_sink->rec("kalarm", " %p\n").ptr("addr", k->addr).end();
       if ( k->hr_timer )
         dump_kptr((unsigned long)k->hr_timer, " hr_timer", delta);
       if ( k->func )
@@ -3414,18 +3875,18 @@ void dump_ktimers(int fd, a64 off, a64 poff, sa64 delta)
   }
   dumb_free<unsigned long> ptmp { per };
   poff += delta;
-  printf("__per_cpu_offset at %p\n", (void *)poff);
+  g_sink->rec("per_cpu_offset", "__per_cpu_offset at %p\n").ptr("addr", poff).end();
   for ( i = 0; i < cpu_num; i++ )
   {
     unsigned long addr = poff + i * sizeof(unsigned long);
-    int err = ioctl(fd, IOCTL_READ_PTR, (int *)&addr);
+    int err = read_kptr(fd, (void *)addr, &addr);
     if ( err )
     {
       printf("error %d while read per_cpu %d\n", err, i);
       continue;
     }
     per[i] = addr;
-    printf("per_cpu[%d]: %p\n", i, (void *)per[i] ); 
+    g_sink->rec("per_cpu", "per_cpu[%d]: %p\n").num("cpu", i).ptr("addr", per[i]).end();
   }
   unsigned long tmax = 0;
   for ( i = 0; i < cpu_num; i++ )
@@ -3449,7 +3910,7 @@ void dump_ktimers(int fd, a64 off, a64 poff, sa64 delta)
   printf("tmax %ld\n", tmax);
 #endif  
   size_t tsize = calc_tsize(tmax);
-  unsigned long *buf = (unsigned long *)malloc(tsize);
+  unsigned long *buf = (unsigned long *)kdev_alloc(tsize);
   if ( !buf )
   {
     printf("cannot alloc buffer for timers, len %lX\n", tsize);
@@ -3469,14 +3930,19 @@ void dump_ktimers(int fd, a64 off, a64 poff, sa64 delta)
       continue;
     }
     ktimer *k = (ktimer *)(buf + 1);
-    printf("timers for cpu %d %ld:\n", i, buf[0]);
+    g_sink->rec("list", "timers for cpu %d %ld:\n").num("cpu", i).num("cnt", buf[0]).end();
+    std::vector<unsigned long> funcs(buf[0]);
+    std::vector<kptr_class> kc(buf[0]);
+    for ( unsigned long l = 0; l < buf[0]; ++l )
+      funcs[l] = (unsigned long)k[l].func;
+    classify_kptrs(funcs.data(), funcs.size(), delta, kc.data());
     for ( unsigned long l = 0; l < buf[0]; ++k, ++l )
     {
       if ( k->wq_addr )
-        printf(" %p wq %p flags %X %p", k->addr, k->wq_addr, k->flags, k->func);
+        g_sink->obj("ktimer", " %p wq %p flags %X %p").ptr("addr", k->addr).ptr("wq", k->wq_addr).num("flags", k->flags).ptr("func", k->func).end();
       else
-        printf(" %p flags %X %p", k->addr, k->flags, k->func);
-      dump_unnamed_kptr((unsigned long)k->func, delta);
+        g_sink->obj("ktimer", " %p flags %X %p").ptr("addr", k->addr).num("flags", k->flags).ptr("func", k->func).end();
+      dump_unnamed_kptr(funcs[l], kc[l]);
     }
   }
 }
@@ -3507,9 +3973,9 @@ void dump_addr_name(a64 addr)
 {
    const char *name = lower_name_by_addr(addr);
    if ( name != NULL )
-      printf("%p # %s\n", (void *)addr, name);
+      g_sink->rec("addr", "%p # %s\n").ptr("addr", addr).str("sym", name).end();
    else
-      printf("%p\n", (void *)addr);
+      g_sink->rec("addr", "%p\n").ptr("addr", addr).end();
 }
 
 int main(int argc, char **argv)
@@ -3530,9 +3996,22 @@ int main(int argc, char **argv)
        opt_T = 0,
        opt_b = 0,
        opt_B = 0,
-       opt_u = 0;
+       opt_u = 0,
+       opt_p = 0;
+   const char *opt_w = NULL,
+              *opt_a = NULL,
+              *opt_A = NULL,
+              *opt_D = NULL,
+              *opt_J = NULL,
+              *opt_R = NULL,
+              *opt_E = NULL,
+              *opt_K = NULL;
+   int opt_P = 0;
    int c;
-   int fd = 0;
+   int fd = -1;
+   // driver is not opened (no -c, failed or -K without driver): kernel memory only through g_kmem,
+   // collectors issuing ioctls are skipped
+   int no_drv = 1;
    std::map<unsigned long, unsigned char> patches;
    while (1)
    {
@@ -3579,7 +4058,7 @@ int main(int argc, char **argv)
        optind++;
        continue;
      }
-     c = getopt(argc, argv, "BbCcdFfghHknrSstTuvj:");
+     c = getopt(argc, argv, "BbCcdeFfghHknOPrSstTuvA:a:D:E:i:I:j:J:K:o:p:R:w:x:");
      if (c == -1)
       break;
 
@@ -3594,6 +4073,62 @@ int main(int argc, char **argv)
         case 'B':
           opt_B = 1;
          break;
+        case 'p':
+          opt_p = atoi(optarg);
+         break;
+        case 'o':
+          if ( !set_sink(optarg) )
+            usage(argv[0]);
+         break;
+        case 'w':
+          opt_w = optarg;
+         break;
+        case 'a':
+          opt_a = optarg;
+         break;
+        case 'A':
+          opt_A = optarg;
+         break;
+        case 'D':
+          opt_D = optarg;
+         break;
+        case 'P':
+          opt_P = 1;
+         break;
+        case 'O':
+          g_opt_O = 1;
+         break;
+        case 'e':
+          g_opt_e = 1;
+         break;
+        case 'R':
+          opt_R = optarg;
+         break;
+        case 'E':
+          opt_E = optarg;
+         break;
+        case 'x':
+          {
+            int err = s_jcache.open(optarg);
+            if ( err )
+              fprintf(stderr, "cannot open jit cache %s, error %d (%s)\n", optarg, err, strerror(err));
+          }
+         break;
+        case 'K':
+          opt_K = optarg;
+          opt_c = 1;
+         break;
+        case 'J':
+          opt_J = optarg;
+          opt_P = 1;
+         break;
+        case 'i':
+          s_daemon.set_interval(atoi(optarg));
+         break;
+        case 'I':
+          if ( !s_daemon.set_intervals(optarg) )
+            usage(argv[0]);
+         break;
         case 'b':
           opt_b = 1;
          break;
@@ -3657,22 +4192,81 @@ int main(int argc, char **argv)
    }
    if (optind == argc)
      usage(argv[0]);
-
-   elfio reader;
+   // in daemon mode collectors are only remembered and run later by s_daemon, so there is
+   // no single pass to make snapshot or allowlist from
+   if ( opt_D != NULL && (opt_w != NULL || opt_a != NULL) )
+   {
+     printf("-w and -a cannot be used in daemon mode\n");
+     usage(argv[0]);
+   }
+   if ( opt_D != NULL )
+     s_collectors.set_resident(1);
+   if ( opt_R != NULL && opt_E != NULL )
+     usage(argv[0]);
+   if ( opt_R != NULL )
+   {
+     int err = kdev_record(opt_R);
+     if ( err )
+     {
+       printf("cannot record to %s, error %d (%s)\n", opt_R, err, strerror(err));
+       return err;
+     }
+   }
+   if ( opt_E != NULL )
+   {
+     int err = kdev_replay(opt_E);
+     if ( err )
+     {
+       printf("cannot replay %s, error %d (%s)\n", opt_E, err, strerror(err));
+       return err;
+     }
+   }
+   if ( opt_K != NULL )
+   {
+     int err = s_core.open(opt_K);
+     if ( err )
+     {
+       printf("cannot open core %s, error %d (%s)\n", opt_K, err, strerror(err));
+       return err;
+     }
+     g_kmem = &s_core;
+   }
+   if ( opt_P && !prof_start(opt_J) )
+     fprintf(stderr, "cannot start profiling, error %d\n", errno);
+   elf_view reader;
    int has_syms = 0;
+   prof_scope ps_load("elf_load");
    if ( !reader.load( argv[optind] ) ) 
    {
       printf( "File %s is not found or it is not an ELF file\n", argv[optind] );
       return 1;
    }
+   ps_load.end();
    optind++;
-   Elf_Half n = reader.sections.size();
-   for ( Elf_Half i = 0; i < n; ++i ) { // For all sections
-     section* sec = reader.sections[i];
+   // must wrap selected sink, so after all options. snapshot is outermost to see all records
+   std::string build_id = reader.get_build_id();
+   if ( opt_A != NULL )
+   {
+     int err = s_allow.load(opt_A);
+     if ( err )
+     {
+       fprintf(stderr, "cannot load allowlist %s, error %d (%s)\n", opt_A, err, strerror(err));
+       return err;
+     }
+     if ( build_id != s_allow.build_id() )
+       fprintf(stderr, "allowlist %s is for build %s, kernel build is %s\n", opt_A, s_allow.build_id(), build_id.c_str());
+     g_sink = s_allow_sink = new allow_sink(g_sink, s_allow, build_id);
+   }
+   if ( (opt_w != NULL || opt_a != NULL) && start_snapshot() )
+     fprintf(stderr, "cannot start snapshot, error %d\n", errno);
+   prof_scope ps_syms("symbols");
+   unsigned int n = reader.sections.size();
+   for ( unsigned int i = 0; i < n; ++i ) { // For all sections
+     const elf_section* sec = reader.sections[i];
      if ( SHT_SYMTAB == sec->get_type() ||
           SHT_DYNSYM == sec->get_type() ) 
      {
-       symbol_section_accessor symbols( reader, sec );
+       elf_symbols symbols( reader, sec );
        if ( !read_syms(reader, symbols) )
          has_syms++;
      }
@@ -3689,13 +4283,20 @@ int main(int argc, char **argv)
      has_syms = 1;
      optind++;
    }
+   ps_syms.end();
    sa64 delta = 0;
    a64 bpf_target = 0;
 #ifndef _MSC_VER
    // open driver
    if ( opt_c ) 
    {
-     fd = open("/dev/lkcd", 0);
+     prof_scope ps_drv("driver_init");
+     fd = kdev_open();
+     if ( -1 == fd && g_kmem != NULL )
+     {
+       init_offline(delta);
+       goto end;
+     }
      if ( -1 == fd )
      {
        printf("cannot open device, error %d\n", errno);
@@ -3707,55 +4308,76 @@ int main(int argc, char **argv)
      if ( !symbol_a )
      {
        close(fd);
-       fd = 0;
+       fd = -1;
        opt_c = 0;
        goto end;
      } else {
        if ( read_kernel_area(fd) )
        {
          close(fd);
-         fd = 0;
+         fd = -1;
          opt_c = 0;
          goto end;
        }
-       int err = init_kmods();
-       if ( err )
-       {
-         printf("init_kmods failed, error %d\n", err);
-         goto end;
-       }
        printf("group_balance_cpu from symbols: %p\n", (void *)symbol_a);
        union ksym_params kparm;
        strcpy(kparm.name, "group_balance_cpu");
-       err = ioctl(fd, IOCTL_RKSYM, (int *)&kparm);
+       int err = ioctl(fd, IOCTL_RKSYM, (int *)&kparm);
        if ( err )
        {
          printf("IOCTL_RKSYM test failed, error %d\n", err);
          close(fd);
-         fd = 0;
+         fd = -1;
          opt_c = 0;
        } else {
+         no_drv = 0;
          printf("group_balance_cpu: %p\n", (void *)kparm.addr);
          delta = (char *)kparm.addr - (char *)symbol_a;
          printf("delta: %lX\n", delta);
        }
+       // prefer driver - it also knows init layouts and bpf images
+       a64 mods = get_addr("modules");
+       a64 mlock = get_addr("module_mutex");
+       a64 bksyms = get_addr("bpf_kallsyms");
+       a64 block = get_addr("bpf_lock");
+       err = ENOENT;
+       if ( opt_c && mods && mlock )
+         err = init_kmods_drv(fd, mods + delta, mlock + delta, bksyms ? bksyms + delta : 0, block ? block + delta : 0);
+       if ( err )
+         err = init_kmods();
+       if ( err )
+       {
+         printf("init_kmods failed, error %d\n", err);
+         goto end;
+       }
+       // modules can be loaded/unloaded between daemon scans
+       s_daemon.set_refresh([=](int cfd) {
+         if ( !mods || !mlock || init_kmods_drv(cfd, mods + delta, mlock + delta, bksyms ? bksyms + delta : 0, block ? block + delta : 0) )
+           init_kmods();
+       });
      }
      if ( opt_c && !patches.empty() )
         patch_kernel(fd, patches);
+     ps_drv.end();
+     // from now output of collectors is buffered and flushed in order
+     if ( opt_c && opt_p > 1 && opt_D == NULL )
+       s_collectors.start(opt_p);
      // dump consoles
      if ( opt_c && opt_C )
-       dump_consoles(fd, delta);
+       s_collectors.run("consoles", fd, [&](int cfd) { dump_consoles(cfd, delta); });
      // dump kprobes
      if ( opt_k && opt_c )
      {
-       dump_kprobes(fd, delta);
-       dump_uprobes(fd, delta);
+       s_collectors.run("kprobes", fd, [&](int cfd) {
+         dump_kprobes(cfd, delta);
+         dump_uprobes(cfd, delta);
+       });
      }
      // dump super-blocks
      if ( opt_F && opt_c )
-       dump_super_blocks(fd, delta);
+       s_collectors.run("super_blocks", fd, [&](int cfd) { dump_super_blocks(cfd, delta); });
      if ( opt_c && opt_n )
-       dump_nets(fd, delta);
+       s_collectors.run("nets", fd, [&](int cfd) { dump_nets(cfd, delta); });
      // check sysfs f_ops
      if ( opt_c && opt_s )
      {
@@ -3775,22 +4397,21 @@ int main(int argc, char **argv)
            printf("IOCTL_KERNFS_NODE(%s) failed, error %d\n", argv[idx], err);
            continue;
          }
-         printf("res %s: %p\n", argv[idx], (void *)kparm.res.addr);
+         g_sink->obj("kernfs", "res %s: %p\n").str("name", argv[idx]).ptr("addr", kparm.res.addr).end();
          if ( kparm.res.addr )
          {
            // dump flags
-           printf(" flags: %lX", kparm.res.flags);
+           std::string fnames;
            if ( kparm.res.flags & 1 )
-             printf(" DIR");
+             fnames += " DIR";
            if ( kparm.res.flags & 2 )
-             printf(" FILE");
+             fnames += " FILE";
            if ( kparm.res.flags & 4 )
-             printf(" LINK");
-           printf("\n");
-
-           printf(" priv: %p\n", (void *)kparm.res.priv);
+             fnames += " LINK";
+           g_sink->rec("kernfs_flags", " flags: %lX%s\n").num("flags", kparm.res.flags).str("kinds", fnames.c_str()).end();
+           g_sink->rec("kernfs_priv", " priv: %p\n").ptr("priv", kparm.res.priv).end();
            if ( kparm.res.kobject )
-             printf("kobject: %p\n", (void *)kparm.res.kobject);
+             g_sink->rec("kernfs_kobject", "kobject: %p\n").ptr("kobject", kparm.res.kobject).end();
            if ( kparm.res.ktype )
              dump_kptr(kparm.res.ktype, "ktype", delta);
            if ( kparm.res.sysfs_ops )
@@ -3800,7 +4421,7 @@ int main(int argc, char **argv)
            if ( kparm.res.store )
              dump_kptr(kparm.res.sysfs_ops, "sysfs_ops.store", delta);
          } else {
-           printf(" inode: %p\n", (void *)kparm.res.flags);
+           g_sink->rec("kernfs_inode", " inode: %p\n").ptr("inode", kparm.res.flags).end();
            if ( kparm.res.s_op )
              dump_kptr(kparm.res.s_op, "s_op", delta);
            if ( kparm.res.priv )
@@ -3817,10 +4438,10 @@ end:
 #endif /* _MSC_VER */
    // find .text section
    Elf64_Addr text_start = 0;
-   Elf_Xword text_size = 0;
-   section *text_section = NULL;
-   for ( Elf_Half i = 0; i < n; ++i ) { // For all sections
-     section* sec = reader.sections[i];
+   Elf64_Xword text_size = 0;
+   const elf_section *text_section = NULL;
+   for ( unsigned int i = 0; i < n; ++i ) { // For all sections
+     const elf_section* sec = reader.sections[i];
      if ( sec->get_name() == ".text" )
      {
        text_start = sec->get_address();
@@ -3831,6 +4452,7 @@ end:
    }
    if ( has_syms )
    {
+     prof_scope ps_ft("ftrace_locs");
      // make some tests
      auto a1 = get_addr("__start_mcount_loc");
      printf("__start_mcount_loc: %p\n", (void *)a1);
@@ -3841,13 +4463,13 @@ end:
      {
        // under arm64 we need process relocs
        if ( reader.get_machine() == 183 )
-         dump_arm64_ftraces(reader, a1, a2, [](Elf_Sxword addend) 
+         dump_arm64_ftraces(reader, a1, a2, [](Elf64_Sxword addend) 
           { 
             dump_addr_name(addend);
           }
          );
        else {
-         const a64 *data = (const a64 *)find_addr(reader, a1);
+         const a64 *data = (const a64 *)reader.find_addr(a1);
          if ( data != NULL )
          {
            for ( a64 i = a1; i < a2; i += sizeof(a64) )
@@ -3865,7 +4487,7 @@ end:
                  continue;
                char *ptr = (char *)addr + delta;
                char *arg = ptr;
-               int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+               int err = read_kptr(fd, arg, &arg);
                if ( err )
                  printf("read ftrace at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
                else if ( !is_nop((unsigned char *)&arg) )
@@ -3883,38 +4505,18 @@ end:
      printf("cannot find .text\n");
      return 1;
    }
-   for ( Elf_Half i = 0; i < n; ++i ) 
+   ptr_hits data_filled;
+   for ( unsigned int i = 0; i < n; ++i ) 
    {
-     section* sec = reader.sections[i];
+     const elf_section* sec = reader.sections[i];
      if ( opt_r && sec->get_name() == ".rodata" )
      {
-       std::map<a64, a64> filled;
+       prof_scope ps_ro("rodata");
+       ptr_hits filled;
        auto off = sec->get_offset();
        printf(".rodata section offset %lX\n", off);
-       size_t count = 0;
-       a64 curr_addr;
-       // under arm64 we need count relocs in .data section       
-       if ( reader.get_machine() == 183 )
-       {
-         a64 dstart = (a64)sec->get_address();
-         count = filter_arm64_relocs(reader, dstart, dstart + sec->get_size(), (a64)text_start, (a64)(text_start + text_size), filled);
-       } else {
-         a64 *curr = (a64 *)sec->get_data();
-         a64 *end  = (a64 *)((char *)curr + sec->get_size());
-         curr_addr = sec->get_address();
-         const endianess_convertor &conv = reader.get_convertor();
-         for ( ; curr < end; curr++, curr_addr += sizeof(a64) )
-         {
-           auto addr = conv(*curr);
-           if ( addr >= (a64)text_start &&
-                addr < (a64)(text_start + text_size)
-              )
-           {
-             count++;
-             filled[curr_addr] = addr;
-           }
-         }
-       }
+       size_t count = scan_section(reader, sec, (a64)text_start, (a64)(text_start + text_size), filled);
+       filled.sort();
        printf("found in .rodata %ld\n", count);
        // dump or check collected addresses
        if ( g_opt_v || opt_c )
@@ -3923,16 +4525,16 @@ end:
      }
      if ( sec->get_name() == ".data" )
      {
-       std::map<a64, a64> filled;
+       // lives in main scope - resident "data" collector uses it in daemon mode
+       ptr_hits &filled = data_filled;
        auto off = sec->get_offset();
        printf(".data section offset %lX\n", off);
        size_t count = 0;
-       a64 curr_addr;
        // dump cgroups
-       if ( opt_g && opt_c && has_syms )
+       if ( opt_g && opt_c && !no_drv && has_syms )
        {
 #ifndef _MSC_VER
-         dump_groups(fd, delta);
+         s_collectors.run("cgroups", fd, [&](int cfd) { dump_groups(cfd, delta); });
 #endif  /* !_MSC_VER */
        }
        if ( opt_u && has_syms )
@@ -3942,14 +4544,14 @@ end:
            printf("cannot find mon_ops\n");
 #ifndef _MSC_VER
          else
-           dump_usb_mon(fd, addr, delta);
+           s_collectors.run("usb_mon", fd, [&, addr](int cfd) { dump_usb_mon(cfd, addr, delta); });
 #endif /* !_MSC_VER */
          addr = get_addr("generic_efivars");
          if ( !addr )
            printf("cannot find generic_efivars\n");
 #ifndef _MSC_VER
          else
-           dump_efivars(fd, addr, delta);
+           s_collectors.run("efivars", fd, [&, addr](int cfd) { dump_efivars(cfd, addr, delta); });
 #endif /* !_MSC_VER */
        }
        if ( opt_T && has_syms )
@@ -3958,13 +4560,14 @@ end:
          if ( off )
          {
           printf("timer_bases %p\n", (void *)off);
-          if ( opt_c )
+          if ( opt_c && !no_drv )
           {
             a64 poff = (a64)get_addr("__per_cpu_offset");
-            dump_ktimers(fd, off, poff, delta);
+            s_collectors.run("ktimers", fd, [&, off, poff](int cfd) { dump_ktimers(cfd, off, poff, delta); });
           }  
          }
-         dunp_kalarms(fd, delta);
+         if ( !no_drv )
+           s_collectors.run("kalarms", fd, [&](int cfd) { dunp_kalarms(cfd, delta); });
        }
        if ( opt_t && has_syms )
        {
@@ -3981,20 +4584,26 @@ end:
                printf(" %p: %s\n", (void *)(tsyms[i].addr), tsyms[i].name);
            }
 #else
-           if ( opt_c )
-             check_tracepoints(fd, delta, tsyms, tcount);
+           if ( opt_c && !no_drv )
+             s_collectors.run("tracepoints", fd, [&, tsyms, tcount](int cfd) { check_tracepoints(cfd, delta, tsyms, tcount); });
 #endif /* _MSC_VER */
-           free(tsyms);
+           // resident collector still needs them
+           if ( opt_D == NULL )
+             free(tsyms);
          }
-         dump_ftrace_options(fd, delta);
-         // dump bpf raw events
-         auto start = get_addr("__start__bpf_raw_tp");
-         auto end   = get_addr("__stop__bpf_raw_tp");
-         dump_bpf_raw_events(fd, start, end, delta);
-         // dump ftrace_ops
-         auto fops = get_addr("ftrace_ops_list");
-         auto m = get_addr("ftrace_lock");
-         dump_ftrace_ops(fd, fops, m, delta);
+         s_collectors.run("ftrace", fd, [&](int cfd) {
+           dump_ftrace_options(cfd, delta);
+           if ( no_drv )
+             return;
+           // dump bpf raw events
+           auto start = get_addr("__start__bpf_raw_tp");
+           auto end   = get_addr("__stop__bpf_raw_tp");
+           dump_bpf_raw_events(cfd, start, end, delta);
+           // dump ftrace_ops
+           auto fops = get_addr("ftrace_ops_list");
+           auto m = get_addr("ftrace_lock");
+           dump_ftrace_ops(cfd, fops, m, delta);
+         });
          // dump ftrace events
          auto ev_start = get_addr("__start_ftrace_events");
          auto ev_stop  = get_addr("__stop_ftrace_events");
@@ -4008,7 +4617,7 @@ end:
            std::set<a64> events;
            if ( reader.get_machine() == 183 )
            {
-             dump_arm64_ftraces(reader, ev_start, ev_stop, [&events](Elf_Sxword addend) 
+             dump_arm64_ftraces(reader, ev_start, ev_stop, [&events](Elf64_Sxword addend) 
               {
                if ( g_opt_v )
                  dump_addr_name(addend);
@@ -4016,7 +4625,7 @@ end:
               }
              );
            } else {
-             const a64 *data = (const a64 *)find_addr(reader, ev_start);
+             const a64 *data = (const a64 *)reader.find_addr(ev_start);
              if ( data != NULL )
                for ( a64 i = ev_start; i < ev_stop; i += sizeof(a64) )
                {
@@ -4028,73 +4637,85 @@ end:
            }
          }
 #ifndef _MSC_VER
-         if ( opt_c )
+         if ( opt_c && !no_drv )
          {
-           auto idr = get_addr("pmu_idr");
-           auto m = get_addr("pmus_lock");
-           dump_pmus(fd, idr, m, delta);
+           s_collectors.run("pmus", fd, [&](int cfd) {
+             auto idr = get_addr("pmu_idr");
+             auto m = get_addr("pmus_lock");
+             dump_pmus(cfd, idr, m, delta);
+           });
            // registered trace_event_calls
-           dump_registered_trace_event_calls(fd, delta);
-           // event cmds
-           auto ecl = get_addr("trigger_commands");
-           auto ecm = get_addr("trigger_cmd_mutex");
-           dump_event_cmds(fd, ecl, ecm, delta);
-           // trace exports
-           ecl = get_addr("ftrace_exports_list");
-           ecm = get_addr("ftrace_export_lock");
-           dump_trace_exports(fd, ecl, ecm, delta);
-           // ftrace cmds
-           ecl = get_addr("ftrace_commands");
-           ecm = get_addr("ftrace_cmd_mutex");
-           dump_tracefunc_cmds(fd, ecl, ecm, delta);
-           // dynamic events ops
-           ecl = get_addr("dyn_event_ops_list");
-           ecm = get_addr("dyn_event_ops_mutex");
-           dump_dynevents_ops(fd, ecl, ecm, delta);
-           // dump dynamic events
-           ecl = get_addr("dyn_event_list");
-           ecm = get_addr("event_mutex");
-           dump_dynamic_events(fd, ecl, ecm, delta);
+           s_collectors.run("trace_event_calls", fd, [&](int cfd) { dump_registered_trace_event_calls(cfd, delta); });
+           s_collectors.run("trace_cmds", fd, [&](int cfd) {
+             // event cmds
+             auto ecl = get_addr("trigger_commands");
+             auto ecm = get_addr("trigger_cmd_mutex");
+             dump_event_cmds(cfd, ecl, ecm, delta);
+             // trace exports
+             ecl = get_addr("ftrace_exports_list");
+             ecm = get_addr("ftrace_export_lock");
+             dump_trace_exports(cfd, ecl, ecm, delta);
+             // ftrace cmds
+             ecl = get_addr("ftrace_commands");
+             ecm = get_addr("ftrace_cmd_mutex");
+             dump_tracefunc_cmds(cfd, ecl, ecm, delta);
+           });
+           s_collectors.run("dynamic_events", fd, [&](int cfd) {
+             // dynamic events ops
+             auto ecl = get_addr("dyn_event_ops_list");
+             auto ecm = get_addr("dyn_event_ops_mutex");
+             dump_dynevents_ops(cfd, ecl, ecm, delta);
+             // dump dynamic events
+             ecl = get_addr("dyn_event_list");
+             ecm = get_addr("event_mutex");
+             dump_dynamic_events(cfd, ecl, ecm, delta);
+           });
          }
 #endif /* _MSC_VER */
        }
-       // under arm64 we need count relocs in .data section       
-       if ( reader.get_machine() == 183 )
+       prof_scope ps_scan("data_scan");
+       count = scan_section(reader, sec, (a64)text_start, (a64)(text_start + text_size), filled);
+       printf("found %ld\n", count);
+       // .data..ro_after_init is writable until end of boot, so collect it into the same array
+       const elf_section *ro_sec = reader.find_section(".data..ro_after_init");
+       if ( ro_sec != NULL )
        {
-         a64 dstart = (a64)sec->get_address();
-         count = filter_arm64_relocs(reader, dstart, dstart + sec->get_size(), (a64)text_start, (a64)(text_start + text_size), filled);
-       } else {
-         a64 *curr = (a64 *)sec->get_data();
-         a64 *end  = (a64 *)((char *)curr + sec->get_size());
-         curr_addr = sec->get_address();
-         const endianess_convertor &conv = reader.get_convertor();
-         for ( ; curr < end; curr++, curr_addr += sizeof(a64) )
-         {
-           auto addr = conv(*curr);
-           if ( addr >= (a64)text_start &&
-                addr < (a64)(text_start + text_size)
-              )
-           {
-             count++;
-             filled[curr_addr] = addr;
-           }
-         }
+         count = scan_section(reader, ro_sec, (a64)text_start, (a64)(text_start + text_size), filled);
+         printf("found in .data..ro_after_init %ld\n", count);
        }
-       printf("found %ld\n", count);
+       filled.sort();
+       ps_scan.end();
        // dump or check collected addresses
        if ( g_opt_v || opt_c )
-         dump_and_check(fd, opt_c, delta, has_syms, filled);
+         s_collectors.run("data", fd, [&](int cfd) { dump_and_check(cfd, opt_c, delta, has_syms, filled); });
+       // .init.data is freed after boot - only dump it, checking would read reused memory
+       const elf_section *init_sec = reader.find_section(".init.data");
+       if ( init_sec != NULL )
+       {
+         ptr_hits init_filled;
+         count = scan_section(reader, init_sec, (a64)text_start, (a64)(text_start + text_size), init_filled);
+         printf("found in .init.data %ld\n", count);
+         if ( g_opt_v )
+         {
+           init_filled.sort();
+           dump_and_check(fd, 0, delta, has_syms, init_filled);
+         }
+       }
 #ifndef _MSC_VER
-       if ( opt_c )
+       if ( opt_c && !no_drv )
        {
-         dump_freq_ntfy(fd, delta);
-         dump_clk_ntfy(fd, get_addr("clk_notifier_list"), get_addr("prepare_lock"), delta);
-         dump_devfreq_ntfy(fd, get_addr("devfreq_list"), get_addr("devfreq_list_lock"), delta);
+         s_collectors.run("notifiers", fd, [&](int cfd) {
+           dump_freq_ntfy(cfd, delta);
+           dump_clk_ntfy(cfd, get_addr("clk_notifier_list"), get_addr("prepare_lock"), delta);
+           dump_devfreq_ntfy(cfd, get_addr("devfreq_list"), get_addr("devfreq_list_lock"), delta);
+         });
        }
 #endif
        if ( opt_d )
        {
+          prof_scope ps_dis("disasm");
           dis_base *bd = NULL;
+          text_section->advise(MADV_WILLNEED);
           if ( reader.get_machine() == 183 )
           {
             arm64_disasm *ad = new arm64_disasm(text_start, text_size, text_section->get_data(), sec->get_address(), sec->get_size());
@@ -4126,7 +4747,7 @@ end:
                  {
                    printf("this_cpu_off: %lX, return_notifier_list: %lX\n", this_cpu_off, return_notifier_list);
 #ifndef _MSC_VER
-                   if ( opt_c )
+                   if ( opt_c && !no_drv )
                    {
                      install_urn(fd, 1);
                      dump_return_notifier_list(fd, this_cpu_off, return_notifier_list, delta);
@@ -4156,40 +4777,55 @@ end:
             else
               bpf_target = bd->process_bpf_target(entry, mlock);
             // dump bpf
-            if ( opt_B && opt_c && has_syms )
+            if ( opt_B && opt_c && !no_drv && has_syms )
             {
 #ifndef _MSC_VER
-               dump_jit_options(fd, delta);
-               auto tgm = get_addr("targets_mutex");
-               dump_bpf_targets(fd, bpf_target, tgm, delta);
-               // bpf maps
-               std::map<void *, std::string> names;
-               auto entry = get_addr("map_idr");
-               tgm = get_addr("map_idr_lock");
-               dump_bpf_maps(fd, entry, tgm, delta, names);
-               // bpf ksyms
-               entry = get_addr("bpf_kallsyms");
-               tgm = get_addr("bpf_lock");
-               dump_bpf_ksyms(fd, entry, tgm, delta);
-               // bpf progs
-               if ( ujit_opened() )
-               {
-                 a64 base = get_addr("__bpf_call_base");
-                 a64 enter = get_addr("__bpf_prog_enter");
-                 a64 ex = get_addr("__bpf_prog_exit");
-                 if ( base && enter && ex )
+               s_collectors.run("bpf_targets", fd, [&](int cfd) {
+                 dump_jit_options(cfd, delta);
+                 auto tgm = get_addr("targets_mutex");
+                 dump_bpf_targets(cfd, bpf_target, tgm, delta);
+               });
+               // progs need names of maps
+               s_collectors.run("bpf_progs", fd, [&](int cfd) {
+                 // bpf maps
+                 std::map<void *, std::string> names;
+                 std::map<void *, unsigned long> mems;
+                 auto entry = get_addr("map_idr");
+                 auto tgm = get_addr("map_idr_lock");
+                 dump_bpf_maps(cfd, entry, tgm, get_addr("prog_idr"), get_addr("prog_idr_lock"), delta, names, mems);
+                 // bpf ksyms
+                 entry = get_addr("bpf_kallsyms");
+                 tgm = get_addr("bpf_lock");
+                 dump_bpf_ksyms(cfd, entry, tgm, delta);
+                 // bpf progs
+                 ujit_ctx jctx;
+                 s_jcache.sync();
+                 if ( ujit_opened() )
                  {
-                   printf("__bpf_call_base %lX\n", base + delta);
-                   put_kdata(base + delta, enter + delta, ex + delta);
+                   put_verbose(jctx, g_opt_v);
+                   a64 base = get_addr("__bpf_call_base");
+                   a64 enter = get_addr("__bpf_prog_enter");
+                   a64 ex = get_addr("__bpf_prog_exit");
+                   if ( base && enter && ex )
+                   {
+                     printf("__bpf_call_base %lX\n", base + delta);
+                     put_kdata(jctx, base + delta, enter + delta, ex + delta);
+                   }
                  }
-               }
-               entry = get_addr("prog_idr");
-               tgm = get_addr("prog_idr_lock");
-               dump_bpf_progs(fd, entry, tgm, delta, names);
+                 entry = get_addr("prog_idr");
+                 tgm = get_addr("prog_idr_lock");
+                 dump_bpf_progs(cfd, entry, tgm, delta, names, mems, jctx);
+               });
                // bpf links
-               entry = get_addr("link_idr");
-               tgm = get_addr("link_idr_lock");
-               dump_bpf_links(fd, entry, tgm, delta);
+               s_collectors.run("bpf_links", fd, [&](int cfd) {
+                 auto entry = get_addr("link_idr");
+                 auto tgm = get_addr("link_idr_lock");
+                 dump_bpf_links(cfd, entry, tgm, delta);
+               });
+               // prog <-> link <-> attach point in one ioctl
+               s_collectors.run("bpf_graph", fd, [&](int cfd) {
+                 dump_bpf_graph(cfd, get_addr("link_idr"), get_addr("link_idr_lock"), get_addr("cgroup_hierarchy_idr"), get_addr("cgroup_mutex"), delta);
+               });
 #endif /* !_MSC_VER */
             }
           }
@@ -4239,8 +4875,8 @@ end:
                   }
                 }
 #ifndef _MSC_VER
-                if ( opt_c )
-                  dump_lsm(fd, delta);
+                if ( opt_c && !no_drv )
+                  s_collectors.run("lsm", fd, [&](int cfd) { dump_lsm(cfd, delta); });
 #endif /* !_MSC_VER */
               }
             }
@@ -4248,9 +4884,9 @@ end:
           // find bss if we need
           if ( opt_b )
           {
-            for ( Elf_Half j = 0; j < n; ++j )
+            for ( unsigned int j = 0; j < n; ++j )
             {
-              section* s = reader.sections[j];
+              const elf_section* s = reader.sections[j];
               if ( (s->get_type() & SHT_NOBITS) && 
                    (s->get_name() == ".bss" )
                  )
@@ -4295,18 +4931,21 @@ end:
           printf("found with disasm: %ld\n", out_res.size());
           if ( g_opt_v )
           {
-            for ( auto c: out_res )
+            std::vector<a64> addrs(out_res.begin(), out_res.end());
+            std::vector<const char *> names(addrs.size());
+            std::vector<size_t> offs(addrs.size());
+            lower_names_by_addrs(addrs.data(), addrs.size(), names.data(), offs.data());
+            for ( size_t i = 0; i < addrs.size(); i++ )
             {
-              size_t off = 0;
-              const char *name = lower_name_by_addr_with_off(c, &off);
-              if ( name != NULL )
-              {
-                if ( off )
-                  printf("# %s+%lX\n", name, off);
-                else
-                  printf("# %s\n", name);
-              }
-              printf("%p\n", (void *)c);
+              a64 c = addrs[i];
+              size_t off = offs[i];
+              const char *name = names[i];
+              if ( name == NULL )
+                g_sink->rec("dptr", "%p\n").ptr("addr", c).end();
+              else if ( off )
+                g_sink->rec("dptr", "# %s+%lX\n%p\n").str("sym", name).num("off", off).ptr("addr", c).end();
+              else
+                g_sink->rec("dptr", "# %s\n%p\n").str("sym", name).ptr("addr", c).end();
             }
           }
 #ifndef _MSC_VER
@@ -4316,7 +4955,7 @@ end:
             {
               char *ptr = (char *)c + delta;
               char *arg = ptr;
-              int err = ioctl(fd, IOCTL_READ_PTR, (int *)&arg);
+              int err = read_kptr(fd, arg, &arg);
               if ( err )
                 printf("read at %p failed, error %d (%s)\n", ptr, errno, strerror(errno));
               else if ( arg != NULL )
@@ -4324,15 +4963,15 @@ end:
                  if ( is_inside_kernel((unsigned long)arg) )
                  {
                     if ( !has_syms )
-                      printf("mem at %p: %p\n", ptr, arg);
+                      g_sink->rec("patched", "mem at %p: %p\n").ptr("addr", ptr).ptr("value", arg).str("owner", "kernel").end();
                     else
                       dump_patched(c, ptr, arg, delta);
                  } else {
                     const char *mname = find_kmod((unsigned long)arg);
                     if ( mname )
-                      printf("mem at %p: %p - patched by %s\n", ptr, arg, mname);
+                      g_sink->rec("patched", "mem at %p: %p - patched by %s\n").ptr("addr", ptr).ptr("value", arg).str("owner", mname).end();
                     else
-                      printf("mem at %p: %p - patched by UNKNOWN\n", ptr, arg);
+                      g_sink->rec("patched", "mem at %p: %p - patched by UNKNOWN\n").ptr("addr", ptr).ptr("value", arg).end();
                  }
               }
             }
@@ -4343,8 +4982,36 @@ end:
      }
    }
 #ifndef _MSC_VER
-   if ( fd )
+   {
+     prof_scope ps_out("output");
+     s_collectors.finish();
+     g_sink->flush();
+   }
+   prof_finish();
+   int res = 0;
+   if ( opt_D != NULL )
+   {
+     // returns only on failure
+     res = s_daemon.serve(opt_D, s_collectors.get_kept());
+     printf("daemon failed, error %d (%s)\n", res, strerror(res));
+   }
+   if ( opt_w != NULL )
+   {
+     int err = finish_snapshot(opt_w);
+     if ( err )
+       fprintf(stderr, "cannot write snapshot %s, error %d (%s)\n", opt_w, err, strerror(err));
+   }
+   if ( opt_a != NULL )
+   {
+     int err = write_allowlist(opt_a, get_snapshot(), build_id);
+     if ( err )
+       fprintf(stderr, "cannot write allowlist %s, error %d (%s)\n", opt_a, err, strerror(err));
+   }
+   if ( s_allow_sink != NULL )
+     fprintf(stderr, "%lu known entries suppressed by allowlist\n", s_allow_sink->dropped());
+   if ( fd != -1 )
      close(fd);
    ujit_close();
+   return res;
 #endif /* _MSC_VER */
 }
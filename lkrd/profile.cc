@@ -0,0 +1,154 @@
+#include <sys/mman.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "profile.h"
+
+uint64_t g_prof_cnt[PC_MAX];
+
+struct prof_rec
+{
+  char name[32];
+  int pid;
+  int depth;
+  uint64_t start;  // ns since prof_start
+  uint64_t wall;
+  uint64_t cpu;
+  uint64_t cnt[PC_MAX];
+  ksyms_stat ks;
+};
+
+static const size_t s_max_recs = 4096;
+
+struct prof_area
+{
+  uint64_t base;
+  uint32_t count;
+  prof_rec recs[s_max_recs];
+};
+
+static prof_area *s_prof = NULL;
+static const char *s_trace = NULL;
+static int s_depth = 0;
+
+static uint64_t get_ns(clockid_t id)
+{
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int prof_start(const char *trace_name)
+{
+  if ( s_prof != NULL )
+    return 1;
+  void *p = mmap(NULL, sizeof(prof_area), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if ( p == MAP_FAILED )
+    return 0;
+  s_prof = (prof_area *)p;
+  s_prof->base = get_ns(CLOCK_MONOTONIC);
+  s_trace = trace_name;
+  return 1;
+}
+
+prof_scope::prof_scope(const char *name)
+ : m_name(name),
+   m_on(s_prof != NULL)
+{
+  if ( !m_on )
+    return;
+  s_depth++;
+  memcpy(m_cnt, g_prof_cnt, sizeof(m_cnt));
+  get_ksyms_stat(&m_ks);
+  m_cpu = get_ns(CLOCK_PROCESS_CPUTIME_ID);
+  m_start = get_ns(CLOCK_MONOTONIC);
+}
+
+void prof_scope::end()
+{
+  if ( !m_on )
+    return;
+  m_on = 0;
+  uint64_t now = get_ns(CLOCK_MONOTONIC);
+  uint64_t cpu = get_ns(CLOCK_PROCESS_CPUTIME_ID);
+  s_depth--;
+  uint32_t idx = __atomic_fetch_add(&s_prof->count, 1, __ATOMIC_RELAXED);
+  if ( idx >= s_max_recs )
+    return;
+  prof_rec &r = s_prof->recs[idx];
+  strncpy(r.name, m_name, sizeof(r.name) - 1);
+  r.pid = getpid();
+  r.depth = s_depth;
+  r.start = m_start - s_prof->base;
+  r.wall = now - m_start;
+  r.cpu = cpu - m_cpu;
+  for ( int i = 0; i < PC_MAX; i++ )
+    r.cnt[i] = g_prof_cnt[i] - m_cnt[i];
+  ksyms_stat ks;
+  get_ksyms_stat(&ks);
+  r.ks.lookups = ks.lookups - m_ks.lookups;
+  r.ks.hits = ks.hits - m_ks.hits;
+  r.ks.name_lookups = ks.name_lookups - m_ks.name_lookups;
+}
+
+static void write_trace(const prof_rec *recs, uint32_t count)
+{
+  FILE *fp = fopen(s_trace, "w");
+  if ( fp == NULL )
+  {
+    fprintf(stderr, "cannot create %s\n", s_trace);
+    return;
+  }
+  // chrome://tracing or perfetto, complete events in microseconds
+  fprintf(fp, "{\"traceEvents\":[\n");
+  for ( uint32_t i = 0; i < count; i++ )
+  {
+    const prof_rec &r = recs[i];
+    fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+      "\"args\":{\"cpu_us\":%.3f,\"ioctls\":%lu,\"kbytes\":%lu,\"funcs\":%lu,\"insns\":%lu,"
+      "\"sym_lookups\":%lu,\"sym_hits\":%lu,\"name_lookups\":%lu}}\n",
+      i ? "," : "", r.name, r.pid, r.pid, r.start / 1e3, r.wall / 1e3, r.cpu / 1e3,
+      r.cnt[PC_IOCTL], r.cnt[PC_KBYTES], r.cnt[PC_FUNCS], r.cnt[PC_INSNS],
+      r.ks.lookups, r.ks.hits, r.ks.name_lookups);
+  }
+  fprintf(fp, "]}\n");
+  fclose(fp);
+}
+
+void prof_finish()
+{
+  if ( s_prof == NULL )
+    return;
+  uint32_t count = s_prof->count;
+  if ( count > s_max_recs )
+  {
+    fprintf(stderr, "profile: %u phases lost\n", count - (uint32_t)s_max_recs);
+    count = s_max_recs;
+  }
+  // sort by start time - children finish in any order
+  prof_rec *recs = s_prof->recs;
+  for ( uint32_t i = 1; i < count; i++ )
+  {
+    prof_rec tmp = recs[i];
+    uint32_t j = i;
+    for ( ; j && recs[j - 1].start > tmp.start; j-- )
+      recs[j] = recs[j - 1];
+    recs[j] = tmp;
+  }
+  fprintf(stderr, "%-32s %7s %10s %10s %7s %10s %6s %9s %8s %5s\n", "phase", "pid", "wall ms", "cpu ms",
+    "ioctls", "kbytes", "funcs", "insns", "lookups", "hit%");
+  for ( uint32_t i = 0; i < count; i++ )
+  {
+    const prof_rec &r = recs[i];
+    // indent is up to 16 levels, so it and name always fit
+    char name[2 * 16 + sizeof(r.name)];
+    int indent = r.depth <= 0 ? 0 : r.depth < 16 ? r.depth * 2 : 2 * 16;
+    snprintf(name, sizeof(name), "%*s%.*s", indent, "", (int)sizeof(r.name) - 1, r.name);
+    fprintf(stderr, "%-32s %7d %10.3f %10.3f %7lu %10lu %6lu %9lu %8lu %5.1f\n", name, r.pid,
+      r.wall / 1e6, r.cpu / 1e6, r.cnt[PC_IOCTL], r.cnt[PC_KBYTES], r.cnt[PC_FUNCS], r.cnt[PC_INSNS],
+      r.ks.lookups + r.ks.name_lookups, r.ks.lookups ? 100.0 * r.ks.hits / r.ks.lookups : 0.0);
+  }
+  if ( s_trace != NULL )
+    write_trace(recs, count);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include "ksyms.h"
+
+// per-phase profiling, enabled with -P
+// each phase records wall & cpu time and deltas of counters below + symbol lookups
+// records are kept in shared mapping so phases of forked collectors are reported too
+enum prof_counter
+{
+  PC_IOCTL = 0, // ioctls issued, counted in __wrap_ioctl (kdev.cc)
+  PC_KBYTES,    // bytes of buffers filled by driver
+  PC_FUNCS,     // functions disassembled
+  PC_INSNS,     // instructions decoded
+  PC_MAX
+};
+
+// per process, counted always - it's cheaper than checking if profiling is enabled
+extern uint64_t g_prof_cnt[PC_MAX];
+
+static inline void prof_add(int c, uint64_t v)
+{
+  g_prof_cnt[c] += v;
+}
+
+// must be called before any fork, trace_name can be NULL
+int prof_start(const char *trace_name);
+// print summary to stderr and write chrome trace
+void prof_finish();
+
+// RAII phase, nesting is allowed
+class prof_scope
+{
+  public:
+    prof_scope(const char *name);
+    ~prof_scope()
+    {
+      end();
+    }
+    void end();
+  protected:
+    const char *m_name;
+    int m_on;
+    uint64_t m_start;
+    uint64_t m_cpu;
+    uint64_t m_cnt[PC_MAX];
+    ksyms_stat m_ks;
+};
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include "ptr_scan.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAS_AVX2_SCAN
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HAS_NEON_SCAN
+#endif
+
+// all kernels check (v - lo) < (hi - lo) as unsigned - single compare per qword
+
+size_t scan_ptrs_scalar(const a64 *data, size_t count, a64 lo, a64 hi, int swap, unsigned int *idx)
+{
+  size_t res = 0;
+  a64 len = hi - lo;
+  if ( swap )
+  {
+    for ( size_t i = 0; i < count; i++ )
+    {
+      idx[res] = (unsigned int)i;
+      res += (__builtin_bswap64(data[i]) - lo) < len;
+    }
+  } else {
+    for ( size_t i = 0; i < count; i++ )
+    {
+      idx[res] = (unsigned int)i;
+      res += (data[i] - lo) < len;
+    }
+  }
+  return res;
+}
+
+#ifdef HAS_AVX2_SCAN
+// avx2 has only signed 64bit compare, so both sides are biased by sign bit
+__attribute__((target("avx2")))
+static size_t scan_ptrs_avx2(const a64 *data, size_t count, a64 lo, a64 hi, int swap, unsigned int *idx)
+{
+  const __m256i bias = _mm256_set1_epi64x((long long)0x8000000000000000UL);
+  const __m256i vlo  = _mm256_set1_epi64x((long long)lo);
+  const __m256i vlen = _mm256_xor_si256(_mm256_set1_epi64x((long long)(hi - lo)), bias);
+  const __m256i bswap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                         7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  size_t res = 0;
+  size_t i = 0;
+  // 8 qwords per iteration, most blocks have no hits at all
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(data + i + 4));
+    if ( swap )
+    {
+      v0 = _mm256_shuffle_epi8(v0, bswap);
+      v1 = _mm256_shuffle_epi8(v1, bswap);
+    }
+    __m256i m0 = _mm256_cmpgt_epi64(vlen, _mm256_xor_si256(_mm256_sub_epi64(v0, vlo), bias));
+    __m256i m1 = _mm256_cmpgt_epi64(vlen, _mm256_xor_si256(_mm256_sub_epi64(v1, vlo), bias));
+    unsigned int mask = _mm256_movemask_pd(_mm256_castsi256_pd(m0)) |
+                        (_mm256_movemask_pd(_mm256_castsi256_pd(m1)) << 4);
+    while ( mask )
+    {
+      idx[res++] = (unsigned int)(i + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+  if ( i < count )
+  {
+    size_t tail = scan_ptrs_scalar(data + i, count - i, lo, hi, swap, idx + res);
+    for ( size_t j = 0; j < tail; j++ )
+      idx[res + j] += (unsigned int)i;
+    res += tail;
+  }
+  return res;
+}
+#endif /* HAS_AVX2_SCAN */
+
+#ifdef HAS_NEON_SCAN
+static size_t scan_ptrs_neon(const a64 *data, size_t count, a64 lo, a64 hi, int swap, unsigned int *idx)
+{
+  const uint64x2_t vlo  = vdupq_n_u64(lo);
+  const uint64x2_t vlen = vdupq_n_u64(hi - lo);
+  size_t res = 0;
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    uint64x2_t v0 = vld1q_u64((const uint64_t *)(data + i));
+    uint64x2_t v1 = vld1q_u64((const uint64_t *)(data + i + 2));
+    if ( swap )
+    {
+      v0 = vreinterpretq_u64_u8(vrev64q_u8(vreinterpretq_u8_u64(v0)));
+      v1 = vreinterpretq_u64_u8(vrev64q_u8(vreinterpretq_u8_u64(v1)));
+    }
+    uint64x2_t m0 = vcltq_u64(vsubq_u64(v0, vlo), vlen);
+    uint64x2_t m1 = vcltq_u64(vsubq_u64(v1, vlo), vlen);
+    if ( !vmaxvq_u32(vreinterpretq_u32_u64(vorrq_u64(m0, m1))) )
+      continue;
+    if ( vgetq_lane_u64(m0, 0) )
+      idx[res++] = (unsigned int)i;
+    if ( vgetq_lane_u64(m0, 1) )
+      idx[res++] = (unsigned int)(i + 1);
+    if ( vgetq_lane_u64(m1, 0) )
+      idx[res++] = (unsigned int)(i + 2);
+    if ( vgetq_lane_u64(m1, 1) )
+      idx[res++] = (unsigned int)(i + 3);
+  }
+  if ( i < count )
+  {
+    size_t tail = scan_ptrs_scalar(data + i, count - i, lo, hi, swap, idx + res);
+    for ( size_t j = 0; j < tail; j++ )
+      idx[res + j] += (unsigned int)i;
+    res += tail;
+  }
+  return res;
+}
+#endif /* HAS_NEON_SCAN */
+
+const char *scan_ptrs_kind()
+{
+#ifdef HAS_AVX2_SCAN
+  if ( __builtin_cpu_supports("avx2") )
+    return "avx2";
+#elif defined(HAS_NEON_SCAN)
+  return "neon";
+#endif
+  return "scalar";
+}
+
+size_t scan_ptrs(const a64 *data, size_t count, a64 lo, a64 hi, int swap, unsigned int *idx)
+{
+  if ( hi <= lo )
+    return 0;
+#ifdef HAS_AVX2_SCAN
+  static int s_has_avx2 = __builtin_cpu_supports("avx2");
+  if ( s_has_avx2 )
+    return scan_ptrs_avx2(data, count, lo, hi, swap, idx);
+#elif defined(HAS_NEON_SCAN)
+  return scan_ptrs_neon(data, count, lo, hi, swap, idx);
+#endif
+  return scan_ptrs_scalar(data, count, lo, hi, swap, idx);
+}
+
+size_t ptr_hits::scan(const a64 *data, size_t count, a64 base, a64 lo, a64 hi, int swap)
+{
+  if ( m_idx.size() < count )
+    m_idx.resize(count);
+  size_t res = scan_ptrs(data, count, lo, hi, swap, m_idx.data());
+  m_hits.reserve(m_hits.size() + res);
+  for ( size_t i = 0; i < res; i++ )
+  {
+    a64 v = data[m_idx[i]];
+    add(base + m_idx[i] * sizeof(a64), swap ? __builtin_bswap64(v) : v);
+  }
+  return res;
+}
+
+void ptr_hits::sort()
+{
+  if ( m_sorted )
+    return;
+  std::stable_sort(m_hits.begin(), m_hits.end());
+  // keep last of duplicates, like std::map assignment did
+  auto out = m_hits.begin();
+  for ( auto it = m_hits.begin(); it != m_hits.end(); ++it )
+  {
+    auto next = it + 1;
+    if ( next != m_hits.end() && next->addr == it->addr )
+      continue;
+    *out++ = *it;
+  }
+  m_hits.erase(out, m_hits.end());
+  m_sorted = 1;
+}
+
+std::vector<ptr_hit>::const_iterator ptr_hits::lower(a64 addr) const
+{
+  return std::lower_bound(m_hits.begin(), m_hits.end(), ptr_hit{ addr, 0 });
+}
+
+const ptr_hit *ptr_hits::find(a64 addr) const
+{
+  auto it = lower(addr);
+  if ( it == m_hits.end() || it->addr != addr )
+    return NULL;
+  return &*it;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+#include "types.h"
+
+// scan of data sections for pointers into some range (like .text)
+// kernel compares block of qwords against [lo, hi) and stores indexes of hits into
+// caller provided array idx, which must have room for count entries
+// swap - data has foreign endianness
+// returns number of hits
+size_t scan_ptrs(const a64 *data, size_t count, a64 lo, a64 hi, int swap, unsigned int *idx);
+// portable version, exported for benchmark
+size_t scan_ptrs_scalar(const a64 *data, size_t count, a64 lo, a64 hi, int swap, unsigned int *idx);
+// name of kernel selected for this cpu
+const char *scan_ptrs_kind();
+
+struct ptr_hit
+{
+  a64 addr;  // where pointer located
+  a64 value; // pointer itself
+
+  bool operator<(const ptr_hit &other) const
+  {
+    return addr < other.addr;
+  }
+};
+
+// flat array of found pointers, sorted by address
+class ptr_hits
+{
+  public:
+    ptr_hits()
+     : m_sorted(1)
+    { }
+    inline void add(a64 addr, a64 value)
+    {
+      if ( !m_hits.empty() && addr <= m_hits.back().addr )
+        m_sorted = 0;
+      m_hits.push_back({ addr, value });
+    }
+    // scan count qwords located at address base, appends all pointers in [lo, hi)
+    // returns number of new hits
+    size_t scan(const a64 *data, size_t count, a64 base, a64 lo, a64 hi, int swap);
+    // must be called after all add before any lookup, for duplicated address last added wins
+    void sort();
+    const ptr_hit *find(a64 addr) const;
+    // first hit with address >= addr, for range queries
+    std::vector<ptr_hit>::const_iterator lower(a64 addr) const;
+    inline int has(a64 addr) const
+    {
+      return find(addr) != NULL;
+    }
+    inline size_t size() const
+    {
+      return m_hits.size();
+    }
+    inline int empty() const
+    {
+      return m_hits.empty();
+    }
+    inline void reserve(size_t n)
+    {
+      m_hits.reserve(n);
+    }
+    inline std::vector<ptr_hit>::const_iterator begin() const
+    {
+      return m_hits.begin();
+    }
+    inline std::vector<ptr_hit>::const_iterator end() const
+    {
+      return m_hits.end();
+    }
+  protected:
+    std::vector<ptr_hit> m_hits;
+    std::vector<unsigned int> m_idx; // scratch for scan_ptrs
+    int m_sorted;
+};
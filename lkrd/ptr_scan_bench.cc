@@ -0,0 +1,99 @@
+// benchmark of pointer scan over data section
+// usage: ptr_scan_bench [number of qwords] [percent of hits]
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <map>
+#include <vector>
+#include "ptr_scan.h"
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  size_t count = 4 * 1024 * 1024; // 32Mb - like .data of fat kernel
+  int pct = 3;
+  if ( argc > 1 )
+    count = atol(argv[1]);
+  if ( argc > 2 )
+    pct = atoi(argv[2]);
+  const a64 text_start = 0xffffffff81000000UL;
+  const a64 text_size  = 0x1000000;
+  const a64 base = 0xffffffff82000000UL;
+  // fixed seed for repeatable runs
+  srand(0x1234);
+  std::vector<a64> data(count), swapped(count);
+  for ( size_t i = 0; i < count; i++ )
+  {
+    int r = rand() % 100;
+    if ( r < pct )
+      data[i] = text_start + rand() % text_size;
+    else if ( r < pct * 2 )
+      data[i] = base + rand(); // pointers to data
+    else if ( r < 50 )
+      data[i] = rand() % 1000;
+    else
+      data[i] = 0;
+    swapped[i] = __builtin_bswap64(data[i]);
+  }
+  // old way - check each qword and put it to std::map
+  double t = now();
+  std::map<a64, a64> old;
+  for ( size_t i = 0; i < count; i++ )
+  {
+    a64 addr = data[i];
+    if ( addr >= text_start && addr < text_start + text_size )
+      old[base + i * sizeof(a64)] = addr;
+  }
+  printf("map: %f, hits %ld\n", now() - t, old.size());
+  // scalar kernel
+  std::vector<unsigned int> idx(count);
+  t = now();
+  size_t scnt = scan_ptrs_scalar(data.data(), count, text_start, text_start + text_size, 0, idx.data());
+  printf("scalar: %f, hits %ld\n", now() - t, scnt);
+  // selected kernel
+  std::vector<unsigned int> vidx(count);
+  t = now();
+  size_t vcnt = scan_ptrs(data.data(), count, text_start, text_start + text_size, 0, vidx.data());
+  printf("%s: %f, hits %ld\n", scan_ptrs_kind(), now() - t, vcnt);
+  // foreign endianness
+  t = now();
+  size_t wcnt = scan_ptrs(swapped.data(), count, text_start, text_start + text_size, 1, vidx.data());
+  printf("%s swapped: %f, hits %ld\n", scan_ptrs_kind(), now() - t, wcnt);
+  // whole flat array
+  ptr_hits hits;
+  t = now();
+  hits.scan(data.data(), count, base, text_start, text_start + text_size, 0);
+  hits.sort();
+  printf("ptr_hits: %f, hits %ld\n", now() - t, hits.size());
+  // check results
+  int err = 0;
+  if ( scnt != old.size() || vcnt != old.size() || wcnt != old.size() || hits.size() != old.size() )
+  {
+    printf("hits count mismatch\n");
+    err++;
+  }
+  size_t i = 0;
+  for ( auto &c: old )
+  {
+    if ( i >= scnt || i >= hits.size() )
+      break;
+    a64 addr = base + idx[i] * sizeof(a64);
+    const ptr_hit *h = hits.find(c.first);
+    if ( addr != c.first || vidx[i] != idx[i] || h == NULL || h->value != c.second )
+    {
+      printf("mismatch at %ld: %lX\n", i, c.first);
+      err++;
+      break;
+    }
+    i++;
+  }
+  if ( !err )
+    printf("results match\n");
+  return err;
+}
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "rsink.h"
+
+static text_sink s_text_sink;
+rsink *g_sink = &s_text_sink;
+
+void rsink::pass_to(rsink *to)
+{
+  to->m_type = m_type;
+  to->m_fmt = m_fmt;
+  to->m_obj = m_obj;
+  to->m_fields = m_fields;
+  to->emit();
+  to->m_fields.clear();
+}
+
+// format of text record is printf-like, each conversion consumes next field
+void text_sink::emit()
+{
+  m_buf.clear();
+  size_t fi = 0;
+  char spec[32];
+  char tmp[128];
+  for ( const char *f = m_fmt; *f; f++ )
+  {
+    if ( *f != '%' )
+    {
+      m_buf.push_back(*f);
+      continue;
+    }
+    if ( f[1] == '%' )
+    {
+      m_buf.push_back('%');
+      f++;
+      continue;
+    }
+    // collect flags & width, skip length modifiers
+    size_t si = 0;
+    spec[si++] = *f++;
+    while ( *f && strchr("-+ #0123456789.", *f) && si < sizeof(spec) - 5 )
+      spec[si++] = *f++;
+    while ( *f && strchr("hlLqjzt", *f) )
+      f++;
+    if ( !*f )
+      break;
+    char conv = *f;
+    if ( fi >= m_fields.size() )
+      continue;
+    const field &fl = m_fields[fi++];
+    switch(conv)
+    {
+      case 's':
+        spec[si++] = 's';
+        spec[si] = 0;
+        if ( si == 2 )
+          m_buf += fl.type == F_STR ? fl.s : "";
+        else {
+          snprintf(tmp, sizeof(tmp), spec, fl.type == F_STR ? fl.s : "");
+          m_buf += tmp;
+        }
+        break;
+      case 'p':
+        spec[si++] = 'p';
+        spec[si] = 0;
+        snprintf(tmp, sizeof(tmp), spec, (void *)fl.v);
+        m_buf += tmp;
+        break;
+      case 'c':
+        m_buf.push_back((char)fl.v);
+        break;
+      case 'f':
+      case 'e':
+      case 'g':
+        spec[si++] = conv;
+        spec[si] = 0;
+        snprintf(tmp, sizeof(tmp), spec, fl.type == F_DBL ? fl.d() : (double)(long long)fl.v);
+        m_buf += tmp;
+        break;
+      case 'd':
+      case 'i':
+        // all integers are printed as 64-bit
+        spec[si++] = 'l';
+        spec[si++] = 'l';
+        spec[si++] = conv;
+        spec[si] = 0;
+        snprintf(tmp, sizeof(tmp), spec, (long long)fl.v);
+        m_buf += tmp;
+        break;
+      default:
+        spec[si++] = 'l';
+        spec[si++] = 'l';
+        spec[si++] = conv;
+        spec[si] = 0;
+        snprintf(tmp, sizeof(tmp), spec, (unsigned long long)fl.v);
+        m_buf += tmp;
+    }
+  }
+  fwrite_unlocked(m_buf.data(), 1, m_buf.size(), stdout);
+}
+
+void text_sink::flush()
+{
+  fflush(stdout);
+}
+
+void buffered_sink::flush()
+{
+  const char *p = m_buf.data();
+  size_t len = m_buf.size();
+  while ( len )
+  {
+    ssize_t wr = write(m_fd, p, len);
+    if ( wr <= 0 )
+      break;
+    p += wr;
+    len -= wr;
+  }
+  m_buf.clear();
+}
+
+void json_sink::put_str(const char *s)
+{
+  m_buf.push_back('"');
+  for ( ; *s; s++ )
+  {
+    unsigned char c = (unsigned char)*s;
+    if ( c == '"' || c == '\\' )
+    {
+      m_buf.push_back('\\');
+      m_buf.push_back(c);
+    } else if ( c < 0x20 )
+    {
+      char tmp[8];
+      snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+      m_buf += tmp;
+    } else
+      m_buf.push_back(c);
+  }
+  m_buf.push_back('"');
+}
+
+void json_sink::emit()
+{
+  char tmp[32];
+  m_buf += "{\"type\":";
+  put_str(m_type);
+  if ( m_scope )
+  {
+    m_buf += ",\"scope\":";
+    put_str(m_scope);
+  }
+  for ( auto &f: m_fields )
+  {
+    m_buf.push_back(',');
+    put_str(f.key);
+    m_buf.push_back(':');
+    switch(f.type)
+    {
+      case F_STR:
+        put_str(f.s);
+        break;
+      case F_PTR:
+        snprintf(tmp, sizeof(tmp), "\"0x%lx\"", (unsigned long)f.v);
+        m_buf += tmp;
+        break;
+      case F_DBL:
+        snprintf(tmp, sizeof(tmp), "%.17g", f.d());
+        m_buf += tmp;
+        break;
+      default:
+        snprintf(tmp, sizeof(tmp), "%ld", (long)f.v);
+        m_buf += tmp;
+    }
+  }
+  m_buf += "}\n";
+  check_flush();
+}
+
+bin_sink::bin_sink(int fd)
+ : buffered_sink(fd)
+{
+  put("LKR2", 4);
+}
+
+// string with u8 length
+void bin_sink::put_sstr(const char *s)
+{
+  size_t len = strlen(s);
+  if ( len > 255 )
+    len = 255;
+  unsigned char l = (unsigned char)len;
+  put(&l, 1);
+  put(s, len);
+}
+
+void bin_sink::emit()
+{
+  size_t start = m_buf.size();
+  uint32_t size = 0;
+  put(&size, sizeof(size));
+  put_sstr(m_type);
+  put_sstr(m_scope ? m_scope : "");
+  unsigned char nf = (unsigned char)m_fields.size();
+  put(&nf, 1);
+  for ( size_t i = 0; i < nf; i++ )
+  {
+    const field &f = m_fields[i];
+    unsigned char kind = (unsigned char)f.type;
+    put(&kind, 1);
+    put_sstr(f.key);
+    if ( f.type == F_STR )
+    {
+      size_t len = strlen(f.s);
+      if ( len > 0xffff )
+        len = 0xffff;
+      uint16_t l = (uint16_t)len;
+      put(&l, sizeof(l));
+      put(f.s, len);
+    } else {
+      uint64_t v = f.v;
+      put(&v, sizeof(v));
+    }
+  }
+  size = (uint32_t)(m_buf.size() - start - sizeof(size));
+  memcpy(&m_buf[start], &size, sizeof(size));
+  check_flush();
+}
+
+static void flush_sink()
+{
+  g_sink->flush();
+}
+
+int set_sink(const char *name)
+{
+  if ( !strcmp(name, "text") )
+  {
+    g_sink = &s_text_sink;
+    return 1;
+  }
+  int json = !strcmp(name, "json");
+  if ( !json && strcmp(name, "bin") )
+    return 0;
+  // records go to original stdout, all plain text to stderr
+  fflush(stdout);
+  int fd = dup(1);
+  if ( fd == -1 )
+    return 0;
+  dup2(2, 1);
+  if ( json )
+    g_sink = new json_sink(fd);
+  else
+    g_sink = new bin_sink(fd);
+  atexit(flush_sink);
+  return 1;
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "types.h"
+
+// structured output of records
+// record has type, printf-like format for text output and list of named fields
+// text backend substitutes fields into format in order, so text is exactly the same as with printf
+// fields not consumed by format are visible only in structured backends
+// usage: g_sink->rec("kptr", " %s: %p\n").str("name", name).ptr("addr", l).end();
+// obj() starts record describing some kernel object (kprobe, bpf prog, entry of list etc), following records
+// belong to it until next obj() or scope change
+// records of type "list" (header of chain/list with field "name") are outer context for following objects
+class rsink
+{
+  public:
+    rsink()
+     : m_type(NULL),
+       m_fmt(NULL),
+       m_obj(0),
+       m_scope(NULL)
+    { }
+    virtual ~rsink() = default;
+    inline rsink &rec(const char *type, const char *fmt)
+    {
+      m_type = type;
+      m_fmt = fmt;
+      m_obj = 0;
+      m_fields.clear();
+      return *this;
+    }
+    inline rsink &obj(const char *type, const char *fmt)
+    {
+      rec(type, fmt);
+      m_obj = 1;
+      return *this;
+    }
+    // name of collector which emits records, NULL for main
+    virtual void set_scope(const char *scope)
+    {
+      m_scope = scope;
+    }
+    inline rsink &str(const char *key, const char *v)
+    {
+      m_fields.push_back({ F_STR, key, v ? v : "", 0 });
+      return *this;
+    }
+    inline rsink &ptr(const char *key, a64 v)
+    {
+      m_fields.push_back({ F_PTR, key, NULL, v });
+      return *this;
+    }
+    inline rsink &ptr(const char *key, const void *v)
+    {
+      return ptr(key, (a64)v);
+    }
+    inline rsink &num(const char *key, long v)
+    {
+      m_fields.push_back({ F_NUM, key, NULL, (a64)v });
+      return *this;
+    }
+    // for %f/%g/%e
+    inline rsink &dbl(const char *key, double v)
+    {
+      a64 bits;
+      memcpy(&bits, &v, sizeof(bits));
+      m_fields.push_back({ F_DBL, key, NULL, bits });
+      return *this;
+    }
+    inline void end()
+    {
+      emit();
+      m_fields.clear();
+    }
+    virtual void flush() = 0;
+    // fd where records are written, -1 for stdout
+    virtual int get_fd() const
+    {
+      return -1;
+    }
+  protected:
+    enum { F_STR = 1, F_PTR, F_NUM, F_DBL };
+    struct field
+    {
+      int type;
+      const char *key;
+      const char *s;
+      a64 v;      // bits of double for F_DBL
+      inline double d() const
+      {
+        double res;
+        memcpy(&res, &v, sizeof(res));
+        return res;
+      }
+    };
+    virtual void emit() = 0;
+    // emit current record in other sink
+    void pass_to(rsink *);
+
+    const char *m_type;
+    const char *m_fmt;
+    int m_obj;
+    const char *m_scope;
+    std::vector<field> m_fields;
+};
+
+// human readable text, goes to stdout in order with plain printf
+class text_sink: public rsink
+{
+  public:
+    virtual void flush();
+  protected:
+    virtual void emit();
+    std::string m_buf;
+};
+
+// base for structured backends - own buffer, written to fd with write(2)
+class buffered_sink: public rsink
+{
+  public:
+    buffered_sink(int fd)
+     : m_fd(fd)
+    {
+      m_buf.reserve(buf_size);
+    }
+    virtual ~buffered_sink()
+    {
+      flush();
+    }
+    virtual void flush();
+    virtual int get_fd() const
+    {
+      return m_fd;
+    }
+  protected:
+    static const size_t buf_size = 64 * 1024;
+    inline void put(const void *data, size_t len)
+    {
+      m_buf.append((const char *)data, len);
+    }
+    inline void check_flush()
+    {
+      if ( m_buf.size() >= buf_size )
+        flush();
+    }
+    int m_fd;
+    std::string m_buf;
+};
+
+// one json object per line: {"type":"kptr","scope":"bpf_progs","name":"...","addr":"0xffffffff81000000"}
+// scope is name of collector and is absent for main process
+// pointers are hex strings bcs they don't fit in json double
+class json_sink: public buffered_sink
+{
+  public:
+    json_sink(int fd)
+     : buffered_sink(fd)
+    { }
+  protected:
+    virtual void emit();
+    void put_str(const char *);
+};
+
+// binary stream: magic "LKR2", then records
+//  u32 size of record body
+//  u8 type length, type
+//  u8 scope length, scope (empty for main process)
+//  u8 number of fields
+//  for each field: u8 kind (1 - string, 2 - pointer, 3 - number, 4 - double), u8 key length, key
+//    string: u16 length, bytes
+//    pointer, number & double: u64 in host byte order
+class bin_sink: public buffered_sink
+{
+  public:
+    bin_sink(int fd);
+  protected:
+    virtual void emit();
+    void put_sstr(const char *);
+};
+
+extern rsink *g_sink;
+// select backend by name: text, json or bin. returns 0 if name is unknown
+// for structured backends plain printf output is moved to stderr
+int set_sink(const char *name);
@@ -0,0 +1,115 @@
+// compare two snapshots written by lkmem -w
+// output: + key value - new item, - key value - removed, ~ key: old -> new - handler changed
+// exit code like diff: 0 - same, 1 - there are differences, 2 - error
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "snapshot.h"
+
+static void print_key(const char *key)
+{
+  for ( ; *key; key++ )
+    putchar(*key == '\t' ? ' ' : *key);
+}
+
+static void print_item(char c, const char *key, const char *value)
+{
+  putchar(c);
+  putchar(' ');
+  print_key(key);
+  if ( *value )
+    printf(" %s", value);
+  putchar('\n');
+}
+
+int main(int argc, char **argv)
+{
+  if ( argc != 3 )
+  {
+    printf("Usage: %s old.snap new.snap\n", argv[0]);
+    return 2;
+  }
+  snapshot o, n;
+  int err = o.load(argv[1]);
+  if ( err )
+  {
+    printf("cannot load %s, error %d (%s)\n", argv[1], err, strerror(err));
+    return 2;
+  }
+  err = n.load(argv[2]);
+  if ( err )
+  {
+    printf("cannot load %s, error %d (%s)\n", argv[2], err, strerror(err));
+    return 2;
+  }
+  // both are sorted by (key, value) - single merge pass
+  uint32_t i = 0, j = 0;
+  size_t diffs = 0;
+  std::vector<const char *> ov, nv;
+  while ( i < o.size() || j < n.size() )
+  {
+    int cmp;
+    if ( i >= o.size() )
+      cmp = 1;
+    else if ( j >= n.size() )
+      cmp = -1;
+    else
+      cmp = strcmp(o.key(i), n.key(j));
+    if ( cmp < 0 )
+    {
+      print_item('-', o.key(i), o.value(i));
+      diffs++;
+      i++;
+      continue;
+    }
+    if ( cmp > 0 )
+    {
+      print_item('+', n.key(j), n.value(j));
+      diffs++;
+      j++;
+      continue;
+    }
+    // same key - values are sorted too, drop common ones
+    const char *key = o.key(i);
+    uint32_t i2 = i, j2 = j;
+    while ( i2 < o.size() && !strcmp(o.key(i2), key) )
+      i2++;
+    while ( j2 < n.size() && !strcmp(n.key(j2), key) )
+      j2++;
+    ov.clear();
+    nv.clear();
+    while ( i < i2 || j < j2 )
+    {
+      int vc;
+      if ( i >= i2 )
+        vc = 1;
+      else if ( j >= j2 )
+        vc = -1;
+      else
+        vc = strcmp(o.value(i), n.value(j));
+      if ( !vc )
+      {
+        i++;
+        j++;
+      } else if ( vc < 0 )
+        ov.push_back(o.value(i++));
+      else
+        nv.push_back(n.value(j++));
+    }
+    if ( ov.size() == 1 && nv.size() == 1 )
+    {
+      putchar('~');
+      putchar(' ');
+      print_key(key);
+      printf(": %s -> %s\n", ov[0], nv[0]);
+      diffs++;
+      continue;
+    }
+    for ( auto v: ov )
+      print_item('-', key, v);
+    for ( auto v: nv )
+      print_item('+', key, v);
+    diffs += ov.size() + nv.size();
+  }
+  return diffs ? 1 : 0;
+}
@@ -0,0 +1,358 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "snapshot.h"
+
+// which fields of record are stable key and which are handler
+struct snap_rule
+{
+  const char *type;
+  const char *keys[3];
+  const char *values[3];
+  int by_content; // records without key fields are keyed by values inside their context
+};
+
+static const snap_rule s_rules[] = {
+  { "list",       { "name", "cpu", NULL },  { NULL, NULL, NULL },      0 },
+  { "entry",      { "name", "idx", NULL },  { NULL, NULL, NULL },      0 },
+  { "kptr",       { "name", NULL, NULL },   { "sym", "owner", NULL },  1 },
+  { "dptr",       { "sym", "off", NULL },   { "to", NULL, NULL },      0 },
+  { "patched",    { "sym", "off", NULL },   { "to", "owner", NULL },   0 },
+  { "addr",       { "sym", NULL, NULL },    { NULL, NULL, NULL },      0 },
+  { "tracepoint", { "name", NULL, NULL },   { NULL, NULL, NULL },      0 },
+  { "tp_func",    { "tp", NULL, NULL },     { "sym", "owner", NULL },  0 },
+  { "kprobe",     { "at", "kind", NULL },   { NULL, NULL, NULL },      0 },
+  { "uprobe",     { "name", "at", NULL },   { NULL, NULL, NULL },      0 },
+  { "bpf_prog",   { "ptype", "tag", NULL }, { NULL, NULL, NULL },      0 },
+  { "bpf_map",    { "name", NULL, NULL },   { NULL, NULL, NULL },      0 },
+  { "bpf_link",   { "ltype", NULL, NULL },  { NULL, NULL, NULL },      0 },
+};
+
+static const snap_rule *find_rule(const char *type)
+{
+  for ( auto &r: s_rules )
+    if ( !strcmp(r.type, type) )
+      return &r;
+  return NULL;
+}
+
+static int in_list(const char * const *list, const char *key)
+{
+  for ( int i = 0; i < 3 && list[i]; i++ )
+    if ( !strcmp(list[i], key) )
+      return 1;
+  return 0;
+}
+
+// separators of temp file and key parts must not appear inside values
+static void append_clean(std::string &out, const char *s)
+{
+  // skip leading spaces - names like "  ops" are indented for text output
+  while ( *s == ' ' )
+    s++;
+  for ( ; *s; s++ )
+  {
+    char c = *s;
+    if ( c == '\n' || c == '\t' || c == '\x1f' )
+      c = ' ';
+    out.push_back(c);
+  }
+}
+
+void canon_sink::set_scope(const char *scope)
+{
+  rsink::set_scope(scope);
+  m_next->set_scope(scope);
+  m_list.clear();
+  m_ctx.clear();
+  m_seen.clear();
+}
+
+void canon_sink::add_field(std::string &out, const field &f)
+{
+  if ( f.type == F_STR )
+    append_clean(out, f.s);
+  else {
+    char tmp[32];
+    snprintf(tmp, sizeof(tmp), "%lX", (unsigned long)f.v);
+    out += tmp;
+  }
+}
+
+int canon_sink::canon(std::string &key, std::string &val)
+{
+  const snap_rule *r = find_rule(m_type);
+  // key fields
+  std::string kf;
+  for ( auto &f: m_fields )
+  {
+    if ( r != NULL ? !in_list(r->keys, f.key) : (f.type != F_STR) )
+      continue;
+    if ( !kf.empty() )
+      kf.push_back(';');
+    kf += f.key;
+    kf.push_back('=');
+    add_field(kf, f);
+  }
+  // header of list/chain is outer context for following objects, not item itself
+  if ( !strcmp(m_type, "list") )
+  {
+    m_list = kf;
+    m_ctx.clear();
+    m_seen.clear();
+    return 0;
+  }
+  if ( kf.empty() )
+  {
+    // like handlers in notifier chains or lsm hooks - have no name, so identified by handler itself
+    if ( m_obj || r == NULL || !r->by_content )
+      return 0;
+    for ( auto &f: m_fields )
+    {
+      if ( !in_list(r->values, f.key) )
+        continue;
+      if ( !kf.empty() )
+        kf.push_back(';');
+      kf += f.key;
+      kf.push_back('=');
+      add_field(kf, f);
+    }
+    if ( kf.empty() )
+      kf = "?";
+    unsigned int n = m_seen[kf]++;
+    if ( n )
+    {
+      char tmp[32];
+      snprintf(tmp, sizeof(tmp), "#%u", n);
+      kf += tmp;
+    }
+  }
+  val.clear();
+  if ( r != NULL )
+  {
+    for ( auto &f: m_fields )
+    {
+      if ( !in_list(r->values, f.key) )
+        continue;
+      if ( !val.empty() )
+        val.push_back('!');
+      add_field(val, f);
+    }
+    if ( val.empty() && r->values[0] )
+      val = "?";
+  }
+  if ( m_obj )
+  {
+    m_ctx = std::string(m_type) + ":" + kf;
+    m_seen.clear();
+  }
+  key.clear();
+  if ( m_scope )
+    key += m_scope;
+  key.push_back('\t');
+  key += m_list;
+  if ( !m_obj && !m_ctx.empty() )
+  {
+    if ( !m_list.empty() )
+      key.push_back('>');
+    key += m_ctx;
+  }
+  key.push_back('\t');
+  key += m_type;
+  key.push_back('\t');
+  key += kf;
+  return 1;
+}
+
+snap_sink::~snap_sink()
+{
+  if ( m_fd != -1 )
+    close(m_fd);
+}
+
+void snap_sink::emit()
+{
+  pass_to(m_next);
+  std::string key, val;
+  if ( !canon(key, val) )
+    return;
+  m_buf += key;
+  m_buf.push_back('\x1f');
+  m_buf += val;
+  m_buf.push_back('\n');
+  if ( m_buf.size() >= 64 * 1024 )
+    flush();
+}
+
+// memfd is shared with forked collectors and position is shared too, whole lines are written with single write
+void snap_sink::flush()
+{
+  const char *p = m_buf.data();
+  size_t len = m_buf.size();
+  while ( len )
+  {
+    ssize_t wr = ::write(m_fd, p, len);
+    if ( wr <= 0 )
+      break;
+    p += wr;
+    len -= wr;
+  }
+  m_buf.clear();
+  m_next->flush();
+}
+
+int snap_sink::read_all(std::string &all)
+{
+  flush();
+  struct stat st;
+  if ( fstat(m_fd, &st) )
+    return errno;
+  all.resize(st.st_size);
+  if ( pread(m_fd, &all[0], st.st_size, 0) != st.st_size )
+    return EIO;
+  return 0;
+}
+
+struct snap_item
+{
+  uint32_t key;
+  uint32_t value;
+};
+
+int snap_sink::write(const char *fname)
+{
+  // build string pool, equal strings stored once
+  std::string pool;
+  std::unordered_map<std::string, uint32_t> interned;
+  auto intern = [&](const char *s, size_t len) -> uint32_t {
+    std::string tmp(s, len);
+    auto it = interned.find(tmp);
+    if ( it != interned.end() )
+      return it->second;
+    uint32_t off = (uint32_t)pool.size();
+    pool.append(tmp);
+    pool.push_back(0);
+    interned[tmp] = off;
+    return off;
+  };
+  std::vector<snap_item> items;
+  int err = each_item([&](const char *k, size_t klen, const char *v, size_t vlen) {
+    items.push_back({ intern(k, klen), intern(v, vlen) });
+  });
+  if ( err )
+    return err;
+  const char *sp = pool.data();
+  std::sort(items.begin(), items.end(), [sp](const snap_item &a, const snap_item &b) -> bool {
+    int res = strcmp(sp + a.key, sp + b.key);
+    if ( res )
+      return res < 0;
+    return strcmp(sp + a.value, sp + b.value) < 0;
+  });
+  // columns
+  snap_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SNAP_MAGIC, 4);
+  hdr.version = SNAP_VERSION;
+  hdr.count = (uint32_t)items.size();
+  hdr.keys = sizeof(hdr);
+  hdr.values = hdr.keys + items.size() * sizeof(uint32_t);
+  hdr.strings = hdr.values + items.size() * sizeof(uint32_t);
+  hdr.strings_size = pool.size();
+  std::vector<uint32_t> col(items.size());
+  FILE *fp = fopen(fname, "wb");
+  if ( fp == NULL )
+    return errno;
+  fwrite(&hdr, sizeof(hdr), 1, fp);
+  for ( size_t i = 0; i < items.size(); i++ )
+    col[i] = items[i].key;
+  fwrite(col.data(), sizeof(uint32_t), col.size(), fp);
+  for ( size_t i = 0; i < items.size(); i++ )
+    col[i] = items[i].value;
+  fwrite(col.data(), sizeof(uint32_t), col.size(), fp);
+  fwrite(pool.data(), 1, pool.size(), fp);
+  err = ferror(fp) ? EIO : 0;
+  if ( fclose(fp) )
+    err = errno;
+  return err;
+}
+
+snapshot::~snapshot()
+{
+  if ( m_base != NULL )
+    munmap((void *)m_base, m_size);
+}
+
+int snapshot::load(const char *fname)
+{
+  int fd = open(fname, O_RDONLY);
+  if ( fd == -1 )
+    return errno;
+  struct stat st;
+  if ( fstat(fd, &st) )
+  {
+    int err = errno;
+    close(fd);
+    return err;
+  }
+  m_size = st.st_size;
+  if ( m_size < sizeof(snap_header) )
+  {
+    close(fd);
+    return EINVAL;
+  }
+  void *base = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if ( base == MAP_FAILED )
+    return errno;
+  m_base = (const char *)base;
+  const snap_header *hdr = (const snap_header *)m_base;
+  if ( memcmp(hdr->magic, SNAP_MAGIC, 4) || hdr->version != SNAP_VERSION )
+    return EINVAL;
+  uint64_t csize = (uint64_t)hdr->count * sizeof(uint32_t);
+  if ( hdr->keys + csize > m_size || hdr->values + csize > m_size ||
+       hdr->strings + hdr->strings_size > m_size )
+    return EINVAL;
+  m_keys = (const uint32_t *)(m_base + hdr->keys);
+  m_values = (const uint32_t *)(m_base + hdr->values);
+  m_strings = m_base + hdr->strings;
+  // pool must be terminated and offsets inside it
+  if ( hdr->count && (!hdr->strings_size || m_strings[hdr->strings_size - 1]) )
+    return EINVAL;
+  for ( uint32_t i = 0; i < hdr->count; i++ )
+    if ( m_keys[i] >= hdr->strings_size || m_values[i] >= hdr->strings_size )
+      return EINVAL;
+  m_hdr = hdr;
+  return 0;
+}
+
+static snap_sink *s_snap = NULL;
+
+int start_snapshot()
+{
+  if ( s_snap != NULL )
+    return 0;
+  int fd = memfd_create("lksnap", 0);
+  if ( fd == -1 )
+    return errno;
+  s_snap = new snap_sink(g_sink, fd);
+  g_sink = s_snap;
+  return 0;
+}
+
+snap_sink *get_snapshot()
+{
+  return s_snap;
+}
+
+int finish_snapshot(const char *fname)
+{
+  if ( s_snap == NULL )
+    return 0;
+  return s_snap->write(fname);
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include "rsink.h"
+
+// snapshot of enumerated kernel objects for comparing hosts against baseline
+// each record from g_sink becomes item (key, value):
+//  key   - scope (collector) \t context (list header > last object record) \t type \t stable fields of record
+//          records without own stable fields (unnamed kptrs) are keyed by their handler fields,
+//          so inserting or removing one hook doesn't shift keys of others. repeated handler in the
+//          same context gets #N suffix
+//  value - handler fields (symbol/owner), addresses are never stored bcs they differ from host to host
+// file is columnar: header, then sorted arrays of offsets to keys and values in string pool
+// so it can be mmapped and compared without any parsing
+
+#define SNAP_MAGIC   "LKSN"
+#define SNAP_VERSION 3
+
+struct snap_header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t count;     // number of items
+  uint32_t reserved;
+  uint64_t keys;      // file offset of uint32_t[count] - offsets of keys in string pool
+  uint64_t values;    // file offset of uint32_t[count] - offsets of values in string pool
+  uint64_t strings;   // file offset of string pool
+  uint64_t strings_size;
+};
+
+// base for sinks wrapping current one: reduces records to canonical (key, value)
+class canon_sink: public rsink
+{
+  public:
+    canon_sink(rsink *next)
+     : m_next(next)
+    { }
+    virtual void flush()
+    {
+      m_next->flush();
+    }
+    virtual int get_fd() const
+    {
+      return m_next->get_fd();
+    }
+    virtual void set_scope(const char *scope);
+  protected:
+    // returns 0 if record has no stable fields and cannot be matched between hosts
+    int canon(std::string &key, std::string &val);
+    void add_field(std::string &, const field &);
+
+    rsink *m_next;
+    std::string m_list; // last list record
+    std::string m_ctx;  // last object record
+    std::unordered_map<std::string, unsigned int> m_seen; // handlers of unnamed records in context
+};
+
+// records are passed to next sink and also collected to snapshot
+// items are appended to memfd shared with forked collectors, so they survive collector_pool
+class snap_sink: public canon_sink
+{
+  public:
+    snap_sink(rsink *next, int tmp_fd)
+     : canon_sink(next),
+       m_fd(tmp_fd)
+    { }
+    virtual ~snap_sink();
+    virtual void flush();
+    // sort collected items and write snapshot file
+    int write(const char *fname);
+    // call f(key, key_len, value, value_len) for each collected item
+    template <typename F>
+    int each_item(F f)
+    {
+      std::string all;
+      int err = read_all(all);
+      if ( err )
+        return err;
+      const char *s = all.data();
+      const char *end = s + all.size();
+      while ( s < end )
+      {
+        const char *eol = (const char *)memchr(s, '\n', end - s);
+        if ( eol == NULL )
+          break;
+        const char *sep = (const char *)memchr(s, '\x1f', eol - s);
+        if ( sep != NULL )
+          f(s, sep - s, sep + 1, eol - sep - 1);
+        s = eol + 1;
+      }
+      return 0;
+    }
+  protected:
+    virtual void emit();
+    int read_all(std::string &);
+
+    int m_fd;
+    std::string m_buf;
+};
+
+// read-only mmapped snapshot
+class snapshot
+{
+  public:
+    snapshot()
+     : m_base(NULL),
+       m_size(0),
+       m_hdr(NULL)
+    { }
+    ~snapshot();
+    // returns 0 on success, errno or EINVAL if file is not valid snapshot
+    int load(const char *fname);
+    inline uint32_t size() const
+    {
+      return m_hdr ? m_hdr->count : 0;
+    }
+    inline const char *key(uint32_t idx) const
+    {
+      return m_strings + m_keys[idx];
+    }
+    inline const char *value(uint32_t idx) const
+    {
+      return m_strings + m_values[idx];
+    }
+  protected:
+    const char *m_base;
+    size_t m_size;
+    const snap_header *m_hdr;
+    const uint32_t *m_keys;
+    const uint32_t *m_values;
+    const char *m_strings;
+};
+
+// wrap g_sink with snapshot collector
+int start_snapshot();
+// collector started with start_snapshot or NULL
+snap_sink *get_snapshot();
+// write snapshot if it was started
+int finish_snapshot(const char *fname);
@@ -0,0 +1,243 @@
+// checks of canonical keys for snapshot and allowlist
+#include <sys/mman.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "allowlist.h"
+
+class null_sink: public rsink
+{
+  public:
+    virtual void flush()
+    { }
+  protected:
+    virtual void emit()
+    { }
+};
+
+struct item
+{
+  std::string key;
+  std::string val;
+};
+
+static int s_failed = 0;
+
+#define CHECK(c) do { if ( !(c) ) { printf("%s:%d: %s failed\n", __FILE__, __LINE__, #c); s_failed++; } } while(0)
+
+static std::vector<item> items(snap_sink *snap)
+{
+  std::vector<item> res;
+  snap->each_item([&](const char *k, size_t klen, const char *v, size_t vlen) {
+    res.push_back({ std::string(k, klen), std::string(v, vlen) });
+  });
+  return res;
+}
+
+// like dump_lsm: list header and unnamed kptrs
+static void lsm_chain(rsink *s, const char *mod)
+{
+  s->rec("list", "%s: %ld\n").str("name", "file_open").num("cnt", 2).end();
+  s->rec("kptr", " %p - kernel!%s\n").ptr("addr", 0xffffffff81000000UL).str("sym", "selinux_file_open").str("owner", "kernel").end();
+  s->rec("kptr", " %p - %s\n").ptr("addr", 0xffffffffc0001000UL).str("owner", mod).end();
+}
+
+static void test_unnamed_kptr(null_sink *ns)
+{
+  snap_sink snap(ns, memfd_create("snaptest", 0));
+  snap.set_scope("lsm");
+  lsm_chain(&snap, "evil");
+  // entry of list: unnamed kptr of entry and named fields
+  snap.rec("list", "\n%s at %p: %ld\n").str("name", "ftrace_ops_list").ptr("addr", 0x1000UL).num("cnt", 1).end();
+  snap.obj("entry", " [%ld] flags %lX at").num("idx", 0).num("flags", 0x20).end();
+  snap.rec("kptr", " %p - kernel!%s\n").ptr("addr", 0xffffffff82000000UL).str("sym", "global_ops").str("owner", "kernel").end();
+  snap.rec("kptr", " %s: %p - kernel!%s\n").str("name", "  func").ptr("addr", 0xffffffff81100000UL).str("sym", "ftrace_stub").str("owner", "kernel").end();
+  auto res = items(&snap);
+  CHECK(res.size() == 5);
+  if ( res.size() != 5 )
+    return;
+  CHECK(res[0].key == "lsm\tname=file_open\tkptr\tsym=selinux_file_open;owner=kernel");
+  CHECK(res[0].val == "selinux_file_open!kernel");
+  CHECK(res[1].key == "lsm\tname=file_open\tkptr\towner=evil");
+  CHECK(res[1].val == "evil");
+  CHECK(res[2].key == "lsm\tname=ftrace_ops_list\tentry\tidx=0");
+  CHECK(res[3].key == "lsm\tname=ftrace_ops_list>entry:idx=0\tkptr\tsym=global_ops;owner=kernel");
+  CHECK(res[3].val == "global_ops!kernel");
+  CHECK(res[4].key == "lsm\tname=ftrace_ops_list>entry:idx=0\tkptr\tname=func");
+}
+
+// inserted hook must not change keys of others, repeated handler is numbered
+static void test_inserted_hook(null_sink *ns)
+{
+  snap_sink a(ns, memfd_create("snaptest", 0));
+  snap_sink b(ns, memfd_create("snaptest", 0));
+  a.set_scope("lsm");
+  b.set_scope("lsm");
+  lsm_chain(&a, "apparmor");
+  b.rec("list", "%s: %ld\n").str("name", "file_open").num("cnt", 4).end();
+  b.rec("kptr", " %p - %s\n").ptr("addr", 0xffffffffc0002000UL).str("owner", "rootkit").end();
+  b.rec("kptr", " %p - kernel!%s\n").ptr("addr", 0xffffffff81000000UL).str("sym", "selinux_file_open").str("owner", "kernel").end();
+  b.rec("kptr", " %p - %s\n").ptr("addr", 0xffffffffc0001000UL).str("owner", "apparmor").end();
+  b.rec("kptr", " %p - %s\n").ptr("addr", 0xffffffffc0001000UL).str("owner", "apparmor").end();
+  auto ra = items(&a);
+  auto rb = items(&b);
+  CHECK(ra.size() == 2 && rb.size() == 4);
+  if ( ra.size() != 2 || rb.size() != 4 )
+    return;
+  CHECK(ra[0].key == rb[1].key);
+  CHECK(ra[1].key == rb[2].key);
+  CHECK(rb[0].key == "lsm\tname=file_open\tkptr\towner=rootkit");
+  CHECK(rb[3].key == "lsm\tname=file_open\tkptr\towner=apparmor#1");
+  // counters start again after scope change
+  a.set_scope("other");
+  a.rec("kptr", " %p - kernel\n").ptr("addr", 0xffffffff81000000UL).str("owner", "kernel").end();
+  a.rec("kptr", " %p UNKNOWN\n").ptr("addr", 0xffffffff81000000UL).end();
+  ra = items(&a);
+  CHECK(ra.size() == 4 && ra[2].key == "other\t\tkptr\towner=kernel" && ra[3].key == "other\t\tkptr\t?");
+}
+
+// hijacked named handler has the same key and other value
+static void test_changed_handler(null_sink *ns)
+{
+  snap_sink a(ns, memfd_create("snaptest", 0));
+  snap_sink b(ns, memfd_create("snaptest", 0));
+  a.set_scope("ops");
+  b.set_scope("ops");
+  a.rec("kptr", " %s: %p - kernel!%s\n").str("name", "open").ptr("addr", 0xffffffff81000000UL).str("sym", "ext4_open").str("owner", "kernel").end();
+  b.rec("kptr", " %s: %p - %s\n").str("name", "open").ptr("addr", 0xffffffffc0001000UL).str("owner", "rootkit").end();
+  auto ra = items(&a);
+  auto rb = items(&b);
+  CHECK(ra.size() == 1 && rb.size() == 1);
+  if ( ra.size() != 1 || rb.size() != 1 )
+    return;
+  CHECK(ra[0].key == rb[0].key);
+  CHECK(ra[0].val != rb[0].val);
+}
+
+// written snapshot can be loaded back
+static void test_write(null_sink *ns)
+{
+  snap_sink snap(ns, memfd_create("snaptest", 0));
+  snap.set_scope("lsm");
+  lsm_chain(&snap, "evil");
+  char fname[] = "/tmp/snaptestXXXXXX";
+  int fd = mkstemp(fname);
+  CHECK(fd != -1);
+  if ( fd == -1 )
+    return;
+  close(fd);
+  CHECK(!snap.write(fname));
+  snapshot sn;
+  CHECK(!sn.load(fname));
+  CHECK(sn.size() == 2);
+  unlink(fname);
+}
+
+// sink which remembers passed records
+class count_sink: public null_sink
+{
+  public:
+    count_sink()
+     : m_cnt(0)
+    { }
+    int m_cnt;
+  protected:
+    virtual void emit()
+    {
+      m_cnt++;
+    }
+};
+
+// allowlist made from known-good host drops its unnamed hook entries and passes hijacked one
+static void test_allow_unnamed(null_sink *ns)
+{
+  snap_sink snap(ns, memfd_create("snaptest", 0));
+  snap.set_scope("lsm");
+  lsm_chain(&snap, "apparmor");
+  char fname[] = "/tmp/allowtestXXXXXX";
+  int fd = mkstemp(fname);
+  CHECK(fd != -1);
+  if ( fd == -1 )
+    return;
+  close(fd);
+  CHECK(!write_allowlist(fname, &snap, "build1"));
+  allowlist al;
+  CHECK(!al.load(fname));
+  CHECK(al.size() == 2);
+  count_sink cs;
+  {
+    allow_sink as(&cs, al, "build1");
+    as.set_scope("lsm");
+    lsm_chain(&as, "apparmor");
+    // list header is always passed, both hooks are dropped
+    CHECK(cs.m_cnt == 1);
+    CHECK(as.dropped() == 2);
+    lsm_chain(&as, "rootkit");
+    CHECK(cs.m_cnt == 3);
+    CHECK(as.dropped() == 3);
+  }
+  // other kernel build
+  {
+    allow_sink as(&cs, al, "build2");
+    as.set_scope("lsm");
+    lsm_chain(&as, "apparmor");
+    CHECK(as.dropped() == 0);
+  }
+  unlink(fname);
+}
+
+// allowlist doesn't depend on order of list entries and hooks
+static void test_allow_reordered(null_sink *ns)
+{
+  snap_sink snap(ns, memfd_create("snaptest", 0));
+  snap.set_scope("ftrace");
+  snap.rec("list", "%s: %ld\n").str("name", "ftrace_ops_list").num("cnt", 2).end();
+  snap.obj("entry", " [%ld] at").num("idx", 0).end();
+  snap.rec("kptr", " %s: %p - kernel!%s\n").str("name", "func").ptr("addr", 0xffffffff81100000UL).str("sym", "ftrace_stub").str("owner", "kernel").end();
+  snap.obj("entry", " [%ld] at").num("idx", 1).end();
+  snap.rec("kptr", " %s: %p - %s\n").str("name", "func").ptr("addr", 0xffffffffc0001000UL).str("owner", "kprobes").end();
+  char fname[] = "/tmp/allowtestXXXXXX";
+  int fd = mkstemp(fname);
+  CHECK(fd != -1);
+  if ( fd == -1 )
+    return;
+  close(fd);
+  CHECK(!write_allowlist(fname, &snap, "build1"));
+  allowlist al;
+  CHECK(!al.load(fname));
+  count_sink cs;
+  {
+    allow_sink as(&cs, al, "build1");
+    as.set_scope("ftrace");
+    as.rec("list", "%s: %ld\n").str("name", "ftrace_ops_list").num("cnt", 3).end();
+    as.obj("entry", " [%ld] at").num("idx", 0).end();
+    as.rec("kptr", " %s: %p - %s\n").str("name", "func").ptr("addr", 0xffffffffc0001000UL).str("owner", "kprobes").end();
+    as.obj("entry", " [%ld] at").num("idx", 1).end();
+    as.rec("kptr", " %s: %p - %s\n").str("name", "func").ptr("addr", 0xffffffffc0002000UL).str("owner", "rootkit").end();
+    as.obj("entry", " [%ld] at").num("idx", 2).end();
+    as.rec("kptr", " %s: %p - kernel!%s\n").str("name", "func").ptr("addr", 0xffffffff81100000UL).str("sym", "ftrace_stub").str("owner", "kernel").end();
+    // list header and only rootkit handler pass, entries and known handlers are dropped
+    CHECK(as.dropped() == 5);
+    CHECK(cs.m_cnt == 2);
+  }
+  unlink(fname);
+}
+
+int main()
+{
+  null_sink ns;
+  test_unnamed_kptr(&ns);
+  test_inserted_hook(&ns);
+  test_changed_handler(&ns);
+  test_write(&ns);
+  test_allow_unnamed(&ns);
+  test_allow_reordered(&ns);
+  if ( s_failed )
+  {
+    printf("%d checks failed\n", s_failed);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
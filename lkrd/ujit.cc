@@ -6,74 +6,135 @@
 #include "../bpfdump/jit/bpf.h"
 #include "ujit.h"
 
-typedef struct bpf_prog *(*jit_compile)(struct bpf_prog *prog);
-typedef void (*set_kdata)(unsigned long base, unsigned long enter, unsigned long ex);
-typedef void (*set_orig_jit_addr)(void *);
-typedef void (*jmem_clear)();
+typedef struct bpf_prog *(*jit_compile)(struct jit_ctx *, struct bpf_prog *prog);
+typedef void (*jit_release)(struct jit_ctx *);
 
-jit_compile s_j = NULL;
-set_kdata s_kdata = NULL;
-set_orig_jit_addr s_orig = NULL;
-void *s_jm = NULL;
-jmem_clear s_clear = NULL;
+// library is reentrant, so one handle is shared by all contexts
+struct ujit_lib
+{
+  void *handle;
+  jit_compile compile;
+  jit_release release;
+  jit_release destroy;
+  uint64_t build;
+};
+
+static ujit_lib s_lib = { NULL, NULL, NULL, NULL, 0 };
+
+static inline ujit_lib *lib_of(const ujit_ctx &ctx)
+{
+  return ctx.lib != NULL ? ctx.lib : &s_lib;
+}
+
+uint64_t ujit_build()
+{
+  return s_lib.build;
+}
+
+uint64_t ujit_build(const ujit_ctx &ctx)
+{
+  return lib_of(ctx)->build;
+}
+
+// FNV-1a of library file - results of different builds must not be mixed in jit cache
+static uint64_t hash_file(const char *fname)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  FILE *fp = fopen(fname, "rb");
+  if ( fp == NULL )
+    return 0;
+  unsigned char buf[4096];
+  size_t rd;
+  while ( (rd = fread(buf, 1, sizeof(buf), fp)) > 0 )
+    for ( size_t i = 0; i < rd; i++ )
+    {
+      h ^= buf[i];
+      h *= 0x100000001b3ULL;
+    }
+  fclose(fp);
+  return h;
+}
 
 int ujit_opened()
 {
-  return s_jm != NULL;
+  return s_lib.handle != NULL;
+}
+
+static void close_lib(ujit_lib *lib)
+{
+  if ( lib->handle )
+    dlclose(lib->handle);
+  memset(lib, 0, sizeof(*lib));
 }
 
 void ujit_close()
 {
-  if ( s_jm )
-  {
-    if ( s_clear != NULL )
-      s_clear();
-    dlclose(s_jm);
-    s_jm = NULL;
-    s_kdata = NULL;
-    s_orig = NULL;
-    s_clear = NULL;
-  }
+  close_lib(&s_lib);
 }
 
-int put_orig_jit_addr(void *addr)
+void ujit_release(ujit_ctx &ctx)
 {
-  if ( !s_orig )
-    return 0;
-  s_orig(addr);
-  return 1;
+  ujit_lib *lib = lib_of(ctx);
+  if ( lib->release != NULL )
+    lib->release(&ctx);
 }
 
-int put_kdata(unsigned long base, unsigned long enter, unsigned long ex)
+ujit_ctx::~ujit_ctx()
 {
-  if ( !s_kdata )
-   return 0;
-  s_kdata(base, enter, ex);
-  return 1;
+  ujit_lib *lib = lib_of(*this);
+  if ( lib->destroy != NULL )
+    lib->destroy(this);
 }
 
-int ujit_open(const char *fname)
+// shims are loaded with RTLD_LOCAL, so the same kernel symbols from different architectures don't clash
+static int open_lib(ujit_lib *lib, const char *fname)
 {
-  if ( s_jm )
-    ujit_close();
-  s_jm = dlopen(fname, RTLD_LAZY);
-  if ( !s_jm )
+  lib->handle = dlopen(fname, RTLD_LAZY | RTLD_LOCAL);
+  if ( !lib->handle )
   {
-    fprintf(stderr, "dlopen(%s) failed, err %d\n", fname, errno);
+    fprintf(stderr, "dlopen(%s) failed: %s\n", fname, dlerror());
     return 0;
   }
-  s_j = (jit_compile)dlsym(s_jm, "bpf_int_jit_compile");
-  if ( !s_j )
+  lib->compile = (jit_compile)dlsym(lib->handle, "jit_compile_ctx");
+  lib->release = (jit_release)dlsym(lib->handle, "jit_ctx_release");
+  lib->destroy = (jit_release)dlsym(lib->handle, "jit_ctx_destroy");
+  if ( !lib->compile || !lib->release || !lib->destroy )
   {
-    fprintf(stderr, "cannot find bpf_int_jit_compile\n");
+    fprintf(stderr, "cannot find jit_compile_ctx in %s\n", fname);
+    close_lib(lib);
     return 0;
   }
-  s_kdata = (set_kdata)dlsym(s_jm, "put_call_base");
-  s_orig = (set_orig_jit_addr)dlsym(s_jm, "put_original_jit_addr");
-  s_clear = (jmem_clear)dlsym(s_jm, "jmem_clear");
+  lib->build = hash_file(fname);
   return 1;
 }
 
+int ujit_open(const char *fname)
+{
+  ujit_close();
+  return open_lib(&s_lib, fname);
+}
+
+ujit_lib *ujit_load(const char *fname)
+{
+  ujit_lib *res = (ujit_lib *)calloc(1, sizeof(ujit_lib));
+  if ( res == NULL )
+    return NULL;
+  if ( !open_lib(res, fname) )
+  {
+    free(res);
+    return NULL;
+  }
+  return res;
+}
+
+void ujit_unload(ujit_lib *lib)
+{
+  if ( lib == NULL )
+    return;
+  close_lib(lib);
+  free(lib);
+}
+
 void free_prog(bpf_prog *fp)
 {
   if (fp->aux) 
@@ -99,9 +160,10 @@ int dump_jit2file(int idx, unsigned char *body, long len)
   return 1;
 }
 
-int ujit2file(int idx, unsigned char *body, long len, unsigned int stack_depth)
+int ujit2file(ujit_ctx &ctx, int idx, unsigned char *body, long len, unsigned int stack_depth)
 {
-  if ( s_j == NULL )
+  jit_compile compile = lib_of(ctx)->compile;
+  if ( compile == NULL )
     return -1;
   // make new bpf_prog
   size_t asize = sizeof(bpf_prog) + 8 * len;
@@ -122,15 +184,15 @@ int ujit2file(int idx, unsigned char *body, long len, unsigned int stack_depth)
   prog->aux->stack_depth = stack_depth;
   prog->bpf_func = NULL;
   prog->jit_requested = 1;
-  printf("s_j %p\n", s_j); fflush(stdout);
-  auto f = s_j(prog);
+  auto f = compile(&ctx, prog);
   if ( !f )
   {
-    fprintf(stderr, "bpf_int_jit_compile failed\n");
+    fprintf(stderr, "jit_compile_ctx failed\n");
     free_prog(prog);
     return 0;
   }
-  printf("jited_len %d bpf_func %p\n", f->jited_len, f->bpf_func);
+  if ( ctx.verbose )
+    printf("jited_len %d bpf_func %p\n", f->jited_len, f->bpf_func);
   if ( !f->jited_len )
   {
     free_prog(prog);
@@ -141,9 +203,10 @@ int ujit2file(int idx, unsigned char *body, long len, unsigned int stack_depth)
   return res;
 }
 
-int ujit2mem(unsigned char *body, long len, unsigned int stack_depth, jitted_code &jc)
+int ujit2mem(ujit_ctx &ctx, unsigned char *body, long len, unsigned int stack_depth, jitted_code &jc)
 {
-  if ( s_j == NULL )
+  jit_compile compile = lib_of(ctx)->compile;
+  if ( compile == NULL )
     return -1;
   // make new bpf_prog
   size_t asize = sizeof(bpf_prog) + 8 * len;
@@ -164,15 +227,15 @@ int ujit2mem(unsigned char *body, long len, unsigned int stack_depth, jitted_cod
   prog->aux->stack_depth = stack_depth;
   prog->bpf_func = NULL;
   prog->jit_requested = 1;
-  printf("s_j %p\n", s_j); fflush(stdout);
-  auto f = s_j(prog);
+  auto f = compile(&ctx, prog);
   if ( !f )
   {
-    fprintf(stderr, "bpf_int_jit_compile failed\n");
+    fprintf(stderr, "jit_compile_ctx failed\n");
     free_prog(prog);
     return 0;
   }
-  printf("ujit2mem: jited_len %d bpf_func %p\n", f->jited_len, f->bpf_func);
+  if ( ctx.verbose )
+    printf("ujit2mem: jited_len %d bpf_func %p\n", f->jited_len, f->bpf_func);
   jc.size = f->jited_len;
   if ( !f->jited_len )
   {
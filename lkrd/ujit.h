@@ -1,5 +1,8 @@
 #pragma once
 // api to usermode ebpf jit
+#include <stdint.h>
+#include <string.h>
+#include "../bpfdump/jit/jctx.h"
 
 struct jitted_code
 {
@@ -7,11 +10,65 @@ struct jitted_code
   unsigned char *body = NULL;
 };
 
+// default library, used by contexts without own library
 int ujit_open(const char *);
-int ujit2mem(unsigned char *, long len, unsigned int stack_depth, jitted_code &);
-int ujit2file(int idx, unsigned char *, long len, unsigned int stack_depth);
-int put_kdata(unsigned long base, unsigned long enter, unsigned long ex);
-int put_orig_jit_addr(void *);
 int ujit_opened();
+// hash of opened library
+uint64_t ujit_build();
+// all contexts must be released before
 void ujit_close();
-int dump_jit2file(int idx, unsigned char *body, long len);
\ No newline at end of file
+
+// additional libraries, so JITs for several architectures can be used at the same time
+struct ujit_lib;
+ujit_lib *ujit_load(const char *);
+void ujit_unload(ujit_lib *);
+
+// JIT state of one thread: kernel addresses and arena for images compiled with it
+// code returned by ujit2mem is valid until ujit_release
+struct ujit_ctx: public jit_ctx
+{
+  explicit ujit_ctx(ujit_lib *l = NULL)
+   : lib(l)
+  {
+    memset((jit_ctx *)this, 0, sizeof(jit_ctx));
+  }
+  ~ujit_ctx();
+  // owns images
+  ujit_ctx(const ujit_ctx &) = delete;
+  ujit_ctx &operator=(const ujit_ctx &) = delete;
+  // NULL - library from ujit_open
+  ujit_lib *lib;
+};
+
+// hash of library used by context
+uint64_t ujit_build(const ujit_ctx &);
+
+static inline void put_kdata(ujit_ctx &ctx, unsigned long base, unsigned long enter, unsigned long ex)
+{
+  ctx.call_base = base;
+  ctx.enter = enter;
+  ctx.ex = ex;
+}
+
+static inline void put_orig_jit_addr(ujit_ctx &ctx, void *addr)
+{
+  ctx.orig_jit_addr = addr;
+}
+
+// see jit_ctx.verbose
+static inline void put_verbose(ujit_ctx &ctx, int level)
+{
+  ctx.verbose = level;
+}
+
+// compile count, bytes and time of all compilations with ctx
+static inline const jit_stat &ujit_stat(const ujit_ctx &ctx)
+{
+  return ctx.stat;
+}
+
+int ujit2mem(ujit_ctx &, unsigned char *, long len, unsigned int stack_depth, jitted_code &);
+int ujit2file(ujit_ctx &, int idx, unsigned char *, long len, unsigned int stack_depth);
+// free code compiled with ctx, its arena is kept for next programs
+void ujit_release(ujit_ctx &);
+int dump_jit2file(int idx, unsigned char *body, long len);
@@ -1,5 +1,14 @@
+#include <string.h>
 #include "x64_disasm.h"
 #include "cf_graph.h"
+#include "profile.h"
+
+// all instructions decoded by analysis are counted for -P
+static inline unsigned int decode(ud_t *u)
+{
+  prof_add(PC_INSNS, 1);
+  return ud_disassemble(u);
+}
 
 int x64_disasm::reg32to64(ud_type from, ud_type &res) const
 {
@@ -79,7 +88,7 @@ int x64_disasm::find_return_notifier_list(a64 addr)
     return 0;
   for ( int i = 0; i < 20; i++ )
   {
-    if ( !ud_disassemble(&ud_obj) )
+    if ( !decode(&ud_obj) )
       return 0;
 #ifdef _DEBUG
     printf("%p %s (I: %d size %d, II: %d size %d)\n", (void *)ud_insn_off(&ud_obj), ud_insn_asm(&ud_obj),
@@ -130,7 +139,7 @@ a64 x64_disasm::process_bpf_target(a64 addr, a64 mlock)
     return 0;
   for ( ; ; )
   {
-    if ( !ud_disassemble(&ud_obj) )
+    if ( !decode(&ud_obj) )
       break;
     if ( is_end() )
       break;
@@ -181,7 +190,7 @@ int x64_disasm::process_sl(lsm_hook &sl)
     return 0;
   for ( ; ;  )
   {
-    if ( !ud_disassemble(&ud_obj) )
+    if ( !decode(&ud_obj) )
       break;
     if ( is_end() )
       break;
@@ -224,7 +233,7 @@ int x64_disasm::process_trace_remove_event_call(a64 addr, a64 free_event_filter)
 #endif /* _DEBUG */
        for ( ; ;  )
        {
-         if ( !ud_disassemble(&ud_obj) )
+         if ( !decode(&ud_obj) )
            break;
 #ifdef _DEBUG
          printf("%p %s (I: %d size %d, II: %d size %d)\n", (void *)ud_insn_off(&ud_obj), ud_insn_asm(&ud_obj),
@@ -286,8 +295,9 @@ int x64_disasm::process_trace_remove_event_call(a64 addr, a64 free_event_filter)
   return 0;
 }
 
-int x64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out_res)
+int x64_disasm::process(a64 addr, const ptr_hits &skip, std::set<a64> &out_res)
 {
+  prof_add(PC_FUNCS, 1);
   using Regs = used_regs<a64>;
   statefull_graph<a64, Regs> cgraph;
   std::list<std::pair<a64, Regs> > addr_list;
@@ -314,7 +324,7 @@ int x64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out_r
 #endif /* _DEBUG */
        for ( ; ;  )
        {
-         if ( !ud_disassemble(&ud_obj) )
+         if ( !decode(&ud_obj) )
            break;
 #ifdef _DEBUG
          printf("%p %s (I: %d size %d, II: %d size %d)\n", (void *)ud_insn_off(&ud_obj), ud_insn_asm(&ud_obj),
@@ -382,8 +392,7 @@ int x64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out_r
            a64 tmp = 0;
            if ( iter->second.asgn(ud_obj.operand[0].base, tmp) && tmp )
            {
-             auto was = skip.find(tmp);
-             if ( was == skip.end() )
+             if ( !skip.has(tmp) )
              {
                out_res.insert(tmp);
                res++;
@@ -399,8 +408,7 @@ int x64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out_r
            a64 addr = (ud_obj.pc & 0xffffffff00000000) + ud_obj.operand[0].lval.udword;
            if ( in_data(addr) )
            {
-             auto was = skip.find(addr);
-             if ( was == skip.end() )
+             if ( !skip.has(addr) )
              {
                out_res.insert(addr);
                res++;
@@ -423,8 +431,7 @@ int x64_disasm::process(a64 addr, std::map<a64, a64> &skip, std::set<a64> &out_r
                 if (0xFFFFFFFF826B9A08 == tmp)
                   printf("gotcha\n");
 #endif /* _DEBUG */
-                auto was = skip.find(tmp);
-                if ( was == skip.end() )
+                if ( !skip.has(tmp) )
                 {
                   out_res.insert(tmp);
                   res++;
@@ -452,7 +459,7 @@ int x64_jit_nops::skip(const char *body, unsigned long len)
    int curr_len, total = 0;
    for ( ; total < len; total += curr_len )
    {
-     curr_len = ud_disassemble(&ud_obj);
+     curr_len = decode(&ud_obj);
      if ( !curr_len )
        return 0;
      if ( ud_obj.mnemonic == UD_Inop )
@@ -461,3 +468,129 @@ int x64_jit_nops::skip(const char *body, unsigned long len)
    }
    return total;
 }
+
+static long imm_value(const ud_operand &op)
+{
+  switch(op.size)
+  {
+    case 8:  return op.lval.sbyte;
+    case 16: return op.lval.sword;
+    case 32: return op.lval.sdword;
+  }
+  return (long)op.lval.sqword;
+}
+
+static int is_reg(const ud_t *u, int idx)
+{
+  return u->operand[idx].type == UD_OP_REG;
+}
+
+static int is_imm(const ud_t *u, int idx)
+{
+  return u->operand[idx].type == UD_OP_IMM;
+}
+
+static int is_abcd(ud_type r)
+{
+  return r == UD_R_RAX || r == UD_R_RBX || r == UD_R_RCX || r == UD_R_RDX;
+}
+
+// prologue: nops for tail calls and poking, push rbp; mov rbp, rsp; sub rsp, N, xor eax, eax for tail call counter
+// and pushes of callee-saved regs
+static int is_prologue(const ud_t *u)
+{
+  switch(u->mnemonic)
+  {
+    case UD_Inop:
+    case UD_Ipush:
+      return 1;
+    case UD_Imov:
+      return is_reg(u, 0) && u->operand[0].base == UD_R_RBP && is_reg(u, 1) && u->operand[1].base == UD_R_RSP;
+    case UD_Isub:
+      return is_reg(u, 0) && u->operand[0].base == UD_R_RSP && is_imm(u, 1);
+    case UD_Ixor:
+      return is_reg(u, 0) && is_reg(u, 1) && u->operand[0].base == UD_R_EAX && u->operand[1].base == UD_R_EAX;
+    default:
+      return 0;
+  }
+}
+
+void x64_jit_disasm::overhead(sa64 delta, jit_ovh &res)
+{
+  memset(&res, 0, sizeof(res));
+  // no text
+  ud_set_syntax(&ud_obj, NULL);
+  // IBT kernels start programs with endbr64 which udis86 doesn't know - part of prologue
+  unsigned int skip = 0;
+  if ( m_len >= 4 && !memcmp(m_body, "\xf3\x0f\x1e\xfa", 4) )
+  {
+    skip = 4;
+    res.insns++;
+    res.bytes += skip;
+    res.prologue += skip;
+  }
+  ud_set_input_buffer(&ud_obj, (uint8_t *)m_body + skip, m_len - skip);
+  ud_set_pc(&ud_obj, (uint64_t)start + skip);
+  int in_prologue = 1;
+  // state: 1 - mov reg, rbp; 3 - mov reg, imm
+  int state = 0;
+  ud_type reg = UD_NONE;
+  const uint8_t *prev = NULL;
+  unsigned int prev_len = 0;
+  unsigned int len;
+  while ( (len = decode(&ud_obj)) )
+  {
+    res.insns++;
+    res.bytes += len;
+    const uint8_t *curr = ud_insn_ptr(&ud_obj);
+    if ( in_prologue )
+    {
+      if ( is_prologue(&ud_obj) )
+      {
+        res.prologue += len;
+        prev = curr;
+        prev_len = len;
+        continue;
+      }
+      in_prologue = 0;
+    }
+    if ( ud_obj.mnemonic == UD_Inop )
+      res.nops += len;
+    else if ( ud_obj.mnemonic == UD_Ilfence )
+      res.barriers += len;
+    else if ( (ud_obj.mnemonic == UD_Icall || ud_obj.mnemonic == UD_Ijmp) && ud_obj.operand[0].type == UD_OP_JIMM )
+    {
+      a64 addr = ud_obj.pc + imm_value(ud_obj.operand[0]);
+      const char *name = name_by_addr((a64)(addr - delta));
+      if ( name != NULL && (!strncmp(name, "__x86_indirect_thunk", 20) || !strcmp(name, "__x86_return_thunk")) )
+        res.retpolines += len;
+    }
+    // odd sequences
+    int next_state = 0;
+    if ( ud_obj.mnemonic == UD_Imov && is_reg(&ud_obj, 0) && is_reg(&ud_obj, 1) && ud_obj.operand[1].base == UD_R_RBP )
+    {
+      // mov reg, rbp; add reg, imm - lea is shorter by 3 bytes
+      reg = ud_obj.operand[0].base;
+      next_state = 1;
+    } else if ( ud_obj.mnemonic == UD_Imov && is_reg(&ud_obj, 0) && is_imm(&ud_obj, 1) )
+    {
+      // mov reg, imm; add reg, imm - whole add is odd
+      reg = ud_obj.operand[0].base;
+      next_state = 3;
+    } else if ( ud_obj.mnemonic == UD_Iadd && is_reg(&ud_obj, 0) && is_imm(&ud_obj, 1) &&
+                (state == 1 || state == 3) && ud_obj.operand[0].base == reg )
+      res.odd += state == 1 ? 3 : len;
+    else if ( (ud_obj.mnemonic == UD_Iadd || ud_obj.mnemonic == UD_Isub) && is_reg(&ud_obj, 0) && is_imm(&ud_obj, 1) &&
+              imm_value(ud_obj.operand[1]) == 1 )
+      res.odd++; // inc/dec
+    else if ( ud_obj.mnemonic == UD_Imov && is_reg(&ud_obj, 0) && is_reg(&ud_obj, 1) &&
+              is_abcd(ud_obj.operand[0].base) && is_abcd(ud_obj.operand[1].base) )
+      res.odd++; // push/pop
+    else if ( prev != NULL && prev_len == len && !memcmp(prev, curr, len) && ud_obj.mnemonic != UD_Inop )
+      res.odd += len; // repeated instruction
+    state = next_state;
+    prev = curr;
+    prev_len = len;
+  }
+  ud_set_syntax(&ud_obj, UD_SYN_INTEL);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <list>
+#include <vector>
 #include "dis_base.h"
 #define __UD_STANDALONE__
 #include "libudis86/types.h"
@@ -112,6 +113,18 @@ struct x64_jit_nops
    ud_t ud_obj;
 };
 
+// overhead of JIT code of one bpf program, all sizes in bytes
+struct jit_ovh
+{
+  unsigned long insns;      // x86 instructions
+  unsigned long bytes;
+  unsigned long prologue;   // leading nops, pushes and stack frame setup
+  unsigned long nops;       // excluding prologue
+  unsigned long barriers;   // lfence
+  unsigned long retpolines; // calls and jumps to __x86_indirect_thunk_xx/__x86_return_thunk
+  unsigned long odd;        // longer than needed sequences, same patterns as scripts/ovh.pl had
+};
+
 class x64_jit_disasm
 {
   public:
@@ -119,13 +132,14 @@ class x64_jit_disasm
    {
       start = addr;
       m_body = body;
+      m_len = len;
       ud_init(&ud_obj);
       ud_set_mode(&ud_obj, 64);
       ud_set_syntax(&ud_obj, UD_SYN_INTEL);
       ud_set_input_buffer(&ud_obj, (uint8_t *)body, len);
       ud_set_pc(&ud_obj, (uint64_t)addr);
    }
-   void disasm(sa64 delta, std::map<void *, std::string> &map_names, std::list<const char *> *holes)
+   void disasm(sa64 delta, std::map<void *, std::string> &map_names, std::vector<const char *> *holes)
    {
      int curr_len;
      while (curr_len = ud_disassemble(&ud_obj))
@@ -173,10 +187,13 @@ class x64_jit_disasm
          printf("%-32s %s\n", hex1, ud_insn_asm(&ud_obj));
      }
    }
+   // decode whole body without printing
+   void overhead(sa64 delta, jit_ovh &);
   protected:
    ud_t ud_obj;
    a64 start;
    const char *m_body;
+   unsigned long m_len;
 };
 
 class x64_disasm: public dis_base
@@ -204,7 +221,7 @@ class x64_disasm: public dis_base
     }
     virtual ~x64_disasm() = default;
     virtual int find_return_notifier_list(a64 addr);
-    virtual int process(a64 addr, std::map<a64, a64> &, std::set<a64> &out_res);
+    virtual int process(a64 addr, const ptr_hits &, std::set<a64> &out_res);
     virtual int process_sl(lsm_hook &);
     virtual a64 process_bpf_target(a64 addr, a64 mlock);
     virtual int process_trace_remove_event_call(a64 addr, a64 free_event_filter);
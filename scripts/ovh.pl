@@ -1,6 +1,7 @@
 #!perl -w
 # lame try to estimate overhead of ebpf jit
 # 4 dec 2021 (c) redplait
+# superseded by lkmem -B -O which counts the same patterns on decoded instructions
 use strict;
 use warnings;
 
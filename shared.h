@@ -860,6 +860,12 @@ struct one_bpf_map
   unsigned int value_size;
   unsigned int id;
   char name[16]; // BPF_OBJ_NAME_LEN
+  unsigned int max_entries;
+  unsigned int map_flags;
+  unsigned long mem;        // bytes, map_mem_usage on 6.4+, estimation like bpf_map_memory_footprint on older
+  unsigned long memcg_id;   // id of cgroup map memory charged to, 0 if unknown
+  unsigned int nprogs;      // how many programs use this map
+  unsigned int progs[8];    // ids of first of them
 };
 
 // read BPF maps
@@ -867,6 +873,8 @@ struct one_bpf_map
 //  0 - address of map_idr
 //  1 - address of map_idr_lock
 //  2 - cnt
+//  3 - address of prog_idr, optional - when non-zero nprogs/progs are filled
+//  4 - address of prog_idr_lock
 // out params
 //  unsigned long + N * one_bpf_map
 #define IOCTL_GET_BPF_MAPS             _IOR(IOCTL_NUM, 0x3D, int*)
@@ -1126,4 +1134,60 @@ struct one_alarm
 // else N + N * one_alarm
 #define IOCTL_GET_ALARMS                _IOR(IOCTL_NUM, 0x50, int*)
 
+struct one_kmod_range
+{
+  void *addr;   // struct module or struct bpf_ksym
+  unsigned long start;
+  unsigned long size;
+  int kind;     // 0 - module core, 1 - module init, 2 - bpf image
+  char name[56];
+};
+
+// read address ranges of loaded modules (both core & init) and bpf images
+// in params:
+//  0 - address of modules list
+//  1 - address of module_mutex
+//  2 - address of bpf_kallsyms, can be 0
+//  3 - address of bpf_lock
+//  4 - count, if zero - just return count
+// out params
+//  N + N * one_kmod_range
+#define IOCTL_GET_KMOD_RANGES           _IOR(IOCTL_NUM, 0x51, int*)
+
+// kinds of attach points in one_bpf_edge
+#define BPF_AP_OTHER      0 // xdp, tcx, struct_ops etc - see attach_type
+#define BPF_AP_CGROUP     1 // target_id is cgroup id
+#define BPF_AP_NETNS      2 // target_id is inode of netns
+#define BPF_AP_TRACEPOINT 3 // name is name of event
+#define BPF_AP_KPROBE     4
+#define BPF_AP_UPROBE     5
+#define BPF_AP_ITER       6 // name is iterator target
+#define BPF_AP_RAW_TP     7 // name is tracepoint
+#define BPF_AP_TRACING    8 // fentry/fexit/lsm, name is attach_func_name
+
+// edge prog -> (link) -> attach point
+struct one_bpf_edge
+{
+  unsigned int prog_id;
+  unsigned int link_id;  // 0 if prog attached without link
+  int kind;              // BPF_AP_XXX
+  int attach_type;       // bpf_attach_type, for cgroups & netns without link - index in run array
+  void *prog;
+  void *target;          // cgroup, net, trace_event_call, bpf_iter_target_info etc
+  unsigned long target_id;
+  char name[64];
+};
+
+// read graph of bpf programs, links and their attach points
+// links, cgroups, network namespaces and trace events are walked in one call, each under own lock
+// in params:
+//  0 - address of link_idr
+//  1 - address of link_idr_lock
+//  2 - address of cgroup_hierarchy_idr, can be 0
+//  3 - address of cgroup_mutex
+//  4 - count, if zero - just return count
+// out params
+//  N + N * one_bpf_edge
+#define IOCTL_GET_BPF_GRAPH             _IOR(IOCTL_NUM, 0x52, int*)
+
 #endif /* LKCD_SHARED_H */
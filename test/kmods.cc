@@ -1,37 +1,93 @@
 #include <stdio.h>
+#include <vector>
 #include <list>
+#include <string>
 #include <fstream>
+#include <algorithm>
 #include <cstring>
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <net/if.h>
+#include <linux/genetlink.h>
 #include "kmods.h"
+#include "../shared.h"
 
 struct one_mod
 {
-  std::string name;
   unsigned long start;
   unsigned long len;
+  const char *name; // points to m_names
 };
 
 class mods_storage
 {
   public:
     int read_mods();
-    const char *find(unsigned long addr);
+    int read_mods(int fd, unsigned long modules, unsigned long mlock, unsigned long bpf_ksyms, unsigned long bpf_lock);
+    const char *find(unsigned long addr) const
+    {
+      auto c = lookup(addr);
+      return c == NULL ? NULL : c->name;
+    }
+    size_t find(const unsigned long *addrs, size_t count, const char **names) const;
   protected:
-    std::list<one_mod> m_list;
+    // sorted by start, ranges don't intersect
+    std::vector<one_mod> m_mods;
+    // names storage, list for stable addresses
+    std::list<std::string> m_names;
+
+    const one_mod *lookup(unsigned long addr) const
+    {
+      // first range with start > addr, previous one can contain addr
+      auto c = std::upper_bound(m_mods.cbegin(), m_mods.cend(), addr, [](unsigned long a, const one_mod &r) -> 
+        bool { return a < r.start; }
+      );
+      if ( c == m_mods.cbegin() )
+        return NULL;
+      --c;
+      if ( addr < c->start + c->len )
+        return &*c;
+      return NULL;
+    }
+    const char *add_name(const char *name)
+    {
+      if ( m_names.empty() || m_names.back() != name )
+        m_names.push_back(name);
+      return m_names.back().c_str();
+    }
+    void sort()
+    {
+      std::sort(m_mods.begin(), m_mods.end(), [](const one_mod &l, const one_mod &r) -> bool { return l.start < r.start; });
+    }
 };
 
 static mods_storage s_mod_stg;
 
-const char *mods_storage::find(unsigned long addr)
+// classify many addresses at once - sort them and walk ranges in one merge pass
+size_t mods_storage::find(const unsigned long *addrs, size_t count, const char **names) const
 {
-  for ( auto &c: m_list )
+  std::vector<size_t> idx(count);
+  for ( size_t i = 0; i < count; i++ )
+  {
+    idx[i] = i;
+    names[i] = NULL;
+  }
+  std::sort(idx.begin(), idx.end(), [addrs](size_t l, size_t r) -> bool { return addrs[l] < addrs[r]; });
+  size_t res = 0;
+  auto m = m_mods.cbegin();
+  for ( auto i: idx )
   {
-    if ( (addr >= c.start) &&
-         (addr < (c.start + c.len) )
-       )
-     return c.name.c_str();
+    unsigned long addr = addrs[i];
+    while ( m != m_mods.cend() && addr >= m->start + m->len )
+      ++m;
+    if ( m == m_mods.cend() )
+      break;
+    if ( addr < m->start )
+      continue;
+    names[i] = m->name;
+    res++;
   }
-  return NULL;
+  return res;
 }
 
 int mods_storage::read_mods()
@@ -40,6 +96,8 @@ int mods_storage::read_mods()
   f.open("/proc/modules");
   if ( !f.is_open() )
     return errno;
+  m_mods.clear();
+  m_names.clear();
   std::string s;
   while( std::getline(f, s) )
   {
@@ -49,7 +107,6 @@ int mods_storage::read_mods()
       w++;
     std::string cn(s.c_str(), w);
     one_mod tmp;
-    tmp.name = cn;
     tmp.len = atoi(w + 1);
     // now find "Live 0x"
     const char *rest = strstr(w + 1, "Live 0x");
@@ -59,8 +116,53 @@ int mods_storage::read_mods()
     tmp.start = strtoul(rest + 7, &end, 0x10);
     if ( !tmp.start )
      continue;
-    m_list.push_back(tmp);
+    tmp.name = add_name(cn.c_str());
+    m_mods.push_back(tmp);
   }
+  sort();
+  return 0;
+}
+
+// lkmem can record answers of driver, it must know size of buffer. other tools are linked without kdev
+extern "C" void kdev_arg_size(const void *arg, size_t size) __attribute__((weak));
+
+// read ranges of modules (including init layouts) and bpf images from driver
+int mods_storage::read_mods(int fd, unsigned long modules, unsigned long mlock, unsigned long bpf_ksyms, unsigned long bpf_lock)
+{
+  unsigned long args[5] = { modules, mlock, bpf_ksyms, bpf_lock, 0 };
+  int err = ioctl(fd, IOCTL_GET_KMOD_RANGES, (int *)args);
+  if ( err )
+    return errno;
+  if ( !args[0] )
+    return ENOENT;
+  size_t size = sizeof(unsigned long) + args[0] * sizeof(one_kmod_range);
+  std::vector<unsigned long> buf(size / sizeof(unsigned long) + 1);
+  buf[0] = modules;
+  buf[1] = mlock;
+  buf[2] = bpf_ksyms;
+  buf[3] = bpf_lock;
+  buf[4] = args[0];
+  if ( kdev_arg_size )
+    kdev_arg_size(buf.data(), buf.size() * sizeof(unsigned long));
+  err = ioctl(fd, IOCTL_GET_KMOD_RANGES, (int *)buf.data());
+  if ( kdev_arg_size )
+    kdev_arg_size(buf.data(), 0);
+  if ( err )
+    return errno;
+  m_mods.clear();
+  m_names.clear();
+  one_kmod_range *curr = (one_kmod_range *)(buf.data() + 1);
+  m_mods.reserve(buf[0]);
+  for ( size_t i = 0; i < buf[0]; i++, curr++ )
+  {
+    curr->name[sizeof(curr->name) - 1] = 0;
+    one_mod tmp;
+    tmp.start = curr->start;
+    tmp.len = curr->size;
+    tmp.name = add_name(curr->name);
+    m_mods.push_back(tmp);
+  }
+  sort();
   return 0;
 }
 
@@ -69,7 +171,17 @@ const char *find_kmod(unsigned long addr)
   return s_mod_stg.find(addr);
 }
 
+size_t find_kmods(const unsigned long *addrs, size_t count, const char **names)
+{
+  return s_mod_stg.find(addrs, count, names);
+}
+
 int init_kmods()
 {
   return s_mod_stg.read_mods();
-}
\ No newline at end of file
+}
+
+int init_kmods_drv(int fd, unsigned long modules, unsigned long mlock, unsigned long bpf_ksyms, unsigned long bpf_lock)
+{
+  return s_mod_stg.read_mods(fd, modules, mlock, bpf_ksyms, bpf_lock);
+}
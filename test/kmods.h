@@ -1,12 +1,18 @@
 #pragma once
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// read modules from /proc/modules
 int init_kmods();
+// read modules and bpf images from driver, bpf_ksyms & bpf_lock can be 0
+int init_kmods_drv(int fd, unsigned long modules, unsigned long mlock, unsigned long bpf_ksyms, unsigned long bpf_lock);
 const char *find_kmod(unsigned long addr);
+// batch version of find_kmod, names[i] is NULL for addresses outside of any module
+size_t find_kmods(const unsigned long *addrs, size_t count, const char **names);
 
 #ifdef __cplusplus
 };
-#endif
\ No newline at end of file
+#endif
@@ -1,16 +1,24 @@
 #include <stdio.h>
-#include <fstream>
 #include <string>
 #include <list>
-#include <map>
-#include <set>
 #include <vector>
 #include <algorithm>
 #include <cstring>
 #include <regex>
+#include <atomic>
 #include <sys/utsname.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
 #ifdef HAS_ELFIO
 #include "elfio/elfio_dump.hpp"
+#elif defined(HAS_ELF_VIEW)
+#include "elf_view.h"
 #endif /* HAS_ELFIO */
 #include "ksyms.h"
 
@@ -22,82 +30,224 @@ typedef unsigned long a64;
 
 struct one_sym
 {
-  std::string name;
   a64 addr;
+  unsigned int name; // offset in arena
   char letter;
 };
 
 struct one_addr
 {
   a64 addr;
-  one_sym *sym;
+  unsigned int name; // offset in arena
 };
 
-struct namesComparer : public std::binary_function<const char *, const char *, bool>
+// direct-mapped cache of address lookups - the same handlers are resolved again and again
+// per thread so lookups from worker threads don't race, gen invalidates entries after reload
+struct lookup_ent
 {
-  bool operator()(const char *a, const char *b) const
+  a64 addr;
+  size_t idx;
+  unsigned int gen;
+};
+static const size_t s_lcache_size = 4096;
+static thread_local lookup_ent s_lcache[s_lcache_size];
+// counters are only for profiling, so relaxed atomics - updated from worker threads too
+static struct
+{
+  std::atomic<size_t> lookups;
+  std::atomic<size_t> hits;
+  std::atomic<size_t> name_lookups;
+} s_stat;
+
+// layout of binary cache stored near System.map (or in cache dir when its dir is read-only),
+// all arrays follow header in this order:
+// one_sym[syms], unsigned int[names], a64[addrs], unsigned int[addrs], char[arena]
+struct ksym_cache_hdr
+{
+  char magic[4];
+  unsigned int version;
+  unsigned long src_size;
+  long src_mtime;
+  long src_mtime_ns;
+  unsigned long src_ino;
+  unsigned long syms;
+  unsigned long names;
+  unsigned long addrs;
+  unsigned long arena;
+  unsigned long sum; // of everything after header, see cache_sum
+};
+
+static const char s_cache_magic[4] = { 'L', 'K', 'S', 'C' };
+static const unsigned int s_cache_version = 3;
+
+// FNV-1a style over 8-byte words - cache can be several Mb so bytewise is too slow
+static unsigned long cache_sum(const char *p, size_t size)
+{
+  unsigned long h = 0xcbf29ce484222325UL;
+  size_t i = 0;
+  for ( ; i + 8 <= size; i += 8 )
   {
-    return strcmp(a, b) < 0;
+    unsigned long w;
+    memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0x100000001b3UL;
   }
-};
+  for ( ; i < size; i++ )
+    h = (h ^ (unsigned char)p[i]) * 0x100000001b3UL;
+  return h;
+}
+
+// System.map.lkc when dir of System.map is writable, else $XDG_CACHE_HOME/lkcd or ~/.cache/lkcd
+// with full path of System.map flattened to file name
+static std::string cache_name(const char *name, int create)
+{
+  std::string res = name;
+  auto slash = res.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : slash ? res.substr(0, slash) : "/";
+  if ( !access(dir.c_str(), W_OK) )
+    return res + ".lkc";
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  if ( xdg != NULL && *xdg )
+    dir = xdg;
+  else {
+    const char *home = getenv("HOME");
+    if ( home == NULL || !*home )
+      return std::string();
+    dir = home;
+    dir += "/.cache";
+    if ( create )
+      mkdir(dir.c_str(), 0700);
+  }
+  dir += "/lkcd";
+  if ( create )
+    mkdir(dir.c_str(), 0700);
+  res.clear();
+  char full[PATH_MAX];
+  const char *src = realpath(name, full) ? full : name;
+  for ( ; *src; src++ )
+    res += *src == '/' ? '_' : *src;
+  return dir + "/" + res + ".lkc";
+}
 
 class ksym_holder
 {
   public:
-    ksym_holder()
-    {
-      m_addresses = NULL;
-    }
-   ~ksym_holder()
-    {
-      if ( m_addresses != NULL )
-        delete[] m_addresses;
-    }
     int read_ksyms(const char *name);
 #ifdef HAS_ELFIO
     int read_syms(const ELFIO::elfio& reader, ELFIO::symbol_section_accessor &);
+#elif defined(HAS_ELF_VIEW)
+    int read_syms(const elf_view& reader, elf_symbols &);
 #endif /* HAS_ELFIO */
     const char *name_by_addr(a64);
     const char *lower_name_by_addr(a64);
     const char *lower_name_by_addr_with_off(a64, size_t *);
+    size_t lower_names_by_addrs(const a64 *addrs, size_t count, const char **names, size_t *offs);
     a64 get_addr(const char *name)
     {
-      auto c = m_names.find(name);
-      if ( c != m_names.end() ) 
-        return c->second->addr;
+      s_stat.name_lookups.fetch_add(1, std::memory_order_relaxed);
+      auto c = find_name(name);
+      if ( c != m_names.end() )
+        return m_syms[*c].addr;
       return 0;
     }
     struct addr_sym *get_in_range(a64 start, a64 end, size_t *count);
     struct addr_sym *start_with(const char *prefix, a64 start, a64 end, size_t *count);
     size_t fill_bpf_protos(std::list<one_bpf_proto> &out_res);
   protected:
-    std::list<one_sym> m_syms;
-    std::map<const char *, one_sym *, namesComparer> m_names;
-    size_t m_asize;
-    one_addr *m_addresses;
+    // all names are zero-terminated strings inside one arena
+    std::vector<char> m_arena;
+    std::vector<one_sym> m_syms;
+    // indexes in m_syms sorted by name, only first symbol with the same name
+    std::vector<unsigned int> m_names;
+    // sorted by address, only first symbol with the same address
+    // keys and names are separate arrays so binary search touches only keys
+    std::vector<a64> m_akeys;
+    std::vector<unsigned int> m_anames;
+    // the same keys in eytzinger (BFS) layout, 1-based, m_epos is index in m_akeys
+    std::vector<a64> m_eytz;
+    std::vector<unsigned int> m_epos;
 
+    inline const char *get_name(unsigned int off) const
+    {
+      return m_arena.data() + off;
+    }
+    unsigned int add_name(const char *name, size_t len)
+    {
+      unsigned int res = (unsigned int)m_arena.size();
+      m_arena.insert(m_arena.end(), name, name + len);
+      m_arena.push_back(0);
+      return res;
+    }
+    std::vector<unsigned int>::const_iterator find_name(const char *name) const
+    {
+      auto c = std::lower_bound(m_names.cbegin(), m_names.cend(), name, [this](unsigned int l, const char *n) -> 
+        bool { return strcmp(get_name(m_syms[l].name), n) < 0; }
+      );
+      if ( c != m_names.cend() && !strcmp(get_name(m_syms[*c].name), name) )
+        return c;
+      return m_names.cend();
+    }
+    unsigned int m_gen = 1;
+
+    // cached lower_idx
+    size_t lookup_idx(a64 addr)
+    {
+      s_stat.lookups.fetch_add(1, std::memory_order_relaxed);
+      lookup_ent &e = s_lcache[(addr >> 4) & (s_lcache_size - 1)];
+      if ( e.gen == m_gen && e.addr == addr )
+      {
+        s_stat.hits.fetch_add(1, std::memory_order_relaxed);
+        return e.idx;
+      }
+      e.idx = lower_idx(addr);
+      e.addr = addr;
+      e.gen = m_gen;
+      return e.idx;
+    }
+    // returns index of first key >= addr or m_akeys.size() if there is no such key
+    size_t lower_idx(a64 addr) const
+    {
+      const a64 *e = m_eytz.data();
+      size_t n = m_akeys.size();
+      size_t k = 1;
+      while ( k <= n )
+      {
+        // 8 keys below k are in one cache line 3 levels down
+        __builtin_prefetch(e + k * 8);
+        k = 2 * k + (e[k] < addr);
+      }
+      // drop trailing right turns + last left turn
+      k >>= __builtin_ffsl(~k);
+      return k ? m_epos[k] : n;
+    }
+    size_t fill_eytz(size_t i, size_t k);
+    void make_eytz();
     void make_addresses();
+    void parse_map(const char *s, const char *end);
+    int read_cache(const char *name, const struct stat *st);
+    void write_cache(const char *name, const struct stat *st) const;
 };
 
 size_t ksym_holder::fill_bpf_protos(std::list<one_bpf_proto> &out_res)
 {
   size_t res = 0;
   std::regex bpf_regex("^bpf_.*_proto$");
-  for ( const auto name: m_names )
+  for ( auto idx: m_names )
   {
-    if ( !std::regex_search(name.first, bpf_regex) )
+    const one_sym &sym = m_syms[idx];
+    const char *name = get_name(sym.name);
+    if ( !std::regex_search(name, bpf_regex) )
       continue;
     // try to find function from proto
-    size_t len = strlen(name.first);
-    std::string fname(name.first, name.first + len - 6);
-    auto fiter = m_names.find(fname.c_str());
+    size_t len = strlen(name);
+    std::string fname(name, name + len - 6);
+    auto fiter = find_name(fname.c_str());
     if ( fiter == m_names.end() )
       continue;
     one_bpf_proto tmp;
-    tmp.proto.name = name.first;
-    tmp.proto.addr = name.second->addr;
-    tmp.func.name = fiter->first;
-    tmp.func.addr = fiter->second->addr;
+    tmp.proto.name = name;
+    tmp.proto.addr = sym.addr;
+    tmp.func.name = get_name(m_syms[*fiter].name);
+    tmp.func.addr = m_syms[*fiter].addr;
     out_res.push_back(tmp);
     res++;
   }
@@ -106,111 +256,126 @@ size_t ksym_holder::fill_bpf_protos(std::list<one_bpf_proto> &out_res)
 
 const char *ksym_holder::name_by_addr(a64 addr)
 {
-  if ( NULL == m_addresses )
+  if ( m_akeys.empty() )
     return NULL;
-  const one_addr *found = std::lower_bound(m_addresses, m_addresses + m_asize, addr, [](const one_addr &l, a64 off) -> 
-      bool { return l.addr < off; }
-  );
-  if ( found == m_addresses + m_asize)
+  size_t found = lookup_idx(addr);
+  if ( found == m_akeys.size() )
     return NULL;
-  if ( found->addr != addr )
+  if ( m_akeys[found] != addr )
     return NULL;
-  return found->sym->name.c_str();
+  return get_name(m_anames[found]);
 }
 
 const char *ksym_holder::lower_name_by_addr(a64 addr)
 {
-  if ( NULL == m_addresses )
+  if ( m_akeys.empty() )
     return NULL;
-  const one_addr *found = std::lower_bound(m_addresses, m_addresses + m_asize, addr, [](const one_addr &l, a64 off) -> 
-      bool { return l.addr < off; }
-  );
-  if ( found == m_addresses + m_asize)
+  size_t found = lookup_idx(addr);
+  if ( found == m_akeys.size() )
     return NULL;
-  if ( found->addr == addr )
-    found->sym->name.c_str();
-  if ( found == m_addresses )
+  if ( m_akeys[found] == addr )
+    return get_name(m_anames[found]);
+  if ( !found )
     return NULL;
-  found--;
-  return found->sym->name.c_str();
+  return get_name(m_anames[found - 1]);
 }
 
 const char *ksym_holder::lower_name_by_addr_with_off(a64 addr, size_t *off)
 {
-  if ( NULL == m_addresses )
+  if ( m_akeys.empty() )
     return NULL;
-  const one_addr *found = std::lower_bound(m_addresses, m_addresses + m_asize, addr, [](const one_addr &l, a64 off) -> 
-      bool { return l.addr < off; }
-  );
-  if ( found == m_addresses + m_asize)
+  size_t found = lookup_idx(addr);
+  if ( found == m_akeys.size() )
     return NULL;
-  if ( found->addr == addr )
+  if ( m_akeys[found] == addr )
   {
     *off = 0;
-    return found->sym->name.c_str();
+    return get_name(m_anames[found]);
   }
-  if ( found == m_addresses )
+  if ( !found )
     return NULL;
   found--;
-  *off = addr - found->addr;
-  return found->sym->name.c_str();
+  *off = addr - m_akeys[found];
+  return get_name(m_anames[found]);
+}
+
+// the same as lower_name_by_addr_with_off for each address but in one merge pass
+// addrs should be sorted, otherwise search restarts on each descending address
+size_t ksym_holder::lower_names_by_addrs(const a64 *addrs, size_t count, const char **names, size_t *offs)
+{
+  size_t res = 0;
+  size_t n = m_akeys.size();
+  size_t found = n;
+  for ( size_t i = 0; i < count; i++ )
+  {
+    a64 addr = addrs[i];
+    names[i] = NULL;
+    if ( offs != NULL )
+      offs[i] = 0;
+    if ( !n )
+      continue;
+    if ( !i || addr < addrs[i - 1] )
+      found = lower_idx(addr);
+    else
+      while ( found < n && m_akeys[found] < addr )
+        found++;
+    if ( found == n )
+      continue;
+    if ( m_akeys[found] == addr )
+      names[i] = get_name(m_anames[found]);
+    else if ( found )
+    {
+      names[i] = get_name(m_anames[found - 1]);
+      if ( offs != NULL )
+        offs[i] = addr - m_akeys[found - 1];
+    } else
+      continue;
+    res++;
+  }
+  return res;
 }
 
 struct addr_sym *ksym_holder::get_in_range(a64 start, a64 end_a, size_t *count)
 {
   *count = 0;
-  if ( NULL == m_addresses )
+  if ( m_akeys.empty() )
     return NULL;
-  auto end = m_addresses + m_asize;
-  one_addr *found = std::lower_bound(m_addresses, end, start, [](const one_addr &l, a64 off) -> 
-      bool { return l.addr < off; }
-  );
-  if ( found == end )
+  size_t found = lower_idx(start);
+  if ( found == m_akeys.size() )
     return NULL;
-  if ( found->addr < start )
-    found++;
-  // calc count  
-  for ( one_addr *curr = found; curr < end; curr++ )
-   if ( curr->addr >= end_a )
-   {
-     end = curr;
-     break;
-   }
-  *count = end - found;
-  if ( !*count )
+  size_t end = lower_idx(end_a);
+  if ( end <= found )
     return NULL;
+  *count = end - found;
   // alloc mem
   auto res = (addr_sym *)malloc(sizeof(addr_sym) * *count);
   if ( NULL == res )
     return res;
-  std::transform(found, end, res, [](one_addr &c) -> addr_sym { return { c.sym->name.c_str(), c.addr}; });
+  for ( size_t i = 0; found < end; found++, i++ )
+    res[i] = { get_name(m_anames[found]), m_akeys[found] };
   return res;
 }
 
 struct addr_sym *ksym_holder::start_with(const char *prefix, a64 start_addr, a64 end_addr, size_t *count)
 {
   *count = 0;
-  if ( NULL == m_addresses )
+  if ( m_akeys.empty() )
     return NULL;
   auto plen = strlen(prefix);
-  auto from = m_addresses;
-  auto end = m_addresses + m_asize;
+  size_t from = 0;
+  size_t end = m_akeys.size();
   if ( start_addr )
   {
-    from = std::lower_bound(m_addresses, end, start_addr, [](const one_addr &l, a64 off) -> 
-      bool { return l.addr < off; }
-    );
+    from = lower_idx(start_addr);
     if ( from == end )
       return NULL;
-    if ( from->addr < start_addr )
-      from++;
   }
-  std::vector<const one_addr *> tmp;
+  std::vector<size_t> tmp;
   for ( ; from < end; from++ )
   {
-    if ( end_addr && from->addr > end_addr )
+    if ( end_addr && m_akeys[from] > end_addr )
       break;
-    if ( strncmp(from->sym->name.c_str(), prefix, plen) )
+    if ( strncmp(get_name(m_anames[from]), prefix, plen) )
       continue;
     tmp.push_back(from);
   }
@@ -220,67 +385,290 @@ struct addr_sym *ksym_holder::start_with(const char *prefix, a64 start_addr, a64
   auto res = (addr_sym *)malloc(sizeof(addr_sym) * *count);
   if ( NULL == res )
     return res;
-  std::transform(tmp.begin(), tmp.end(), res, [](const one_addr *c) -> addr_sym { return { c->sym->name.c_str(), c->addr}; });
+  std::transform(tmp.begin(), tmp.end(), res, [this](size_t c) -> addr_sym { return { get_name(m_anames[c]), m_akeys[c]}; });
   return res;
 }
 
+// in-order walk of implicit tree assigns sorted keys to BFS positions
+size_t ksym_holder::fill_eytz(size_t i, size_t k)
+{
+  if ( k <= m_akeys.size() )
+  {
+    i = fill_eytz(i, 2 * k);
+    m_eytz[k] = m_akeys[i];
+    m_epos[k] = (unsigned int)i;
+    i = fill_eytz(i + 1, 2 * k + 1);
+  }
+  return i;
+}
+
+void ksym_holder::make_eytz()
+{
+  m_eytz.resize(m_akeys.size() + 1);
+  m_epos.resize(m_akeys.size() + 1);
+  fill_eytz(0, 1);
+}
+
 void ksym_holder::make_addresses()
 {
-  auto count = m_syms.size();
-  if ( !count )
+  m_gen++;
+  m_akeys.clear();
+  m_anames.clear();
+  m_names.clear();
+  if ( m_syms.empty() )
     return;
-  m_addresses = new one_addr[count];
-  std::set<a64> inserted;
+  // addresses - stable sort to keep first symbol for each address like before
+  std::vector<one_addr> addresses;
+  addresses.reserve(m_syms.size());
   for ( auto &c: m_syms )
+    addresses.push_back({ c.addr, c.name });
+  std::stable_sort(addresses.begin(), addresses.end(), [](const one_addr &l, const one_addr &r) -> bool { return l.addr < r.addr; });
+  auto aend = std::unique(addresses.begin(), addresses.end(), [](const one_addr &l, const one_addr &r) -> bool { return l.addr == r.addr; });
+  m_akeys.reserve(aend - addresses.begin());
+  m_anames.reserve(aend - addresses.begin());
+  for ( auto c = addresses.begin(); c != aend; ++c )
   {
-    auto was = inserted.find(c.addr);
-    if ( was != inserted.end() )
-      continue;
-    m_addresses[m_asize].addr = c.addr;
-    m_addresses[m_asize].sym = &c;
-    m_asize++;
-    inserted.insert(c.addr);
+    m_akeys.push_back(c->addr);
+    m_anames.push_back(c->name);
+  }
+  make_eytz();
+  // names - the same for names
+  m_names.resize(m_syms.size());
+  for ( unsigned int i = 0; i < m_syms.size(); i++ )
+    m_names[i] = i;
+  std::stable_sort(m_names.begin(), m_names.end(), [this](unsigned int l, unsigned int r) -> 
+    bool { return strcmp(get_name(m_syms[l].name), get_name(m_syms[r].name)) < 0; }
+  );
+  auto nend = std::unique(m_names.begin(), m_names.end(), [this](unsigned int l, unsigned int r) -> 
+    bool { return !strcmp(get_name(m_syms[l].name), get_name(m_syms[r].name)); }
+  );
+  m_names.erase(nend, m_names.end());
+}
+
+// format of each line: hex_address letter name [\t[module]]
+void ksym_holder::parse_map(const char *s, const char *end)
+{
+  // rough estimation - each line is about 40 bytes
+  m_syms.reserve(m_syms.size() + (end - s) / 40);
+  m_arena.reserve(m_arena.size() + (end - s) / 2);
+  while ( s < end )
+  {
+    const char *eol = (const char *)memchr(s, '\n', end - s);
+    if ( eol == NULL )
+      eol = end;
+    one_sym tmp;
+    tmp.addr = 0;
+    const char *next = s;
+    for ( ; next < eol; next++ )
+    {
+      int d;
+      if ( *next >= '0' && *next <= '9' )
+        d = *next - '0';
+      else if ( *next >= 'a' && *next <= 'f' )
+        d = *next - 'a' + 10;
+      else if ( *next >= 'A' && *next <= 'F' )
+        d = *next - 'A' + 10;
+      else
+        break;
+      tmp.addr = (tmp.addr << 4) | d;
+    }
+    // skip space, letter and one more space
+    if ( eol - next > 3 )
+    {
+      tmp.letter = next[1];
+      next += 3;
+      tmp.name = add_name(next, eol - next);
+      m_syms.push_back(tmp);
+    }
+    s = eol + 1;
   }
-  if ( !m_asize )
+}
+
+// any mismatch means the cache is stale or damaged - caller parses System.map then
+int ksym_holder::read_cache(const char *name, const struct stat *st)
+{
+  std::string cname = cache_name(name, 0);
+  if ( cname.empty() )
+    return 0;
+  int fd = open(cname.c_str(), O_RDONLY);
+  if ( -1 == fd )
+    return 0;
+  int res = 0;
+  struct stat cst;
+  if ( !fstat(fd, &cst) && cst.st_size >= (off_t)sizeof(ksym_cache_hdr) )
+  {
+    void *map = mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( map != MAP_FAILED )
+    {
+      const ksym_cache_hdr *hdr = (const ksym_cache_hdr *)map;
+      size_t rest = cst.st_size - sizeof(ksym_cache_hdr);
+      // check each count against what is left so the sum cannot overflow
+      int ok = !memcmp(hdr->magic, s_cache_magic, sizeof(s_cache_magic)) &&
+               hdr->version == s_cache_version &&
+               hdr->src_size == (unsigned long)st->st_size &&
+               hdr->src_mtime == (long)st->st_mtim.tv_sec &&
+               hdr->src_mtime_ns == (long)st->st_mtim.tv_nsec &&
+               hdr->src_ino == (unsigned long)st->st_ino &&
+               hdr->syms <= rest / sizeof(one_sym);
+      if ( ok )
+      {
+        rest -= hdr->syms * sizeof(one_sym);
+        ok = hdr->names <= rest / sizeof(unsigned int);
+      }
+      if ( ok )
+      {
+        rest -= hdr->names * sizeof(unsigned int);
+        ok = hdr->addrs <= rest / (sizeof(a64) + sizeof(unsigned int));
+      }
+      if ( ok )
+      {
+        rest -= hdr->addrs * (sizeof(a64) + sizeof(unsigned int));
+        ok = hdr->arena == rest && (!rest || !((const char *)map)[cst.st_size - 1]) &&
+             hdr->arena <= 0xffffffffUL &&
+             hdr->sum == cache_sum((const char *)(hdr + 1), cst.st_size - sizeof(ksym_cache_hdr));
+      }
+      const one_sym *syms = (const one_sym *)(hdr + 1);
+      const unsigned int *names = (const unsigned int *)(syms + (ok ? hdr->syms : 0));
+      const a64 *addrs = (const a64 *)(names + (ok ? hdr->names : 0));
+      const unsigned int *anames = (const unsigned int *)(addrs + (ok ? hdr->addrs : 0));
+      const char *arena = (const char *)(anames + (ok ? hdr->addrs : 0));
+      // checksum says file is what we wrote, but offsets are used without checks later
+      for ( size_t i = 0; ok && i < hdr->syms; i++ )
+        ok = syms[i].name < hdr->arena;
+      for ( size_t i = 0; ok && i < hdr->names; i++ )
+        ok = names[i] < hdr->syms;
+      for ( size_t i = 0; ok && i < hdr->addrs; i++ )
+        ok = anames[i] < hdr->arena && (!i || addrs[i - 1] < addrs[i]);
+      if ( ok )
+      {
+        // addresses are replaced - invalidate lookup caches like make_addresses
+        m_gen++;
+        m_syms.assign(syms, syms + hdr->syms);
+        m_names.assign(names, names + hdr->names);
+        m_akeys.assign(addrs, addrs + hdr->addrs);
+        m_anames.assign(anames, anames + hdr->addrs);
+        m_arena.assign(arena, arena + hdr->arena);
+        make_eytz();
+        res = 1;
+      }
+      munmap(map, cst.st_size);
+    }
+  }
+  close(fd);
+  return res;
+}
+
+// cache is optional - silently ignore all errors
+void ksym_holder::write_cache(const char *name, const struct stat *st) const
+{
+  std::string cname = cache_name(name, 1);
+  if ( cname.empty() )
+    return;
+  ksym_cache_hdr hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, s_cache_magic, sizeof(s_cache_magic));
+  hdr.version = s_cache_version;
+  hdr.src_size = st->st_size;
+  hdr.src_mtime = st->st_mtim.tv_sec;
+  hdr.src_mtime_ns = st->st_mtim.tv_nsec;
+  hdr.src_ino = st->st_ino;
+  hdr.syms = m_syms.size();
+  hdr.names = m_names.size();
+  hdr.addrs = m_akeys.size();
+  hdr.arena = m_arena.size();
+  // checksum needs contiguous body
+  std::vector<char> body;
+  body.reserve(hdr.syms * sizeof(one_sym) + hdr.names * sizeof(unsigned int) +
+    hdr.addrs * (sizeof(a64) + sizeof(unsigned int)) + hdr.arena);
+  auto put = [&body](const void *p, size_t size) {
+    body.insert(body.end(), (const char *)p, (const char *)p + size);
+  };
+  put(m_syms.data(), hdr.syms * sizeof(one_sym));
+  put(m_names.data(), hdr.names * sizeof(unsigned int));
+  put(m_akeys.data(), hdr.addrs * sizeof(a64));
+  put(m_anames.data(), hdr.addrs * sizeof(unsigned int));
+  put(m_arena.data(), hdr.arena);
+  hdr.sum = cache_sum(body.data(), body.size());
+  std::string tname = cname + ".tmp";
+  FILE *f = fopen(tname.c_str(), "wb");
+  if ( NULL == f )
     return;
-  // sort them
-  std::sort(m_addresses, m_addresses + m_asize, [](const one_addr &l, const one_addr &r) -> bool { return l.addr < r.addr; });
+  int ok = 1 == fwrite(&hdr, sizeof(hdr), 1, f) &&
+           body.size() == fwrite(body.data(), 1, body.size(), f);
+  if ( fclose(f) )
+    ok = 0;
+  if ( !ok || rename(tname.c_str(), cname.c_str()) )
+    unlink(tname.c_str());
 }
 
 int ksym_holder::read_ksyms(const char *name)
 {
-  std::ifstream f;
-  f.open(name);
-  if ( !f.is_open() )
+  int fd = open(name, O_RDONLY);
+  if ( -1 == fd )
     return errno;
-  std::string line;
-  while( std::getline(f, line) )
+  struct stat st;
+  if ( fstat(fd, &st) )
   {
-     one_sym tmp;
-     const char *s = line.c_str();
-     char *next;
-#ifdef _MSC_VER
-     tmp.addr = _strtoui64(s, &next, 16);
-#else
-     tmp.addr = strtoul(s, &next, 16);
-#endif /* _MSC_VER */
-     next++;
-     tmp.letter = *next;
-     next += 2;
-     tmp.name = next;
-     m_syms.push_back(tmp);
-     auto was = m_names.find(next);
-     if ( was != m_names.end() )
-       continue;
-     auto &back = m_syms.back();
-     m_names[back.name.c_str()] = &back;
+    int err = errno;
+    close(fd);
+    return err;
   }
+  // procfs files like /proc/kallsyms have zero size and cannot be mapped
+  if ( !st.st_size || !S_ISREG(st.st_mode) )
+  {
+    std::string content;
+    char buf[0x10000];
+    ssize_t readed;
+    while ( (readed = read(fd, buf, sizeof(buf))) > 0 )
+      content.append(buf, readed);
+    close(fd);
+    parse_map(content.data(), content.data() + content.size());
+    make_addresses();
+    return 0;
+  }
+  if ( m_syms.empty() && read_cache(name, &st) )
+  {
+    close(fd);
+    return 0;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if ( map == MAP_FAILED )
+  {
+    int err = errno;
+    close(fd);
+    return err;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  const char *s = (const char *)map;
+  int from_scratch = m_syms.empty();
+  parse_map(s, s + st.st_size);
+  munmap(map, st.st_size);
+  close(fd);
   if ( m_syms.empty() )
     return 0;
   make_addresses();
+  if ( from_scratch )
+    write_cache(name, &st);
   return 0;
 }
 
+#if defined(HAS_ELFIO) || defined(HAS_ELF_VIEW)
+// letter - see https://sourceware.org/binutils/docs/binutils/nm.html
+static char sym_letter(unsigned int sh_type, unsigned long sh_flags, unsigned char bind)
+{
+  // check if symbol in .bss
+  if ( sh_type & SHT_NOBITS )
+    return bind == STB_GLOBAL ? 'B' : 'b';
+  // symbol in executable section?
+  if ( sh_flags & SHF_EXECINSTR )
+    return bind == STB_GLOBAL ? 'T' : 't';
+  // symbol in writable section?
+  if ( sh_flags & SHF_WRITE )
+    return bind == STB_GLOBAL ? 'D' : 'd';
+  return bind == STB_GLOBAL ? 'R' : 'r';
+}
+#endif
+
 #ifdef HAS_ELFIO
 
 using namespace ELFIO;
@@ -308,51 +696,50 @@ int ksym_holder::read_syms(const elfio& reader, symbol_section_accessor &symbols
     if (name.at(0) == '$')
       continue;
     tmp.addr = value;
-    tmp.name = name;
-    // letter - see https://sourceware.org/binutils/docs/binutils/nm.html
     section* sec = reader.sections[section_idx];
     if (NULL == sec)
       continue;
     if (type == STT_FILE || type == STT_SECTION )
       continue;
-    if (name.empty())
-      continue;
-    // check if symbol in .bss
-    if ( sec->get_type() & SHT_NOBITS )
-    {
-      if ( bind == STB_GLOBAL )
-        tmp.letter = 'B';
-      else
-        tmp.letter = 'b';
-    } else {
-      auto sflags = sec->get_flags();
-      // symbol in executable section?
-      if ( sflags & SHF_EXECINSTR )
-      {
-        if ( bind == STB_GLOBAL )
-          tmp.letter = 'T';
-        else
-          tmp.letter = 't';
-        // symbol in writable section?
-      } else if ( sflags & SHF_WRITE )
-      {
-        if ( bind == STB_GLOBAL )
-          tmp.letter = 'D';
-        else
-          tmp.letter = 'd';
-      } else {
-        if ( bind == STB_GLOBAL )
-          tmp.letter = 'R';
-        else
-          tmp.letter = 'r';
-      }
-    }
+    tmp.letter = sym_letter(sec->get_type(), sec->get_flags(), bind);
+    tmp.name = add_name(name.c_str(), name.size());
     m_syms.push_back(tmp);
-    auto was = m_names.find(name.c_str());
-    if ( was != m_names.end() )
+  }
+  if ( m_syms.empty() )
+    return 0;
+  make_addresses();
+  return 0;
+}
+#elif defined(HAS_ELF_VIEW)
+int ksym_holder::read_syms(const elf_view& reader, elf_symbols &symbols)
+{
+  Elf64_Xword sym_no = symbols.get_symbols_num();
+  if ( !sym_no )
+    return 1;
+  m_syms.reserve(m_syms.size() + sym_no);
+  for ( Elf64_Xword i = 0; i < sym_no; ++i ) 
+  {
+    const char   *name    = NULL;
+    Elf64_Addr    value   = 0;
+    Elf64_Xword   size    = 0;
+    unsigned char bind    = 0;
+    unsigned char type    = 0;
+    Elf64_Half    section_idx = 0;
+    unsigned char other   = 0;
+    symbols.get_symbol( i, name, value, size, bind, type, section_idx, other );
+    // skip all empty names and started with $
+    if ( !*name || *name == '$' )
       continue;
-    auto &back = m_syms.back();
-    m_names[back.name.c_str()] = &back;
+    if (type == STT_FILE || type == STT_SECTION )
+      continue;
+    const elf_section* sec = reader.sections[section_idx];
+    if (NULL == sec)
+      continue;
+    one_sym tmp;
+    tmp.addr = value;
+    tmp.letter = sym_letter(sec->get_type(), sec->get_flags(), bind);
+    tmp.name = add_name(name, strlen(name));
+    m_syms.push_back(tmp);
   }
   if ( m_syms.empty() )
     return 0;
@@ -392,6 +779,13 @@ a64 get_addr(const char *name)
   return s_ksyms.get_addr(name);
 }
 
+void get_ksyms_stat(struct ksyms_stat *res)
+{
+  res->lookups = s_stat.lookups.load(std::memory_order_relaxed);
+  res->hits = s_stat.hits.load(std::memory_order_relaxed);
+  res->name_lookups = s_stat.name_lookups.load(std::memory_order_relaxed);
+}
+
 const char *name_by_addr(a64 addr)
 {
   return s_ksyms.name_by_addr(addr);
@@ -407,6 +801,11 @@ const char *lower_name_by_addr_with_off(a64 addr, size_t *off)
   return s_ksyms.lower_name_by_addr_with_off(addr, off);
 }
 
+size_t lower_names_by_addrs(const a64 *addrs, size_t count, const char **names, size_t *offs)
+{
+  return s_ksyms.lower_names_by_addrs(addrs, count, names, offs);
+}
+
 struct addr_sym *get_in_range(a64 start, a64 end, size_t *count)
 {
   return s_ksyms.get_in_range(start, end, count);
@@ -422,4 +821,9 @@ int read_syms(const ELFIO::elfio& reader, ELFIO::symbol_section_accessor &ssa)
 {
   return s_ksyms.read_syms(reader, ssa);
 }
+#elif defined(HAS_ELF_VIEW)
+int read_syms(const elf_view& reader, elf_symbols &ssa)
+{
+  return s_ksyms.read_syms(reader, ssa);
+}
 #endif /* HAS_ELFIO */
@@ -13,6 +13,19 @@ struct one_bpf_proto
   struct addr_sym func;
 };
 
+// counters of symbol lookups, only single address lookups go through cache
+struct ksyms_stat
+{
+  size_t lookups;
+  size_t hits;
+  size_t name_lookups;
+};
+
+#ifdef HAS_ELF_VIEW
+class elf_view;
+class elf_symbols;
+#endif /* HAS_ELF_VIEW */
+
 // plain C interface to /proc/kallsyms
 #ifdef __cplusplus
 size_t fill_bpf_protos(std::list<one_bpf_proto> &out_res);
@@ -24,13 +37,18 @@ int read_system_map();
 int read_ksyms(const char *name);
 #ifdef HAS_ELFIO
 int read_syms(const ELFIO::elfio& reader, ELFIO::symbol_section_accessor &);
+#elif defined(HAS_ELF_VIEW)
+int read_syms(const elf_view& reader, elf_symbols &);
 #endif /* HAS_ELFIO */
 const char *name_by_addr(a64);
 const char *lower_name_by_addr(a64);
 const char *lower_name_by_addr_with_off(a64, size_t *);
+// batch version of lower_name_by_addr_with_off for sorted addresses, offs can be NULL
+size_t lower_names_by_addrs(const a64 *addrs, size_t count, const char **names, size_t *offs);
 a64 get_addr(const char *);
 struct addr_sym *get_in_range(a64 start, a64 end, size_t *count);
 struct addr_sym *start_with(const char *prefix, a64 start, a64 end, size_t *count);
+void get_ksyms_stat(struct ksyms_stat *);
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,115 @@
+// benchmark of address->symbol lookups
+// usage: ksyms_bench System.map [number of lookups]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <list>
+#include <vector>
+#include <algorithm>
+#include "ksyms.h"
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// previous implementation - std::lower_bound over array of (address, name)
+static const char *old_lower_name(const addr_sym *syms, size_t cnt, a64 addr, size_t *off)
+{
+  const addr_sym *found = std::lower_bound(syms, syms + cnt, addr, [](const addr_sym &l, a64 off) -> 
+      bool { return l.addr < off; }
+  );
+  if ( found == syms + cnt )
+    return NULL;
+  if ( found->addr == addr )
+  {
+    *off = 0;
+    return found->name;
+  }
+  if ( found == syms )
+    return NULL;
+  found--;
+  *off = addr - found->addr;
+  return found->name;
+}
+
+int main(int argc, char **argv)
+{
+  if ( argc < 2 )
+  {
+    printf("Usage: %s System.map [count]\n", argv[0]);
+    return 6;
+  }
+  size_t count = 1000000;
+  if ( argc > 2 )
+    count = atol(argv[2]);
+  double t = now();
+  int err = read_ksyms(argv[1]);
+  if ( err )
+  {
+    printf("cannot read %s, error %d\n", argv[1], err);
+    return err;
+  }
+  printf("load: %f\n", now() - t);
+  size_t scnt = 0;
+  addr_sym *syms = get_in_range(0, (a64)-1, &scnt);
+  if ( syms == NULL )
+  {
+    printf("no symbols\n");
+    return 1;
+  }
+  printf("symbols: %ld\n", scnt);
+  // fixed seed for repeatable runs
+  srand(0x1234);
+  a64 first = syms[0].addr;
+  a64 span = syms[scnt - 1].addr - first;
+  std::vector<a64> addrs(count);
+  for ( auto &c: addrs )
+    c = first + (((a64)rand() << 31) ^ rand()) % (span + 1);
+  std::vector<const char *> names(count);
+  std::vector<size_t> offs(count);
+  // old
+  size_t sum = 0;
+  t = now();
+  for ( size_t i = 0; i < count; i++ )
+  {
+    size_t off = 0;
+    if ( old_lower_name(syms, scnt, addrs[i], &off) )
+      sum += off;
+  }
+  printf("lower_bound: %f (%lX)\n", now() - t, sum);
+  // new
+  sum = 0;
+  t = now();
+  for ( size_t i = 0; i < count; i++ )
+  {
+    size_t off = 0;
+    if ( lower_name_by_addr_with_off(addrs[i], &off) )
+      sum += off;
+  }
+  printf("eytzinger: %f (%lX)\n", now() - t, sum);
+  // batch
+  std::sort(addrs.begin(), addrs.end());
+  sum = 0;
+  t = now();
+  lower_names_by_addrs(addrs.data(), count, names.data(), offs.data());
+  for ( size_t i = 0; i < count; i++ )
+    sum += offs[i];
+  printf("batch sorted: %f (%lX)\n", now() - t, sum);
+  // check
+  for ( size_t i = 0; i < count; i++ )
+  {
+    size_t off = 0;
+    const char *name = old_lower_name(syms, scnt, addrs[i], &off);
+    if ( name != names[i] || (name && off != offs[i]) )
+    {
+      printf("mismatch at %p: %s vs %s\n", (void *)addrs[i], name, names[i]);
+      return 1;
+    }
+  }
+  free(syms);
+  return 0;
+}
@@ -43,6 +43,12 @@ int read_kernel_area(int fd)
   return 0;
 }
 
+void set_kernel_area(unsigned long start, unsigned long end)
+{
+  g_kstart = start;
+  g_kend = end;
+}
+
 const char hexes[] = "0123456789ABCDEF";
 
 void HexDump(unsigned char *From, int Len)
@@ -32,6 +32,8 @@ union kernfs_params
 
 int is_inside_kernel(unsigned long a);
 int read_kernel_area(int fd);
+// when there is no driver
+void set_kernel_area(unsigned long start, unsigned long end);
 void HexDump(unsigned char *From, int Len);
 
 #ifdef __cplusplus